@@ -0,0 +1,284 @@
+#ifndef MAIN_ADVERTISEMENTENCODER_HPP_
+#define MAIN_ADVERTISEMENTENCODER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADVERTISEMENT_LENGTH_MAX (31)
+
+namespace Esp32
+{
+
+/*
+ * Encoded AD structures (length, type, value) of an advertisement or scan response. The size is part of the type, so
+ * payloads built by AdvertisementEncoder are complete at compile time and an overflow is a static_assert. Concatenate
+ * structures with operator+, declare the result static constexpr to keep it in flash.
+ */
+template<size_t N>
+struct AdvertisementPayload
+{
+    static constexpr size_t length = N;
+
+    uint8_t data[N];
+
+    template<size_t M>
+    constexpr AdvertisementPayload<N + M> operator+(const AdvertisementPayload<M>& other) const;
+};
+
+/*
+ * Compile time encoder for the AD types of the Core Specification Supplement, e.g.
+ *
+ *   static constexpr auto advertisement =
+ *       AdvertisementEncoder::flags(0x06)
+ *       + AdvertisementEncoder::completeName("Sensor")
+ *       + AdvertisementEncoder::manufacturerData(0x02e5, {0x01, 0x02});
+ *
+ * Fields which are only known at runtime are written by AdvertisementWriter instead.
+ */
+struct AdvertisementEncoder
+{
+    static constexpr uint8_t typeFlags = 0x01;
+    static constexpr uint8_t typeIncompleteUuids16 = 0x02;
+    static constexpr uint8_t typeCompleteUuids16 = 0x03;
+    static constexpr uint8_t typeIncompleteUuids32 = 0x04;
+    static constexpr uint8_t typeCompleteUuids32 = 0x05;
+    static constexpr uint8_t typeIncompleteUuids128 = 0x06;
+    static constexpr uint8_t typeCompleteUuids128 = 0x07;
+    static constexpr uint8_t typeShortenedName = 0x08;
+    static constexpr uint8_t typeCompleteName = 0x09;
+    static constexpr uint8_t typeTxPower = 0x0a;
+    static constexpr uint8_t typeConnectionIntervalRange = 0x12;
+    static constexpr uint8_t typeServiceData16 = 0x16;
+    static constexpr uint8_t typeAppearance = 0x19;
+    static constexpr uint8_t typeServiceData32 = 0x20;
+    static constexpr uint8_t typeServiceData128 = 0x21;
+    static constexpr uint8_t typeManufacturerData = 0xff;
+
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 2> structure(uint8_t type, const uint8_t (&value)[N]);
+
+    static constexpr AdvertisementPayload<3> flags(uint8_t flags);
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 1> completeName(const char (&name)[N]);
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 1> shortenedName(const char (&name)[N]);
+    static constexpr AdvertisementPayload<3> txPower(int8_t dBm);
+    static constexpr AdvertisementPayload<4> appearance(uint16_t appearance);
+    static constexpr AdvertisementPayload<6> connectionIntervalRange(uint16_t minimum, uint16_t maximum);
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 4> manufacturerData(uint16_t companyId, const uint8_t (&data)[N]);
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 4> serviceData16(uint16_t uuid, const uint8_t (&data)[N]);
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 6> serviceData32(uint32_t uuid, const uint8_t (&data)[N]);
+    template<size_t N>
+    static constexpr AdvertisementPayload<N + 18> serviceData128(const uint8_t (&uuid)[16], const uint8_t (&data)[N]);
+    template<size_t N>
+    static constexpr AdvertisementPayload<2 * N + 2> uuids16(const uint16_t (&uuids)[N], bool complete = true);
+    template<size_t N>
+    static constexpr AdvertisementPayload<4 * N + 2> uuids32(const uint32_t (&uuids)[N], bool complete = true);
+    template<size_t N>
+    static constexpr AdvertisementPayload<16 * N + 2> uuids128(const uint8_t (&uuids)[N][16], bool complete = true);
+
+    template<size_t N>
+    static constexpr AdvertisementPayload<N> header(uint8_t type);
+    template<size_t N>
+    static constexpr void putLittleEndian(AdvertisementPayload<N>& payload, size_t offset, uint32_t value, size_t size);
+};
+
+template<size_t N>
+template<size_t M>
+constexpr AdvertisementPayload<N + M> AdvertisementPayload<N>::operator+(const AdvertisementPayload<M>& other) const
+{
+    static_assert(N + M <= ADVERTISEMENT_LENGTH_MAX, "advertisement too long");
+
+    AdvertisementPayload<N + M> result = {};
+    for (size_t i = 0; i < N; ++i)
+    {
+        result.data[i] = data[i];
+    }
+    for (size_t i = 0; i < M; ++i)
+    {
+        result.data[N + i] = other.data[i];
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N> AdvertisementEncoder::header(uint8_t type)
+{
+    static_assert(N >= 2 && N <= ADVERTISEMENT_LENGTH_MAX, "AD structure does not fit into an advertisement");
+
+    AdvertisementPayload<N> result = {};
+    result.data[0] = N - 1;
+    result.data[1] = type;
+    return result;
+}
+
+template<size_t N>
+constexpr void AdvertisementEncoder::putLittleEndian(
+    AdvertisementPayload<N>& payload,
+    size_t offset,
+    uint32_t value,
+    size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        payload.data[offset + i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 2> AdvertisementEncoder::structure(uint8_t type, const uint8_t (&value)[N])
+{
+    auto result = header<N + 2>(type);
+    for (size_t i = 0; i < N; ++i)
+    {
+        result.data[2 + i] = value[i];
+    }
+    return result;
+}
+
+constexpr AdvertisementPayload<3> AdvertisementEncoder::flags(uint8_t flags)
+{
+    return structure(typeFlags, {flags});
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 1> AdvertisementEncoder::completeName(const char (&name)[N])
+{
+    // the terminating zero is not transmitted
+    auto result = header<N + 1>(typeCompleteName);
+    for (size_t i = 0; i + 1 < N; ++i)
+    {
+        result.data[2 + i] = name[i];
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 1> AdvertisementEncoder::shortenedName(const char (&name)[N])
+{
+    auto result = completeName(name);
+    result.data[1] = typeShortenedName;
+    return result;
+}
+
+constexpr AdvertisementPayload<3> AdvertisementEncoder::txPower(int8_t dBm)
+{
+    return structure(typeTxPower, {(uint8_t) dBm});
+}
+
+constexpr AdvertisementPayload<4> AdvertisementEncoder::appearance(uint16_t appearance)
+{
+    auto result = header<4>(typeAppearance);
+    putLittleEndian(result, 2, appearance, 2);
+    return result;
+}
+
+constexpr AdvertisementPayload<6> AdvertisementEncoder::connectionIntervalRange(uint16_t minimum, uint16_t maximum)
+{
+    // both in units of 1.25 ms
+    auto result = header<6>(typeConnectionIntervalRange);
+    putLittleEndian(result, 2, minimum, 2);
+    putLittleEndian(result, 4, maximum, 2);
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 4> AdvertisementEncoder::manufacturerData(
+    uint16_t companyId,
+    const uint8_t (&data)[N])
+{
+    auto result = header<N + 4>(typeManufacturerData);
+    putLittleEndian(result, 2, companyId, 2);
+    for (size_t i = 0; i < N; ++i)
+    {
+        result.data[4 + i] = data[i];
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 4> AdvertisementEncoder::serviceData16(uint16_t uuid, const uint8_t (&data)[N])
+{
+    auto result = header<N + 4>(typeServiceData16);
+    putLittleEndian(result, 2, uuid, 2);
+    for (size_t i = 0; i < N; ++i)
+    {
+        result.data[4 + i] = data[i];
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 6> AdvertisementEncoder::serviceData32(uint32_t uuid, const uint8_t (&data)[N])
+{
+    auto result = header<N + 6>(typeServiceData32);
+    putLittleEndian(result, 2, uuid, 4);
+    for (size_t i = 0; i < N; ++i)
+    {
+        result.data[6 + i] = data[i];
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<N + 18> AdvertisementEncoder::serviceData128(
+    const uint8_t (&uuid)[16],
+    const uint8_t (&data)[N])
+{
+    // the UUID is expected in little endian byte order, as used by the Bluetooth stack
+    auto result = header<N + 18>(typeServiceData128);
+    for (size_t i = 0; i < 16; ++i)
+    {
+        result.data[2 + i] = uuid[i];
+    }
+    for (size_t i = 0; i < N; ++i)
+    {
+        result.data[18 + i] = data[i];
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<2 * N + 2> AdvertisementEncoder::uuids16(const uint16_t (&uuids)[N], bool complete)
+{
+    auto result = header<2 * N + 2>(complete ? typeCompleteUuids16 : typeIncompleteUuids16);
+    for (size_t i = 0; i < N; ++i)
+    {
+        putLittleEndian(result, 2 + 2 * i, uuids[i], 2);
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<4 * N + 2> AdvertisementEncoder::uuids32(const uint32_t (&uuids)[N], bool complete)
+{
+    auto result = header<4 * N + 2>(complete ? typeCompleteUuids32 : typeIncompleteUuids32);
+    for (size_t i = 0; i < N; ++i)
+    {
+        putLittleEndian(result, 2 + 4 * i, uuids[i], 4);
+    }
+    return result;
+}
+
+template<size_t N>
+constexpr AdvertisementPayload<16 * N + 2> AdvertisementEncoder::uuids128(
+    const uint8_t (&uuids)[N][16],
+    bool complete)
+{
+    auto result = header<16 * N + 2>(complete ? typeCompleteUuids128 : typeIncompleteUuids128);
+    for (size_t i = 0; i < N; ++i)
+    {
+        for (size_t j = 0; j < 16; ++j)
+        {
+            result.data[2 + 16 * i + j] = uuids[i][j];
+        }
+    }
+    return result;
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_ADVERTISEMENTENCODER_HPP_ */
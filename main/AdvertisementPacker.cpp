@@ -0,0 +1,329 @@
+#include <string.h>
+#include <esp_log.h>
+#include <stdexcept>
+#include "AdvertisementPacker.hpp"
+
+#define LOG_TAG "AdvertisementPacker"
+
+namespace Esp32
+{
+
+AdvertisementPacker::AdvertisementPacker():
+    m_elements(),
+    m_numberOfElements(0),
+    m_pool(),
+    m_poolUsed(0),
+    m_flagsIndex(-1),
+    m_nameIndex(-1),
+    m_shortNameOffset(0),
+    m_shortNameLength(0),
+    m_nameShortened(false)
+{
+}
+
+AdvertisementPacker::~AdvertisementPacker()
+{
+}
+
+void AdvertisementPacker::setFlags(uint8_t flags)
+{
+    if (m_flagsIndex >= 0)
+    {
+        m_pool[m_elements[m_flagsIndex].offset] = flags;
+        return;
+    }
+
+    add(AdvertisementEncoder::typeFlags, &flags, sizeof(flags), UINT8_MAX);
+    m_flagsIndex = m_numberOfElements - 1;
+}
+
+void AdvertisementPacker::add(uint8_t type, const void* value, size_t length, uint8_t priority)
+{
+    if (!value && length)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    memcpy(reserve(type, length, priority), value, length);
+}
+
+void AdvertisementPacker::addStructures(const uint8_t* structures, size_t length, uint8_t priority)
+{
+    if (!structures)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    size_t offset = 0;
+    while (offset < length)
+    {
+        auto structureLength = structures[offset];
+        if (!structureLength || offset + 1 + structureLength > length)
+        {
+            throw std::invalid_argument("malformed AD structure");
+        }
+
+        auto type = structures[offset + 1];
+        if (type == AdvertisementEncoder::typeFlags && structureLength == 2)
+        {
+            setFlags(structures[offset + 2]);
+        }
+        else
+        {
+            add(type, structures + offset + 2, structureLength - 1, priority);
+        }
+        offset += 1 + structureLength;
+    }
+}
+
+void AdvertisementPacker::addName(const char* name, const char* shortName, uint8_t priority)
+{
+    if (!name)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (m_nameIndex >= 0)
+    {
+        throw std::runtime_error("device name was already added");
+    }
+
+    if (shortName)
+    {
+        auto shortNameLength = strlen(shortName);
+        if (shortNameLength > ADVERTISEMENT_LENGTH_MAX - 2)
+        {
+            throw std::invalid_argument("short device name too long");
+        }
+        m_shortNameOffset = allocate(shortNameLength) - m_pool;
+        m_shortNameLength = shortNameLength;
+        memcpy(m_pool + m_shortNameOffset, shortName, shortNameLength);
+    }
+
+    add(AdvertisementEncoder::typeCompleteName, name, strlen(name), priority);
+    m_nameIndex = m_numberOfElements - 1;
+}
+
+uint8_t* AdvertisementPacker::reserve(uint8_t type, size_t length, uint8_t priority)
+{
+    if (m_numberOfElements >= ADVERTISEMENT_PACKER_ELEMENTS_MAX)
+    {
+        throw std::runtime_error("too many AD elements");
+    }
+
+    // an element which does not fit into an empty data set could never be placed
+    if (length > ADVERTISEMENT_LENGTH_MAX - 2)
+    {
+        throw std::invalid_argument("AD element too long");
+    }
+
+    auto value = allocate(length);
+
+    auto& element = m_elements[m_numberOfElements++];
+    element.offset = value - m_pool;
+    element.length = length;
+    element.type = type;
+    element.priority = priority;
+    element.placement = Placement::NONE;
+
+    return value;
+}
+
+size_t AdvertisementPacker::pack(AdvertisementWriter* advertisement, AdvertisementWriter* scanResponse)
+{
+    if (!advertisement || !scanResponse)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    for (size_t i = 0; i < m_numberOfElements; ++i)
+    {
+        m_elements[i].placement = Placement::NONE;
+    }
+    m_nameShortened = false;
+
+    size_t dropped = 0;
+    while (auto element = nextElement())
+    {
+        if (m_nameIndex >= 0 && element == &m_elements[m_nameIndex])
+        {
+            placeName(element, advertisement, scanResponse);
+        }
+        else
+        {
+            placeElement(element, advertisement, scanResponse);
+        }
+
+        if (element->placement == Placement::DROPPED)
+        {
+            ESP_LOGW(
+                LOG_TAG,
+                "AD element of type 0x%02x (%u bytes) dropped",
+                (unsigned) element->type,
+                (unsigned) element->length);
+            ++dropped;
+        }
+    }
+
+    return dropped;
+}
+
+size_t AdvertisementPacker::numberOfElements(void) const
+{
+    return m_numberOfElements;
+}
+
+uint8_t AdvertisementPacker::type(size_t index) const
+{
+    if (index >= m_numberOfElements)
+    {
+        throw std::out_of_range("AD element index out of range");
+    }
+    return m_elements[index].type;
+}
+
+AdvertisementPacker::Placement AdvertisementPacker::placement(size_t index) const
+{
+    if (index >= m_numberOfElements)
+    {
+        throw std::out_of_range("AD element index out of range");
+    }
+    return m_elements[index].placement;
+}
+
+bool AdvertisementPacker::nameShortened(void) const
+{
+    return m_nameShortened;
+}
+
+AdvertisementPacker::Element* AdvertisementPacker::nextElement(void)
+{
+    // the flags go first, the rest by descending priority; strict comparison keeps the order of adding
+    if (m_flagsIndex >= 0 && m_elements[m_flagsIndex].placement == Placement::NONE)
+    {
+        return m_elements + m_flagsIndex;
+    }
+
+    Element* next = nullptr;
+    for (size_t i = 0; i < m_numberOfElements; ++i)
+    {
+        auto& element = m_elements[i];
+        if (element.placement == Placement::NONE && (!next || element.priority > next->priority))
+        {
+            next = &element;
+        }
+    }
+    return next;
+}
+
+void AdvertisementPacker::placeElement(
+    Element* element,
+    AdvertisementWriter* advertisement,
+    AdvertisementWriter* scanResponse)
+{
+    auto value = m_pool + element->offset;
+
+    if (fits(advertisement, element->length))
+    {
+        advertisement->appendStructure(element->type, value, element->length);
+        element->placement = Placement::ADVERTISEMENT;
+    }
+    else if (element->type != AdvertisementEncoder::typeFlags && fits(scanResponse, element->length))
+    {
+        // flags are only valid within the advertisement
+        scanResponse->appendStructure(element->type, value, element->length);
+        element->placement = Placement::SCAN_RESPONSE;
+    }
+    else
+    {
+        element->placement = Placement::DROPPED;
+    }
+}
+
+void AdvertisementPacker::placeName(
+    Element* element,
+    AdvertisementWriter* advertisement,
+    AdvertisementWriter* scanResponse)
+{
+    auto value = m_pool + element->offset;
+
+    if (fits(advertisement, element->length))
+    {
+        advertisement->appendStructure(element->type, value, element->length);
+        element->placement = Placement::ADVERTISEMENT;
+    }
+    else if (placeShortenedName(element, advertisement))
+    {
+        // an active scanner gets the complete name by the scan request
+        if (fits(scanResponse, element->length))
+        {
+            scanResponse->appendStructure(element->type, value, element->length);
+            element->placement = Placement::SCAN_RESPONSE;
+        }
+        else
+        {
+            element->placement = Placement::DROPPED;
+        }
+    }
+    else if (fits(scanResponse, element->length))
+    {
+        scanResponse->appendStructure(element->type, value, element->length);
+        element->placement = Placement::SCAN_RESPONSE;
+    }
+    else
+    {
+        // the complete name is dropped even if a shortened one fits
+        placeShortenedName(element, scanResponse);
+        element->placement = Placement::DROPPED;
+    }
+}
+
+bool AdvertisementPacker::placeShortenedName(const Element* element, AdvertisementWriter* writer)
+{
+    const uint8_t* name;
+    size_t length;
+
+    if (m_shortNameLength)
+    {
+        name = m_pool + m_shortNameOffset;
+        length = m_shortNameLength;
+        if (!fits(writer, length))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // the longest prefix of the complete name which fits
+        name = m_pool + element->offset;
+        length = writer->capacity() - writer->length();
+        if (length < 2 + ADVERTISEMENT_PACKER_NAME_LENGTH_MIN || length - 2 >= element->length)
+        {
+            return false;
+        }
+        length -= 2;
+    }
+
+    writer->appendStructure(AdvertisementEncoder::typeShortenedName, name, length);
+    m_nameShortened = true;
+    return true;
+}
+
+uint8_t* AdvertisementPacker::allocate(size_t length)
+{
+    if (m_poolUsed + length > ADVERTISEMENT_PACKER_POOL_SIZE)
+    {
+        throw std::runtime_error("AD element pool exhausted");
+    }
+
+    auto value = m_pool + m_poolUsed;
+    m_poolUsed += length;
+    return value;
+}
+
+bool AdvertisementPacker::fits(const AdvertisementWriter* writer, size_t length)
+{
+    return writer->length() + 2 + length <= writer->capacity();
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,103 @@
+#ifndef MAIN_ADVERTISEMENTPACKER_HPP_
+#define MAIN_ADVERTISEMENTPACKER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AdvertisementEncoder.hpp"
+#include "AdvertisementWriter.hpp"
+
+#define ADVERTISEMENT_PACKER_ELEMENTS_MAX (12)
+#define ADVERTISEMENT_PACKER_POOL_SIZE (128)
+#define ADVERTISEMENT_PACKER_NAME_LENGTH_MIN (4)
+
+namespace Esp32
+{
+
+/*
+ * Distributes prioritized AD elements over the advertisement and the scan response. Elements are placed in order of
+ * descending priority (equal priorities keep the order of adding), each one into the advertisement if it still fits
+ * there, otherwise into the scan response, otherwise it is dropped. Thus scanners find the important data in the
+ * first packet and only need a scan request for the rest.
+ *
+ * The flags are only placed at the start of the advertisement, the scan response never repeats them. The device name
+ * is shortened only if the complete name does not fit into the advertisement anymore: the given short name, or else
+ * the longest prefix fitting (at least ADVERTISEMENT_PACKER_NAME_LENGTH_MIN characters), is advertised and the
+ * complete name goes into the scan response if there is room left. Values are copied, the caller's buffers need not
+ * outlive the packer. Check placement() after pack() to find out what was dropped: for the name it tells where the
+ * complete name went, nameShortened() whether a shortened name was placed besides or instead of it.
+ */
+class AdvertisementPacker
+{
+public:
+    enum class Placement: uint8_t
+    {
+        NONE,
+        ADVERTISEMENT,
+        SCAN_RESPONSE,
+        DROPPED,
+    };
+
+    static constexpr uint8_t priorityLow = 64;
+    static constexpr uint8_t priorityNormal = 128;
+    static constexpr uint8_t priorityHigh = 192;
+
+    AdvertisementPacker();
+    virtual ~AdvertisementPacker();
+
+    void setFlags(uint8_t flags);
+    void add(uint8_t type, const void* value, size_t length, uint8_t priority);
+    void addStructures(const uint8_t* structures, size_t length, uint8_t priority);
+    template<size_t N>
+    void add(const AdvertisementPayload<N>& payload, uint8_t priority);
+    void addName(const char* name, const char* shortName, uint8_t priority);
+    uint8_t* reserve(uint8_t type, size_t length, uint8_t priority);
+
+    size_t pack(AdvertisementWriter* advertisement, AdvertisementWriter* scanResponse);
+
+    size_t numberOfElements(void) const;
+    uint8_t type(size_t index) const;
+    Placement placement(size_t index) const;
+    bool nameShortened(void) const;
+
+protected:
+
+    struct Element
+    {
+        uint16_t offset;
+        uint8_t length;
+        uint8_t type;
+        uint8_t priority;
+        Placement placement;
+    };
+
+    Element m_elements[ADVERTISEMENT_PACKER_ELEMENTS_MAX];
+    size_t m_numberOfElements;
+    uint8_t m_pool[ADVERTISEMENT_PACKER_POOL_SIZE];
+    size_t m_poolUsed;
+    int m_flagsIndex;
+    int m_nameIndex;
+    uint16_t m_shortNameOffset;
+    uint8_t m_shortNameLength;
+    bool m_nameShortened;
+
+    Element* nextElement(void);
+    void placeElement(Element* element, AdvertisementWriter* advertisement, AdvertisementWriter* scanResponse);
+    void placeName(Element* element, AdvertisementWriter* advertisement, AdvertisementWriter* scanResponse);
+    bool placeShortenedName(const Element* element, AdvertisementWriter* writer);
+    uint8_t* allocate(size_t length);
+
+    static bool fits(const AdvertisementWriter* writer, size_t length);
+
+private:
+
+};
+
+template<size_t N>
+void AdvertisementPacker::add(const AdvertisementPayload<N>& payload, uint8_t priority)
+{
+    addStructures(payload.data, N, priority);
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_ADVERTISEMENTPACKER_HPP_ */
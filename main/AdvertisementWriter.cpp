@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+#include "AdvertisementWriter.hpp"
+
+namespace Esp32
+{
+
+AdvertisementWriter::AdvertisementWriter(uint8_t* buffer, size_t capacity):
+    m_buffer(buffer),
+    m_capacity(capacity),
+    m_length(0)
+{
+    if (!buffer)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+}
+
+AdvertisementWriter::~AdvertisementWriter()
+{
+}
+
+void AdvertisementWriter::append(const uint8_t* structures, size_t length)
+{
+    checkCapacity(length);
+
+    memcpy(m_buffer + m_length, structures, length);
+    m_length += length;
+}
+
+void AdvertisementWriter::appendStructure(uint8_t type, const void* value, size_t length)
+{
+    memcpy(reserveStructure(type, length), value, length);
+}
+
+uint8_t* AdvertisementWriter::reserveStructure(uint8_t type, size_t length)
+{
+    checkCapacity(2 + length);
+
+    auto structure = m_buffer + m_length;
+    structure[0] = 1 + length;
+    structure[1] = type;
+    m_length += 2 + length;
+
+    return structure + 2;
+}
+
+size_t AdvertisementWriter::length(void) const
+{
+    return m_length;
+}
+
+size_t AdvertisementWriter::capacity(void) const
+{
+    return m_capacity;
+}
+
+void AdvertisementWriter::checkCapacity(size_t length) const
+{
+    if (m_length + length > m_capacity)
+    {
+        char buffer[64];
+        snprintf(
+            buffer,
+            sizeof(buffer) - 1,
+            "advertisement to long (now %u bytes, max accepted is %u)",
+            (unsigned) (m_length + length),
+            (unsigned) m_capacity);
+        throw std::runtime_error(buffer);
+    }
+}
+
+} /* namespace Esp32 */
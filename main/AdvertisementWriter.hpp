@@ -0,0 +1,50 @@
+#ifndef MAIN_ADVERTISEMENTWRITER_HPP_
+#define MAIN_ADVERTISEMENTWRITER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AdvertisementEncoder.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Runtime counterpart of AdvertisementEncoder for fields which are only known at runtime, e.g. the UUIDs of the
+ * registered services. Appends AD structures to a caller supplied buffer and throws if they do not fit.
+ */
+class AdvertisementWriter
+{
+public:
+    AdvertisementWriter(uint8_t* buffer, size_t capacity = ADVERTISEMENT_LENGTH_MAX);
+    virtual ~AdvertisementWriter();
+
+    void append(const uint8_t* structures, size_t length);
+    template<size_t N>
+    void append(const AdvertisementPayload<N>& payload);
+    void appendStructure(uint8_t type, const void* value, size_t length);
+    uint8_t* reserveStructure(uint8_t type, size_t length);
+
+    size_t length(void) const;
+    size_t capacity(void) const;
+
+protected:
+
+    uint8_t* m_buffer;
+    size_t m_capacity;
+    size_t m_length;
+
+    void checkCapacity(size_t length) const;
+
+private:
+
+};
+
+template<size_t N>
+void AdvertisementWriter::append(const AdvertisementPayload<N>& payload)
+{
+    append(payload.data, N);
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_ADVERTISEMENTWRITER_HPP_ */
@@ -0,0 +1,260 @@
+#include <string.h>
+#include <esp_log.h>
+#include <stdexcept>
+#include "AggregateGattCharacteristic.hpp"
+
+#define LOG_TAG "AggregateGattCharacteristic"
+
+#define AGGREGATE_LENGTH_MAX (512)
+#define AGGREGATE_READ_PERMISSIONS \
+    (ESP_GATT_PERM_READ | ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_READ_ENC_MITM)
+
+namespace Esp32
+{
+
+AggregateGattCharacteristic::Member::Member():
+    characteristic(nullptr),
+    service(nullptr),
+    application(nullptr)
+{
+}
+
+AggregateGattCharacteristic::AggregateGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint8_t* buffer,
+    uint16_t bufferSize,
+    const char* description):
+    GenericGattCharacteristic(characteristicId, bufferSize, ESP_GATT_PERM_READ, description),
+    m_numberOfMembers(0),
+    m_buffer(buffer),
+    m_snapshotLength(0),
+    m_snapshotConnectionId(-1),
+    m_worstCaseLength(0),
+    m_truncatedReads(0),
+    m_truncated(false)
+{
+    if (!buffer)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (!bufferSize || bufferSize > AGGREGATE_LENGTH_MAX)
+    {
+        throw std::invalid_argument("invalid buffer size");
+    }
+}
+
+AggregateGattCharacteristic::~AggregateGattCharacteristic()
+{
+}
+
+void AggregateGattCharacteristic::addMember(GenericGattCharacteristic* characteristic)
+{
+    if (!characteristic)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (characteristic->length() > AGGREGATE_VALUE_LENGTH_MAX)
+    {
+        throw std::invalid_argument("characteristic too long for an aggregate");
+    }
+
+    reserve(worstCaseLength(characteristic));
+    nextMember().characteristic = characteristic;
+}
+
+void AggregateGattCharacteristic::addMember(GattsService* service)
+{
+    if (!service)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    reserve(worstCaseLength(service));
+    nextMember().service = service;
+}
+
+void AggregateGattCharacteristic::addMember(GattsApplication* application)
+{
+    if (!application)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    // services added to the application later on are not known yet, their records are truncated by serialize()
+    size_t length = 0;
+    application->lockServices();
+    auto servicePointer = application->services();
+    while (servicePointer)
+    {
+        length += worstCaseLength(servicePointer);
+        servicePointer = servicePointer->nextService();
+    }
+    application->unlockServices();
+
+    reserve(length);
+    nextMember().application = application;
+}
+
+void AggregateGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    *length = serialize(buffer);
+}
+
+void AggregateGattCharacteristic::readAt(uint16_t connectionId, uint16_t offset, uint8_t* buffer, uint16_t* length)
+{
+    // reads are served by the Bluetooth task one at a time, thus a single snapshot is sufficient
+    if (!offset || m_snapshotConnectionId != (int) connectionId)
+    {
+        m_snapshotLength = serialize(m_buffer);
+        m_snapshotConnectionId = connectionId;
+    }
+
+    if (offset > m_snapshotLength)
+    {
+        throw std::out_of_range("read offset beyond the value");
+    }
+
+    *length = m_snapshotLength - offset;
+    memcpy(buffer, m_buffer + offset, *length);
+}
+
+size_t AggregateGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this) + m_length;
+}
+
+uint32_t AggregateGattCharacteristic::truncatedReads(void) const
+{
+    return m_truncatedReads;
+}
+
+AggregateGattCharacteristic::Member& AggregateGattCharacteristic::nextMember(void)
+{
+    if (m_numberOfMembers >= AGGREGATE_MEMBERS_MAX)
+    {
+        throw std::runtime_error("too many aggregate members");
+    }
+
+    return m_members[m_numberOfMembers++];
+}
+
+void AggregateGattCharacteristic::reserve(size_t length)
+{
+    if (m_worstCaseLength + length > m_length)
+    {
+        throw std::length_error("aggregated values may exceed the characteristic length");
+    }
+    m_worstCaseLength += length;
+}
+
+size_t AggregateGattCharacteristic::worstCaseLength(const GenericGattCharacteristic* characteristic) const
+{
+    // the same conditions as serializeCharacteristic() and serializeService(), except for the handle assigned later
+    if (characteristic == this
+        || characteristic->length() > AGGREGATE_VALUE_LENGTH_MAX
+        || !(characteristic->permission() & AGGREGATE_READ_PERMISSIONS))
+    {
+        return 0;
+    }
+    return AGGREGATE_RECORD_HEADER_LENGTH + characteristic->length();
+}
+
+size_t AggregateGattCharacteristic::worstCaseLength(const GattsService* service) const
+{
+    size_t length = 0;
+    auto characteristicPointer = service->characteristics();
+    while (characteristicPointer)
+    {
+        length += worstCaseLength(characteristicPointer);
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+    return length;
+}
+
+uint16_t AggregateGattCharacteristic::serialize(uint8_t* buffer)
+{
+    uint16_t used = 0;
+    m_truncated = false;
+    for (size_t i = 0; i < m_numberOfMembers; ++i)
+    {
+        const auto& member = m_members[i];
+        if (member.characteristic)
+        {
+            used = serializeCharacteristic(member.characteristic, buffer, used);
+        }
+        else if (member.service)
+        {
+            used = serializeService(member.service, buffer, used);
+        }
+        else
+        {
+            auto servicePointer = member.application->services();
+            while (servicePointer)
+            {
+                used = serializeService(servicePointer, buffer, used);
+                servicePointer = servicePointer->nextService();
+            }
+        }
+    }
+
+    if (m_truncated)
+    {
+        ++m_truncatedReads;
+        ESP_LOGW(LOG_TAG, "aggregated values truncated to %u bytes", used);
+    }
+    return used;
+}
+
+uint16_t AggregateGattCharacteristic::serializeService(const GattsService* service, uint8_t* buffer, uint16_t used)
+{
+    auto characteristicPointer = service->characteristics();
+    while (characteristicPointer)
+    {
+        if (characteristicPointer != this && characteristicPointer->length() <= AGGREGATE_VALUE_LENGTH_MAX)
+        {
+            used = serializeCharacteristic(characteristicPointer, buffer, used);
+        }
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+    return used;
+}
+
+uint16_t AggregateGattCharacteristic::serializeCharacteristic(
+    GenericGattCharacteristic* characteristic,
+    uint8_t* buffer,
+    uint16_t used)
+{
+    if (!characteristic->handle() || !(characteristic->permission() & AGGREGATE_READ_PERMISSIONS))
+    {
+        return used;
+    }
+
+    // only services added to an application member after addMember() get here, their records are left out
+    if (used + AGGREGATE_RECORD_HEADER_LENGTH + characteristic->length() > m_length)
+    {
+        m_truncated = true;
+        return used;
+    }
+
+    uint16_t valueLength = characteristic->length();
+    try
+    {
+        characteristic->read(buffer + used + AGGREGATE_RECORD_HEADER_LENGTH, &valueLength);
+    }
+    catch (const std::exception& e)
+    {
+        ESP_LOGD(LOG_TAG, "skipping handle %u: %s", characteristic->handle(), e.what());
+        return used;
+    }
+
+    auto handle = characteristic->handle();
+    buffer[used] = handle & 0xff;
+    buffer[used + 1] = handle >> 8;
+    buffer[used + 2] = valueLength;
+
+    return used + AGGREGATE_RECORD_HEADER_LENGTH + valueLength;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,91 @@
+#ifndef MAIN_AGGREGATEGATTCHARACTERISTIC_HPP_
+#define MAIN_AGGREGATEGATTCHARACTERISTIC_HPP_
+
+#include <sdkconfig.h>
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "GenericGattCharacteristic.hpp"
+
+#ifdef CONFIG_BLE_AGGREGATE_MEMBERS_MAX
+#define AGGREGATE_MEMBERS_MAX (CONFIG_BLE_AGGREGATE_MEMBERS_MAX)
+#else
+#define AGGREGATE_MEMBERS_MAX (8)
+#endif
+
+#define AGGREGATE_RECORD_HEADER_LENGTH (3)
+#define AGGREGATE_VALUE_LENGTH_MAX (255)
+
+namespace Esp32
+{
+
+/*
+ * Read-only characteristic returning the values of many characteristics at once, so a client refreshes its state in
+ * one or two round trips instead of reading each characteristic separately. The value is a sequence of records
+ *
+ *   u16 handle, u8 length, value
+ *
+ * in little endian byte order. Members are single characteristics, all characteristics of a service or all
+ * characteristics of an application. Only readable characteristics with a handle and a value of at most
+ * AGGREGATE_VALUE_LENGTH_MAX bytes are included, characteristics whose read fails are skipped.
+ *
+ * The caller supplies the buffer holding the serialized values, its size is the maximum length of the characteristic
+ * (at most 512 bytes). addMember() throws std::length_error if the records of all members at their maximum length
+ * may exceed it. Only services added to an application member later on can still overflow the buffer, their records
+ * are left out and counted by truncatedReads(). Values longer than the MTU are continued by the client with Read Blob
+ * requests, these are served from the snapshot taken by the initial read so the client receives consistent values.
+ */
+class AggregateGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    AggregateGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint8_t* buffer,
+        uint16_t bufferSize,
+        const char* description = nullptr);
+    virtual ~AggregateGattCharacteristic();
+
+    void addMember(GenericGattCharacteristic* characteristic);
+    void addMember(GattsService* service);
+    void addMember(GattsApplication* application);
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    void readAt(uint16_t connectionId, uint16_t offset, uint8_t* buffer, uint16_t* length) override;
+    size_t objectSize(void) const override;
+
+    uint32_t truncatedReads(void) const;
+
+protected:
+
+    struct Member
+    {
+        Member();
+
+        GenericGattCharacteristic* characteristic;
+        GattsService* service;
+        GattsApplication* application;
+    };
+
+    Member m_members[AGGREGATE_MEMBERS_MAX];
+    size_t m_numberOfMembers;
+    uint8_t* m_buffer;
+    uint16_t m_snapshotLength;
+    int m_snapshotConnectionId;
+    size_t m_worstCaseLength;
+    uint32_t m_truncatedReads;
+    bool m_truncated;
+
+    Member& nextMember(void);
+    void reserve(size_t length);
+    size_t worstCaseLength(const GenericGattCharacteristic* characteristic) const;
+    size_t worstCaseLength(const GattsService* service) const;
+    uint16_t serialize(uint8_t* buffer);
+    uint16_t serializeService(const GattsService* service, uint8_t* buffer, uint16_t used);
+    uint16_t serializeCharacteristic(GenericGattCharacteristic* characteristic, uint8_t* buffer, uint16_t used);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_AGGREGATEGATTCHARACTERISTIC_HPP_ */
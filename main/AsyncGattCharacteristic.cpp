@@ -0,0 +1,49 @@
+#include <stdexcept>
+#include "AsyncGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+AsyncGattCharacteristic::AsyncGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint16_t length,
+    uint16_t permission,
+    const char* description):
+    GenericGattCharacteristic(characteristicId, length, permission, description)
+{
+}
+
+AsyncGattCharacteristic::~AsyncGattCharacteristic()
+{
+}
+
+void AsyncGattCharacteristic::readAt(uint16_t connectionId, uint16_t offset, uint8_t* buffer, uint16_t* length)
+{
+    readAsync(PendingTransactions::instance()->defer());
+}
+
+void AsyncGattCharacteristic::write(const uint8_t* buffer, uint16_t length)
+{
+    // the buffer belongs to the GATTS event, copy what is needed before returning
+    writeAsync(PendingTransactions::instance()->defer(), buffer, length);
+}
+
+size_t AsyncGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
+void AsyncGattCharacteristic::readAsync(const PendingTransactions::Response& response)
+{
+    throw std::runtime_error("reading from characteristic not supported");
+}
+
+void AsyncGattCharacteristic::writeAsync(
+    const PendingTransactions::Response& response,
+    const uint8_t* buffer,
+    uint16_t length)
+{
+    throw std::runtime_error("writing to characteristic not supported");
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,57 @@
+#ifndef MAIN_ASYNCGATTCHARACTERISTIC_HPP_
+#define MAIN_ASYNCGATTCHARACTERISTIC_HPP_
+
+#include "GenericGattCharacteristic.hpp"
+#include "PendingTransactions.hpp"
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "AsyncGattCharacteristic needs Bluedroid, NimBLE answers requests within its access callbacks"
+#endif
+
+namespace Esp32
+{
+
+/*
+ * Characteristic answering read and write requests later, e.g. after a slow sensor or bus transaction. Instead of
+ * filling the buffer within the Bluetooth task, readAsync() and writeAsync() get a Response, start the transaction
+ * and return; whichever task finishes it calls Response::complete() (or fail()) then. The Bluetooth task keeps
+ * serving other connections and events meanwhile.
+ *
+ *   void SensorCharacteristic::readAsync(const PendingTransactions::Response& response)
+ *   {
+ *       m_pendingResponse = response;
+ *       xTaskNotifyGive(m_sensorTask);
+ *   }
+ *
+ * For Read Blob requests the complete value is passed again, the offset is applied when responding. A long write is
+ * passed as a whole once it is executed and its Response answers the Execute Write request; a reliable write may cover
+ * one asynchronous characteristic only, as the request has a single response. A request not completed in time is
+ * answered with an error by PendingTransactions. The value is not available to read(), so the characteristic cannot be
+ * notified or aggregated.
+ */
+class AsyncGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    AsyncGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint16_t length,
+        uint16_t permission = ESP_GATT_PERM_READ,
+        const char* description = nullptr);
+    virtual ~AsyncGattCharacteristic();
+
+    void readAt(uint16_t connectionId, uint16_t offset, uint8_t* buffer, uint16_t* length) override;
+    void write(const uint8_t* buffer, uint16_t length) override;
+    size_t objectSize(void) const override;
+
+protected:
+
+    virtual void readAsync(const PendingTransactions::Response& response);
+    virtual void writeAsync(const PendingTransactions::Response& response, const uint8_t* buffer, uint16_t length);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_ASYNCGATTCHARACTERISTIC_HPP_ */
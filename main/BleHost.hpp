@@ -0,0 +1,53 @@
+#ifndef MAIN_BLEHOST_HPP_
+#define MAIN_BLEHOST_HPP_
+
+#include <sdkconfig.h>
+#include <stdint.h>
+
+/*
+ * The Bluetooth host is chosen by the ESP-IDF configuration (Component config > Bluetooth > Host). Bluedroid is the
+ * default, with CONFIG_BT_NIMBLE_ENABLED the server runs on NimBLE instead (see BleServerNimble.cpp), which takes
+ * considerably less RAM and flash.
+ *
+ * Applications keep using the Bluedroid constants for permissions and attributes either way: for NimBLE they are
+ * defined here with the values of Bluedroid, thus characteristics and schema files are the same for both hosts. The
+ * GATT interface is a Bluedroid notion only, with NimBLE it is always ESP_GATT_IF_NONE.
+ */
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+
+#include <host/ble_hs.h>
+
+typedef uint8_t esp_gatt_if_t;
+
+#define ESP_GATT_IF_NONE (0xff)
+
+#define ESP_GATT_PERM_READ (1 << 0)
+#define ESP_GATT_PERM_READ_ENCRYPTED (1 << 1)
+#define ESP_GATT_PERM_READ_ENC_MITM (1 << 2)
+#define ESP_GATT_PERM_WRITE (1 << 4)
+#define ESP_GATT_PERM_WRITE_ENCRYPTED (1 << 5)
+#define ESP_GATT_PERM_WRITE_ENC_MITM (1 << 6)
+
+#define ESP_GATT_UUID_PRI_SERVICE (0x2800)
+#define ESP_GATT_UUID_CHAR_DECLARE (0x2803)
+#define ESP_GATT_UUID_CHAR_DESCRIPTION (0x2901)
+#define ESP_GATT_UUID_CHAR_CLIENT_CONFIG (0x2902)
+
+// characteristic properties, NimBLE takes them as the lower byte of the characteristic flags
+#define ESP_GATT_CHAR_PROP_BIT_READ (BLE_GATT_CHR_F_READ)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE_NR (BLE_GATT_CHR_F_WRITE_NO_RSP)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE (BLE_GATT_CHR_F_WRITE)
+#define ESP_GATT_CHAR_PROP_BIT_NOTIFY (BLE_GATT_CHR_F_NOTIFY)
+#define ESP_GATT_CHAR_PROP_BIT_INDICATE (BLE_GATT_CHR_F_INDICATE)
+
+#define ESP_GATT_DEF_BLE_MTU_SIZE (BLE_ATT_MTU_DFLT)
+#define ESP_GATT_MAX_ATTR_LEN (BLE_ATT_ATTR_MAX_LEN)
+
+#else
+
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+
+#endif
+
+#endif /* MAIN_BLEHOST_HPP_ */
@@ -1,34 +1,45 @@
 #include <esp_bt.h>
-#include <esp_bt_main.h>
-#include <esp_gatt_common_api.h>
 #include <esp_log.h>
+#include <string.h>
 #include <stdexcept>
 #include "BleServer.hpp"
 
-#define LOG_TAG "BleServer"
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+#include <esp_bt_main.h>
+#include <esp_gatt_common_api.h>
+#endif
 
-#define BLE_GATT_LOCAL_MTU (400)
+#define LOG_TAG "BleServer"
 
 namespace Esp32
 {
 
 static BleServer bleServer;
 
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 static void gapEventCallbackWrapper(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
 static void gattsEventCallbackWrapper(
     esp_gatts_cb_event_t event,
     esp_gatt_if_t gatts_if,
     esp_ble_gatts_cb_param_t* param);
+#endif
 
 BleServer::BleServer():
-    m_gattsApplication(nullptr)
+    m_numberOfGattsApplications(0),
+    m_advertisingApplication(nullptr)
 {
+    memset(m_gattsApplications, 0, sizeof(m_gattsApplications));
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+    memset(m_gattsApplicationByInterface, 0, sizeof(m_gattsApplicationByInterface));
+    m_registeringApplication = nullptr;
+#endif
 }
 
 BleServer::~BleServer()
 {
 }
 
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 void BleServer::probe(void)
 {
     ESP_LOGD(LOG_TAG, "BleServer::probe()");
@@ -75,43 +86,211 @@ void BleServer::probe(void)
     }
 }
 
-void BleServer::setGattsApplication(GattsApplication* gattsApplication)
+void BleServer::addGattsApplication(GattsApplication* gattsApplication)
 {
-    m_gattsApplication = gattsApplication;
-    if (!m_gattsApplication)
+    if (!gattsApplication)
     {
-        throw std::runtime_error("no GATTS application registered");
+        throw std::invalid_argument("null pointer exception");
     }
 
-    if (esp_ble_gatts_app_register(m_gattsApplication->applicationId()) != ESP_OK)
+    if (m_numberOfGattsApplications >= BLE_SERVER_APPLICATIONS_MAX)
     {
-        throw std::runtime_error("error registering the GATTS application");
+        throw std::runtime_error("too many GATTS applications");
+    }
+
+    for (auto i = 0; i < m_numberOfGattsApplications; ++i)
+    {
+        if (m_gattsApplications[i]->applicationId() == gattsApplication->applicationId())
+        {
+            throw std::invalid_argument("GATTS application ID already in use");
+        }
+    }
+
+    if (gattsApplication->advertises() && m_advertisingApplication)
+    {
+        throw std::invalid_argument("advertising is already owned by another GATTS application");
+    }
+
+    m_gattsApplications[m_numberOfGattsApplications] = gattsApplication;
+    ++m_numberOfGattsApplications;
+    if (gattsApplication->advertises())
+    {
+        m_advertisingApplication = gattsApplication;
+    }
+
+    // applications are registered one after another, see registrationProgressed()
+    if (!m_registeringApplication)
+    {
+        registerGattsApplication(gattsApplication);
     }
 }
 
 void BleServer::gapEventCallback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param)
 {
-    if (!m_gattsApplication)
+    // GAP events only concern advertising, so they are delivered to the owning application only
+    auto gattsApplication = m_advertisingApplication;
+    if (!gattsApplication)
     {
-        throw std::runtime_error("no GATTS application registered");
+        return;
     }
-    m_gattsApplication->gapEventCallback(event, param);
+
+    DISPATCH_STATISTICS_START();
+    gattsApplication->gapEventCallback(event, param);
+    DISPATCH_STATISTICS_STOP(m_gapDispatchStatistics);
 }
 
 void BleServer::gattsEventCallback(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
 {
-    if (!m_gattsApplication)
+    if (event == ESP_GATTS_REG_EVT)
+    {
+        auto gattsApplication = gattsApplicationForRegistration(param->reg.app_id);
+        if (param->reg.status == ESP_GATT_OK)
+        {
+            if (gatts_if >= BLE_SERVER_INTERFACES_MAX)
+            {
+                throw std::runtime_error("GATTS interface out of range");
+            }
+            m_gattsApplicationByInterface[gatts_if] = gattsApplication;
+        }
+        else
+        {
+            registrationProgressed(gattsApplication, true);
+        }
+        gattsApplication->gattsEventCallback(event, gatts_if, param);
+        return;
+    }
+
+    if (gatts_if == ESP_GATT_IF_NONE)
+    {
+        for (auto i = 0; i < m_numberOfGattsApplications; ++i)
+        {
+            auto gattsApplication = m_gattsApplications[i];
+            if (gattsApplication->interface() == ESP_GATT_IF_NONE)
+            {
+                continue;
+            }
+
+            try
+            {
+                gattsApplication->gattsEventCallback(event, gattsApplication->interface(), param);
+            }
+            catch(const std::exception& e)
+            {
+                ESP_LOGE(
+                    LOG_TAG,
+                    "error handling GATTS event in application %04x: %s",
+                    gattsApplication->applicationId(),
+                    e.what());
+            }
+        }
+        return;
+    }
+
+    DISPATCH_STATISTICS_START();
+    auto gattsApplication = gatts_if < BLE_SERVER_INTERFACES_MAX ? m_gattsApplicationByInterface[gatts_if] : nullptr;
+    if (!gattsApplication)
+    {
+        throw std::runtime_error("no GATTS application registered for this interface");
+    }
+    gattsApplication->gattsEventCallback(event, gatts_if, param);
+    DISPATCH_STATISTICS_STOP(m_gattsDispatchStatistics);
+    registrationProgressed(gattsApplication, false);
+}
+#endif
+
+const DispatchStatistics& BleServer::gapDispatchStatistics(void) const
+{
+    return m_gapDispatchStatistics;
+}
+
+const DispatchStatistics& BleServer::gattsDispatchStatistics(void) const
+{
+    return m_gattsDispatchStatistics;
+}
+
+void BleServer::dumpDispatchStatistics(void) const
+{
+    ESP_LOGI(
+        LOG_TAG,
+        "dispatch: GAP %u events, %u cycles/event; GATTS %u events, %u cycles/event",
+        (unsigned) m_gapDispatchStatistics.events,
+        (unsigned) m_gapDispatchStatistics.cyclesPerEvent(),
+        (unsigned) m_gattsDispatchStatistics.events,
+        (unsigned) m_gattsDispatchStatistics.cyclesPerEvent());
+}
+
+size_t BleServer::footprint(void) const
+{
+    size_t bytes = sizeof(*this);
+    for (uint8_t i = 0; i < m_numberOfGattsApplications; ++i)
+    {
+        bytes += m_gattsApplications[i]->footprint();
+    }
+    return bytes;
+}
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+GattsApplication* BleServer::gattsApplicationForRegistration(uint16_t applicationId)
+{
+    for (auto i = 0; i < m_numberOfGattsApplications; ++i)
+    {
+        if (m_gattsApplications[i]->applicationId() == applicationId)
+        {
+            return m_gattsApplications[i];
+        }
+    }
+    throw std::runtime_error("registration event for unknown GATTS application");
+}
+
+void BleServer::registerGattsApplication(GattsApplication* gattsApplication)
+{
+    m_registeringApplication = gattsApplication;
+    if (esp_ble_gatts_app_register(gattsApplication->applicationId()) != ESP_OK)
+    {
+        m_registeringApplication = nullptr;
+        throw std::runtime_error("error registering the GATTS application");
+    }
+}
+
+void BleServer::registrationProgressed(GattsApplication* gattsApplication, bool failed)
+{
+    // the attribute tables of all applications are generated in the GattArena, which is released in LIFO order; an
+    // application registering in parallel would release the table of another one
+    if (gattsApplication != m_registeringApplication
+        || (!failed && gattsApplication->registrationState() != GattsApplication::RegistrationState::READY))
+    {
+        return;
+    }
+
+    m_registeringApplication = nullptr;
+    for (auto i = 0; i + 1 < m_numberOfGattsApplications; ++i)
     {
-        throw std::runtime_error("no GATTS application registered");
+        if (m_gattsApplications[i] == gattsApplication)
+        {
+            try
+            {
+                registerGattsApplication(m_gattsApplications[i + 1]);
+            }
+            catch(const std::exception& e)
+            {
+                ESP_LOGE(
+                    LOG_TAG,
+                    "error registering application %04x: %s",
+                    m_gattsApplications[i + 1]->applicationId(),
+                    e.what());
+            }
+            return;
+        }
     }
-    m_gattsApplication->gattsEventCallback(event, gatts_if, param);
 }
+#endif
 
 BleServer* BleServer::instance(void)
 {
     return &bleServer;
 }
 
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 void gapEventCallbackWrapper(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param)
 {
     try
@@ -135,5 +314,6 @@ void gattsEventCallbackWrapper(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_i
         ESP_LOGE(LOG_TAG, "error handling GATTS event: %s", e.what());
     }
 }
+#endif
 
 } /* namespace Esp32 */
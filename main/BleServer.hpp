@@ -1,10 +1,15 @@
 #ifndef MAIN_BLESERVER_HPP_
 #define MAIN_BLESERVER_HPP_
 
-#include <esp_gap_ble_api.h>
-#include <esp_gatts_api.h>
+#include "BleHost.hpp"
+#include "DispatchStatistics.hpp"
 #include "GattsApplication.hpp"
 
+#define BLE_GATT_LOCAL_MTU (400)
+
+#define BLE_SERVER_APPLICATIONS_MAX (4)
+#define BLE_SERVER_INTERFACES_MAX (16)
+
 namespace Esp32
 {
 
@@ -15,16 +20,45 @@ public:
     virtual ~BleServer();
 
     void probe(void);
-    void setGattsApplication(GattsApplication* gattsApplication);
+    void addGattsApplication(GattsApplication* gattsApplication);
 
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    void hostSynchronized(void);
+    int gapEvent(struct ble_gap_event* event);
+#else
     void gapEventCallback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
     void gattsEventCallback(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+#endif
+
+    const DispatchStatistics& gapDispatchStatistics(void) const;
+    const DispatchStatistics& gattsDispatchStatistics(void) const;
+    void dumpDispatchStatistics(void) const;
+    size_t footprint(void) const;
 
     static BleServer* instance(void);
 
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    static int gapEventCallback(struct ble_gap_event* event, void* argument);
+#endif
+
 protected:
 
-    GattsApplication* m_gattsApplication;
+    GattsApplication* m_gattsApplications[BLE_SERVER_APPLICATIONS_MAX];
+    uint8_t m_numberOfGattsApplications;
+    GattsApplication* m_advertisingApplication;
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+    GattsApplication* m_gattsApplicationByInterface[BLE_SERVER_INTERFACES_MAX];
+    GattsApplication* m_registeringApplication;
+#endif
+
+    DispatchStatistics m_gapDispatchStatistics;
+    DispatchStatistics m_gattsDispatchStatistics;
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+    GattsApplication* gattsApplicationForRegistration(uint16_t applicationId);
+    void registerGattsApplication(GattsApplication* gattsApplication);
+    void registrationProgressed(GattsApplication* gattsApplication, bool failed);
+#endif
 
 private:
 
@@ -0,0 +1,136 @@
+#include <esp_bt.h>
+#include <esp_log.h>
+#include <nimble/nimble_port.h>
+#include <nimble/nimble_port_freertos.h>
+#include <services/gap/ble_svc_gap.h>
+#include <services/gatt/ble_svc_gatt.h>
+#include <stdexcept>
+#include "BleServer.hpp"
+
+#define LOG_TAG "BleServer"
+
+namespace Esp32
+{
+
+static void hostTask(void* parameter);
+static void syncCallback(void);
+static void resetCallback(int reason);
+
+void BleServer::probe(void)
+{
+    ESP_LOGD(LOG_TAG, "BleServer::probe()");
+
+    if (esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT) != ESP_OK)
+    {
+        throw std::runtime_error("error releasing non-necessary memory from the bluetooth controller");
+    }
+
+    // initializes the controller as well
+    if (nimble_port_init() != ESP_OK)
+    {
+        throw std::runtime_error("error initializing the bluetooth stack");
+    }
+
+    ble_hs_cfg.sync_cb = syncCallback;
+    ble_hs_cfg.reset_cb = resetCallback;
+
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+
+    if (ble_att_set_preferred_mtu(BLE_GATT_LOCAL_MTU) != 0)
+    {
+        throw std::runtime_error("error setting GATT MTU");
+    }
+}
+
+void BleServer::addGattsApplication(GattsApplication* gattsApplication)
+{
+    if (!gattsApplication)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    // the GATT database is taken as a whole when the host starts, thus there is one application only
+    if (m_numberOfGattsApplications)
+    {
+        throw std::runtime_error("NimBLE supports a single GATTS application");
+    }
+
+    m_gattsApplications[m_numberOfGattsApplications] = gattsApplication;
+    ++m_numberOfGattsApplications;
+    if (gattsApplication->advertises())
+    {
+        m_advertisingApplication = gattsApplication;
+    }
+
+    gattsApplication->registerServices();
+    nimble_port_freertos_init(hostTask);
+}
+
+void BleServer::hostSynchronized(void)
+{
+    uint8_t ownAddressType;
+    if (ble_hs_id_infer_auto(0, &ownAddressType) != 0)
+    {
+        throw std::runtime_error("error determining the address type");
+    }
+
+    for (auto i = 0; i < m_numberOfGattsApplications; ++i)
+    {
+        m_gattsApplications[i]->hostSynchronized(ownAddressType);
+    }
+}
+
+int BleServer::gapEvent(struct ble_gap_event* event)
+{
+    // there is no GATTS event stream with NimBLE, connections and subscriptions are reported as GAP events
+    auto gattsApplication = m_numberOfGattsApplications ? m_gattsApplications[0] : nullptr;
+    if (!gattsApplication)
+    {
+        return 0;
+    }
+
+    DISPATCH_STATISTICS_START();
+    auto result = gattsApplication->gapEvent(event);
+    DISPATCH_STATISTICS_STOP(m_gapDispatchStatistics);
+    return result;
+}
+
+int BleServer::gapEventCallback(struct ble_gap_event* event, void* argument)
+{
+    try
+    {
+        return instance()->gapEvent(event);
+    }
+    catch(const std::exception& e)
+    {
+        ESP_LOGE(LOG_TAG, "error handling GAP event: %s", e.what());
+    }
+    return 0;
+}
+
+void hostTask(void* parameter)
+{
+    // returns once nimble_port_stop() is called
+    nimble_port_run();
+    nimble_port_freertos_deinit();
+}
+
+void syncCallback(void)
+{
+    try
+    {
+        BleServer::instance()->hostSynchronized();
+    }
+    catch(const std::exception& e)
+    {
+        ESP_LOGE(LOG_TAG, "error synchronizing with the host: %s", e.what());
+    }
+}
+
+void resetCallback(int reason)
+{
+    ESP_LOGW(LOG_TAG, "host reset, reason=%d", reason);
+}
+
+} /* namespace Esp32 */
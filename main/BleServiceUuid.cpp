@@ -12,7 +12,11 @@ BleServiceUuid::BleServiceUuid(
 {
 }
 
-BleServiceUuid::~BleServiceUuid()
+BleServiceUuid::BleServiceUuid(
+    const BleUuid& uuid,
+    bool advertise):
+    BleUuid(uuid),
+    advertise(advertise)
 {
 }
 
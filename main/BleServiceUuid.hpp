@@ -12,7 +12,9 @@ struct BleServiceUuid: public BleUuid
         Width width,
         uint32_t uuid,
         bool advertise = true);
-    virtual ~BleServiceUuid();
+    BleServiceUuid(
+        const BleUuid& uuid,
+        bool advertise = true);
 
     bool advertise;
 };
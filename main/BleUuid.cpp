@@ -1,19 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+#include <sdkconfig.h>
+#include <stdexcept>
 #include "BleUuid.hpp"
 
+#ifdef CONFIG_BLE_UUID_BASE_TABLE_SIZE
+#define UUID_BASE_TABLE_SIZE (CONFIG_BLE_UUID_BASE_TABLE_SIZE)
+#else
+#define UUID_BASE_TABLE_SIZE (4)
+#endif
+
+#define UUID_BASE_LENGTH (12)
+#define UUID_128_LENGTH (16)
+
 namespace Esp32
 {
 
+// plain zero-initialized storage, so UUIDs may be constructed during static initialization
+static uint8_t uuidBaseTable[UUID_BASE_TABLE_SIZE][UUID_BASE_LENGTH];
+static uint8_t uuidBaseTableLength;
+
 BleUuid::BleUuid(
     Width width,
     uint32_t uuid):
+    uuid(width == Width::UUID_16 ? (uint16_t) uuid : uuid),
     width(width),
-    uuid16((uint16_t) uuid),
-    uuid32(uuid)
+    baseIndex(0)
+{
+    if (width == Width::UUID_128)
+    {
+        throw std::invalid_argument("128 bit UUIDs need a base");
+    }
+}
+
+BleUuid::BleUuid(const uint8_t* uuid128):
+    uuid(0),
+    width(Width::UUID_128),
+    baseIndex(internBase(uuid128))
+{
+    memcpy(&uuid, uuid128 + UUID_BASE_LENGTH, sizeof(uuid));
+}
+
+BleUuid::BleUuid(
+    const uint8_t* base128,
+    uint32_t uuid):
+    uuid(uuid),
+    width(Width::UUID_128),
+    baseIndex(internBase(base128))
+{
+}
+
+uint16_t BleUuid::length(void) const
 {
+    switch (width)
+    {
+        case Width::UUID_16:
+            return sizeof(uint16_t);
+        case Width::UUID_32:
+            return sizeof(uint32_t);
+        case Width::UUID_128:
+            return UUID_128_LENGTH;
+        default:
+            break;
+    }
+    throw std::runtime_error("UUID width is not supported");
+}
+
+const uint8_t* BleUuid::data(void) const
+{
+    if (width == Width::UUID_128)
+    {
+        throw std::runtime_error("128 bit UUIDs are stored interned, use copyTo()");
+    }
+    return (const uint8_t*) &uuid;
+}
+
+void BleUuid::copyTo(uint8_t* buffer) const
+{
+    if (width == Width::UUID_128)
+    {
+        memcpy(buffer, uuidBaseTable[baseIndex], UUID_BASE_LENGTH);
+        memcpy(buffer + UUID_BASE_LENGTH, &uuid, sizeof(uuid));
+    }
+    else
+    {
+        memcpy(buffer, &uuid, length());
+    }
+}
+
+void BleUuid::toString(char* buffer, size_t size) const
+{
+    switch (width)
+    {
+        case Width::UUID_16:
+            snprintf(buffer, size, "%04x", (unsigned) uuid);
+            break;
+        case Width::UUID_32:
+            snprintf(buffer, size, "%08x", (unsigned) uuid);
+            break;
+        default:
+        {
+            uint8_t bytes[UUID_128_LENGTH];
+            copyTo(bytes);
+            snprintf(
+                buffer,
+                size,
+                "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                bytes[15], bytes[14], bytes[13], bytes[12],
+                bytes[11], bytes[10],
+                bytes[9], bytes[8],
+                bytes[7], bytes[6],
+                bytes[5], bytes[4], bytes[3], bytes[2], bytes[1], bytes[0]);
+            break;
+        }
+    }
+}
+
+bool BleUuid::operator==(const BleUuid& other) const
+{
+    // bases are interned, thus equal bases have equal indices
+    return uuid == other.uuid && width == other.width && baseIndex == other.baseIndex;
+}
+
+bool BleUuid::operator!=(const BleUuid& other) const
+{
+    return !(*this == other);
+}
+
+uint8_t BleUuid::internBase(const uint8_t* base128)
+{
+    if (!base128)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    for (uint8_t i = 0; i < uuidBaseTableLength; ++i)
+    {
+        if (memcmp(uuidBaseTable[i], base128, UUID_BASE_LENGTH) == 0)
+        {
+            return i;
+        }
+    }
+
+    if (uuidBaseTableLength >= UUID_BASE_TABLE_SIZE)
+    {
+        throw std::runtime_error("UUID base table is full");
+    }
+
+    memcpy(uuidBaseTable[uuidBaseTableLength], base128, UUID_BASE_LENGTH);
+    return uuidBaseTableLength++;
 }
 
-BleUuid::~BleUuid()
+size_t BleUuid::numberOfBases(void)
 {
+    return uuidBaseTableLength;
 }
 
 } /* namespace Esp32 */
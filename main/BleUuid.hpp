@@ -1,27 +1,50 @@
 #ifndef MAIN_BLEUUID_HPP_
 #define MAIN_BLEUUID_HPP_
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace Esp32
 {
 
+/*
+ * Compact UUID representation: one 32 bit value in little endian byte order. A 16 bit UUID occupies the lower half,
+ * thus data() can be handed over to the Bluetooth stack for either width.
+ *
+ * 128 bit UUIDs are split into a vendor base (bytes 0..11 of the little endian representation) and the 32 bit value
+ * in bytes 12..15. Bases are interned in a global table shared by all UUIDs, each UUID only keeps the table index.
+ * Use copyTo() to get the full 16 bytes back.
+ */
 struct BleUuid
 {
-    enum class Width
+    enum class Width: uint8_t
     {
         UUID_16,
         UUID_32,
+        UUID_128,
     };
 
     BleUuid(
         Width width,
         uint32_t uuid);
-    virtual ~BleUuid();
+    BleUuid(const uint8_t* uuid128);
+    BleUuid(
+        const uint8_t* base128,
+        uint32_t uuid);
 
+    uint16_t length(void) const;
+    const uint8_t* data(void) const;
+    void copyTo(uint8_t* buffer) const;
+    void toString(char* buffer, size_t size) const;
+    bool operator==(const BleUuid& other) const;
+    bool operator!=(const BleUuid& other) const;
+
+    uint32_t uuid;
     Width width;
-    uint16_t uuid16;
-    uint32_t uuid32;
+    uint8_t baseIndex;
+
+    static uint8_t internBase(const uint8_t* base128);
+    static size_t numberOfBases(void);
 };
 
 } /* namespace Esp32 */
@@ -0,0 +1,130 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdexcept>
+#include "CachedGattCharacteristic.hpp"
+
+#define LOG_TAG "CachedGattCharacteristic"
+
+namespace Esp32
+{
+
+CachedGattCharacteristic::CachedGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint16_t length,
+    Producer producer,
+    void* producerContext,
+    uint32_t timeToLiveMs,
+    uint8_t* buffer,
+    const char* description):
+    GenericGattCharacteristic(characteristicId, length, ESP_GATT_PERM_READ, description),
+    m_producer(producer),
+    m_producerContext(producerContext),
+    m_timeToLive((int64_t) timeToLiveMs * 1000),
+    m_buffer(buffer),
+    m_cachedLength(0),
+    m_expiry(0),
+    m_generation(0),
+    m_hits(0),
+    m_misses(0),
+    m_mutexBuffer(),
+    m_mutex(xSemaphoreCreateMutexStatic(&m_mutexBuffer))
+{
+    if (!producer || !buffer)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+}
+
+CachedGattCharacteristic::~CachedGattCharacteristic()
+{
+}
+
+void CachedGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    // a refresh completed while waiting for the mutex is served as well, even if the TTL is 0
+    auto generation = m_generation.load();
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+
+    try
+    {
+        if (generation != m_generation.load() || m_expiry > esp_timer_get_time())
+        {
+            ++m_hits;
+        }
+        else
+        {
+            ++m_misses;
+            refresh();
+        }
+    }
+    catch (...)
+    {
+        xSemaphoreGive(m_mutex);
+        throw;
+    }
+
+    memcpy(buffer, m_buffer, m_cachedLength);
+    *length = m_cachedLength;
+
+    xSemaphoreGive(m_mutex);
+}
+
+size_t CachedGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
+void CachedGattCharacteristic::invalidate(void)
+{
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    m_expiry = 0;
+    xSemaphoreGive(m_mutex);
+}
+
+void CachedGattCharacteristic::setTimeToLive(uint32_t timeToLiveMs)
+{
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    m_timeToLive = (int64_t) timeToLiveMs * 1000;
+    m_expiry = 0;
+    xSemaphoreGive(m_mutex);
+}
+
+uint32_t CachedGattCharacteristic::hits(void) const
+{
+    return m_hits.load();
+}
+
+uint32_t CachedGattCharacteristic::misses(void) const
+{
+    return m_misses.load();
+}
+
+void CachedGattCharacteristic::resetStatistics(void)
+{
+    m_hits.store(0);
+    m_misses.store(0);
+}
+
+void CachedGattCharacteristic::refresh(void)
+{
+    // the cache stays invalid if the producer throws
+    m_expiry = 0;
+
+    uint16_t length = m_length;
+    m_producer(m_producerContext, m_buffer, &length);
+    if (length > m_length)
+    {
+        throw std::runtime_error("produced value exceeds the characteristic length");
+    }
+
+    // the TTL starts when the value is complete, a slow producer does not shorten it
+    m_cachedLength = length;
+    m_expiry = esp_timer_get_time() + m_timeToLive;
+    ++m_generation;
+
+    ESP_LOGD(LOG_TAG, "refreshed %u bytes", (unsigned) length);
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,70 @@
+#ifndef MAIN_CACHEDGATTCHARACTERISTIC_HPP_
+#define MAIN_CACHEDGATTCHARACTERISTIC_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include "GenericGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Read-only characteristic whose value is computed by a producer (e.g. an ADC average or a derived status) and cached
+ * in its encoded form for a time-to-live. Reads within the TTL, from any client and for notifications alike, are
+ * served from the cache; the first read after expiry runs the producer. Refreshes are single-flight: a read arriving
+ * while another task refreshes waits for that refresh and is served its result instead of producing again.
+ *
+ * A TTL of 0 refreshes on every read which is not coalesced with a running refresh. invalidate() forces the next read
+ * to refresh, e.g. when the inputs of the value changed. The caller supplies the cache buffer of the characteristic
+ * length. As long values are served from the cache as well, the Read Blob requests of one long read are consistent
+ * within the TTL.
+ */
+class CachedGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    typedef void (*Producer)(void* context, uint8_t* buffer, uint16_t* length);
+
+    CachedGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint16_t length,
+        Producer producer,
+        void* producerContext,
+        uint32_t timeToLiveMs,
+        uint8_t* buffer,
+        const char* description = nullptr);
+    virtual ~CachedGattCharacteristic();
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    size_t objectSize(void) const override;
+
+    void invalidate(void);
+    void setTimeToLive(uint32_t timeToLiveMs);
+    uint32_t hits(void) const;
+    uint32_t misses(void) const;
+    void resetStatistics(void);
+
+protected:
+
+    Producer m_producer;
+    void* m_producerContext;
+    int64_t m_timeToLive;
+    uint8_t* m_buffer;
+    uint16_t m_cachedLength;
+    int64_t m_expiry;
+    std::atomic<uint32_t> m_generation;
+    std::atomic<uint32_t> m_hits;
+    std::atomic<uint32_t> m_misses;
+
+    StaticSemaphore_t m_mutexBuffer;
+    SemaphoreHandle_t m_mutex;
+
+    void refresh(void);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_CACHEDGATTCHARACTERISTIC_HPP_ */
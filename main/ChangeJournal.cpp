@@ -0,0 +1,185 @@
+#include <string.h>
+#include "ChangeJournal.hpp"
+
+// bounds the time read() holds the lock to copying a few maximum size entries
+#define CHANGE_JOURNAL_ENTRIES_PER_LOCK (4)
+
+namespace Esp32
+{
+
+static ChangeJournal changeJournal;
+
+struct ChangeJournalEntryHeader
+{
+    uint32_t sequence;
+    uint16_t handle;
+    uint16_t length;
+};
+
+static_assert(
+    sizeof(ChangeJournalEntryHeader) == CHANGE_JOURNAL_ENTRY_HEADER_LENGTH,
+    "journal entry header has to be packed");
+
+static inline uint16_t storedValueLength(uint16_t length)
+{
+    return (length & CHANGE_JOURNAL_VALUE_OMITTED) ? 0 : length;
+}
+
+ChangeJournal::ChangeJournal():
+    m_head(0),
+    m_tail(0),
+    m_used(0),
+    m_sequence(0),
+    m_oldestSequence(1),
+    m_evictedEntries(0),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+ChangeJournal::~ChangeJournal()
+{
+}
+
+void ChangeJournal::record(uint16_t handle, const uint8_t* value, uint16_t length)
+{
+    ChangeJournalEntryHeader header;
+    header.handle = handle;
+    header.length = length;
+    if (length > CHANGE_JOURNAL_VALUE_LENGTH_MAX)
+    {
+        header.length = CHANGE_JOURNAL_VALUE_OMITTED | (length & ~CHANGE_JOURNAL_VALUE_OMITTED);
+        length = 0;
+    }
+    auto entryLength = sizeof(header) + length;
+
+    portENTER_CRITICAL_SAFE(&m_lock);
+    while (m_used + entryLength > sizeof(m_storage))
+    {
+        evictOldestEntry();
+    }
+
+    header.sequence = ++m_sequence;
+    copyIn(m_head, &header, sizeof(header));
+    copyIn((m_head + sizeof(header)) % sizeof(m_storage), value, length);
+    m_head = (m_head + entryLength) % sizeof(m_storage);
+    m_used += entryLength;
+    portEXIT_CRITICAL_SAFE(&m_lock);
+}
+
+ChangeJournal::ReadResult ChangeJournal::read(
+    uint32_t afterSequence,
+    uint8_t* buffer,
+    uint16_t size,
+    uint16_t* length,
+    uint32_t* lastSequence)
+{
+    *length = 0;
+    *lastSequence = afterSequence;
+
+    // the entry at position has the sequence number nextSequence, 0 before the first lock
+    size_t position = 0;
+    uint32_t nextSequence = 0;
+    for (;;)
+    {
+        // a few entries per lock, record() on the BT task must not wait for a whole journal to be copied
+        portENTER_CRITICAL_SAFE(&m_lock);
+        if (!nextSequence)
+        {
+            if (afterSequence + 1 < m_oldestSequence || afterSequence > m_sequence)
+            {
+                // entries were evicted in between or the client saw a sequence of an earlier boot
+                portEXIT_CRITICAL_SAFE(&m_lock);
+                return ReadResult::WRAPPED;
+            }
+            position = m_tail;
+            nextSequence = m_oldestSequence;
+        }
+        else if (nextSequence < m_oldestSequence)
+        {
+            // evicted while the lock was released, the entries copied so far are still consistent and the client
+            // learns about the gap when it continues after them
+            portEXIT_CRITICAL_SAFE(&m_lock);
+            return *length ? ReadResult::MORE : ReadResult::WRAPPED;
+        }
+
+        // entries are ordered, the ones already known to the client are skipped
+        for (int i = 0; i < CHANGE_JOURNAL_ENTRIES_PER_LOCK && nextSequence <= m_sequence; ++i)
+        {
+            ChangeJournalEntryHeader header;
+            copyOut(position, &header, sizeof(header));
+            auto entryLength = sizeof(header) + storedValueLength(header.length);
+
+            if (header.sequence > afterSequence)
+            {
+                if (*length + entryLength > size)
+                {
+                    portEXIT_CRITICAL_SAFE(&m_lock);
+                    return ReadResult::MORE;
+                }
+                copyOut(position, buffer + *length, entryLength);
+                *length += entryLength;
+                *lastSequence = header.sequence;
+            }
+
+            position = (position + entryLength) % sizeof(m_storage);
+            ++nextSequence;
+        }
+
+        auto complete = nextSequence > m_sequence;
+        portEXIT_CRITICAL_SAFE(&m_lock);
+        if (complete)
+        {
+            return ReadResult::COMPLETE;
+        }
+    }
+}
+
+uint32_t ChangeJournal::sequence(void) const
+{
+    return m_sequence;
+}
+
+uint32_t ChangeJournal::oldestSequence(void) const
+{
+    return m_oldestSequence;
+}
+
+uint32_t ChangeJournal::evictedEntries(void) const
+{
+    return m_evictedEntries;
+}
+
+ChangeJournal* ChangeJournal::instance(void)
+{
+    return &changeJournal;
+}
+
+void ChangeJournal::evictOldestEntry(void)
+{
+    ChangeJournalEntryHeader header;
+    copyOut(m_tail, &header, sizeof(header));
+    auto entryLength = sizeof(header) + storedValueLength(header.length);
+
+    m_tail = (m_tail + entryLength) % sizeof(m_storage);
+    m_used -= entryLength;
+    m_oldestSequence = header.sequence + 1;
+    ++m_evictedEntries;
+}
+
+void ChangeJournal::copyIn(size_t position, const void* data, size_t length)
+{
+    auto firstPart = sizeof(m_storage) - position < length ? sizeof(m_storage) - position : length;
+
+    memcpy(m_storage + position, data, firstPart);
+    memcpy(m_storage, (const uint8_t*) data + firstPart, length - firstPart);
+}
+
+void ChangeJournal::copyOut(size_t position, void* data, size_t length) const
+{
+    auto firstPart = sizeof(m_storage) - position < length ? sizeof(m_storage) - position : length;
+
+    memcpy(data, m_storage + position, firstPart);
+    memcpy((uint8_t*) data + firstPart, m_storage, length - firstPart);
+}
+
+} /* namespace Esp32 */
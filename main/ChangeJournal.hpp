@@ -0,0 +1,83 @@
+#ifndef MAIN_CHANGEJOURNAL_HPP_
+#define MAIN_CHANGEJOURNAL_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_BLE_CHANGE_JOURNAL_SIZE
+#define CHANGE_JOURNAL_SIZE (CONFIG_BLE_CHANGE_JOURNAL_SIZE)
+#else
+#define CHANGE_JOURNAL_SIZE (1024)
+#endif
+
+#define CHANGE_JOURNAL_ENTRY_HEADER_LENGTH (8)
+#define CHANGE_JOURNAL_VALUE_LENGTH_MAX (64)
+#define CHANGE_JOURNAL_VALUE_OMITTED (0x8000)
+
+namespace Esp32
+{
+
+/*
+ * Bounded in-RAM journal of characteristic value updates. Each entry is stored as
+ *
+ *   u32 sequence number, u16 handle, u16 value length, value
+ *
+ * in little endian byte order. Values longer than CHANGE_JOURNAL_VALUE_LENGTH_MAX are recorded without the value and
+ * CHANGE_JOURNAL_VALUE_OMITTED set in the length, clients have to read those characteristics. If the journal is full
+ * the oldest entries are evicted. Sequence numbers start at 1 after each reset.
+ *
+ * record() and read() share a spin lock. read() releases it after every few entries and continues after checking
+ * that the next entry has not been evicted meanwhile, so a reader copying the whole journal delays a writer by the
+ * copy of a few entries only.
+ */
+class ChangeJournal
+{
+public:
+    enum class ReadResult
+    {
+        COMPLETE,
+        MORE,
+        WRAPPED,
+    };
+
+    ChangeJournal();
+    virtual ~ChangeJournal();
+
+    void record(uint16_t handle, const uint8_t* value, uint16_t length);
+    ReadResult read(
+        uint32_t afterSequence,
+        uint8_t* buffer,
+        uint16_t size,
+        uint16_t* length,
+        uint32_t* lastSequence);
+
+    uint32_t sequence(void) const;
+    uint32_t oldestSequence(void) const;
+    uint32_t evictedEntries(void) const;
+
+    static ChangeJournal* instance(void);
+
+protected:
+
+    uint8_t m_storage[CHANGE_JOURNAL_SIZE];
+    size_t m_head;
+    size_t m_tail;
+    size_t m_used;
+    uint32_t m_sequence;
+    uint32_t m_oldestSequence;
+    uint32_t m_evictedEntries;
+    portMUX_TYPE m_lock;
+
+    void evictOldestEntry(void);
+    void copyIn(size_t position, const void* data, size_t length);
+    void copyOut(size_t position, void* data, size_t length) const;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_CHANGEJOURNAL_HPP_ */
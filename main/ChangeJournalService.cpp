@@ -0,0 +1,260 @@
+#include <string.h>
+#include <esp_log.h>
+#include <stdexcept>
+#include "ChangeJournalService.hpp"
+#include "NotificationDispatcher.hpp"
+
+#define LOG_TAG "ChangeJournalService"
+
+#define CHANGE_JOURNAL_CONTROL_LENGTH (8)
+#define CHANGE_JOURNAL_READ_PERMISSIONS \
+    (ESP_GATT_PERM_READ | ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_READ_ENC_MITM)
+
+namespace Esp32
+{
+
+ChangeJournalService::Cursor::Cursor():
+    requested(false),
+    snapshot(false),
+    sequence(0),
+    service(nullptr),
+    characteristic(nullptr)
+{
+}
+
+ChangeJournalService::ChangeJournalService(
+    const BleServiceUuid& serviceId,
+    const BleUuid& controlCharacteristicId,
+    const BleUuid& dataCharacteristicId,
+    GattsApplication* application):
+    GattsService(serviceId),
+    m_controlCharacteristic(
+        controlCharacteristicId,
+        CHANGE_JOURNAL_CONTROL_LENGTH,
+        ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        "Journal control"),
+    m_dataCharacteristic(dataCharacteristicId, NOTIFICATION_VALUE_LENGTH_MAX, ESP_GATT_PERM_READ, "Journal data"),
+    m_application(application)
+{
+    if (!application)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    addCharacteristic(&m_controlCharacteristic);
+    addCharacteristic(&m_dataCharacteristic);
+}
+
+ChangeJournalService::~ChangeJournalService()
+{
+}
+
+void ChangeJournalService::readCharacteristic(
+    uint16_t connectionId,
+    uint16_t handle,
+    uint16_t offset,
+    uint8_t* buffer,
+    uint16_t* length)
+{
+    if (offset && (handle == m_controlCharacteristic.handle() || handle == m_dataCharacteristic.handle()))
+    {
+        // responses never exceed the MTU, a client has no reason to continue them by Read Blob
+        throw std::out_of_range("read offset not supported");
+    }
+
+    if (handle == m_controlCharacteristic.handle())
+    {
+        auto journal = ChangeJournal::instance();
+        uint32_t sequences[2] = {journal->sequence(), journal->oldestSequence()};
+        memcpy(buffer, sequences, sizeof(sequences));
+        *length = sizeof(sequences);
+    }
+    else if (handle == m_dataCharacteristic.handle())
+    {
+        readChanges(connectionId, buffer, length);
+    }
+    else
+    {
+        GattsService::readCharacteristic(connectionId, handle, offset, buffer, length);
+    }
+}
+
+void ChangeJournalService::writeCharacteristic(
+    uint16_t connectionId,
+    uint16_t handle,
+    const uint8_t* buffer,
+    uint16_t length)
+{
+    if (handle != m_controlCharacteristic.handle())
+    {
+        GattsService::writeCharacteristic(connectionId, handle, buffer, length);
+        return;
+    }
+
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        throw std::invalid_argument("connection id out of range");
+    }
+
+    uint32_t sequence;
+    if (length != sizeof(sequence))
+    {
+        throw std::length_error("journal request has to be a sequence number");
+    }
+    memcpy(&sequence, buffer, sizeof(sequence));
+
+    auto& cursor = m_cursors[connectionId];
+    cursor = Cursor();
+    cursor.requested = true;
+    cursor.sequence = sequence;
+
+    ESP_LOGD(LOG_TAG, "connection %u requested changes after %u", connectionId, sequence);
+}
+
+void ChangeJournalService::clearClientConfigurations(uint16_t connectionId)
+{
+    GattsService::clearClientConfigurations(connectionId);
+
+    if (connectionId < GATT_CONNECTIONS_MAX)
+    {
+        m_cursors[connectionId] = Cursor();
+    }
+}
+
+void ChangeJournalService::readChanges(uint16_t connectionId, uint8_t* buffer, uint16_t* length)
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        throw std::invalid_argument("connection id out of range");
+    }
+
+    auto& cursor = m_cursors[connectionId];
+    if (!cursor.requested)
+    {
+        throw std::runtime_error("no journal request was written");
+    }
+
+    auto journal = ChangeJournal::instance();
+    auto size = NotificationDispatcher::instance()->payloadLength(1u << connectionId);
+    buffer[0] = 0;
+
+    if (!cursor.snapshot)
+    {
+        uint16_t entriesLength;
+        uint32_t lastSequence;
+        auto result = journal->read(cursor.sequence, buffer + 1, size - 1, &entriesLength, &lastSequence);
+        if (result != ChangeJournal::ReadResult::WRAPPED)
+        {
+            cursor.sequence = lastSequence;
+            buffer[0] = result == ChangeJournal::ReadResult::MORE ? CHANGE_JOURNAL_RESPONSE_MORE : 0;
+            *length = 1 + entriesLength;
+            return;
+        }
+
+        // the journal does not reach back far enough, the client has to take all current values instead
+        ESP_LOGI(LOG_TAG, "connection %u is out of sync, sending a snapshot", connectionId);
+        cursor.snapshot = true;
+        cursor.sequence = journal->sequence();
+        cursor.service = m_application->services();
+        cursor.characteristic = cursor.service ? cursor.service->characteristics() : nullptr;
+    }
+
+    *length = 1 + readSnapshot(cursor, buffer + 1, size - 1);
+    buffer[0] = CHANGE_JOURNAL_RESPONSE_SNAPSHOT;
+    if (cursor.snapshot || journal->sequence() != cursor.sequence)
+    {
+        buffer[0] |= CHANGE_JOURNAL_RESPONSE_MORE;
+    }
+}
+
+uint16_t ChangeJournalService::readSnapshot(Cursor& cursor, uint8_t* buffer, uint16_t size)
+{
+    uint16_t used = 0;
+    while (nextSnapshotCharacteristic(cursor))
+    {
+        auto characteristic = cursor.characteristic;
+        uint16_t valueLength = 0;
+        uint16_t entryLength = CHANGE_JOURNAL_ENTRY_HEADER_LENGTH;
+        bool omitted = CHANGE_JOURNAL_ENTRY_HEADER_LENGTH + characteristic->length() > size
+            || characteristic->length() > sizeof(m_valueBuffer);
+        if (!omitted)
+        {
+            entryLength += characteristic->length();
+        }
+
+        if (used + entryLength > size)
+        {
+            // continue with this characteristic in the next response
+            break;
+        }
+
+        if (!omitted)
+        {
+            try
+            {
+                valueLength = characteristic->length();
+                characteristic->read(m_valueBuffer, &valueLength);
+            }
+            catch (const std::exception& e)
+            {
+                ESP_LOGW(LOG_TAG, "error reading handle %u for snapshot: %s", characteristic->handle(), e.what());
+                omitted = true;
+            }
+        }
+
+        if (omitted)
+        {
+            putEntryHeader(buffer + used, cursor.sequence, characteristic->handle(),
+                CHANGE_JOURNAL_VALUE_OMITTED | characteristic->length());
+            used += CHANGE_JOURNAL_ENTRY_HEADER_LENGTH;
+        }
+        else
+        {
+            putEntryHeader(buffer + used, cursor.sequence, characteristic->handle(), valueLength);
+            memcpy(buffer + used + CHANGE_JOURNAL_ENTRY_HEADER_LENGTH, m_valueBuffer, valueLength);
+            used += CHANGE_JOURNAL_ENTRY_HEADER_LENGTH + valueLength;
+        }
+
+        cursor.characteristic = characteristic->nextCharacteristic();
+    }
+
+    if (!cursor.characteristic && !cursor.service)
+    {
+        // snapshot complete, changes made meanwhile follow from the journal
+        cursor.snapshot = false;
+    }
+
+    return used;
+}
+
+bool ChangeJournalService::nextSnapshotCharacteristic(Cursor& cursor)
+{
+    while (cursor.service)
+    {
+        while (cursor.characteristic)
+        {
+            auto characteristic = cursor.characteristic;
+            if (cursor.service != this
+                && characteristic->handle()
+                && (characteristic->permission() & CHANGE_JOURNAL_READ_PERMISSIONS))
+            {
+                return true;
+            }
+            cursor.characteristic = characteristic->nextCharacteristic();
+        }
+
+        cursor.service = cursor.service->nextService();
+        cursor.characteristic = cursor.service ? cursor.service->characteristics() : nullptr;
+    }
+
+    return false;
+}
+
+void ChangeJournalService::putEntryHeader(uint8_t* buffer, uint32_t sequence, uint16_t handle, uint16_t length)
+{
+    memcpy(buffer, &sequence, sizeof(sequence));
+    memcpy(buffer + 4, &handle, sizeof(handle));
+    memcpy(buffer + 6, &length, sizeof(length));
+}
+
+} /* namespace Esp32 */
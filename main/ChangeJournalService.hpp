@@ -0,0 +1,78 @@
+#ifndef MAIN_CHANGEJOURNALSERVICE_HPP_
+#define MAIN_CHANGEJOURNALSERVICE_HPP_
+
+#include "ChangeJournal.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+
+#define CHANGE_JOURNAL_RESPONSE_SNAPSHOT (0x01)
+#define CHANGE_JOURNAL_RESPONSE_MORE (0x02)
+#define CHANGE_JOURNAL_SNAPSHOT_VALUE_LENGTH_MAX (512)
+
+namespace Esp32
+{
+
+/*
+ * Catch-up synchronisation for clients which reconnect, based on the ChangeJournal (enable CONFIG_BLE_CHANGE_JOURNAL).
+ *
+ * Control characteristic: reading returns the current and the oldest journaled sequence number (u32 each), writing
+ * a u32 sequence number N requests all changes after N (0 for everything). The request is kept per connection.
+ *
+ * Data characteristic: each read returns a flags byte followed by as many journal entries (see ChangeJournal) as fit
+ * into the MTU of the connection. Keep reading while CHANGE_JOURNAL_RESPONSE_MORE is set, a response with only the
+ * flags byte means the client is up to date. If the changes after N are not journaled anymore (or N is from an earlier
+ * boot) a snapshot of all readable characteristics of the application follows instead, flagged with
+ * CHANGE_JOURNAL_RESPONSE_SNAPSHOT. Snapshot entries carry the sequence number at which the snapshot was started, the
+ * journal continues from there afterwards.
+ */
+class ChangeJournalService: public GattsService
+{
+public:
+    ChangeJournalService(
+        const BleServiceUuid& serviceId,
+        const BleUuid& controlCharacteristicId,
+        const BleUuid& dataCharacteristicId,
+        GattsApplication* application);
+    virtual ~ChangeJournalService();
+
+    void readCharacteristic(
+        uint16_t connectionId,
+        uint16_t handle,
+        uint16_t offset,
+        uint8_t* buffer,
+        uint16_t* length) override;
+    void writeCharacteristic(uint16_t connectionId, uint16_t handle, const uint8_t* buffer, uint16_t length) override;
+    void clearClientConfigurations(uint16_t connectionId) override;
+
+protected:
+
+    struct Cursor
+    {
+        Cursor();
+
+        bool requested;
+        bool snapshot;
+        uint32_t sequence;
+        GattsService* service;
+        GenericGattCharacteristic* characteristic;
+    };
+
+    GenericGattCharacteristic m_controlCharacteristic;
+    GenericGattCharacteristic m_dataCharacteristic;
+    GattsApplication* m_application;
+    Cursor m_cursors[GATT_CONNECTIONS_MAX];
+    uint8_t m_valueBuffer[CHANGE_JOURNAL_SNAPSHOT_VALUE_LENGTH_MAX];
+
+    void readChanges(uint16_t connectionId, uint8_t* buffer, uint16_t* length);
+    uint16_t readSnapshot(Cursor& cursor, uint8_t* buffer, uint16_t size);
+    bool nextSnapshotCharacteristic(Cursor& cursor);
+
+    static void putEntryHeader(uint8_t* buffer, uint32_t sequence, uint16_t handle, uint16_t length);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_CHANGEJOURNALSERVICE_HPP_ */
@@ -0,0 +1,258 @@
+#include <string.h>
+#include <esp_log.h>
+#include <stdexcept>
+#include "CharacteristicIndex.hpp"
+
+#define LOG_TAG "CharacteristicIndex"
+
+#define CHARACTERISTIC_INDEX_SEEDS_MAX (UINT16_MAX)
+
+namespace Esp32
+{
+
+CharacteristicIndex::CharacteristicIndex(
+    GenericGattCharacteristic** slots,
+    size_t capacity,
+    uint16_t* seeds,
+    uint8_t* bucketSizes,
+    size_t numberOfBuckets):
+    m_slots(slots),
+    m_capacity(capacity),
+    m_seeds(seeds),
+    m_bucketSizes(bucketSizes),
+    m_numberOfBuckets(numberOfBuckets),
+    m_size(0),
+    m_duplicates(0)
+{
+    if (!slots || !seeds || !bucketSizes)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (!capacity || !numberOfBuckets)
+    {
+        throw std::invalid_argument("invalid capacity");
+    }
+
+    clear();
+}
+
+CharacteristicIndex::~CharacteristicIndex()
+{
+}
+
+void CharacteristicIndex::build(const GattsApplication* application)
+{
+    build(&application, 1);
+}
+
+void CharacteristicIndex::build(const GattsApplication* const* applications, size_t numberOfApplications)
+{
+    if (!applications)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    clear();
+
+    // distribute the keys into buckets
+    size_t numberOfKeys = 0;
+    uint8_t largestBucket = 0;
+    for (size_t i = 0; i < numberOfApplications; ++i)
+    {
+        auto servicePointer = applications[i]->services();
+        while (servicePointer)
+        {
+            auto characteristicPointer = servicePointer->characteristics();
+            while (characteristicPointer)
+            {
+                auto bucket = reduce(hash(key(characteristicPointer->characteristicId()), 0), m_numberOfBuckets);
+                if (m_bucketSizes[bucket] >= CHARACTERISTIC_INDEX_BUCKET_SIZE_MAX)
+                {
+                    clear();
+                    throw std::runtime_error("characteristic index bucket overflow");
+                }
+                if (++m_bucketSizes[bucket] > largestBucket)
+                {
+                    largestBucket = m_bucketSizes[bucket];
+                }
+                ++numberOfKeys;
+
+                characteristicPointer = characteristicPointer->nextCharacteristic();
+            }
+            servicePointer = servicePointer->nextService();
+        }
+    }
+
+    if (numberOfKeys > m_capacity)
+    {
+        clear();
+        throw std::runtime_error("too many characteristics for the index");
+    }
+
+    // place the largest buckets first while most slots are still free
+    for (auto bucketSize = largestBucket; bucketSize > 0; --bucketSize)
+    {
+        for (size_t bucket = 0; bucket < m_numberOfBuckets; ++bucket)
+        {
+            if (m_bucketSizes[bucket] != bucketSize)
+            {
+                continue;
+            }
+
+            GenericGattCharacteristic* members[CHARACTERISTIC_INDEX_BUCKET_SIZE_MAX];
+            size_t slots[CHARACTERISTIC_INDEX_BUCKET_SIZE_MAX];
+            auto numberOfMembers = gatherBucket(applications, numberOfApplications, bucket, members);
+
+            uint32_t seed = 0;
+            while (!placeBucket(members, numberOfMembers, seed, slots))
+            {
+                if (++seed > CHARACTERISTIC_INDEX_SEEDS_MAX)
+                {
+                    clear();
+                    throw std::runtime_error("no perfect hash found, increase the index capacity");
+                }
+            }
+
+            m_seeds[bucket] = seed;
+            for (size_t i = 0; i < numberOfMembers; ++i)
+            {
+                m_slots[slots[i]] = members[i];
+            }
+            m_size += numberOfMembers;
+        }
+    }
+
+    ESP_LOGI(
+        LOG_TAG,
+        "indexed %u characteristics in %u slots, %u duplicate UUIDs skipped",
+        (unsigned) m_size,
+        (unsigned) m_capacity,
+        (unsigned) m_duplicates);
+}
+
+GenericGattCharacteristic* CharacteristicIndex::find(const BleUuid& uuid) const
+{
+    auto uuidKey = key(uuid);
+    auto bucket = reduce(hash(uuidKey, 0), m_numberOfBuckets);
+    auto characteristic = m_slots[reduce(hash(uuidKey, m_seeds[bucket] + 1), m_capacity)];
+
+    // keys which are not indexed land on an arbitrary slot
+    return characteristic && characteristic->characteristicId() == uuid ? characteristic : nullptr;
+}
+
+size_t CharacteristicIndex::size(void) const
+{
+    return m_size;
+}
+
+size_t CharacteristicIndex::capacity(void) const
+{
+    return m_capacity;
+}
+
+size_t CharacteristicIndex::duplicates(void) const
+{
+    return m_duplicates;
+}
+
+void CharacteristicIndex::clear(void)
+{
+    memset(m_slots, 0, m_capacity * sizeof(*m_slots));
+    memset(m_seeds, 0, m_numberOfBuckets * sizeof(*m_seeds));
+    memset(m_bucketSizes, 0, m_numberOfBuckets * sizeof(*m_bucketSizes));
+    m_size = 0;
+    m_duplicates = 0;
+}
+
+size_t CharacteristicIndex::gatherBucket(
+    const GattsApplication* const* applications,
+    size_t numberOfApplications,
+    size_t bucket,
+    GenericGattCharacteristic** members)
+{
+    size_t numberOfMembers = 0;
+    for (size_t i = 0; i < numberOfApplications; ++i)
+    {
+        auto servicePointer = applications[i]->services();
+        while (servicePointer)
+        {
+            auto characteristicPointer = servicePointer->characteristics();
+            while (characteristicPointer)
+            {
+                auto& uuid = characteristicPointer->characteristicId();
+                if (reduce(hash(key(uuid), 0), m_numberOfBuckets) == bucket)
+                {
+                    // equal UUIDs always share a bucket, only the first characteristic is kept
+                    bool duplicate = false;
+                    for (size_t j = 0; j < numberOfMembers && !duplicate; ++j)
+                    {
+                        duplicate = members[j]->characteristicId() == uuid;
+                    }
+
+                    if (duplicate)
+                    {
+                        ++m_duplicates;
+                    }
+                    else
+                    {
+                        members[numberOfMembers++] = characteristicPointer;
+                    }
+                }
+                characteristicPointer = characteristicPointer->nextCharacteristic();
+            }
+            servicePointer = servicePointer->nextService();
+        }
+    }
+    return numberOfMembers;
+}
+
+bool CharacteristicIndex::placeBucket(
+    GenericGattCharacteristic** members,
+    size_t numberOfMembers,
+    uint16_t seed,
+    size_t* slots)
+{
+    for (size_t i = 0; i < numberOfMembers; ++i)
+    {
+        slots[i] = reduce(hash(key(members[i]->characteristicId()), seed + 1), m_capacity);
+        if (m_slots[slots[i]])
+        {
+            return false;
+        }
+
+        for (size_t j = 0; j < i; ++j)
+        {
+            if (slots[j] == slots[i])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t CharacteristicIndex::key(const BleUuid& uuid)
+{
+    return uuid.uuid | ((uint64_t) uuid.width << 32) | ((uint64_t) uuid.baseIndex << 40);
+}
+
+uint32_t CharacteristicIndex::hash(uint64_t key, uint32_t seed)
+{
+    // finalizer of MurmurHash3, the seed selects one of a family of independent hash functions
+    key ^= seed * 0x9e3779b97f4a7c15ull;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return (uint32_t) key;
+}
+
+size_t CharacteristicIndex::reduce(uint32_t hash, size_t range)
+{
+    // maps the hash onto [0, range) by a multiplication instead of a division
+    return (size_t) (((uint64_t) hash * range) >> 32);
+}
+
+} /* namespace Esp32 */
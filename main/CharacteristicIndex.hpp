@@ -0,0 +1,109 @@
+#ifndef MAIN_CHARACTERISTICINDEX_HPP_
+#define MAIN_CHARACTERISTICINDEX_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "BleUuid.hpp"
+#include "GattsApplication.hpp"
+#include "GenericGattCharacteristic.hpp"
+
+#define CHARACTERISTIC_INDEX_KEYS_PER_BUCKET (4)
+#define CHARACTERISTIC_INDEX_BUCKET_SIZE_MAX (16)
+
+namespace Esp32
+{
+
+/*
+ * Constant time lookup of characteristics by UUID, for application code updating values without keeping its own
+ * pointers. build() computes a perfect hash (hash and displace) over the characteristic UUIDs of one or more
+ * applications: keys are distributed into buckets by a first hash, then each bucket gets a displacement seed for a
+ * second hash which places all its keys into distinct free slots. find() computes both hashes and compares the one
+ * candidate found, it neither allocates nor walks any list.
+ *
+ * Rebuild the index after services were added or removed at runtime. If a UUID is used by several characteristics only
+ * the first one is indexed. Storage is provided by StaticCharacteristicIndex below.
+ */
+class CharacteristicIndex
+{
+public:
+    CharacteristicIndex(
+        GenericGattCharacteristic** slots,
+        size_t capacity,
+        uint16_t* seeds,
+        uint8_t* bucketSizes,
+        size_t numberOfBuckets);
+    virtual ~CharacteristicIndex();
+
+    void build(const GattsApplication* application);
+    void build(const GattsApplication* const* applications, size_t numberOfApplications);
+    GenericGattCharacteristic* find(const BleUuid& uuid) const;
+
+    size_t size(void) const;
+    size_t capacity(void) const;
+    size_t duplicates(void) const;
+
+protected:
+
+    GenericGattCharacteristic** m_slots;
+    size_t m_capacity;
+    uint16_t* m_seeds;
+    uint8_t* m_bucketSizes;
+    size_t m_numberOfBuckets;
+    size_t m_size;
+    size_t m_duplicates;
+
+    void clear(void);
+    size_t gatherBucket(
+        const GattsApplication* const* applications,
+        size_t numberOfApplications,
+        size_t bucket,
+        GenericGattCharacteristic** members);
+    bool placeBucket(GenericGattCharacteristic** members, size_t numberOfMembers, uint16_t seed, size_t* slots);
+
+    static uint64_t key(const BleUuid& uuid);
+    static uint32_t hash(uint64_t key, uint32_t seed);
+    static size_t reduce(uint32_t hash, size_t range);
+
+private:
+
+};
+
+/*
+ * Index with statically allocated storage for up to CAPACITY characteristics. Choose CAPACITY about 25% above the
+ * number of characteristics to keep build() fast, a minimal index (CAPACITY equal to the number of characteristics)
+ * works as well but takes more attempts to place the last buckets.
+ */
+template<size_t CAPACITY>
+class StaticCharacteristicIndex: public CharacteristicIndex
+{
+public:
+    StaticCharacteristicIndex();
+    ~StaticCharacteristicIndex();
+
+protected:
+
+    static constexpr size_t numberOfBuckets =
+        (CAPACITY + CHARACTERISTIC_INDEX_KEYS_PER_BUCKET - 1) / CHARACTERISTIC_INDEX_KEYS_PER_BUCKET;
+
+    GenericGattCharacteristic* m_slotStorage[CAPACITY];
+    uint16_t m_seedStorage[numberOfBuckets];
+    uint8_t m_bucketSizeStorage[numberOfBuckets];
+
+private:
+
+};
+
+template<size_t CAPACITY>
+StaticCharacteristicIndex<CAPACITY>::StaticCharacteristicIndex():
+    CharacteristicIndex(m_slotStorage, CAPACITY, m_seedStorage, m_bucketSizeStorage, numberOfBuckets)
+{
+}
+
+template<size_t CAPACITY>
+StaticCharacteristicIndex<CAPACITY>::~StaticCharacteristicIndex()
+{
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_CHARACTERISTICINDEX_HPP_ */
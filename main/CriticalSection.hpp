@@ -0,0 +1,78 @@
+#ifndef MAIN_CRITICALSECTION_HPP_
+#define MAIN_CRITICALSECTION_HPP_
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#else
+#include <atomic>
+#endif
+
+namespace Esp32
+{
+
+/*
+ * Short critical section which may be entered from tasks on both cores and from ISRs. On the ESP32 it is a portMUX
+ * spinlock entered with portENTER_CRITICAL_SAFE(), built for the host (see test/host) it is a plain spinlock, so that
+ * header-only primitives using it can be tested with threads.
+ */
+class CriticalSection
+{
+public:
+    CriticalSection();
+
+    void enter(void);
+    void exit(void);
+
+protected:
+
+#ifdef ESP_PLATFORM
+    portMUX_TYPE m_lock;
+#else
+    std::atomic_flag m_lock;
+#endif
+
+private:
+
+};
+
+#ifdef ESP_PLATFORM
+
+inline CriticalSection::CriticalSection():
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+inline void CriticalSection::enter(void)
+{
+    portENTER_CRITICAL_SAFE(&m_lock);
+}
+
+inline void CriticalSection::exit(void)
+{
+    portEXIT_CRITICAL_SAFE(&m_lock);
+}
+
+#else
+
+inline CriticalSection::CriticalSection()
+{
+    m_lock.clear();
+}
+
+inline void CriticalSection::enter(void)
+{
+    while (m_lock.test_and_set(std::memory_order_acquire))
+    {
+    }
+}
+
+inline void CriticalSection::exit(void)
+{
+    m_lock.clear(std::memory_order_release);
+}
+
+#endif
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_CRITICALSECTION_HPP_ */
@@ -0,0 +1,50 @@
+#ifndef MAIN_DISPATCHSTATISTICS_HPP_
+#define MAIN_DISPATCHSTATISTICS_HPP_
+
+#include <stdint.h>
+#include <esp_cpu.h>
+#include <sdkconfig.h>
+
+#ifdef CONFIG_BLE_SERVER_DISPATCH_STATISTICS
+#define DISPATCH_STATISTICS_START() auto dispatchStart = esp_cpu_get_cycle_count()
+#define DISPATCH_STATISTICS_STOP(statistics) \
+    do { \
+        (statistics).cycles += (uint32_t)(esp_cpu_get_cycle_count() - dispatchStart); \
+        ++(statistics).events; \
+    } while (0)
+#else
+#define DISPATCH_STATISTICS_START() do {} while (0)
+#define DISPATCH_STATISTICS_STOP(statistics) do {} while (0)
+#endif
+
+namespace Esp32
+{
+
+/*
+ * Number of dispatched events and CPU cycles spent on dispatching them, only updated if
+ * CONFIG_BLE_SERVER_DISPATCH_STATISTICS is enabled.
+ */
+struct DispatchStatistics
+{
+    DispatchStatistics();
+
+    uint32_t events;
+    uint64_t cycles;
+
+    uint32_t cyclesPerEvent(void) const;
+};
+
+inline DispatchStatistics::DispatchStatistics():
+    events(0),
+    cycles(0)
+{
+}
+
+inline uint32_t DispatchStatistics::cyclesPerEvent(void) const
+{
+    return events ? (uint32_t)(cycles / events) : 0;
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_DISPATCHSTATISTICS_HPP_ */
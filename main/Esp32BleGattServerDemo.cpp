@@ -5,6 +5,7 @@
 #include "GattsApplication.hpp"
 #include "GattsService.hpp"
 #include "NonVolatileStorage.hpp"
+#include "NotificationDispatcher.hpp"
 #include "UInt16GattCharacteristic.hpp"
 
 #define LOG_TAG "Main"
@@ -58,6 +59,10 @@ void app_main(void)
         ESP_LOGI(LOG_TAG, "NonVolatileStorage: probing done");
         BleServer::instance()->probe();
         ESP_LOGI(LOG_TAG, "BleServer: probing done");
+        NotificationDispatcher::instance()->probe();
+        ESP_LOGI(LOG_TAG, "NotificationDispatcher: probing done");
+
+        characteristicA2.setNotification(GenericGattCharacteristic::Notification::NOTIFY);
 
         gattsServiceA.addCharacteristic(&characteristicA1);
         gattsServiceA.addCharacteristic(&characteristicA2);
@@ -69,8 +74,8 @@ void app_main(void)
         gattsServiceC.addCharacteristic(&characteristicC);
         gattsApplication.addService(&gattsServiceC);
 
-        BleServer::instance()->setGattsApplication(&gattsApplication);
-        ESP_LOGI(LOG_TAG, "BleServer: GATTS application successfully set");
+        BleServer::instance()->addGattsApplication(&gattsApplication);
+        ESP_LOGI(LOG_TAG, "BleServer: GATTS application successfully added");
     }
     catch(const std::exception& e)
     {
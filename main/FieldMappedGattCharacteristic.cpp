@@ -0,0 +1,220 @@
+#include <string.h>
+#include <stdexcept>
+#include "FieldMappedGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+FieldMappedGattCharacteristic::FieldMappedGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint8_t* structure,
+    size_t structureSize,
+    const StructField* fields,
+    size_t numberOfFields,
+    uint16_t permission,
+    const char* description):
+    GenericGattCharacteristic(characteristicId, valueLength(fields, numberOfFields), permission, description),
+    m_structure(structure),
+    m_structureSize(structureSize),
+    m_fields(fields),
+    m_numberOfFields(numberOfFields),
+    m_fieldsChanged(nullptr),
+    m_fieldsChangedContext(nullptr),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    if (!structure)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    // the structure belongs to a derived class which is not constructed yet, only its layout may be checked
+    for (size_t i = 0; i < numberOfFields; ++i)
+    {
+        if (!fields[i].size || fields[i].offset + fields[i].size > structureSize)
+        {
+            throw std::invalid_argument("field outside of the structure");
+        }
+    }
+}
+
+FieldMappedGattCharacteristic::~FieldMappedGattCharacteristic()
+{
+}
+
+void FieldMappedGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    portENTER_CRITICAL_SAFE(&m_lock);
+    auto bufferPointer = buffer;
+    for (size_t i = 0; i < m_numberOfFields; ++i)
+    {
+        auto& field = m_fields[i];
+        auto fieldPointer = m_structure + field.offset;
+        if (field.byteOrder == StructField::ByteOrder::BIG)
+        {
+            for (size_t j = field.size; j > 0; --j)
+            {
+                *bufferPointer++ = fieldPointer[j - 1];
+            }
+        }
+        else
+        {
+            memcpy(bufferPointer, fieldPointer, field.size);
+            bufferPointer += field.size;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&m_lock);
+
+    *length = m_length;
+}
+
+void FieldMappedGattCharacteristic::write(const uint8_t* buffer, uint16_t length)
+{
+    writeAt(0, 0, buffer, length);
+}
+
+void FieldMappedGattCharacteristic::writeAt(
+    uint16_t connectionId,
+    uint16_t offset,
+    const uint8_t* buffer,
+    uint16_t length)
+{
+    if (offset > m_length)
+    {
+        throw std::out_of_range("write offset beyond the value");
+    }
+
+    if (offset + length > m_length)
+    {
+        throw std::length_error("value exceeds the maximum length");
+    }
+
+    uint32_t changedFields = 0;
+    uint16_t end = offset + length;
+    uint16_t fieldStart = 0;
+
+    portENTER_CRITICAL_SAFE(&m_lock);
+    for (size_t i = 0; i < m_numberOfFields && fieldStart < end; ++i)
+    {
+        auto& field = m_fields[i];
+        uint16_t fieldEnd = fieldStart + field.size;
+
+        // the written bytes within this field, if any
+        uint16_t position = offset > fieldStart ? offset : fieldStart;
+        for (; position < end && position < fieldEnd; ++position)
+        {
+            uint16_t index = position - fieldStart;
+            if (field.byteOrder == StructField::ByteOrder::BIG)
+            {
+                index = field.size - 1 - index;
+            }
+
+            auto& target = m_structure[field.offset + index];
+            if (target != buffer[position - offset])
+            {
+                target = buffer[position - offset];
+                changedFields |= 1UL << i;
+            }
+        }
+        fieldStart = fieldEnd;
+    }
+    portEXIT_CRITICAL_SAFE(&m_lock);
+
+    if (!changedFields)
+    {
+        return;
+    }
+
+    valueChanged();
+    if (m_fieldsChanged)
+    {
+        m_fieldsChanged(m_fieldsChangedContext, this, changedFields);
+    }
+}
+
+size_t FieldMappedGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
+void FieldMappedGattCharacteristic::setFieldsChangedCallback(FieldsChanged fieldsChanged, void* context)
+{
+    m_fieldsChanged = fieldsChanged;
+    m_fieldsChangedContext = context;
+}
+
+size_t FieldMappedGattCharacteristic::numberOfFields(void) const
+{
+    return m_numberOfFields;
+}
+
+uint16_t FieldMappedGattCharacteristic::fieldOffset(size_t index) const
+{
+    if (index >= m_numberOfFields)
+    {
+        throw std::out_of_range("field index out of range");
+    }
+
+    uint16_t offset = 0;
+    for (size_t i = 0; i < index; ++i)
+    {
+        offset += m_fields[i].size;
+    }
+    return offset;
+}
+
+void FieldMappedGattCharacteristic::loadStructure(void* structure) const
+{
+    portENTER_CRITICAL_SAFE(&m_lock);
+    memcpy(structure, m_structure, m_structureSize);
+    portEXIT_CRITICAL_SAFE(&m_lock);
+}
+
+void FieldMappedGattCharacteristic::storeStructure(const void* structure)
+{
+    portENTER_CRITICAL_SAFE(&m_lock);
+    memcpy(m_structure, structure, m_structureSize);
+    portEXIT_CRITICAL_SAFE(&m_lock);
+
+    valueChanged();
+}
+
+void FieldMappedGattCharacteristic::valueChanged(void)
+{
+    // the journal keeps complete values, partial writes are journaled by their result
+    uint8_t value[FIELD_MAPPED_VALUE_LENGTH_MAX];
+    uint16_t length;
+    read(value, &length);
+    journalChange(value, length);
+
+    if (m_notification != Notification::NONE)
+    {
+        notify();
+    }
+}
+
+uint16_t FieldMappedGattCharacteristic::valueLength(const StructField* fields, size_t numberOfFields)
+{
+    if (!fields)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (!numberOfFields || numberOfFields > FIELD_MAPPED_FIELDS_MAX)
+    {
+        throw std::invalid_argument("invalid number of fields");
+    }
+
+    size_t length = 0;
+    for (size_t i = 0; i < numberOfFields; ++i)
+    {
+        length += fields[i].size;
+    }
+
+    if (length > FIELD_MAPPED_VALUE_LENGTH_MAX)
+    {
+        throw std::invalid_argument("mapped value too long");
+    }
+    return length;
+}
+
+} /* namespace Esp32 */
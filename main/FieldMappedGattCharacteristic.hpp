@@ -0,0 +1,186 @@
+#ifndef MAIN_FIELDMAPPEDGATTCHARACTERISTIC_HPP_
+#define MAIN_FIELDMAPPEDGATTCHARACTERISTIC_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include "GenericGattCharacteristic.hpp"
+
+#define FIELD_MAPPED_FIELDS_MAX (32)
+#define FIELD_MAPPED_VALUE_LENGTH_MAX (128)
+
+// describes a member of a struct mapped by StructGattCharacteristic, in the order of the characteristic value
+#define STRUCT_FIELD(type, member) \
+    { offsetof(type, member), sizeof(type::member), Esp32::StructField::ByteOrder::LITTLE }
+#define STRUCT_FIELD_BIG_ENDIAN(type, member) \
+    { offsetof(type, member), sizeof(type::member), Esp32::StructField::ByteOrder::BIG }
+
+namespace Esp32
+{
+
+struct StructField
+{
+    enum class ByteOrder: uint8_t
+    {
+        LITTLE,
+        BIG,
+    };
+
+    uint16_t offset;
+    uint16_t size;
+    ByteOrder byteOrder;
+};
+
+/*
+ * Characteristic whose value is a struct in memory, encoded field by field as given by a list of StructField
+ * descriptors: fields follow each other without padding in the order of the list, each in the given byte order (the
+ * struct itself keeps the little endian order of the CPU). Thus one characteristic, i.e. three attributes and one
+ * round trip, carries a whole configuration instead of one characteristic per field.
+ *
+ * Writes may start at an offset (prepared writes) and cover any part of the value, only the bytes written are
+ * updated. The fields changed by a client write are reported to the FieldsChanged callback as a bit mask of the field
+ * indices, writes not changing anything are not reported.
+ *
+ * Use StructGattCharacteristic below which provides the storage and typed access.
+ */
+class FieldMappedGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    typedef void (*FieldsChanged)(void* context, FieldMappedGattCharacteristic* characteristic, uint32_t fields);
+
+    FieldMappedGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint8_t* structure,
+        size_t structureSize,
+        const StructField* fields,
+        size_t numberOfFields,
+        uint16_t permission = ESP_GATT_PERM_READ,
+        const char* description = nullptr);
+    virtual ~FieldMappedGattCharacteristic();
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    void write(const uint8_t* buffer, uint16_t length) override;
+    void writeAt(uint16_t connectionId, uint16_t offset, const uint8_t* buffer, uint16_t length) override;
+    size_t objectSize(void) const override;
+
+    void setFieldsChangedCallback(FieldsChanged fieldsChanged, void* context);
+    size_t numberOfFields(void) const;
+    uint16_t fieldOffset(size_t index) const;
+
+protected:
+
+    uint8_t* m_structure;
+    size_t m_structureSize;
+    const StructField* m_fields;
+    size_t m_numberOfFields;
+    FieldsChanged m_fieldsChanged;
+    void* m_fieldsChangedContext;
+    mutable portMUX_TYPE m_lock;
+
+    void loadStructure(void* structure) const;
+    void storeStructure(const void* structure);
+    void valueChanged(void);
+
+    static uint16_t valueLength(const StructField* fields, size_t numberOfFields);
+
+private:
+
+};
+
+/*
+ * Characteristic mapping a trivially copyable struct T, e.g.
+ *
+ *   struct Configuration
+ *   {
+ *       uint16_t interval;
+ *       uint8_t mode;
+ *       uint32_t threshold;
+ *   };
+ *
+ *   static constexpr StructField configurationFields[] = {
+ *       STRUCT_FIELD(Configuration, interval),
+ *       STRUCT_FIELD(Configuration, mode),
+ *       STRUCT_FIELD_BIG_ENDIAN(Configuration, threshold),
+ *   };
+ *
+ *   static StructGattCharacteristic<Configuration> configuration(uuid, configurationFields, {1000, 0, 50});
+ *
+ * is a characteristic of 7 bytes. The field list has to outlive the characteristic.
+ */
+template<typename T>
+class StructGattCharacteristic: public FieldMappedGattCharacteristic
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "mapped struct needs to be trivially copyable");
+
+    template<size_t N>
+    StructGattCharacteristic(
+        const BleUuid& characteristicId,
+        const StructField (&fields)[N],
+        const T& value = T(),
+        uint16_t permission = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        const char* description = nullptr);
+    ~StructGattCharacteristic();
+
+    size_t objectSize(void) const override;
+
+    T value(void) const;
+    void setValue(const T& value);
+
+protected:
+
+    T m_value;
+
+private:
+
+};
+
+template<typename T>
+template<size_t N>
+StructGattCharacteristic<T>::StructGattCharacteristic(
+    const BleUuid& characteristicId,
+    const StructField (&fields)[N],
+    const T& value,
+    uint16_t permission,
+    const char* description):
+    FieldMappedGattCharacteristic(
+        characteristicId,
+        (uint8_t*) &m_value,
+        sizeof(T),
+        fields,
+        N,
+        permission,
+        description),
+    m_value(value)
+{
+}
+
+template<typename T>
+StructGattCharacteristic<T>::~StructGattCharacteristic()
+{
+}
+
+template<typename T>
+size_t StructGattCharacteristic<T>::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
+template<typename T>
+T StructGattCharacteristic<T>::value(void) const
+{
+    T value;
+    loadStructure(&value);
+    return value;
+}
+
+template<typename T>
+void StructGattCharacteristic<T>::setValue(const T& value)
+{
+    storeStructure(&value);
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_FIELDMAPPEDGATTCHARACTERISTIC_HPP_ */
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <sdkconfig.h>
+#include <stdexcept>
+#include "GattArena.hpp"
+
+#ifdef CONFIG_BLE_GATT_ARENA_SIZE
+#define GATT_ARENA_SIZE (CONFIG_BLE_GATT_ARENA_SIZE)
+#else
+#define GATT_ARENA_SIZE (1024)
+#endif
+
+namespace Esp32
+{
+
+static GattArena gattArena;
+
+alignas(8) static uint8_t gattArenaStorage[GATT_ARENA_SIZE];
+
+GattArena::GattArena():
+    m_used(0),
+    m_highWaterMark(0)
+{
+}
+
+GattArena::~GattArena()
+{
+}
+
+void* GattArena::allocate(size_t size, size_t alignment)
+{
+    auto offset = (m_used + alignment - 1) & ~(alignment - 1);
+    if (offset + size > sizeof(gattArenaStorage))
+    {
+        char buffer[80];
+        snprintf(
+            buffer,
+            sizeof(buffer) - 1,
+            "GATT arena exhausted (requested %u bytes, %u of %u in use)",
+            (unsigned) size,
+            (unsigned) m_used,
+            (unsigned) sizeof(gattArenaStorage));
+        throw std::runtime_error(buffer);
+    }
+
+    m_used = offset + size;
+    if (m_used > m_highWaterMark)
+    {
+        m_highWaterMark = m_used;
+    }
+    return gattArenaStorage + offset;
+}
+
+size_t GattArena::mark(void) const
+{
+    return m_used;
+}
+
+void GattArena::release(size_t mark)
+{
+    if (mark > m_used)
+    {
+        throw std::invalid_argument("invalid arena mark");
+    }
+    m_used = mark;
+}
+
+size_t GattArena::capacity(void) const
+{
+    return sizeof(gattArenaStorage);
+}
+
+size_t GattArena::used(void) const
+{
+    return m_used;
+}
+
+size_t GattArena::highWaterMark(void) const
+{
+    return m_highWaterMark;
+}
+
+GattArena* GattArena::instance(void)
+{
+    return &gattArena;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,41 @@
+#ifndef MAIN_GATTARENA_HPP_
+#define MAIN_GATTARENA_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Esp32
+{
+
+/*
+ * Statically allocated bump allocator for all GATT database allocations. Memory is released in LIFO order by
+ * rewinding to a mark previously taken with mark().
+ */
+class GattArena
+{
+public:
+    GattArena();
+    virtual ~GattArena();
+
+    void* allocate(size_t size, size_t alignment = alignof(void*));
+    size_t mark(void) const;
+    void release(size_t mark);
+
+    size_t capacity(void) const;
+    size_t used(void) const;
+    size_t highWaterMark(void) const;
+
+    static GattArena* instance(void);
+
+protected:
+
+    size_t m_used;
+    size_t m_highWaterMark;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_GATTARENA_HPP_ */
@@ -0,0 +1,220 @@
+#include <stdexcept>
+#include "GattSchema.hpp"
+
+#define GATT_SCHEMA_SERVICE_LENGTH (4)
+#define GATT_SCHEMA_CHARACTERISTIC_LENGTH (12)
+#define GATT_SCHEMA_FLAG_ADVERTISE (0x01)
+#define GATT_SCHEMA_NOTIFICATION_MAX (2)
+
+namespace Esp32
+{
+
+GattSchema::GattSchema(const uint8_t* data, size_t size):
+    m_data(data),
+    m_length(0),
+    m_numberOfServices(0),
+    m_numberOfCharacteristics(0)
+{
+    if (!data)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (size < GATT_SCHEMA_HEADER_LENGTH || readUInt32(data) != GATT_SCHEMA_MAGIC)
+    {
+        throw std::invalid_argument("not a GATT schema");
+    }
+
+    if (data[4] != GATT_SCHEMA_VERSION)
+    {
+        throw std::invalid_argument("unsupported GATT schema version");
+    }
+
+    // the partition is usually larger than the schema, the header tells the real length
+    m_length = readUInt32(data + 8);
+    if (m_length < GATT_SCHEMA_HEADER_LENGTH || m_length > size)
+    {
+        throw std::invalid_argument("invalid GATT schema length");
+    }
+
+    if (crc32(data + GATT_SCHEMA_HEADER_LENGTH, m_length - GATT_SCHEMA_HEADER_LENGTH) != readUInt32(data + 12))
+    {
+        throw std::invalid_argument("GATT schema checksum mismatch");
+    }
+
+    m_numberOfServices = data[5];
+    validate();
+}
+
+GattSchema::~GattSchema()
+{
+}
+
+uint8_t GattSchema::numberOfServices(void) const
+{
+    return m_numberOfServices;
+}
+
+size_t GattSchema::numberOfCharacteristics(void) const
+{
+    return m_numberOfCharacteristics;
+}
+
+size_t GattSchema::length(void) const
+{
+    return m_length;
+}
+
+const uint8_t* GattSchema::firstRecord(void) const
+{
+    return m_data + GATT_SCHEMA_HEADER_LENGTH;
+}
+
+const uint8_t* GattSchema::readService(const uint8_t* record, Service* service) const
+{
+    checkBounds(record, GATT_SCHEMA_SERVICE_LENGTH);
+
+    service->uuidLength = record[0];
+    service->advertise = (record[1] & GATT_SCHEMA_FLAG_ADVERTISE) != 0;
+    service->numberOfCharacteristics = record[2];
+    record += GATT_SCHEMA_SERVICE_LENGTH;
+
+    auto uuidLength = uuidFieldLength(service->uuidLength);
+    checkBounds(record, uuidLength);
+    service->uuid = record;
+
+    return record + uuidLength;
+}
+
+const uint8_t* GattSchema::readCharacteristic(const uint8_t* record, Characteristic* characteristic) const
+{
+    checkBounds(record, GATT_SCHEMA_CHARACTERISTIC_LENGTH);
+
+    characteristic->uuidLength = record[0];
+    characteristic->notification = record[1];
+    characteristic->permission = readUInt16(record + 2);
+    characteristic->length = readUInt16(record + 4);
+    characteristic->initialValueLength = readUInt16(record + 6);
+    auto descriptionLength = readUInt16(record + 8);
+    record += GATT_SCHEMA_CHARACTERISTIC_LENGTH;
+
+    if (characteristic->notification > GATT_SCHEMA_NOTIFICATION_MAX)
+    {
+        throw std::invalid_argument("invalid notification in GATT schema");
+    }
+
+    if (characteristic->permission & ~(GATT_SCHEMA_PERMISSION_READ | GATT_SCHEMA_PERMISSION_WRITE))
+    {
+        throw std::invalid_argument("unsupported permission in GATT schema");
+    }
+
+    if (!characteristic->length
+        || characteristic->length > GATT_SCHEMA_VALUE_LENGTH_MAX
+        || characteristic->initialValueLength > characteristic->length)
+    {
+        throw std::invalid_argument("invalid value length in GATT schema");
+    }
+
+    auto uuidLength = uuidFieldLength(characteristic->uuidLength);
+    checkBounds(record, uuidLength);
+    characteristic->uuid = record;
+    record += uuidLength;
+
+    checkBounds(record, padded(characteristic->initialValueLength));
+    characteristic->initialValue = record;
+    record += padded(characteristic->initialValueLength);
+
+    characteristic->description = nullptr;
+    if (descriptionLength)
+    {
+        checkBounds(record, padded(descriptionLength));
+        if (record[descriptionLength - 1] != '\0')
+        {
+            throw std::invalid_argument("unterminated description in GATT schema");
+        }
+        characteristic->description = (const char*) record;
+        record += padded(descriptionLength);
+    }
+
+    return record;
+}
+
+uint32_t GattSchema::crc32(const uint8_t* data, size_t length)
+{
+    // bitwise CRC-32 (IEEE 802.3), same as zlib.crc32() of the compiler, the schema is only checked once at startup
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void GattSchema::validate(void)
+{
+    auto record = firstRecord();
+    for (uint8_t i = 0; i < m_numberOfServices; ++i)
+    {
+        Service service;
+        record = readService(record, &service);
+        if (!service.numberOfCharacteristics)
+        {
+            throw std::invalid_argument("service without characteristics in GATT schema");
+        }
+
+        for (uint8_t j = 0; j < service.numberOfCharacteristics; ++j)
+        {
+            Characteristic characteristic;
+            record = readCharacteristic(record, &characteristic);
+            ++m_numberOfCharacteristics;
+        }
+    }
+
+    if (record != m_data + m_length)
+    {
+        throw std::invalid_argument("trailing data in GATT schema");
+    }
+}
+
+void GattSchema::checkBounds(const uint8_t* record, size_t length) const
+{
+    if (record < m_data || (size_t) (record - m_data) + length > m_length)
+    {
+        throw std::invalid_argument("truncated GATT schema");
+    }
+}
+
+uint16_t GattSchema::readUInt16(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+uint32_t GattSchema::readUInt32(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+size_t GattSchema::padded(size_t length)
+{
+    return (length + 3) & ~(size_t) 3;
+}
+
+size_t GattSchema::uuidFieldLength(uint8_t uuidLength)
+{
+    switch (uuidLength)
+    {
+        case 2:
+        case 4:
+            return 4;
+        case 16:
+            return 16;
+        default:
+            throw std::invalid_argument("invalid UUID length in GATT schema");
+    }
+}
+
+} /* namespace Esp32 */
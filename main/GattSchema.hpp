@@ -0,0 +1,92 @@
+#ifndef MAIN_GATTSCHEMA_HPP_
+#define MAIN_GATTSCHEMA_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GATT_SCHEMA_MAGIC (0x48435347)  // "GSCH"
+#define GATT_SCHEMA_VERSION (1)
+#define GATT_SCHEMA_HEADER_LENGTH (16)
+#define GATT_SCHEMA_VALUE_LENGTH_MAX (512)
+// ESP_GATT_PERM_READ and ESP_GATT_PERM_WRITE, the only permissions GattsService supports
+#define GATT_SCHEMA_PERMISSION_READ (0x0001)
+#define GATT_SCHEMA_PERMISSION_WRITE (0x0010)
+
+namespace Esp32
+{
+
+/*
+ * Read-only view of a binary GATT schema as generated by tools/gatt_schema.py. All integers are little endian, all
+ * records start at a multiple of four bytes:
+ *
+ *   header          magic "GSCH", u8 version, u8 number of services, u16 reserved,
+ *                   u32 total length (including the header), u32 CRC-32 of everything after the header
+ *   service         u8 UUID length (2, 4 or 16), u8 flags (bit 0: advertise), u8 number of characteristics,
+ *                   u8 reserved, UUID (4 bytes for 16/32 bit UUIDs, otherwise 16 bytes)
+ *   characteristic  u8 UUID length, u8 notification (0 none, 1 notify, 2 indicate), u16 permission (ESP_GATT_PERM_READ
+ *                   and/or ESP_GATT_PERM_WRITE, encrypted and signed access is rejected),
+ *                   u16 maximum value length, u16 initial value length, u16 description length including the
+ *                   terminating zero (0 = no description), u16 reserved, UUID, initial value, description
+ *
+ * Each service is followed by its characteristics, initial value and description are padded to four bytes. The
+ * constructor validates the complete schema and throws on the first error, afterwards the accessors return pointers
+ * into the schema itself so nothing is copied. The class does not depend on ESP-IDF and can be used on a host.
+ */
+class GattSchema
+{
+public:
+    struct Service
+    {
+        uint8_t uuidLength;
+        const uint8_t* uuid;
+        bool advertise;
+        uint8_t numberOfCharacteristics;
+    };
+
+    struct Characteristic
+    {
+        uint8_t uuidLength;
+        const uint8_t* uuid;
+        uint8_t notification;
+        uint16_t permission;
+        uint16_t length;
+        const uint8_t* initialValue;
+        uint16_t initialValueLength;
+        const char* description;
+    };
+
+    GattSchema(const uint8_t* data, size_t size);
+    virtual ~GattSchema();
+
+    uint8_t numberOfServices(void) const;
+    size_t numberOfCharacteristics(void) const;
+    size_t length(void) const;
+
+    const uint8_t* firstRecord(void) const;
+    const uint8_t* readService(const uint8_t* record, Service* service) const;
+    const uint8_t* readCharacteristic(const uint8_t* record, Characteristic* characteristic) const;
+
+    static uint32_t crc32(const uint8_t* data, size_t length);
+
+protected:
+
+    const uint8_t* m_data;
+    size_t m_length;
+    uint8_t m_numberOfServices;
+    size_t m_numberOfCharacteristics;
+
+    void validate(void);
+    void checkBounds(const uint8_t* record, size_t length) const;
+
+    static uint16_t readUInt16(const uint8_t* data);
+    static uint32_t readUInt32(const uint8_t* data);
+    static size_t padded(size_t length);
+    static size_t uuidFieldLength(uint8_t uuidLength);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_GATTSCHEMA_HPP_ */
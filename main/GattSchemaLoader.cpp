@@ -0,0 +1,142 @@
+#include <esp_log.h>
+#include <new>
+#include <stdexcept>
+#include "GattArena.hpp"
+#include "GattSchemaLoader.hpp"
+#include "SchemaGattCharacteristic.hpp"
+
+#define LOG_TAG "GattSchemaLoader"
+
+#define GATT_SCHEMA_PERM_WRITE_MASK (ESP_GATT_PERM_WRITE | ESP_GATT_PERM_WRITE_ENCRYPTED | ESP_GATT_PERM_WRITE_ENC_MITM)
+
+namespace Esp32
+{
+
+GattSchemaLoader::GattSchemaLoader():
+    m_mmapHandle(0),
+    m_numberOfServices(0),
+    m_numberOfCharacteristics(0)
+{
+}
+
+GattSchemaLoader::~GattSchemaLoader()
+{
+}
+
+void GattSchemaLoader::load(GattsApplication* application, const char* partitionLabel)
+{
+    ESP_LOGD(LOG_TAG, "GattSchemaLoader::load(%s)", partitionLabel);
+
+    auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+    if (!partition)
+    {
+        throw std::runtime_error("GATT schema partition not found");
+    }
+
+    const void* schema = nullptr;
+    if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &schema, &m_mmapHandle) != ESP_OK)
+    {
+        throw std::runtime_error("error mapping the GATT schema partition");
+    }
+
+    // the mapping is kept on success, descriptions and values point into it
+    try
+    {
+        load(application, (const uint8_t*) schema, partition->size);
+    }
+    catch(...)
+    {
+        spi_flash_munmap(m_mmapHandle);
+        m_mmapHandle = 0;
+        throw;
+    }
+}
+
+void GattSchemaLoader::load(GattsApplication* application, const uint8_t* schema, size_t size)
+{
+    if (!application)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    GattSchema gattSchema(schema, size);
+    auto arena = GattArena::instance();
+
+    auto record = gattSchema.firstRecord();
+    for (uint8_t i = 0; i < gattSchema.numberOfServices(); ++i)
+    {
+        GattSchema::Service serviceRecord;
+        record = gattSchema.readService(record, &serviceRecord);
+
+        auto service = new (arena->allocate(sizeof(GattsService), alignof(GattsService))) GattsService(
+            BleServiceUuid(uuidFromSchema(serviceRecord.uuidLength, serviceRecord.uuid), serviceRecord.advertise));
+
+        for (uint8_t j = 0; j < serviceRecord.numberOfCharacteristics; ++j)
+        {
+            GattSchema::Characteristic characteristicRecord;
+            record = gattSchema.readCharacteristic(record, &characteristicRecord);
+
+            // read-only values stay in flash
+            uint8_t* valueBuffer = nullptr;
+            if (characteristicRecord.permission & GATT_SCHEMA_PERM_WRITE_MASK)
+            {
+                valueBuffer = (uint8_t*) arena->allocate(characteristicRecord.length, 1);
+            }
+
+            auto characteristic = new (arena->allocate(
+                sizeof(SchemaGattCharacteristic),
+                alignof(SchemaGattCharacteristic))) SchemaGattCharacteristic(
+                    uuidFromSchema(characteristicRecord.uuidLength, characteristicRecord.uuid),
+                    characteristicRecord.length,
+                    characteristicRecord.permission,
+                    characteristicRecord.description,
+                    characteristicRecord.initialValue,
+                    characteristicRecord.initialValueLength,
+                    valueBuffer);
+            if (characteristicRecord.notification)
+            {
+                characteristic->setNotification(
+                    (GenericGattCharacteristic::Notification) characteristicRecord.notification);
+            }
+
+            service->addCharacteristic(characteristic);
+            ++m_numberOfCharacteristics;
+        }
+
+        application->addService(service);
+        ++m_numberOfServices;
+    }
+
+    ESP_LOGI(
+        LOG_TAG,
+        "GATT schema loaded: %u services, %u characteristics, %u bytes",
+        (unsigned) m_numberOfServices,
+        (unsigned) m_numberOfCharacteristics,
+        (unsigned) gattSchema.length());
+}
+
+size_t GattSchemaLoader::numberOfServices(void) const
+{
+    return m_numberOfServices;
+}
+
+size_t GattSchemaLoader::numberOfCharacteristics(void) const
+{
+    return m_numberOfCharacteristics;
+}
+
+BleUuid GattSchemaLoader::uuidFromSchema(uint8_t uuidLength, const uint8_t* uuid)
+{
+    uint32_t value = uuid[0] | (uuid[1] << 8) | (uuid[2] << 16) | ((uint32_t) uuid[3] << 24);
+    switch (uuidLength)
+    {
+        case 2:
+            return BleUuid(BleUuid::Width::UUID_16, value & 0xffff);
+        case 4:
+            return BleUuid(BleUuid::Width::UUID_32, value);
+        default:
+            return BleUuid(uuid);
+    }
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,50 @@
+#ifndef MAIN_GATTSCHEMALOADER_HPP_
+#define MAIN_GATTSCHEMALOADER_HPP_
+
+#include <esp_partition.h>
+#include <sdkconfig.h>
+#include "GattSchema.hpp"
+#include "GattsApplication.hpp"
+
+#ifdef CONFIG_BLE_GATT_SCHEMA_PARTITION_LABEL
+#define GATT_SCHEMA_PARTITION_LABEL CONFIG_BLE_GATT_SCHEMA_PARTITION_LABEL
+#else
+#define GATT_SCHEMA_PARTITION_LABEL "gatt_schema"
+#endif
+
+namespace Esp32
+{
+
+/*
+ * Builds services and characteristics from a binary GATT schema (see GattSchema) and adds them to a GATTS
+ * application. The schema is memory mapped from a data partition and stays mapped, UUIDs of 16/32 bit, descriptions
+ * and read-only values are used in place. Only the service/characteristic objects and the buffers of writable values
+ * are allocated, both from the GATT arena.
+ */
+class GattSchemaLoader
+{
+public:
+    GattSchemaLoader();
+    virtual ~GattSchemaLoader();
+
+    void load(GattsApplication* application, const char* partitionLabel = GATT_SCHEMA_PARTITION_LABEL);
+    void load(GattsApplication* application, const uint8_t* schema, size_t size);
+
+    size_t numberOfServices(void) const;
+    size_t numberOfCharacteristics(void) const;
+
+protected:
+
+    spi_flash_mmap_handle_t m_mmapHandle;
+    size_t m_numberOfServices;
+    size_t m_numberOfCharacteristics;
+
+    static BleUuid uuidFromSchema(uint8_t uuidLength, const uint8_t* uuid);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_GATTSCHEMALOADER_HPP_ */
@@ -1,12 +1,16 @@
 #include <string.h>
 #include <esp_log.h>
 #include <stdexcept>
+#include "GattArena.hpp"
 #include "GattsApplication.hpp"
+#include "HandleIndex.hpp"
+#include "NotificationDispatcher.hpp"
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+#include "PendingTransactions.hpp"
+#endif
 
 #define LOG_TAG "GattsApplication"
 
-#define ADVERTISEMENT_LENGTH_MAX (31)
-
 #define CONFIGURATION_ADVERTISEMENT_PENDING (1 << 0)
 #define CONFIGURATION_SCAN_RESPONSE_PENDING (1 << 1)
 
@@ -15,6 +19,7 @@ namespace Esp32
 
 const uint8_t GattsApplication::advertisementFlags[3] = { 0x02, 0x01, 0x06 };
 
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 esp_ble_adv_params_t GattsApplication::advertisementParameters = {
     .adv_int_min = 0x20,
     .adv_int_max = 0x40,
@@ -24,10 +29,10 @@ esp_ble_adv_params_t GattsApplication::advertisementParameters = {
     .channel_map = ADV_CHNL_ALL,
     .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
 };
+#endif
 
-GattsApplication::AdvertisementData::AdvertisementData(uint8_t* payload, size_t length):
-    payload(payload),
-    length(length)
+GattsApplication::AdvertisementData::AdvertisementData():
+    length(0)
 {
 }
 
@@ -38,23 +43,14 @@ void GattsApplication::AdvertisementData::dump(void) const
     int writtenBytes;
     auto bufferPointer = buffer;
 
-    writtenBytes = snprintf(bufferPointer, remainingSize, "AD[%2d: ", length);
+    writtenBytes = snprintf(bufferPointer, remainingSize, "AD[%2d: ", (int)length);
 
-    if (!payload)
+    auto payloadPointer = payload;
+    for (auto i = length; i > 0; --i, ++payloadPointer)
     {
         remainingSize -= writtenBytes;
         bufferPointer += writtenBytes;
-        writtenBytes = snprintf(bufferPointer, remainingSize, "nullptr");
-    }
-    else
-    {
-        auto payloadPointer = payload;
-        for (auto i = length; i > 0; --i, ++payloadPointer)
-        {
-            remainingSize -= writtenBytes;
-            bufferPointer += writtenBytes;
-            writtenBytes = snprintf(bufferPointer, remainingSize, "%02x ", (int)*payloadPointer);
-        }
+        writtenBytes = snprintf(bufferPointer, remainingSize, "%02x ", (int)*payloadPointer);
     }
     remainingSize -= writtenBytes;
     bufferPointer += writtenBytes;
@@ -63,29 +59,74 @@ void GattsApplication::AdvertisementData::dump(void) const
     ESP_LOGI(LOG_TAG, "dump(%s)", buffer);
 }
 
-GattsApplication::ServiceList::ServiceList(GattsService* service):
-    service(service),
-    next(nullptr)
-{
-}
-
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 GattsApplication::GattsApplication(
     uint16_t applicationId,
     const char* shortDeviceName,
     const char* fullDeviceName,
-    uint16_t appearance):
+    uint16_t appearance,
+    bool advertise):
     m_applicationId(applicationId),
     m_shortDeviceName(shortDeviceName),
     m_fullDeviceName(fullDeviceName),
     m_appearance(appearance),
+    m_advertise(advertise),
     m_services(nullptr),
+    m_lastService(nullptr),
+    m_servicesMutex(xSemaphoreCreateRecursiveMutexStatic(&m_servicesMutexBuffer)),
+    m_registrationState(RegistrationState::IDLE),
+    m_interface(ESP_GATT_IF_NONE),
     m_nextServiceForRegistration(nullptr),
-    m_nextServiceRegistrationNumber(0),
+    m_nextChunkForRegistration(0),
+    m_pendingDeletions(0),
+    m_changedService(nullptr),
     m_configurationDone(0),
-    m_interface(ESP_GATT_IF_NONE),
-    m_dummyValue(0)
+    m_dummyValue(0),
+    m_unhandledGapEvents(0),
+    m_unhandledGattsEvents(0)
 {
+    memset(m_gapEventHandlers, 0, sizeof(m_gapEventHandlers));
+    memset(m_gattsEventHandlers, 0, sizeof(m_gattsEventHandlers));
+
+    m_gapEventHandlers[ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT] =
+        &gapEventHandler<&GattsApplication::handleGapEventAdvertisementDataSetComplete>;
+    m_gapEventHandlers[ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT] =
+        &gapEventHandler<&GattsApplication::handleGapEventScanResponseDataSetComplete>;
+    m_gapEventHandlers[ESP_GAP_BLE_ADV_START_COMPLETE_EVT] =
+        &gapEventHandler<&GattsApplication::handleGapEventAdvertisementStartComplete>;
+    m_gapEventHandlers[ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT] =
+        &gapEventHandler<&GattsApplication::handleGapEventUpdatedConnectionParameters>;
+    m_gapEventHandlers[ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT] = &ignoreGapEvent;
+    m_gapEventHandlers[ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT] = &ignoreGapEvent;
+
+    m_gattsEventHandlers[ESP_GATTS_REG_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventRegister>;
+    m_gattsEventHandlers[ESP_GATTS_READ_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventRead>;
+    m_gattsEventHandlers[ESP_GATTS_WRITE_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventWrite>;
+    m_gattsEventHandlers[ESP_GATTS_EXEC_WRITE_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventExecuteWrite>;
+    m_gattsEventHandlers[ESP_GATTS_MTU_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventMtu>;
+    m_gattsEventHandlers[ESP_GATTS_START_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventStart>;
+    m_gattsEventHandlers[ESP_GATTS_CONNECT_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventConnect>;
+    m_gattsEventHandlers[ESP_GATTS_DISCONNECT_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventDisconnect>;
+    m_gattsEventHandlers[ESP_GATTS_RESPONSE_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventResponse>;
+    m_gattsEventHandlers[ESP_GATTS_CREAT_ATTR_TAB_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventCreateAttributeTable>;
+    m_gattsEventHandlers[ESP_GATTS_DELETE_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventDelete>;
+    m_gattsEventHandlers[ESP_GATTS_SEND_SERVICE_CHANGE_EVT] = &ignoreGattsEvent;
+    m_gattsEventHandlers[ESP_GATTS_CONF_EVT] = &ignoreGattsEvent;
+    m_gattsEventHandlers[ESP_GATTS_CONGEST_EVT] =
+        &gattsEventHandler<&GattsApplication::handleGattsEventCongest>;
 }
+#endif
 
 GattsApplication::~GattsApplication()
 {
@@ -96,6 +137,16 @@ uint16_t GattsApplication::applicationId(void) const
     return m_applicationId;
 }
 
+bool GattsApplication::advertises(void) const
+{
+    return m_advertise;
+}
+
+esp_gatt_if_t GattsApplication::interface(void) const
+{
+    return m_interface;
+}
+
 void GattsApplication::addService(GattsService* service)
 {
     if (!service)
@@ -103,58 +154,214 @@ void GattsApplication::addService(GattsService* service)
         throw std::invalid_argument("null pointer exception");
     }
 
-    auto serviceListEntry = new ServiceList(service);
+    lockServices();
+    try
+    {
+        addServiceLocked(service);
+    }
+    catch(...)
+    {
+        unlockServices();
+        throw;
+    }
+    unlockServices();
+}
+
+void GattsApplication::addServiceLocked(GattsService* service)
+{
+    if (service->nextService() || service == m_lastService)
+    {
+        throw std::invalid_argument("service was already added");
+    }
+
+    if (m_registrationState.load() == RegistrationState::IDLE)
+    {
+        if (!m_services)
+        {
+            m_services = service;
+        }
+        else
+        {
+            m_lastService->setNextService(service);
+        }
+        m_lastService = service;
+        return;
+    }
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    // NimBLE takes the GATT database as a whole when the host starts
+    throw std::runtime_error("services cannot be added after addGattsApplication() with NimBLE");
+#else
+    // the application is running: register the service on its own, the other services keep their handles
+    beginServiceChange();
+
+    m_changedService = service;
     if (!m_services)
     {
-        m_services = serviceListEntry;
+        m_services = service;
     }
     else
     {
-        auto servicePointer = m_services;
-        for(; servicePointer->next; servicePointer = servicePointer->next)
+        m_lastService->setNextService(service);
+    }
+    m_lastService = service;
+
+    m_nextServiceForRegistration = service;
+    m_nextChunkForRegistration = 0;
+    registerNextService(m_interface);
+#endif
+}
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+void GattsApplication::removeService(GattsService* service)
+{
+    if (!service)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    lockServices();
+    try
+    {
+        removeServiceLocked(service);
+    }
+    catch(...)
+    {
+        unlockServices();
+        throw;
+    }
+    unlockServices();
+}
+
+void GattsApplication::removeServiceLocked(GattsService* service)
+{
+    beginServiceChange();
+
+    auto servicePointer = m_services;
+    while (servicePointer && servicePointer != service)
+    {
+        servicePointer = servicePointer->nextService();
+    }
+    if (!servicePointer || !service->startHandle())
+    {
+        m_registrationState.store(RegistrationState::READY);
+        throw std::invalid_argument("service is not registered");
+    }
+
+    // the service stays linked until the Bluetooth stack confirmed the deletion of all chunks, see
+    // handleGattsEventDelete()
+    m_changedService = service;
+    m_pendingDeletions = service->numberOfRegisteredChunks();
+    for (size_t i = 0; i < service->numberOfRegisteredChunks(); ++i)
+    {
+        if (esp_ble_gatts_delete_service(service->chunkStartHandle(i)) != ESP_OK)
         {
+            if (!i)
+            {
+                m_changedService = nullptr;
+                m_registrationState.store(RegistrationState::READY);
+                throw std::runtime_error("error deleting the GATT service");
+            }
+
+            // the chunks deleted already are confirmed, the service is unlinked as a whole
+            ESP_LOGW(LOG_TAG, "Could not delete chunk %u of the GATT service", (unsigned) i);
+            m_pendingDeletions = i;
+            break;
         }
-        servicePointer->next = serviceListEntry;
     }
 }
+#endif
+
+GattsApplication::RegistrationState GattsApplication::registrationState(void) const
+{
+    return m_registrationState.load();
+}
+
+GattsService* GattsApplication::services(void) const
+{
+    return m_services;
+}
+
+void GattsApplication::lockServices(void) const
+{
+    xSemaphoreTakeRecursive(m_servicesMutex, portMAX_DELAY);
+}
+
+void GattsApplication::unlockServices(void) const
+{
+    xSemaphoreGiveRecursive(m_servicesMutex);
+}
 
 int GattsApplication::numberOfAdvertisedServices(BleUuid::Width width) const
 {
     int counter = 0;
+    lockServices();
     auto servicePointer = m_services;
     while (servicePointer)
     {
-        auto& serviceId = servicePointer->service->serviceId();
+        auto& serviceId = servicePointer->serviceId();
         if (serviceId.width == width && serviceId.advertise)
         {
             ++counter;
         }
-        servicePointer = servicePointer->next;
+        servicePointer = servicePointer->nextService();
     }
+    unlockServices();
 
     return counter;
 }
 
+size_t GattsApplication::footprint(void) const
+{
+    size_t bytes = sizeof(*this);
+
+    lockServices();
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        bytes += servicePointer->footprint();
+        servicePointer = servicePointer->nextService();
+    }
+    unlockServices();
+
+    return bytes;
+}
+
+void GattsApplication::dumpFootprint(void) const
+{
+    lockServices();
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        servicePointer->dumpFootprint();
+        servicePointer = servicePointer->nextService();
+    }
+    unlockServices();
+
+    ESP_LOGI(
+        LOG_TAG,
+        "application %04x: %u bytes total (object %u bytes), GATT arena %u/%u bytes (peak %u)",
+        m_applicationId,
+        (unsigned) footprint(),
+        (unsigned) sizeof(*this),
+        (unsigned) GattArena::instance()->used(),
+        (unsigned) GattArena::instance()->capacity(),
+        (unsigned) GattArena::instance()->highWaterMark());
+}
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 void GattsApplication::gapEventCallback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param)
 {
-    switch (event)
+    DISPATCH_STATISTICS_START();
+    auto handler = (unsigned) event < GATTS_APPLICATION_GAP_EVENTS ? m_gapEventHandlers[event] : nullptr;
+    if (!handler)
     {
-        case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
-            handleGapEventAdvertisementDataSetComplete();
-            break;
-        case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT:
-            handleGapEventScanResponseDataSetComplete();
-            break;
-        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
-            handleGapEventAdvertisementStartComplete(param);
-            break;
-        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
-            handleGapEventUpdatedConnectionParameters(param);
-            break;
-        default:
-            ESP_LOGW(LOG_TAG, "gapEventCallback(event=%d)", (int)event);
-            throw std::runtime_error("not yet implemented");
+        ++m_unhandledGapEvents;
+        ESP_LOGD(LOG_TAG, "gapEventCallback(event=%d) not handled", (int)event);
+        return;
     }
+    handler(this, param);
+    DISPATCH_STATISTICS_STOP(m_gapDispatchStatistics);
 }
 
 void GattsApplication::gattsEventCallback(
@@ -162,64 +369,82 @@ void GattsApplication::gattsEventCallback(
     esp_gatt_if_t gatts_if,
     esp_ble_gatts_cb_param_t* param)
 {
-    if (event == ESP_GATTS_REG_EVT)
+    DISPATCH_STATISTICS_START();
+    auto handler = (unsigned) event < GATTS_APPLICATION_GATTS_EVENTS ? m_gattsEventHandlers[event] : nullptr;
+    if (!handler)
     {
-        if (param->reg.status != ESP_GATT_OK)
-        {
-            char buffer[64];
-            snprintf(
-                buffer,
-                sizeof(buffer) - 1,
-                "error registering the application %04x, status %d",
-                param->reg.app_id,
-                param->reg.status);
-            throw std::runtime_error(buffer);
-        }
-
-        m_interface = gatts_if;
+        ++m_unhandledGattsEvents;
+        ESP_LOGD(LOG_TAG, "gattsEventCallback(event=%d,gatts_if=%d) not handled", (int)event, (int)gatts_if);
+        return;
     }
 
-    switch (event)
+    // the handlers walk the service list, addService() and removeService() change it from other tasks
+    lockServices();
+    try
     {
-        case ESP_GATTS_REG_EVT:
-            handleGattsEventRegister(gatts_if);
-            break;
-        case ESP_GATTS_READ_EVT:
-            handleGattsEventRead(gatts_if, param);
-            break;
-        case ESP_GATTS_WRITE_EVT:
-            handleGattsEventWrite(gatts_if, param);
-            break;
-        case ESP_GATTS_MTU_EVT:
-            handleGattsEventMtu(gatts_if, param);
-            break;
-        case ESP_GATTS_START_EVT:
-            ESP_LOGD(LOG_TAG, "GATTS event: service started");
-            m_nextServiceForRegistration = m_nextServiceForRegistration->next;
-            ++m_nextServiceRegistrationNumber;
+        handler(this, gatts_if, param);
+    }
+    catch(...)
+    {
+        unlockServices();
+        throw;
+    }
+    unlockServices();
+    DISPATCH_STATISTICS_STOP(m_gattsDispatchStatistics);
+}
 
-            registerNextService(gatts_if);
+void GattsApplication::setGapEventHandler(esp_gap_ble_cb_event_t event, GapEventHandler handler)
+{
+    if ((unsigned) event >= GATTS_APPLICATION_GAP_EVENTS)
+    {
+        throw std::out_of_range("GAP event exceeds the handler table");
+    }
+    m_gapEventHandlers[event] = handler;
+}
 
-            break;
-        case ESP_GATTS_CONNECT_EVT:
-            handleGattsEventConnect(gatts_if, param);
-            break;
-        case ESP_GATTS_DISCONNECT_EVT:
-            handleGattsEventDisconnect(gatts_if, param);
-            break;
-        case ESP_GATTS_RESPONSE_EVT:
-            ESP_LOGD(LOG_TAG, "GATTS event: response completed");
-            break;
-        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
-            handleGattsEventCreateAttributeTable(gatts_if, param);
-            break;
-        default:
-            ESP_LOGW(LOG_TAG, "gattsEventCallback(event=%d,gatts_if=%d)", (int)event, (int)gatts_if);
-            throw std::runtime_error("not yet implemented");
+void GattsApplication::setGattsEventHandler(esp_gatts_cb_event_t event, GattsEventHandler handler)
+{
+    if ((unsigned) event >= GATTS_APPLICATION_GATTS_EVENTS)
+    {
+        throw std::out_of_range("GATTS event exceeds the handler table");
     }
+    m_gattsEventHandlers[event] = handler;
+}
+
+uint32_t GattsApplication::unhandledGapEvents(void) const
+{
+    return m_unhandledGapEvents;
+}
+
+uint32_t GattsApplication::unhandledGattsEvents(void) const
+{
+    return m_unhandledGattsEvents;
+}
+#endif
+
+const DispatchStatistics& GattsApplication::gapDispatchStatistics(void) const
+{
+    return m_gapDispatchStatistics;
+}
+
+const DispatchStatistics& GattsApplication::gattsDispatchStatistics(void) const
+{
+    return m_gattsDispatchStatistics;
 }
 
-void GattsApplication::handleGapEventAdvertisementDataSetComplete(void)
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+void GattsApplication::ignoreGapEvent(GattsApplication* application, esp_ble_gap_cb_param_t* param)
+{
+}
+
+void GattsApplication::ignoreGattsEvent(
+    GattsApplication* application,
+    esp_gatt_if_t gatts_if,
+    esp_ble_gatts_cb_param_t* param)
+{
+}
+
+void GattsApplication::handleGapEventAdvertisementDataSetComplete(esp_ble_gap_cb_param_t* param)
 {
     setConfigurationAdvertisementDoneFlag();
     if (configurationDone())
@@ -228,7 +453,7 @@ void GattsApplication::handleGapEventAdvertisementDataSetComplete(void)
     }
 }
 
-void GattsApplication::handleGapEventScanResponseDataSetComplete(void)
+void GattsApplication::handleGapEventScanResponseDataSetComplete(esp_ble_gap_cb_param_t* param)
 {
     setConfigurationScanResponseDoneFlag();
     if (configurationDone())
@@ -262,6 +487,18 @@ void GattsApplication::handleGapEventUpdatedConnectionParameters(esp_ble_gap_cb_
         param->update_conn_params.timeout * 10);
 }
 
+void GattsApplication::handleGattsEventCongest(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+{
+    ESP_LOGD(LOG_TAG, "CONGEST, conn_id=%d, congested=%d", param->congest.conn_id, (int) param->congest.congested);
+
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        servicePointer->congestionChanged(param->congest.conn_id, param->congest.congested);
+        servicePointer = servicePointer->nextService();
+    }
+}
+
 void GattsApplication::handleGattsEventConnect(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
 {
     ESP_LOGI(
@@ -275,6 +512,12 @@ void GattsApplication::handleGattsEventConnect(esp_gatt_if_t gatts_if, esp_ble_g
         param->connect.remote_bda[4],
         param->connect.remote_bda[5]);
 
+    // every application receives the connection, the one owning advertising negotiates its parameters
+    if (!m_advertise)
+    {
+        return;
+    }
+
     esp_ble_conn_update_params_t connectionParameters;
     bzero(&connectionParameters, sizeof(connectionParameters));
     memcpy(connectionParameters.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
@@ -294,21 +537,70 @@ void GattsApplication::handleGattsEventCreateAttributeTable(
     esp_gatt_if_t gatts_if,
     esp_ble_gatts_cb_param_t* param)
 {
-    if (param->add_attr_tab.status != ESP_GATT_OK)
+    // a failed runtime change is rolled back, including the chunks of the service registered already
+    try
     {
-        throw std::runtime_error("error creating the GATT attribute table");
+        if (param->add_attr_tab.status != ESP_GATT_OK)
+        {
+            throw std::runtime_error("error creating the GATT attribute table");
+        }
+
+        if (param->add_attr_tab.num_handle !=
+            m_nextServiceForRegistration->attributeTable(m_nextChunkForRegistration).length)
+        {
+            // the table is not known to the service yet, so the rollback would miss it
+            esp_ble_gatts_delete_service(param->add_attr_tab.handles[0]);
+            throw std::runtime_error("unexpected number of handles registered");
+        }
+
+        m_nextServiceForRegistration->pushHandles(gatts_if, param->add_attr_tab.handles);
+        m_nextServiceForRegistration->releaseAttributeTable();
+        if (esp_ble_gatts_start_service(param->add_attr_tab.handles[0]) != ESP_OK)
+        {
+            throw std::runtime_error("error starting the GATT service");
+        }
+    }
+    catch(...)
+    {
+        abortServiceChange();
+        throw;
     }
+}
 
-    if (param->add_attr_tab.num_handle != m_nextServiceForRegistration->service->attributeTable().length)
+void GattsApplication::handleGattsEventDelete(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+{
+    auto service = m_changedService;
+    if (!service || m_registrationState.load() != RegistrationState::CHANGING)
     {
-        throw std::runtime_error("unexpected number of handles registered");
+        ESP_LOGW(LOG_TAG, "unexpected deletion of service %04x", param->del.service_handle);
+        return;
     }
 
-    m_nextServiceForRegistration->service->pushHandles(param->add_attr_tab.handles);
-    if (esp_ble_gatts_start_service(param->add_attr_tab.handles[0]) != ESP_OK)
+    if (param->del.status != ESP_GATT_OK)
     {
-        throw std::runtime_error("error starting the GATT service");
+        m_pendingDeletions = 0;
+        m_changedService = nullptr;
+        m_registrationState.store(RegistrationState::READY);
+        throw std::runtime_error("error deleting the GATT service");
     }
+
+    // a service registered in chunks is deleted by one event per chunk
+    if (m_pendingDeletions > 1)
+    {
+        --m_pendingDeletions;
+        return;
+    }
+    m_pendingDeletions = 0;
+    m_changedService = nullptr;
+
+    auto startHandle = service->startHandle();
+    auto endHandle = service->endHandle();
+
+    unlinkService(service);
+    service->resetHandles();
+
+    sendServiceChanged(startHandle, endHandle);
+    m_registrationState.store(RegistrationState::READY);
 }
 
 void GattsApplication::handleGattsEventDisconnect(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
@@ -325,6 +617,24 @@ void GattsApplication::handleGattsEventDisconnect(esp_gatt_if_t gatts_if, esp_bl
         param->disconnect.remote_bda[5],
         param->disconnect.reason);
 
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        servicePointer->clearClientConfigurations(param->disconnect.conn_id);
+        servicePointer = servicePointer->nextService();
+    }
+    NotificationDispatcher::instance()->setMtu(param->disconnect.conn_id, ESP_GATT_DEF_BLE_MTU_SIZE);
+    PendingTransactions::instance()->cancel(param->disconnect.conn_id);
+    if (m_prepareWriteQueue.owns(param->disconnect.conn_id))
+    {
+        m_prepareWriteQueue.clear();
+    }
+
+    if (!m_advertise)
+    {
+        return;
+    }
+
     if (configurationDone())
     {
         esp_ble_gap_start_advertising(&advertisementParameters);
@@ -335,9 +645,39 @@ void GattsApplication::handleGattsEventDisconnect(esp_gatt_if_t gatts_if, esp_bl
     }
 }
 
+void GattsApplication::handleGattsEventExecuteWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+{
+    ESP_LOGD(
+        LOG_TAG,
+        "EXEC_WRITE conn_id=%d, flag=%d",
+        param->exec_write.conn_id,
+        (int)param->exec_write.exec_write_flag);
+
+    // an asynchronous characteristic among the prepared writes answers the execute write request later on
+    auto transactions = PendingTransactions::instance();
+    transactions->begin(gatts_if, param->exec_write.conn_id, param->exec_write.trans_id, 0, 0, false, true);
+
+    auto status = ESP_GATT_OK;
+    if (m_prepareWriteQueue.owns(param->exec_write.conn_id))
+    {
+        if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC)
+        {
+            status = executeWrites(param->exec_write.conn_id);
+        }
+        m_prepareWriteQueue.clear();
+    }
+
+    bool answered = status == ESP_GATT_OK ? transactions->end() : !transactions->abort();
+    if (!answered)
+    {
+        esp_ble_gatts_send_response(gatts_if, param->exec_write.conn_id, param->exec_write.trans_id, status, nullptr);
+    }
+}
+
 void GattsApplication::handleGattsEventMtu(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
 {
     ESP_LOGD(LOG_TAG, "MTU, conn_id=%d, mtu=%d", param->mtu.conn_id, param->mtu.mtu);
+    NotificationDispatcher::instance()->setMtu(param->mtu.conn_id, param->mtu.mtu);
 }
 
 void GattsApplication::handleGattsEventRead(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
@@ -345,35 +685,59 @@ void GattsApplication::handleGattsEventRead(esp_gatt_if_t gatts_if, esp_ble_gatt
     ESP_LOGD(LOG_TAG, "READ need_rsp=%d, handle=%04x", (int)param->read.need_rsp, param->read.handle);
     if (param->read.need_rsp)
     {
-        esp_gatt_rsp_t response;
+        // the response is larger than 600 bytes, keep it off the stack of the Bluetooth task
+        static esp_gatt_rsp_t response;
         bzero(&response, sizeof(response));
         response.attr_value.handle = param->read.handle;
+        response.attr_value.offset = param->read.offset;
+
+        auto transactions = PendingTransactions::instance();
+        transactions->begin(
+            gatts_if,
+            param->read.conn_id,
+            param->read.trans_id,
+            param->read.handle,
+            param->read.offset,
+            true,
+            true);
 
         try
         {
-            auto servicePointer = m_services;
-            while (servicePointer)
+            auto servicePointer = serviceForHandle(param->read.handle);
+            if (servicePointer)
             {
-                if (servicePointer->service->hasHandle(param->read.handle))
+                if (servicePointer->hasClientConfigurationHandle(param->read.handle))
                 {
-                    servicePointer->service->readCharacteristic(
+                    servicePointer->readClientConfiguration(
+                        param->read.conn_id,
+                        param->read.handle,
+                        response.attr_value.value,
+                        &response.attr_value.len);
+                }
+                else
+                {
+                    servicePointer->readCharacteristic(
+                        param->read.conn_id,
                         param->read.handle,
+                        param->read.offset,
                         response.attr_value.value,
                         &response.attr_value.len);
+                }
 
+                // a deferred read is answered by the characteristic later on
+                if (!transactions->end())
+                {
                     esp_ble_gatts_send_response(
                         gatts_if,
                         param->read.conn_id,
                         param->read.trans_id,
                         ESP_GATT_OK,
                         &response);
-                    break;
                 }
-
-                servicePointer = servicePointer->next;
             }
-            if (!servicePointer)
+            else
             {
+                transactions->end();
                 ESP_LOGW(LOG_TAG, "Could not find suitable service for handle %04x", param->read.handle);
                 esp_ble_gatts_send_response(
                     gatts_if,
@@ -383,23 +747,64 @@ void GattsApplication::handleGattsEventRead(esp_gatt_if_t gatts_if, esp_ble_gatt
                     &response);
             }
         }
+        catch(const std::out_of_range& e)
+        {
+            ESP_LOGW(LOG_TAG, "Could not respond to read request: %s", e.what());
+            // a deferred request may have been completed by another task already
+            if (transactions->abort())
+            {
+                esp_ble_gatts_send_response(
+                    gatts_if,
+                    param->read.conn_id,
+                    param->read.trans_id,
+                    ESP_GATT_INVALID_OFFSET,
+                    &response);
+            }
+        }
         catch(const std::exception& e)
         {
             ESP_LOGW(LOG_TAG, "Could not respond to read request: %s", e.what());
-            esp_ble_gatts_send_response(
-                gatts_if,
-                param->read.conn_id,
-                param->read.trans_id,
-                ESP_GATT_INTERNAL_ERROR,
-                &response);
+            if (transactions->abort())
+            {
+                esp_ble_gatts_send_response(
+                    gatts_if,
+                    param->read.conn_id,
+                    param->read.trans_id,
+                    ESP_GATT_INTERNAL_ERROR,
+                    &response);
+            }
         }
 
         ++m_dummyValue;
     }
 }
 
-void GattsApplication::handleGattsEventRegister(esp_gatt_if_t gatts_if)
+void GattsApplication::handleGattsEventRegister(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
 {
+    if (param->reg.status != ESP_GATT_OK)
+    {
+        char buffer[64];
+        snprintf(
+            buffer,
+            sizeof(buffer) - 1,
+            "error registering the application %04x, status %d",
+            param->reg.app_id,
+            param->reg.status);
+        throw std::runtime_error(buffer);
+    }
+
+    m_interface = gatts_if;
+    m_registrationState.store(RegistrationState::REGISTERING);
+
+    if (!m_advertise)
+    {
+        // advertising is owned by another application on the same server
+        m_nextServiceForRegistration = m_services;
+        m_nextChunkForRegistration = 0;
+        registerNextService(gatts_if);
+        return;
+    }
+
     auto deviceName = m_fullDeviceName;
     if (!deviceName)
     {
@@ -414,9 +819,11 @@ void GattsApplication::handleGattsEventRegister(esp_gatt_if_t gatts_if)
         throw std::runtime_error("error setting the device name");
     }
 
-    generateRawAdvertisementData();
+    if (!m_rawAdvertisementData.length || !m_rawScanResponseData.length)
+    {
+        generateRawData();
+    }
     m_rawAdvertisementData.dump();
-    generateRawScanResponseData();
     m_rawScanResponseData.dump();
 
     if (esp_ble_gap_config_adv_data_raw(m_rawAdvertisementData.payload, m_rawAdvertisementData.length) != ESP_OK)
@@ -432,6 +839,30 @@ void GattsApplication::handleGattsEventRegister(esp_gatt_if_t gatts_if)
     setConfigurationScanResponsePendingFlag();
 
     m_nextServiceForRegistration = m_services;
+    m_nextChunkForRegistration = 0;
+    registerNextService(gatts_if);
+}
+
+void GattsApplication::handleGattsEventResponse(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+{
+    ESP_LOGD(LOG_TAG, "GATTS event: response completed");
+}
+
+void GattsApplication::handleGattsEventStart(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+{
+    ESP_LOGD(LOG_TAG, "GATTS event: service started");
+    if (param->start.status != ESP_GATT_OK)
+    {
+        abortServiceChange();
+        throw std::runtime_error("error starting the GATT service");
+    }
+
+    if (++m_nextChunkForRegistration >= m_nextServiceForRegistration->numberOfChunks())
+    {
+        m_nextServiceForRegistration = m_nextServiceForRegistration->nextService();
+        m_nextChunkForRegistration = 0;
+    }
+
     registerNextService(gatts_if);
 }
 
@@ -446,35 +877,52 @@ void GattsApplication::handleGattsEventWrite(esp_gatt_if_t gatts_if, esp_ble_gat
 
     if (!param->write.is_prep)
     {
+        auto transactions = PendingTransactions::instance();
+        transactions->begin(
+            gatts_if,
+            param->write.conn_id,
+            param->write.trans_id,
+            param->write.handle,
+            param->write.offset,
+            false,
+            param->write.need_rsp);
 
         try
         {
-            auto servicePointer = m_services;
-            while (servicePointer)
+            auto servicePointer = serviceForHandle(param->write.handle);
+            if (servicePointer)
             {
-                if (servicePointer->service->hasHandle(param->write.handle))
+                if (servicePointer->hasClientConfigurationHandle(param->write.handle))
                 {
-                    servicePointer->service->writeCharacteristic(
+                    servicePointer->writeClientConfiguration(
+                        param->write.conn_id,
+                        param->write.handle,
+                        param->write.value,
+                        param->write.len);
+                }
+                else
+                {
+                    servicePointer->writeCharacteristic(
+                        param->write.conn_id,
                         param->write.handle,
                         param->write.value,
                         param->write.len);
-
-                    if (param->write.need_rsp)
-                    {
-                        esp_ble_gatts_send_response(
-                            gatts_if,
-                            param->write.conn_id,
-                            param->write.trans_id,
-                            ESP_GATT_OK,
-                            nullptr);
-                    }
-                    break;
                 }
 
-                servicePointer = servicePointer->next;
+                // a deferred write is answered by the characteristic later on
+                if (!transactions->end() && param->write.need_rsp)
+                {
+                    esp_ble_gatts_send_response(
+                        gatts_if,
+                        param->write.conn_id,
+                        param->write.trans_id,
+                        ESP_GATT_OK,
+                        nullptr);
+                }
             }
-            if (!servicePointer)
+            else
             {
+                transactions->end();
                 ESP_LOGW(LOG_TAG, "Could not find suitable service for handle %04x", param->write.handle);
                 esp_ble_gatts_send_response(
                     gatts_if,
@@ -484,181 +932,394 @@ void GattsApplication::handleGattsEventWrite(esp_gatt_if_t gatts_if, esp_ble_gat
                     nullptr);
             }
         }
+        catch(const std::length_error& e)
+        {
+            ESP_LOGW(LOG_TAG, "Could not respond to write request: %s", e.what());
+            if (transactions->abort())
+            {
+                esp_ble_gatts_send_response(
+                    gatts_if,
+                    param->write.conn_id,
+                    param->write.trans_id,
+                    ESP_GATT_INVALID_ATTR_LEN,
+                    nullptr);
+            }
+        }
         catch(const std::exception& e)
         {
             ESP_LOGW(LOG_TAG, "Could not respond to write request: %s", e.what());
-            esp_ble_gatts_send_response(
-                gatts_if,
-                param->write.conn_id,
-                param->write.trans_id,
-                ESP_GATT_INTERNAL_ERROR,
-                nullptr);
+            if (transactions->abort())
+            {
+                esp_ble_gatts_send_response(
+                    gatts_if,
+                    param->write.conn_id,
+                    param->write.trans_id,
+                    ESP_GATT_INTERNAL_ERROR,
+                    nullptr);
+            }
+        }
+    }
+    else
+    {
+        prepareWrite(gatts_if, param);
+    }
+}
+
+void GattsApplication::prepareWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+{
+    auto status = ESP_GATT_INVALID_HANDLE;
+    auto servicePointer = serviceForHandle(param->write.handle);
+    if (servicePointer)
+    {
+        // client configurations are never long, a prepared write to them is refused
+        if (servicePointer->hasClientConfigurationHandle(param->write.handle))
+        {
+            status = ESP_GATT_WRITE_NOT_PERMIT;
+        }
+        else if (!m_prepareWriteQueue.add(
+            param->write.conn_id,
+            param->write.handle,
+            param->write.offset,
+            param->write.value,
+            param->write.len))
+        {
+            status = ESP_GATT_PREPARE_Q_FULL;
+        }
+        else
+        {
+            status = ESP_GATT_OK;
         }
     }
+
+    if (!param->write.need_rsp)
+    {
+        return;
+    }
+
+    // the response echoes the prepared value, keep it off the stack of the Bluetooth task
+    static esp_gatt_rsp_t response;
+    bzero(&response, sizeof(response));
+    response.attr_value.handle = param->write.handle;
+    response.attr_value.offset = param->write.offset;
+    response.attr_value.len = param->write.len;
+    memcpy(response.attr_value.value, param->write.value, param->write.len);
+
+    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, &response);
 }
 
-void GattsApplication::generateRawAdvertisementData(void)
+esp_gatt_status_t GattsApplication::executeWrites(uint16_t connectionId)
 {
-    if (m_rawAdvertisementData.payload)
+    m_prepareWriteQueue.coalesce();
+
+    try
+    {
+        for (size_t i = 0; i < m_prepareWriteQueue.size(); ++i)
+        {
+            auto& entry = m_prepareWriteQueue.entry(i);
+
+            auto servicePointer = serviceForHandle(entry.handle);
+            if (!servicePointer)
+            {
+                // the service was removed meanwhile
+                return ESP_GATT_INVALID_HANDLE;
+            }
+
+            servicePointer->writeCharacteristicAt(
+                connectionId,
+                entry.handle,
+                entry.offset,
+                m_prepareWriteQueue.value(entry),
+                entry.length);
+        }
+    }
+    catch(const std::out_of_range& e)
+    {
+        ESP_LOGW(LOG_TAG, "Could not execute prepared writes: %s", e.what());
+        return ESP_GATT_INVALID_OFFSET;
+    }
+    catch(const std::length_error& e)
+    {
+        ESP_LOGW(LOG_TAG, "Could not execute prepared writes: %s", e.what());
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    catch(const std::exception& e)
     {
-        throw std::runtime_error("advertisement data was already generated");
+        ESP_LOGW(LOG_TAG, "Could not execute prepared writes: %s", e.what());
+        return ESP_GATT_INTERNAL_ERROR;
     }
 
-    size_t requiredLength = sizeof(advertisementFlags);
+    return ESP_GATT_OK;
+}
+#endif
+
+void GattsApplication::generateRawData(void)
+{
+    // data sets given by setAdvertisementData() or setScanResponseData() are kept as they are
+    bool packAdvertisement = !m_rawAdvertisementData.length;
+    bool packScanResponse = !m_rawScanResponseData.length;
 
-    if (!m_shortDeviceName)
+    AdvertisementWriter advertisement(m_rawAdvertisementData.payload, packAdvertisement ? ADVERTISEMENT_LENGTH_MAX : 0);
+    AdvertisementWriter scanResponse(m_rawScanResponseData.payload, packScanResponse ? ADVERTISEMENT_LENGTH_MAX : 0);
+    AdvertisementPacker packer;
+
+    if (packAdvertisement)
+    {
+        packer.addStructures(advertisementFlags, sizeof(advertisementFlags), AdvertisementPacker::priorityHigh);
+    }
+    addAdvertisedServices(&packer, BleUuid::Width::UUID_16, 2, AdvertisementEncoder::typeCompleteUuids16);
+    addAdvertisedServices(&packer, BleUuid::Width::UUID_32, 4, AdvertisementEncoder::typeCompleteUuids32);
+    addAdvertisedServices(&packer, BleUuid::Width::UUID_128, 16, AdvertisementEncoder::typeCompleteUuids128);
+    if (m_fullDeviceName)
     {
-        throw std::runtime_error("no short device name given");
+        packer.addName(m_fullDeviceName, m_shortDeviceName, AdvertisementPacker::priorityNormal);
+    }
+    else if (m_shortDeviceName)
+    {
+        packer.addName(m_shortDeviceName, nullptr, AdvertisementPacker::priorityNormal);
+    }
+    if (m_appearance != GATTS_APPLICATION_DEFAULT_APPEARANCE)
+    {
+        // the default means "unknown", not worth 4 bytes
+        packer.add(
+            AdvertisementEncoder::typeAppearance,
+            &m_appearance,
+            sizeof(m_appearance),
+            AdvertisementPacker::priorityLow);
     }
-    requiredLength += 2 + strlen(m_shortDeviceName);
 
-    int uuid16ServiceCount = numberOfAdvertisedServices(BleUuid::Width::UUID_16);
-    if (uuid16ServiceCount > 0)
+    auto dropped = packer.pack(&advertisement, &scanResponse);
+    if (dropped)
     {
-        requiredLength += 2 + 2 * uuid16ServiceCount;
+        ESP_LOGW(LOG_TAG, "%u AD elements did not fit into advertisement and scan response", (unsigned) dropped);
     }
-    int uuid32ServiceCount = numberOfAdvertisedServices(BleUuid::Width::UUID_32);
-    if (uuid32ServiceCount > 0)
+    if (packer.nameShortened())
     {
-        requiredLength += 2 + 4 * uuid32ServiceCount;
+        ESP_LOGI(LOG_TAG, "device name shortened within the advertisement");
     }
 
-    if (requiredLength > ADVERTISEMENT_LENGTH_MAX)
+    if (packAdvertisement)
     {
-        char buffer[64];
-        snprintf(
-            buffer,
-            sizeof(buffer) - 1,
-            "advertisement to long (now %d bytes, max accepted is %d)",
-            requiredLength,
-            ADVERTISEMENT_LENGTH_MAX);
-        throw std::runtime_error(buffer);
+        m_rawAdvertisementData.length = advertisement.length();
+    }
+    if (packScanResponse)
+    {
+        m_rawScanResponseData.length = scanResponse.length();
     }
+}
 
-    m_rawAdvertisementData.payload = (uint8_t*) malloc(requiredLength * sizeof(uint8_t));
-    if (!m_rawAdvertisementData.payload)
+void GattsApplication::addAdvertisedServices(
+    AdvertisementPacker* packer,
+    BleUuid::Width width,
+    size_t uuidLength,
+    uint8_t type)
+{
+    auto numberOfServices = numberOfAdvertisedServices(width);
+    if (numberOfServices <= 0)
     {
-        throw std::runtime_error("error allocating memory for the advertisment data");
+        return;
     }
-    m_rawAdvertisementData.length = requiredLength;
 
-    // put advertisement flags
-    auto payloadPointer = m_rawAdvertisementData.payload;
-    memcpy(payloadPointer, advertisementFlags, sizeof(advertisementFlags));
-    payloadPointer += sizeof(advertisementFlags);
+    auto payloadPointer = packer->reserve(type, numberOfServices * uuidLength, AdvertisementPacker::priorityHigh);
 
-    // put short device name
-    *payloadPointer = strlen(m_shortDeviceName) + 1;
-    ++payloadPointer;
-    *payloadPointer = 0x09;
-    ++payloadPointer;
-    memcpy(payloadPointer, m_shortDeviceName, strlen(m_shortDeviceName));
-    payloadPointer += strlen(m_shortDeviceName);
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        auto& serviceId = servicePointer->serviceId();
+        if (serviceId.width == width && serviceId.advertise)
+        {
+            serviceId.copyTo(payloadPointer);
+            payloadPointer += serviceId.length();
+        }
 
-    // put services
-    if (uuid16ServiceCount > 0)
+        servicePointer = servicePointer->nextService();
+    }
+}
+
+void GattsApplication::setAdvertisementData(const uint8_t* payload, size_t length)
+{
+    setRawData(&m_rawAdvertisementData, payload, length);
+}
+
+void GattsApplication::setScanResponseData(const uint8_t* payload, size_t length)
+{
+    setRawData(&m_rawScanResponseData, payload, length);
+}
+
+void GattsApplication::setRawData(AdvertisementData* data, const uint8_t* payload, size_t length)
+{
+    if (!payload)
     {
-        *payloadPointer = 1 + 2 * uuid16ServiceCount;
-        ++payloadPointer;
-        *payloadPointer = 0x03;
-        ++payloadPointer;
+        throw std::invalid_argument("null pointer exception");
+    }
 
-        auto servicePointer = m_services;
-        while (servicePointer)
-        {
-            auto& serviceId = servicePointer->service->serviceId();
-            if (serviceId.width == BleUuid::Width::UUID_16 && serviceId.advertise)
-            {
-                memcpy(payloadPointer, &serviceId.uuid16, sizeof(serviceId.uuid16));
-                payloadPointer += sizeof(serviceId.uuid16);
-            }
+    if (m_registrationState.load() != RegistrationState::IDLE)
+    {
+        throw std::runtime_error("advertisement data can only be set before the registration");
+    }
 
-            servicePointer = servicePointer->next;
+    AdvertisementWriter writer(data->payload);
+    writer.append(payload, length);
+    data->length = writer.length();
+}
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+void GattsApplication::registerNextService(esp_gatt_if_t gatts_if)
+{
+    if (!m_nextServiceForRegistration)
+    {
+        if (m_registrationState.load() == RegistrationState::CHANGING)
+        {
+            auto service = m_changedService;
+            m_changedService = nullptr;
+            sendServiceChanged(service->startHandle(), service->endHandle());
         }
+        else
+        {
+            ESP_LOGI(LOG_TAG, "Finished registering all services");
+            dumpFootprint();
+        }
+        m_registrationState.store(RegistrationState::READY);
+        return;
     }
-    if (uuid32ServiceCount > 0)
-    {
-        *payloadPointer = 1 + 4 * uuid32ServiceCount;
-        ++payloadPointer;
-        *payloadPointer = 0x05;
-        ++payloadPointer;
 
-        auto servicePointer = m_services;
-        while (servicePointer)
+    try
+    {
+        if (!m_nextChunkForRegistration)
         {
-            auto& serviceId = servicePointer->service->serviceId();
-            if (serviceId.width == BleUuid::Width::UUID_32 && serviceId.advertise)
-            {
-                memcpy(payloadPointer, &serviceId.uuid32, sizeof(serviceId.uuid32));
-                payloadPointer += sizeof(serviceId.uuid32);
-            }
+            assignInstanceId(m_nextServiceForRegistration);
+        }
 
-            servicePointer = servicePointer->next;
+        auto attributeTable = m_nextServiceForRegistration->attributeTable(m_nextChunkForRegistration);
+        if (esp_ble_gatts_create_attr_tab(
+                attributeTable.table,
+                gatts_if,
+                attributeTable.length,
+                m_nextServiceForRegistration->instanceId() + m_nextChunkForRegistration) != ESP_OK)
+        {
+            throw std::runtime_error("error registering the GATT attribute table");
         }
     }
+    catch(...)
+    {
+        // a runtime change is rolled back, a failed initial registration has nothing to return to
+        abortServiceChange();
+        throw;
+    }
 }
 
-void GattsApplication::generateRawScanResponseData(void)
+void GattsApplication::assignInstanceId(GattsService* service)
 {
-    if (m_rawScanResponseData.payload)
+    // Bluedroid tells services apart by UUID and instance id, so ids need only be unique among equal UUIDs
+    auto numberOfChunks = service->numberOfChunks();
+    if (numberOfChunks > GATTS_SERVICE_CHUNKS_MAX)
     {
-        throw std::runtime_error("scan response data was already generated");
+        throw std::runtime_error("service has too many attributes");
     }
 
-    size_t requiredLength = sizeof(advertisementFlags);
-
-    requiredLength += 4;  // appearance
+    size_t instanceId = 0;
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        if (servicePointer != service &&
+            servicePointer->numberOfRegisteredChunks() &&
+            servicePointer->serviceId() == service->serviceId())
+        {
+            auto nextInstanceId = servicePointer->instanceId() + servicePointer->numberOfRegisteredChunks();
+            if (nextInstanceId > instanceId)
+            {
+                instanceId = nextInstanceId;
+            }
+        }
+        servicePointer = servicePointer->nextService();
+    }
 
-    if (requiredLength > ADVERTISEMENT_LENGTH_MAX)
+    if (instanceId + numberOfChunks > UINT8_MAX + 1)
     {
-        char buffer[64];
-        snprintf(
-            buffer,
-            sizeof(buffer) - 1,
-            "scan response to long (now %d bytes, max accepted is %d)",
-            requiredLength,
-            ADVERTISEMENT_LENGTH_MAX);
-        throw std::runtime_error(buffer);
+        throw std::runtime_error("too many instances of the service");
     }
+    service->setInstanceId(instanceId);
+}
+
+GattsService* GattsApplication::serviceForHandle(uint16_t handle) const
+{
+    auto entry = HandleIndex::instance()->find(handle);
+    return entry ? entry->service : nullptr;
+}
 
-    m_rawScanResponseData.payload = (uint8_t*) malloc(requiredLength * sizeof(uint8_t));
-    if (!m_rawScanResponseData.payload)
+void GattsApplication::beginServiceChange(void)
+{
+    // one change at a time, the service list is only modified while no other registration is in progress
+    auto expected = RegistrationState::READY;
+    if (!m_registrationState.compare_exchange_strong(expected, RegistrationState::CHANGING))
     {
-        throw std::runtime_error("error allocating memory for the scan response data");
+        throw std::runtime_error("services cannot be changed now, registration is in progress");
     }
-    m_rawScanResponseData.length = requiredLength;
+}
 
-    // put advertisement flags
-    auto payloadPointer = m_rawScanResponseData.payload;
-    memcpy(payloadPointer, advertisementFlags, sizeof(advertisementFlags));
-    payloadPointer += sizeof(advertisementFlags);
+void GattsApplication::abortServiceChange(void)
+{
+    if (m_registrationState.load() != RegistrationState::CHANGING)
+    {
+        return;
+    }
 
-    // put appearance
-    *payloadPointer = 3;
-    ++payloadPointer;
-    *payloadPointer = 0x19;
-    ++payloadPointer;
-    memcpy(payloadPointer, &m_appearance, sizeof(m_appearance));
-    payloadPointer += sizeof(m_appearance);
+    if (m_changedService)
+    {
+        // chunks registered already are removed from the Bluetooth stack as well, their deletion is not awaited
+        for (size_t i = 0; i < m_changedService->numberOfRegisteredChunks(); ++i)
+        {
+            esp_ble_gatts_delete_service(m_changedService->chunkStartHandle(i));
+        }
+        m_changedService->releaseAttributeTable();
+        m_changedService->resetHandles();
+        unlinkService(m_changedService);
+        m_changedService = nullptr;
+    }
+    m_nextServiceForRegistration = nullptr;
+    m_nextChunkForRegistration = 0;
+    m_registrationState.store(RegistrationState::READY);
 }
 
-void GattsApplication::registerNextService(esp_gatt_if_t gatts_if)
+void GattsApplication::unlinkService(GattsService* service)
 {
-    if (!m_nextServiceForRegistration)
+    GattsService* previousService = nullptr;
+    auto servicePointer = m_services;
+    while (servicePointer && servicePointer != service)
+    {
+        previousService = servicePointer;
+        servicePointer = servicePointer->nextService();
+    }
+    if (!servicePointer)
     {
-        ESP_LOGI(LOG_TAG, "Finished registering all services");
         return;
     }
 
-    auto attributeTable = m_nextServiceForRegistration->service->attributeTable();
-    if (esp_ble_gatts_create_attr_tab(
-            attributeTable.table,
-            gatts_if,
-            attributeTable.length,
-            m_nextServiceRegistrationNumber) != ESP_OK)
+    if (previousService)
+    {
+        previousService->setNextService(service->nextService());
+    }
+    else
+    {
+        m_services = service->nextService();
+    }
+    if (m_lastService == service)
+    {
+        m_lastService = previousService;
+    }
+    service->setNextService(nullptr);
+}
+
+void GattsApplication::sendServiceChanged(uint16_t startHandle, uint16_t endHandle)
+{
+    ESP_LOGI(LOG_TAG, "services changed, handles %04x-%04x", startHandle, endHandle);
+
+#ifdef CONFIG_BT_GATTS_SEND_SERVICE_CHANGE_MANUAL
+    // Bluedroid indicates the whole handle range to all connected clients which are subscribed to Service Changed
+    if (esp_ble_gatts_send_service_change_indication(m_interface, nullptr) != ESP_OK)
     {
-        throw std::runtime_error("error registering the GATT attribute table");
+        ESP_LOGW(LOG_TAG, "Could not send the service changed indication");
     }
+#endif
 }
 
 void GattsApplication::setConfigurationAdvertisementPendingFlag(void)
@@ -685,5 +1346,6 @@ bool GattsApplication::configurationDone(void) const
 {
     return m_configurationDone == 0;
 }
+#endif
 
 } /* namespace Esp32 */
@@ -1,53 +1,124 @@
 #ifndef MAIN_GATTSAPPLICATION_HPP_
 #define MAIN_GATTSAPPLICATION_HPP_
 
-#include <esp_gap_ble_api.h>
-#include <esp_gatts_api.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include "AdvertisementPacker.hpp"
+#include "BleHost.hpp"
+#include "DispatchStatistics.hpp"
 #include "GattsService.hpp"
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+#include "PrepareWriteQueue.hpp"
+#endif
 
 #define GATTS_APPLICATION_DEFAULT_APPEARANCE (0x0000)
 
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+// the GATTS events lack a maximum, events beyond the table are counted as unhandled
+#ifndef GATTS_APPLICATION_GATTS_EVENTS
+#define GATTS_APPLICATION_GATTS_EVENTS (ESP_GATTS_SEND_SERVICE_CHANGE_EVT + 1)
+#endif
+#ifndef GATTS_APPLICATION_GAP_EVENTS
+#define GATTS_APPLICATION_GAP_EVENTS (ESP_GAP_BLE_EVT_MAX)
+#endif
+#endif
+
 namespace Esp32
 {
 
+/*
+ * With NimBLE there are neither GATTS events nor runtime changes of the GATT database: the services are handed over
+ * by registerServices() before the host starts, the host answers requests by the access callbacks of the services
+ * and reports connections by GAP events to gapEvent().
+ *
+ * With Bluedroid addService() and removeService() change the service list from the calling task while the BT task
+ * walks it for every GATTS event. A recursive mutex guards the list: gattsEventCallback() holds it for the whole
+ * handler, addService() and removeService() for the whole change. Code walking services() outside of GATTS handlers
+ * has to hold it as well, see lockServices().
+ */
 class GattsApplication
 {
 public:
-    struct AdvertisementData
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+    typedef void (*GattsEventHandler)(
+        GattsApplication* application,
+        esp_gatt_if_t gatts_if,
+        esp_ble_gatts_cb_param_t* param);
+    typedef void (*GapEventHandler)(GattsApplication* application, esp_ble_gap_cb_param_t* param);
+#endif
+
+    enum class RegistrationState: uint8_t
     {
-        AdvertisementData(uint8_t* payload = nullptr, size_t length = 0);
-
-        uint8_t* payload;
-        size_t length;
-
-        void dump(void) const;
+        IDLE,
+        REGISTERING,
+        READY,
+        CHANGING,
     };
 
-    struct ServiceList
+    struct AdvertisementData
     {
-        ServiceList(GattsService* service);
+        AdvertisementData();
 
-        GattsService* service;
-        ServiceList* next;
+        uint8_t payload[ADVERTISEMENT_LENGTH_MAX];
+        uint8_t length;
+
+        void dump(void) const;
     };
 
     GattsApplication(
         uint16_t applicationId,
         const char* shortDeviceName,
         const char* fullDeviceName = nullptr,
-        uint16_t appearance = GATTS_APPLICATION_DEFAULT_APPEARANCE);
+        uint16_t appearance = GATTS_APPLICATION_DEFAULT_APPEARANCE,
+        bool advertise = true);
     virtual ~GattsApplication();
 
     uint16_t applicationId(void) const;
+    bool advertises(void) const;
+    esp_gatt_if_t interface(void) const;
 
     void addService(GattsService* service);
+    void removeService(GattsService* service);
+    RegistrationState registrationState(void) const;
+    GattsService* services(void) const;
+    void lockServices(void) const;
+    void unlockServices(void) const;
     int numberOfAdvertisedServices(BleUuid::Width width) const;
-
+    void setAdvertisementData(const uint8_t* payload, size_t length);
+    void setScanResponseData(const uint8_t* payload, size_t length);
+    template<size_t N>
+    void setAdvertisementData(const AdvertisementPayload<N>& payload);
+    template<size_t N>
+    void setScanResponseData(const AdvertisementPayload<N>& payload);
+    size_t footprint(void) const;
+    void dumpFootprint(void) const;
+    const DispatchStatistics& gapDispatchStatistics(void) const;
+    const DispatchStatistics& gattsDispatchStatistics(void) const;
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    void registerServices(void);
+    void hostSynchronized(uint8_t ownAddressType);
+    int gapEvent(struct ble_gap_event* event);
+#else
     void gapEventCallback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
     void gattsEventCallback(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
 
+    void setGapEventHandler(esp_gap_ble_cb_event_t event, GapEventHandler handler);
+    void setGattsEventHandler(esp_gatts_cb_event_t event, GattsEventHandler handler);
+    uint32_t unhandledGapEvents(void) const;
+    uint32_t unhandledGattsEvents(void) const;
+
+    static void ignoreGapEvent(GattsApplication* application, esp_ble_gap_cb_param_t* param);
+    static void ignoreGattsEvent(GattsApplication* application, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+#endif
+
     const static uint8_t advertisementFlags[3];
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    static struct ble_gap_adv_params advertisementParameters;
+#else
     static esp_ble_adv_params_t advertisementParameters;
+#endif
 
 protected:
 
@@ -55,46 +126,124 @@ protected:
     const char* m_shortDeviceName;
     const char* m_fullDeviceName;
     uint16_t m_appearance;
+    bool m_advertise;
 
-    ServiceList* m_services;
-    ServiceList* m_nextServiceForRegistration;
-    uint8_t m_nextServiceRegistrationNumber;
+    GattsService* m_services;
+    GattsService* m_lastService;
+    StaticSemaphore_t m_servicesMutexBuffer;
+    SemaphoreHandle_t m_servicesMutex;
+    std::atomic<RegistrationState> m_registrationState;
 
-    uint8_t m_configurationDone;
     esp_gatt_if_t m_interface;
     AdvertisementData m_rawAdvertisementData;
     AdvertisementData m_rawScanResponseData;
+    DispatchStatistics m_gapDispatchStatistics;
+    DispatchStatistics m_gattsDispatchStatistics;
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    uint8_t m_ownAddressType;
+#else
+    GattsService* m_nextServiceForRegistration;
+    size_t m_nextChunkForRegistration;
+    size_t m_pendingDeletions;
+    GattsService* m_changedService;
+
+    uint8_t m_configurationDone;
+    PrepareWriteQueue m_prepareWriteQueue;
 
     uint8_t m_dummyValue;
 
-    void handleGapEventAdvertisementDataSetComplete(void);
-    void handleGapEventScanResponseDataSetComplete(void);
+    GapEventHandler m_gapEventHandlers[GATTS_APPLICATION_GAP_EVENTS];
+    GattsEventHandler m_gattsEventHandlers[GATTS_APPLICATION_GATTS_EVENTS];
+    uint32_t m_unhandledGapEvents;
+    uint32_t m_unhandledGattsEvents;
+#endif
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    void handleGapEventConnect(struct ble_gap_event* event);
+    void handleGapEventDisconnect(struct ble_gap_event* event);
+    void handleGapEventAdvertisementComplete(struct ble_gap_event* event);
+    void handleGapEventSubscribe(struct ble_gap_event* event);
+    void handleGapEventMtu(struct ble_gap_event* event);
+
+    void startAdvertising(void);
+#else
+    void handleGapEventAdvertisementDataSetComplete(esp_ble_gap_cb_param_t* param);
+    void handleGapEventScanResponseDataSetComplete(esp_ble_gap_cb_param_t* param);
     void handleGapEventAdvertisementStartComplete(esp_ble_gap_cb_param_t* param);
     void handleGapEventUpdatedConnectionParameters(esp_ble_gap_cb_param_t* param);
 
+    void handleGattsEventCongest(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
     void handleGattsEventConnect(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
     void handleGattsEventCreateAttributeTable(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+    void handleGattsEventDelete(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
     void handleGattsEventDisconnect(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+    void handleGattsEventExecuteWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
     void handleGattsEventMtu(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
     void handleGattsEventRead(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
-    void handleGattsEventRegister(esp_gatt_if_t gatts_if);
+    void handleGattsEventRegister(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+    void handleGattsEventResponse(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+    void handleGattsEventStart(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
     void handleGattsEventWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
 
-    void generateRawAdvertisementData(void);
-    void generateRawScanResponseData(void);
-
+    // adapt member handlers to the handler tables
+    template<void (GattsApplication::*handler)(esp_ble_gap_cb_param_t*)>
+    static void gapEventHandler(GattsApplication* application, esp_ble_gap_cb_param_t* param)
+    {
+        (application->*handler)(param);
+    }
+    template<void (GattsApplication::*handler)(esp_gatt_if_t, esp_ble_gatts_cb_param_t*)>
+    static void gattsEventHandler(GattsApplication* application, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param)
+    {
+        (application->*handler)(gatts_if, param);
+    }
+
+    void prepareWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+    esp_gatt_status_t executeWrites(uint16_t connectionId);
+#endif
+
+    void addServiceLocked(GattsService* service);
+    void generateRawData(void);
+    void addAdvertisedServices(
+        AdvertisementPacker* packer,
+        BleUuid::Width width,
+        size_t uuidLength,
+        uint8_t type);
+    void setRawData(AdvertisementData* data, const uint8_t* payload, size_t length);
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+    void removeServiceLocked(GattsService* service);
     void registerNextService(esp_gatt_if_t gatts_if);
+    void assignInstanceId(GattsService* service);
+    GattsService* serviceForHandle(uint16_t handle) const;
+    void beginServiceChange(void);
+    void abortServiceChange(void);
+    void unlinkService(GattsService* service);
+    void sendServiceChanged(uint16_t startHandle, uint16_t endHandle);
 
     void setConfigurationAdvertisementPendingFlag(void);
     void setConfigurationAdvertisementDoneFlag(void);
     void setConfigurationScanResponsePendingFlag(void);
     void setConfigurationScanResponseDoneFlag(void);
     bool configurationDone(void) const;
+#endif
 
 private:
 
 };
 
+template<size_t N>
+void GattsApplication::setAdvertisementData(const AdvertisementPayload<N>& payload)
+{
+    setAdvertisementData(payload.data, N);
+}
+
+template<size_t N>
+void GattsApplication::setScanResponseData(const AdvertisementPayload<N>& payload)
+{
+    setScanResponseData(payload.data, N);
+}
+
 } /* namespace Esp32 */
 
 #endif /* MAIN_GATTSAPPLICATION_HPP_ */
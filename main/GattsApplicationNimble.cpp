@@ -0,0 +1,299 @@
+#include <string.h>
+#include <esp_log.h>
+#include <services/gap/ble_svc_gap.h>
+#include <stdexcept>
+#include "BleServer.hpp"
+#include "GattsApplication.hpp"
+#include "HandleIndex.hpp"
+#include "NotificationDispatcher.hpp"
+
+#define LOG_TAG "GattsApplication"
+
+#define CLIENT_CONFIGURATION_NOTIFY (0x0001)
+#define CLIENT_CONFIGURATION_INDICATE (0x0002)
+
+namespace Esp32
+{
+
+struct ble_gap_adv_params GattsApplication::advertisementParameters = {
+    .conn_mode = BLE_GAP_CONN_MODE_UND,
+    .disc_mode = BLE_GAP_DISC_MODE_GEN,
+    .itvl_min = 0x20,
+    .itvl_max = 0x40,
+    .channel_map = 0,  // all channels
+    .filter_policy = BLE_HCI_ADV_FILT_NONE,
+};
+
+GattsApplication::GattsApplication(
+    uint16_t applicationId,
+    const char* shortDeviceName,
+    const char* fullDeviceName,
+    uint16_t appearance,
+    bool advertise):
+    m_applicationId(applicationId),
+    m_shortDeviceName(shortDeviceName),
+    m_fullDeviceName(fullDeviceName),
+    m_appearance(appearance),
+    m_advertise(advertise),
+    m_services(nullptr),
+    m_lastService(nullptr),
+    m_servicesMutex(xSemaphoreCreateRecursiveMutexStatic(&m_servicesMutexBuffer)),
+    m_registrationState(RegistrationState::IDLE),
+    m_interface(ESP_GATT_IF_NONE),
+    m_ownAddressType(0)
+{
+}
+
+void GattsApplication::removeService(GattsService* service)
+{
+    if (!service)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    // NimBLE takes the GATT database as a whole when the host starts
+    throw std::runtime_error("services cannot be removed with NimBLE");
+}
+
+void GattsApplication::registerServices(void)
+{
+    if (m_registrationState.load() != RegistrationState::IDLE)
+    {
+        throw std::runtime_error("services were already registered");
+    }
+
+    // the device name and the appearance are served by the GAP service of the host
+    auto deviceName = m_fullDeviceName;
+    if (!deviceName)
+    {
+        deviceName = m_shortDeviceName;
+    }
+    if (!deviceName)
+    {
+        throw std::runtime_error("no device name available");
+    }
+    if (ble_svc_gap_device_name_set(deviceName) != 0)
+    {
+        throw std::runtime_error("error setting the device name");
+    }
+    if (ble_svc_gap_device_appearance_set(m_appearance) != 0)
+    {
+        throw std::runtime_error("error setting the appearance");
+    }
+
+    auto servicePointer = m_services;
+    while (servicePointer)
+    {
+        auto serviceDefinition = servicePointer->serviceDefinition();
+
+        // the host sizes its attribute and client configuration pools by the counted definitions
+        if (ble_gatts_count_cfg(serviceDefinition) != 0)
+        {
+            throw std::runtime_error("error counting the attributes of the GATT service");
+        }
+        if (ble_gatts_add_svcs(serviceDefinition) != 0)
+        {
+            throw std::runtime_error("error registering the GATT service");
+        }
+
+        servicePointer = servicePointer->nextService();
+    }
+
+    m_registrationState.store(RegistrationState::REGISTERING);
+}
+
+void GattsApplication::hostSynchronized(uint8_t ownAddressType)
+{
+    m_ownAddressType = ownAddressType;
+
+    // the host synchronizes again after a reset, the GATT database and its handles are kept then
+    if (m_registrationState.load() == RegistrationState::REGISTERING)
+    {
+        auto servicePointer = m_services;
+        while (servicePointer)
+        {
+            servicePointer->pushHandles();
+            servicePointer = servicePointer->nextService();
+        }
+        m_registrationState.store(RegistrationState::READY);
+
+        ESP_LOGI(LOG_TAG, "Finished registering all services");
+        dumpFootprint();
+    }
+
+    if (m_advertise)
+    {
+        startAdvertising();
+    }
+}
+
+int GattsApplication::gapEvent(struct ble_gap_event* event)
+{
+    DISPATCH_STATISTICS_START();
+    switch (event->type)
+    {
+        case BLE_GAP_EVENT_CONNECT:
+            handleGapEventConnect(event);
+            break;
+        case BLE_GAP_EVENT_DISCONNECT:
+            handleGapEventDisconnect(event);
+            break;
+        case BLE_GAP_EVENT_ADV_COMPLETE:
+            handleGapEventAdvertisementComplete(event);
+            break;
+        case BLE_GAP_EVENT_SUBSCRIBE:
+            handleGapEventSubscribe(event);
+            break;
+        case BLE_GAP_EVENT_MTU:
+            handleGapEventMtu(event);
+            break;
+        default:
+            ESP_LOGD(LOG_TAG, "gapEvent(type=%d) not handled", (int)event->type);
+            return 0;
+    }
+    DISPATCH_STATISTICS_STOP(m_gapDispatchStatistics);
+
+    return 0;
+}
+
+void GattsApplication::handleGapEventConnect(struct ble_gap_event* event)
+{
+    if (event->connect.status != 0)
+    {
+        ESP_LOGW(LOG_TAG, "CONNECT failed, status=%d", event->connect.status);
+        if (m_advertise)
+        {
+            startAdvertising();
+        }
+        return;
+    }
+
+    ESP_LOGI(LOG_TAG, "CONNECT, conn_handle=%d", event->connect.conn_handle);
+
+    // connection handles are used as connection ids, e.g. as bit index of the subscribers
+    if (event->connect.conn_handle >= GATT_CONNECTIONS_MAX)
+    {
+        ESP_LOGW(LOG_TAG, "Connection handle out of range, disconnecting");
+        ble_gap_terminate(event->connect.conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+        return;
+    }
+
+    struct ble_gap_upd_params connectionParameters;
+    bzero(&connectionParameters, sizeof(connectionParameters));
+    /* For the iOS system, please refer to Apple official documents about the BLE connection parameters restrictions. */
+    connectionParameters.latency = 0;
+    connectionParameters.itvl_min = 0x10;    // itvl_min = 0x10*1.25ms = 20ms
+    connectionParameters.itvl_max = 0x20;    // itvl_max = 0x20*1.25ms = 40ms
+    connectionParameters.supervision_timeout = 400;    // timeout = 400*10ms = 4000ms
+
+    if (ble_gap_update_params(event->connect.conn_handle, &connectionParameters) != 0)
+    {
+        ESP_LOGW(LOG_TAG, "Could not update connection parameters! Skipping.");
+    }
+}
+
+void GattsApplication::handleGapEventDisconnect(struct ble_gap_event* event)
+{
+    ESP_LOGI(
+        LOG_TAG,
+        "DISCONNECT, conn_handle=%d, reason=0x%04x",
+        event->disconnect.conn.conn_handle,
+        event->disconnect.reason);
+
+    auto connectionId = event->disconnect.conn.conn_handle;
+    if (connectionId < GATT_CONNECTIONS_MAX)
+    {
+        auto servicePointer = m_services;
+        while (servicePointer)
+        {
+            servicePointer->clearClientConfigurations(connectionId);
+            servicePointer = servicePointer->nextService();
+        }
+        NotificationDispatcher::instance()->setMtu(connectionId, ESP_GATT_DEF_BLE_MTU_SIZE);
+    }
+
+    if (m_advertise && m_registrationState.load() == RegistrationState::READY)
+    {
+        startAdvertising();
+    }
+}
+
+void GattsApplication::handleGapEventAdvertisementComplete(struct ble_gap_event* event)
+{
+    ESP_LOGD(LOG_TAG, "ADV_COMPLETE, reason=%d", event->adv_complete.reason);
+    if (m_advertise)
+    {
+        startAdvertising();
+    }
+}
+
+void GattsApplication::handleGapEventSubscribe(struct ble_gap_event* event)
+{
+    ESP_LOGD(
+        LOG_TAG,
+        "SUBSCRIBE, conn_handle=%d, handle=%04x, notify=%d, indicate=%d",
+        event->subscribe.conn_handle,
+        event->subscribe.attr_handle,
+        (int)event->subscribe.cur_notify,
+        (int)event->subscribe.cur_indicate);
+
+    // the host keeps the client configuration descriptors itself, the characteristics learn about them here
+    bool clientConfiguration;
+    auto entry = HandleIndex::instance()->find(event->subscribe.attr_handle, &clientConfiguration);
+    if (!entry || clientConfiguration)
+    {
+        // e.g. Service Changed of the GATT service of the host
+        return;
+    }
+
+    uint16_t value = 0;
+    if (event->subscribe.cur_notify)
+    {
+        value |= CLIENT_CONFIGURATION_NOTIFY;
+    }
+    if (event->subscribe.cur_indicate)
+    {
+        value |= CLIENT_CONFIGURATION_INDICATE;
+    }
+    entry->characteristic->setClientConfiguration(event->subscribe.conn_handle, value);
+}
+
+void GattsApplication::handleGapEventMtu(struct ble_gap_event* event)
+{
+    ESP_LOGD(LOG_TAG, "MTU, conn_handle=%d, mtu=%d", event->mtu.conn_handle, event->mtu.value);
+    NotificationDispatcher::instance()->setMtu(event->mtu.conn_handle, event->mtu.value);
+}
+
+void GattsApplication::startAdvertising(void)
+{
+    if (!m_rawAdvertisementData.length || !m_rawScanResponseData.length)
+    {
+        generateRawData();
+        m_rawAdvertisementData.dump();
+        m_rawScanResponseData.dump();
+    }
+
+    if (ble_gap_adv_set_data(m_rawAdvertisementData.payload, m_rawAdvertisementData.length) != 0)
+    {
+        throw std::runtime_error("error setting raw advertising data");
+    }
+
+    if (ble_gap_adv_rsp_set_data(m_rawScanResponseData.payload, m_rawScanResponseData.length) != 0)
+    {
+        throw std::runtime_error("error setting raw scan response data");
+    }
+
+    if (ble_gap_adv_start(
+            m_ownAddressType,
+            nullptr,
+            BLE_HS_FOREVER,
+            &advertisementParameters,
+            BleServer::gapEventCallback,
+            nullptr) != 0)
+    {
+        throw std::runtime_error("error starting advertising");
+    }
+    ESP_LOGI(LOG_TAG, "started advertising");
+}
+
+} /* namespace Esp32 */
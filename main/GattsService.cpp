@@ -1,7 +1,11 @@
 #include <string.h>
 #include <esp_log.h>
 #include <stdexcept>
+#include "GattArena.hpp"
 #include "GattsService.hpp"
+#include "HandleIndex.hpp"
+#include "NotificationDispatcher.hpp"
+#include "ValueChangeBus.hpp"
 
 #define LOG_TAG "GattsService"
 
@@ -11,27 +15,36 @@ namespace Esp32
 const uint16_t GattsService::primaryServiceUuid = ESP_GATT_UUID_PRI_SERVICE;
 const uint16_t GattsService::characterDeclarationUuid = ESP_GATT_UUID_CHAR_DECLARE;
 const uint16_t GattsService::characterDescriptionUuid = ESP_GATT_UUID_CHAR_DESCRIPTION;
+const uint16_t GattsService::clientConfigurationUuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+const uint16_t GattsService::clientConfigurationDefault = 0x0000;
 const uint8_t GattsService::characteristicPropertyRead = ESP_GATT_CHAR_PROP_BIT_READ;
 const uint8_t GattsService::characteristicPropertyReadWrite =
     ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
 const uint8_t GattsService::characteristicPropertyWrite = ESP_GATT_CHAR_PROP_BIT_WRITE;
 
-GattsService::CharacteristicList::CharacteristicList(GenericGattCharacteristic* characteristic):
-    characteristic(characteristic),
-    next(nullptr)
-{
-}
-
+#ifndef CONFIG_BT_NIMBLE_ENABLED
 GattsService::AttributeTable::AttributeTable(esp_gatts_attr_db_t* table, size_t length):
     table(table),
     length(length)
 {
 }
+#endif
 
 GattsService::GattsService(const BleServiceUuid& serviceId):
     m_serviceId(serviceId),
     m_characteristics(nullptr),
-    m_characteristicHandles(nullptr)
+    m_lastCharacteristic(nullptr),
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    m_serviceDefinition(nullptr),
+#else
+    m_attributeTableArenaMark(0),
+    m_attributeTableChunk(0),
+#endif
+    m_chunkStartHandles(),
+    m_chunkLengths(),
+    m_numberOfRegisteredChunks(0),
+    m_instanceId(0),
+    m_nextService(nullptr)
 {
 }
 
@@ -44,15 +57,69 @@ const BleServiceUuid& GattsService::serviceId(void) const
     return m_serviceId;
 }
 
-const GattsService::AttributeTable& GattsService::attributeTable(void)
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+const GattsService::AttributeTable& GattsService::attributeTable(size_t chunk)
 {
     if (!m_attributeTable.table)
     {
-        generateAttributeTable();
+        generateAttributeTable(chunk);
+    }
+    else if (chunk != m_attributeTableChunk)
+    {
+        throw std::runtime_error("attribute table of another chunk was not released");
     }
     return m_attributeTable;
 }
 
+void GattsService::releaseAttributeTable(void)
+{
+    // the Bluetooth stack copies UUIDs and values while creating the service, thus the table is not needed anymore
+    if (!m_attributeTable.table)
+    {
+        return;
+    }
+
+    GattArena::instance()->release(m_attributeTableArenaMark);
+    m_attributeTable.table = nullptr;
+}
+#endif
+
+size_t GattsService::numberOfChunks(void) const
+{
+    size_t chunks = 1;
+    size_t attributes = 1;  // service declaration
+
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        auto characteristicAttributes = characteristicPointer->numberOfAttributes();
+        if (attributes + characteristicAttributes > GATTS_SERVICE_CHUNK_ATTRIBUTES_MAX)
+        {
+            ++chunks;
+            attributes = 1;
+        }
+        attributes += characteristicAttributes;
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+
+    return chunks;
+}
+
+void GattsService::setInstanceId(uint8_t instanceId)
+{
+    if (m_numberOfRegisteredChunks)
+    {
+        throw std::runtime_error("service is registered");
+    }
+    m_instanceId = instanceId;
+}
+
+uint8_t GattsService::instanceId(void) const
+{
+    return m_instanceId;
+}
+
 void GattsService::addCharacteristic(GenericGattCharacteristic* characteristic)
 {
     if (!characteristic)
@@ -60,57 +127,179 @@ void GattsService::addCharacteristic(GenericGattCharacteristic* characteristic)
         throw std::invalid_argument("null pointer exception");
     }
 
-    auto characteristicListEntry = new CharacteristicList(characteristic);
+    if (characteristic->nextCharacteristic() || characteristic == m_lastCharacteristic)
+    {
+        throw std::invalid_argument("characteristic was already added");
+    }
+
     if (!m_characteristics)
     {
-        m_characteristics = characteristicListEntry;
+        m_characteristics = characteristic;
     }
     else
     {
-        auto characteristicPointer = m_characteristics;
-        for(; characteristicPointer->next; characteristicPointer = characteristicPointer->next)
-        {
-        }
-        characteristicPointer->next = characteristicListEntry;
+        m_lastCharacteristic->setNextCharacteristic(characteristic);
     }
+    m_lastCharacteristic = characteristic;
 }
 
-void GattsService::readCharacteristic(uint16_t handle, uint8_t* buffer, uint16_t* length)
+void GattsService::readCharacteristic(
+    uint16_t connectionId,
+    uint16_t handle,
+    uint16_t offset,
+    uint8_t* buffer,
+    uint16_t* length)
 {
-    getCharacteristicForHandle(handle)->read(buffer, length);
+    getCharacteristicForHandle(handle)->readAt(connectionId, offset, buffer, length);
 }
 
-void GattsService::writeCharacteristic(uint16_t handle, const uint8_t* buffer, uint16_t length)
+void GattsService::writeCharacteristic(
+    uint16_t connectionId,
+    uint16_t handle,
+    const uint8_t* buffer,
+    uint16_t length)
 {
-    getCharacteristicForHandle(handle)->write(buffer, length);
+    auto characteristic = getCharacteristicForHandle(handle);
+    characteristic->write(buffer, length);
+    ValueChangeBus::instance()->publish(characteristic, connectionId, 0, buffer, length);
+}
+
+void GattsService::writeCharacteristicAt(
+    uint16_t connectionId,
+    uint16_t handle,
+    uint16_t offset,
+    const uint8_t* buffer,
+    uint16_t length)
+{
+    // complete values take the same path as write requests, services intercepting them need not care about offsets
+    if (!offset)
+    {
+        writeCharacteristic(connectionId, handle, buffer, length);
+        return;
+    }
+    auto characteristic = getCharacteristicForHandle(handle);
+    characteristic->writeAt(connectionId, offset, buffer, length);
+    ValueChangeBus::instance()->publish(characteristic, connectionId, offset, buffer, length);
 }
 
-void GattsService::pushHandles(const uint16_t* handles)
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+void GattsService::pushHandles(esp_gatt_if_t gatts_if, const uint16_t* handles)
 {
-    if (!handles || !m_attributeTable.table)
+    if (!handles || !m_attributeTable.length)
     {
         throw std::invalid_argument("null pointer exception");
     }
 
-    if (m_characteristicHandles)
+    if (m_attributeTableChunk != m_numberOfRegisteredChunks)
     {
         throw std::invalid_argument("handles were already supplied");
     }
 
-    m_characteristicHandles = (uint16_t*) malloc(m_attributeTable.length * sizeof(uint16_t));
-    memcpy(m_characteristicHandles, handles, m_attributeTable.length * sizeof(uint16_t));
+    // handles within an attribute table are assigned consecutively, thus only the start handle needs to be kept
+    for (size_t i = 1; i < m_attributeTable.length; ++i)
+    {
+        if (handles[i] != handles[0] + i)
+        {
+            throw std::runtime_error("attribute handles are not consecutive");
+        }
+    }
+
+    m_chunkStartHandles[m_numberOfRegisteredChunks] = handles[0];
+    m_chunkLengths[m_numberOfRegisteredChunks] = m_attributeTable.length;
+    ++m_numberOfRegisteredChunks;
+
+    size_t remainingAttributes;
+    auto characteristicPointer = chunk(m_attributeTableChunk, &remainingAttributes);
+    --remainingAttributes;
+    while (characteristicPointer && remainingAttributes)
+    {
+        remainingAttributes -= characteristicPointer->numberOfAttributes();
+        characteristicPointer->setHandle(gatts_if, handles[0] + characteristicPointer->handleIndex());
+        HandleIndex::instance()->add(characteristicPointer->handle(), this, characteristicPointer);
+        if (characteristicPointer->notification() != GenericGattCharacteristic::Notification::NONE)
+        {
+            NotificationDispatcher::instance()->registerCharacteristic(characteristicPointer);
+        }
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
 }
+#endif
 
-bool GattsService::hasHandle(uint16_t handle)
+void GattsService::resetHandles(void)
 {
-    if (!m_characteristicHandles)
+    // the service was deleted from the Bluetooth stack, subscriptions end with it and handles may be reused
+    for (uint16_t connectionId = 0; connectionId < GATT_CONNECTIONS_MAX; ++connectionId)
     {
-        return false;
+        clearClientConfigurations(connectionId);
     }
 
-    for (auto i = 0; i < m_attributeTable.length; ++i)
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        characteristicPointer->setHandle(ESP_GATT_IF_NONE, 0);
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+
+    HandleIndex::instance()->remove(this);
+    m_numberOfRegisteredChunks = 0;
+}
+
+uint16_t GattsService::startHandle(void) const
+{
+    uint16_t startHandle = 0;
+    for (size_t i = 0; i < m_numberOfRegisteredChunks; ++i)
+    {
+        if (!startHandle || m_chunkStartHandles[i] < startHandle)
+        {
+            startHandle = m_chunkStartHandles[i];
+        }
+    }
+    return startHandle;
+}
+
+uint16_t GattsService::endHandle(void) const
+{
+    uint16_t endHandle = 0;
+    for (size_t i = 0; i < m_numberOfRegisteredChunks; ++i)
+    {
+        if (m_chunkStartHandles[i] + m_chunkLengths[i] - 1 > endHandle)
+        {
+            endHandle = m_chunkStartHandles[i] + m_chunkLengths[i] - 1;
+        }
+    }
+    return endHandle;
+}
+
+uint16_t GattsService::numberOfHandles(void) const
+{
+    uint16_t numberOfHandles = 0;
+    for (size_t i = 0; i < m_numberOfRegisteredChunks; ++i)
+    {
+        numberOfHandles += m_chunkLengths[i];
+    }
+    return numberOfHandles;
+}
+
+size_t GattsService::numberOfRegisteredChunks(void) const
+{
+    return m_numberOfRegisteredChunks;
+}
+
+uint16_t GattsService::chunkStartHandle(size_t chunk) const
+{
+    if (chunk >= m_numberOfRegisteredChunks)
+    {
+        throw std::out_of_range("chunk index out of range");
+    }
+    return m_chunkStartHandles[chunk];
+}
+
+bool GattsService::hasHandle(uint16_t handle)
+{
+    for (size_t i = 0; i < m_numberOfRegisteredChunks; ++i)
     {
-        if (m_characteristicHandles[i] == handle)
+        if (handle >= m_chunkStartHandles[i] && handle - m_chunkStartHandles[i] < m_chunkLengths[i])
         {
             return true;
         }
@@ -118,31 +307,144 @@ bool GattsService::hasHandle(uint16_t handle)
     return false;
 }
 
-void GattsService::generateAttributeTable(void)
+bool GattsService::hasClientConfigurationHandle(uint16_t handle)
 {
-    if (m_attributeTable.table)
+    return hasHandle(handle) && getCharacteristicForClientConfigurationHandle(handle);
+}
+
+void GattsService::readClientConfiguration(uint16_t connectionId, uint16_t handle, uint8_t* buffer, uint16_t* length)
+{
+    auto characteristic = getCharacteristicForClientConfigurationHandle(handle);
+    if (!characteristic)
     {
-        throw std::runtime_error("attribute table was already generated");
+        throw std::runtime_error("requested handle not found");
+    }
+
+    auto clientConfiguration = characteristic->clientConfiguration(connectionId);
+    *length = sizeof(clientConfiguration);
+    memcpy(buffer, &clientConfiguration, sizeof(clientConfiguration));
+}
+
+void GattsService::writeClientConfiguration(
+    uint16_t connectionId,
+    uint16_t handle,
+    const uint8_t* buffer,
+    uint16_t length)
+{
+    auto characteristic = getCharacteristicForClientConfigurationHandle(handle);
+    if (!characteristic)
+    {
+        throw std::runtime_error("requested handle not found");
+    }
+
+    uint16_t clientConfiguration;
+    if (length != sizeof(clientConfiguration))
+    {
+        throw std::length_error("client configuration has to be two bytes");
+    }
+    memcpy(&clientConfiguration, buffer, sizeof(clientConfiguration));
+
+    characteristic->setClientConfiguration(connectionId, clientConfiguration);
+}
+
+void GattsService::clearClientConfigurations(uint16_t connectionId)
+{
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        if (characteristicPointer->notification() != GenericGattCharacteristic::Notification::NONE)
+        {
+            characteristicPointer->setClientConfiguration(connectionId, 0);
+        }
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
     }
+}
+
+void GattsService::congestionChanged(uint16_t connectionId, bool congested)
+{
+}
+
+GenericGattCharacteristic* GattsService::characteristics(void) const
+{
+    return m_characteristics;
+}
+
+void GattsService::setNextService(GattsService* service)
+{
+    m_nextService = service;
+}
+
+GattsService* GattsService::nextService(void) const
+{
+    return m_nextService;
+}
 
-    size_t requiredLength = 1;  // service declaration
+size_t GattsService::footprint(void) const
+{
+    size_t bytes = sizeof(*this);
 
     auto characteristicPointer = m_characteristics;
     while (characteristicPointer)
     {
-        requiredLength +=
-            2 +
-            (characteristicPointer->characteristic->description() ? 1 : 0);
+        bytes += characteristicPointer->objectSize();
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+
+    return bytes;
+}
 
-        characteristicPointer = characteristicPointer->next;
+void GattsService::dumpFootprint(void) const
+{
+    char uuidString[40];
+
+    m_serviceId.toString(uuidString, sizeof(uuidString));
+    ESP_LOGI(
+        LOG_TAG,
+        "service %s: %u bytes total (object %u bytes), %u attributes in %u tables (released after creation)",
+        uuidString,
+        (unsigned) footprint(),
+        (unsigned) sizeof(*this),
+        (unsigned) numberOfAttributes(),
+        (unsigned) numberOfChunks());
+
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        characteristicPointer->characteristicId().toString(uuidString, sizeof(uuidString));
+        ESP_LOGI(
+            LOG_TAG,
+            "  characteristic %s: object %u bytes, %d attributes",
+            uuidString,
+            (unsigned) characteristicPointer->objectSize(),
+            characteristicPointer->numberOfAttributes());
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
     }
+}
 
-    m_attributeTable.table = (esp_gatts_attr_db_t*) malloc(sizeof(esp_gatts_attr_db_t) * requiredLength);
-    if (!m_attributeTable.table)
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+void GattsService::generateAttributeTable(size_t chunk)
+{
+    if (m_attributeTable.table)
+    {
+        throw std::runtime_error("attribute table was already generated");
+    }
+
+    if (chunk >= GATTS_SERVICE_CHUNKS_MAX)
     {
-        throw std::runtime_error("error allocating memory for the attribute table");
+        throw std::runtime_error("service has too many attributes");
     }
+
+    size_t requiredLength;
+    auto characteristicPointer = this->chunk(chunk, &requiredLength);
+
+    m_attributeTableArenaMark = GattArena::instance()->mark();
+    m_attributeTable.table = (esp_gatts_attr_db_t*) GattArena::instance()->allocate(
+        sizeof(esp_gatts_attr_db_t) * requiredLength,
+        alignof(esp_gatts_attr_db_t));
     m_attributeTable.length = requiredLength;
+    m_attributeTableChunk = chunk;
 
     auto tablePointer = m_attributeTable.table;
 
@@ -152,32 +454,32 @@ void GattsService::generateAttributeTable(void)
         ESP_UUID_LEN_16,
         (uint8_t *)&GattsService::primaryServiceUuid,
         ESP_GATT_PERM_READ,
-        0,
-        0,
-        nullptr
+        m_serviceId.length(),
+        m_serviceId.length(),
+        uuidForAttributeTable(m_serviceId)
     };
-    switch (m_serviceId.width)
-    {
-        case BleUuid::Width::UUID_16:
-            tablePointer->att_desc.length = sizeof(m_serviceId.uuid16);
-            tablePointer->att_desc.max_length = sizeof(m_serviceId.uuid16);
-            tablePointer->att_desc.value = (uint8_t*) &m_serviceId.uuid16;
-            break;
-        case BleUuid::Width::UUID_32:
-            tablePointer->att_desc.length = sizeof(m_serviceId.uuid32);
-            tablePointer->att_desc.max_length = sizeof(m_serviceId.uuid32);
-            tablePointer->att_desc.value = (uint8_t*) &m_serviceId.uuid32;
-            break;
-        default:
-            throw std::runtime_error("UUID width is not supported");
-    }
 
-    // put characteristic declarations
-    characteristicPointer = m_characteristics;
-    while (characteristicPointer)
+    // put characteristic declarations of the chunk
+    while (tablePointer + 1 < m_attributeTable.table + requiredLength)
     {
-        auto permission = characteristicPointer->characteristic->permission();
-        auto characteristicProperty = permissionBitmaskToCharacteristicProperty(permission);
+        auto permission = characteristicPointer->permission();
+        auto characteristicProperty = (uint8_t*) GattArena::instance()->allocate(sizeof(uint8_t), 1);
+        *characteristicProperty = permissionBitmaskToCharacteristicProperty(permission);
+        if (characteristicPointer->writeWithoutResponse())
+        {
+            *characteristicProperty |= ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+        }
+        switch (characteristicPointer->notification())
+        {
+            case GenericGattCharacteristic::Notification::NOTIFY:
+                *characteristicProperty |= ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+                break;
+            case GenericGattCharacteristic::Notification::INDICATE:
+                *characteristicProperty |= ESP_GATT_CHAR_PROP_BIT_INDICATE;
+                break;
+            default:
+                break;
+        }
 
         ++tablePointer;
         tablePointer->attr_control = { ESP_GATT_AUTO_RSP };
@@ -185,42 +487,42 @@ void GattsService::generateAttributeTable(void)
             ESP_UUID_LEN_16,
             (uint8_t *)&GattsService::characterDeclarationUuid,
             ESP_GATT_PERM_READ,
-            sizeof(characteristicProperty),
-            sizeof(characteristicProperty),
-            (uint8_t*) characteristicProperty
+            sizeof(*characteristicProperty),
+            sizeof(*characteristicProperty),
+            characteristicProperty
         };
 
         ++tablePointer;
         tablePointer->attr_control = { ESP_GATT_RSP_BY_APP };
-        auto& characteristicId = characteristicPointer->characteristic->characteristicId();
+        auto& characteristicId = characteristicPointer->characteristicId();
 
         tablePointer->att_desc = {
-            0,
-            nullptr,
+            characteristicId.length(),
+            uuidForAttributeTable(characteristicId),
             permission,
-            characteristicPointer->characteristic->length(),
-            characteristicPointer->characteristic->length(),
+            characteristicPointer->length(),
+            characteristicPointer->length(),
             &m_dummyByte
         };
 
-        switch (characteristicId.width)
+        characteristicPointer->setHandleIndex(tablePointer - m_attributeTable.table);
+
+        if (characteristicPointer->notification() != GenericGattCharacteristic::Notification::NONE)
         {
-            case BleUuid::Width::UUID_16:
-                tablePointer->att_desc.uuid_length = ESP_UUID_LEN_16;
-                tablePointer->att_desc.uuid_p =
-                    (uint8_t*) &characteristicPointer->characteristic->characteristicId().uuid16; // TODO try reference
-                break;
-            case BleUuid::Width::UUID_32:
-                tablePointer->att_desc.uuid_length = ESP_UUID_LEN_32;
-                tablePointer->att_desc.uuid_p =
-                    (uint8_t*) &characteristicPointer->characteristic->characteristicId().uuid32;
-                break;
-            default:
-                throw std::runtime_error("UUID width is not supported");
+            // client configuration is kept per connection, thus it is handled by the application
+            ++tablePointer;
+            tablePointer->attr_control = { ESP_GATT_RSP_BY_APP };
+            tablePointer->att_desc = {
+                ESP_UUID_LEN_16,
+                (uint8_t *)&GattsService::clientConfigurationUuid,
+                ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                sizeof(GattsService::clientConfigurationDefault),
+                sizeof(GattsService::clientConfigurationDefault),
+                (uint8_t *)&GattsService::clientConfigurationDefault
+            };
         }
-        characteristicPointer->characteristic->setHandleIndex(tablePointer - m_attributeTable.table);
 
-        auto description = characteristicPointer->characteristic->description();
+        auto description = characteristicPointer->description();
         if (description)
         {
             ++tablePointer;
@@ -235,48 +537,125 @@ void GattsService::generateAttributeTable(void)
             };
         }
 
-        characteristicPointer = characteristicPointer->next;
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+}
+#endif
+
+GenericGattCharacteristic* GattsService::chunk(size_t index, size_t* numberOfAttributes) const
+{
+    // characteristics are never split, a chunk ends before the first characteristic which does not fit anymore
+    size_t chunk = 0;
+    size_t attributes = 1;  // service declaration
+    auto firstCharacteristic = m_characteristics;
+
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        auto characteristicAttributes = characteristicPointer->numberOfAttributes();
+        if (attributes + characteristicAttributes > GATTS_SERVICE_CHUNK_ATTRIBUTES_MAX)
+        {
+            if (chunk == index)
+            {
+                break;
+            }
+            ++chunk;
+            attributes = 1;
+            firstCharacteristic = characteristicPointer;
+        }
+        attributes += characteristicAttributes;
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+
+    if (chunk != index)
+    {
+        throw std::out_of_range("chunk index out of range");
+    }
+
+    *numberOfAttributes = attributes;
+    return firstCharacteristic;
+}
+
+size_t GattsService::numberOfAttributes(void) const
+{
+    size_t attributes = numberOfChunks();  // a service declaration per chunk
+
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        attributes += characteristicPointer->numberOfAttributes();
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
     }
+
+    return attributes;
+}
+
+#ifndef CONFIG_BT_NIMBLE_ENABLED
+uint8_t* GattsService::uuidForAttributeTable(const BleUuid& uuid)
+{
+    if (uuid.width != BleUuid::Width::UUID_128)
+    {
+        return (uint8_t*) uuid.data();
+    }
+
+    // expand interned 128 bit UUIDs next to the attribute table, they are released together
+    auto buffer = (uint8_t*) GattArena::instance()->allocate(uuid.length(), 1);
+    uuid.copyTo(buffer);
+    return buffer;
 }
+#endif
 
 GenericGattCharacteristic* GattsService::getCharacteristicForHandle(uint16_t handle)
 {
-    if (!m_characteristicHandles)
+    if (!m_numberOfRegisteredChunks)
     {
         throw std::runtime_error("no handles initialized yet");
     }
 
-    for (auto i = 0; i < m_attributeTable.length; ++i)
+    if (!hasHandle(handle))
     {
-        if (m_characteristicHandles[i] == handle)
-        {
-            auto characteristicPointer = m_characteristics;
+        throw std::runtime_error("requested handle not found");
+    }
 
-            while (characteristicPointer)
-            {
-                if (characteristicPointer->characteristic->handleIndex() == i)
-                {
-                    return characteristicPointer->characteristic;
-                }
+    bool clientConfiguration;
+    auto entry = HandleIndex::instance()->find(handle, &clientConfiguration);
+    if (!entry || entry->service != this || clientConfiguration)
+    {
+        throw std::runtime_error("requested characteristic not found");
+    }
+    return entry->characteristic;
+}
 
-                characteristicPointer = characteristicPointer->next;
-            }
-            throw std::runtime_error("requested characteristic not found");
-        }
+GenericGattCharacteristic* GattsService::getCharacteristicForClientConfigurationHandle(uint16_t handle)
+{
+    if (!hasHandle(handle))
+    {
+        return nullptr;
+    }
+
+    bool clientConfiguration;
+    auto entry = HandleIndex::instance()->find(handle, &clientConfiguration);
+    if (!entry || entry->service != this || !clientConfiguration)
+    {
+        return nullptr;
     }
-    throw std::runtime_error("requested handle not found");
+    return entry->characteristic;
 }
 
-const uint8_t* GattsService::permissionBitmaskToCharacteristicProperty(uint8_t permission)
+uint8_t GattsService::permissionBitmaskToCharacteristicProperty(uint8_t permission)
 {
     switch (permission)
     {
+        case 0:
+            return 0;  // notification only
         case ESP_GATT_PERM_READ:
-            return &characteristicPropertyRead;
+            return characteristicPropertyRead;
         case ESP_GATT_PERM_WRITE:
-            return &characteristicPropertyWrite;
+            return characteristicPropertyWrite;
         case ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE:
-            return &characteristicPropertyReadWrite;
+            return characteristicPropertyReadWrite;
         default:
             break;
     }
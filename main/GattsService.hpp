@@ -1,24 +1,37 @@
 #ifndef MAIN_GATTSSERVICE_HPP_
 #define MAIN_GATTSSERVICE_HPP_
 
-#include <esp_gatts_api.h>
+#include "BleHost.hpp"
 #include "BleServiceUuid.hpp"
 #include "GenericGattCharacteristic.hpp"
 
+// attributes per table accepted by esp_ble_gatts_create_attr_tab(), NimBLE takes a service as a whole
+#if defined(CONFIG_BT_NIMBLE_ENABLED)
+#define GATTS_SERVICE_CHUNK_ATTRIBUTES_MAX (UINT16_MAX)
+#elif defined(ESP_GATT_ATTR_HANDLE_MAX)
+#define GATTS_SERVICE_CHUNK_ATTRIBUTES_MAX (ESP_GATT_ATTR_HANDLE_MAX)
+#else
+#define GATTS_SERVICE_CHUNK_ATTRIBUTES_MAX (100)
+#endif
+#define GATTS_SERVICE_CHUNKS_MAX (8)
+
 namespace Esp32
 {
 
+/*
+ * A service is registered by attribute tables of at most GATTS_SERVICE_CHUNK_ATTRIBUTES_MAX attributes. Services
+ * exceeding this limit are split into chunks of whole characteristics, each registered as an instance of the service
+ * UUID of its own with consecutive instance ids starting at instanceId(). Only the table of the chunk being
+ * registered is held in the arena at a time.
+ *
+ * With NimBLE the service is registered as a whole by the definition built by serviceDefinition(). The host refers
+ * to it as long as it runs, thus the definition stays in the arena. Handles are taken over by pushHandles() once the
+ * host assigned them, requests are answered by the access callbacks of the definition.
+ */
 class GattsService
 {
 public:
-    struct CharacteristicList
-    {
-        CharacteristicList(GenericGattCharacteristic* characteristic);
-
-        GenericGattCharacteristic* characteristic;
-        CharacteristicList* next;
-    };
-
+#ifndef CONFIG_BT_NIMBLE_ENABLED
     struct AttributeTable
     {
         AttributeTable(esp_gatts_attr_db_t* table = nullptr, size_t length = 0);
@@ -26,22 +39,67 @@ public:
         esp_gatts_attr_db_t* table;
         size_t length;
     };
+#endif
 
     GattsService(const BleServiceUuid& serviceId);
     virtual ~GattsService();
 
     const BleServiceUuid& serviceId(void) const;
-    const AttributeTable& attributeTable(void);
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    const struct ble_gatt_svc_def* serviceDefinition(void);
+#else
+    const AttributeTable& attributeTable(size_t chunk = 0);
+    void releaseAttributeTable(void);
+#endif
+    size_t numberOfChunks(void) const;
+    void setInstanceId(uint8_t instanceId);
+    uint8_t instanceId(void) const;
 
     void addCharacteristic(GenericGattCharacteristic* characteristic);
-    void readCharacteristic(uint16_t handle, uint8_t* buffer, uint16_t* length);
-    virtual void writeCharacteristic(uint16_t handle, const uint8_t* buffer, uint16_t length);
-    void pushHandles(const uint16_t* handles);
+    virtual void readCharacteristic(
+        uint16_t connectionId,
+        uint16_t handle,
+        uint16_t offset,
+        uint8_t* buffer,
+        uint16_t* length);
+    virtual void writeCharacteristic(uint16_t connectionId, uint16_t handle, const uint8_t* buffer, uint16_t length);
+    virtual void writeCharacteristicAt(
+        uint16_t connectionId,
+        uint16_t handle,
+        uint16_t offset,
+        const uint8_t* buffer,
+        uint16_t length);
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    void pushHandles(void);
+#else
+    void pushHandles(esp_gatt_if_t gatts_if, const uint16_t* handles);
+#endif
+    void resetHandles(void);
+    uint16_t startHandle(void) const;
+    uint16_t endHandle(void) const;
+    uint16_t numberOfHandles(void) const;
+    size_t numberOfRegisteredChunks(void) const;
+    uint16_t chunkStartHandle(size_t chunk) const;
     bool hasHandle(uint16_t handle);
 
+    bool hasClientConfigurationHandle(uint16_t handle);
+    void readClientConfiguration(uint16_t connectionId, uint16_t handle, uint8_t* buffer, uint16_t* length);
+    void writeClientConfiguration(uint16_t connectionId, uint16_t handle, const uint8_t* buffer, uint16_t length);
+    virtual void clearClientConfigurations(uint16_t connectionId);
+    virtual void congestionChanged(uint16_t connectionId, bool congested);
+
+    GenericGattCharacteristic* characteristics(void) const;
+    void setNextService(GattsService* service);
+    GattsService* nextService(void) const;
+
+    size_t footprint(void) const;
+    void dumpFootprint(void) const;
+
     static const uint16_t primaryServiceUuid;
     static const uint16_t characterDeclarationUuid;
     static const uint16_t characterDescriptionUuid;
+    static const uint16_t clientConfigurationUuid;
+    static const uint16_t clientConfigurationDefault;
     static const uint8_t characteristicPropertyRead;
     static const uint8_t characteristicPropertyReadWrite;
     static const uint8_t characteristicPropertyWrite;
@@ -50,15 +108,49 @@ protected:
 
     BleServiceUuid m_serviceId;
 
-    CharacteristicList* m_characteristics;
+    GenericGattCharacteristic* m_characteristics;
+    GenericGattCharacteristic* m_lastCharacteristic;
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    struct ble_gatt_svc_def* m_serviceDefinition;
+#else
     AttributeTable m_attributeTable;
-    uint16_t* m_characteristicHandles;
+    size_t m_attributeTableArenaMark;
+    size_t m_attributeTableChunk;
+#endif
+    uint16_t m_chunkStartHandles[GATTS_SERVICE_CHUNKS_MAX];
+    uint16_t m_chunkLengths[GATTS_SERVICE_CHUNKS_MAX];
+    uint8_t m_numberOfRegisteredChunks;
+    uint8_t m_instanceId;
+
+    GattsService* m_nextService;
 
     uint8_t m_dummyByte;
 
-    void generateAttributeTable(void);
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    const ble_uuid_t* uuidForServiceDefinition(const BleUuid& uuid);
+    uint16_t characteristicFlags(const GenericGattCharacteristic* characteristic);
+#else
+    void generateAttributeTable(size_t chunk);
+    uint8_t* uuidForAttributeTable(const BleUuid& uuid);
+#endif
+    GenericGattCharacteristic* chunk(size_t index, size_t* numberOfAttributes) const;
+    size_t numberOfAttributes(void) const;
     GenericGattCharacteristic* getCharacteristicForHandle(uint16_t handle);
-    const uint8_t* permissionBitmaskToCharacteristicProperty(uint8_t permission);
+    GenericGattCharacteristic* getCharacteristicForClientConfigurationHandle(uint16_t handle);
+    uint8_t permissionBitmaskToCharacteristicProperty(uint8_t permission);
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    static int accessCallback(
+        uint16_t connectionHandle,
+        uint16_t attributeHandle,
+        struct ble_gatt_access_ctxt* context,
+        void* argument);
+    static int descriptionAccessCallback(
+        uint16_t connectionHandle,
+        uint16_t attributeHandle,
+        struct ble_gatt_access_ctxt* context,
+        void* argument);
+#endif
 
 private:
 
@@ -0,0 +1,286 @@
+#include <string.h>
+#include <esp_log.h>
+#include <stdexcept>
+#include "GattArena.hpp"
+#include "GattsService.hpp"
+#include "HandleIndex.hpp"
+#include "NotificationDispatcher.hpp"
+
+#define LOG_TAG "GattsService"
+
+namespace Esp32
+{
+
+static const ble_uuid16_t descriptionUuid = { { BLE_UUID_TYPE_16 }, ESP_GATT_UUID_CHAR_DESCRIPTION };
+
+const struct ble_gatt_svc_def* GattsService::serviceDefinition(void)
+{
+    if (m_serviceDefinition)
+    {
+        return m_serviceDefinition;
+    }
+
+    size_t numberOfCharacteristics = 0;
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        ++numberOfCharacteristics;
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+
+    // the host refers to the definition as long as it runs, so it is never released; arrays end by a zeroed entry
+    auto arena = GattArena::instance();
+    auto arenaMark = arena->mark();
+    try
+    {
+        auto serviceDefinition = (struct ble_gatt_svc_def*) arena->allocate(
+            2 * sizeof(struct ble_gatt_svc_def),
+            alignof(struct ble_gatt_svc_def));
+        auto characteristicDefinition = (struct ble_gatt_chr_def*) arena->allocate(
+            (numberOfCharacteristics + 1) * sizeof(struct ble_gatt_chr_def),
+            alignof(struct ble_gatt_chr_def));
+        auto valueHandles = (uint16_t*) arena->allocate(numberOfCharacteristics * sizeof(uint16_t), alignof(uint16_t));
+        memset(serviceDefinition, 0, 2 * sizeof(struct ble_gatt_svc_def));
+        memset(characteristicDefinition, 0, (numberOfCharacteristics + 1) * sizeof(struct ble_gatt_chr_def));
+
+        serviceDefinition->type = BLE_GATT_SVC_TYPE_PRIMARY;
+        serviceDefinition->uuid = uuidForServiceDefinition(m_serviceId);
+        serviceDefinition->characteristics = characteristicDefinition;
+
+        // NimBLE lays out a characteristic like the attribute tables for Bluedroid: declaration, value, client
+        // configuration (added by the host for notifying characteristics), description
+        int handleIndex = 1;  // service declaration
+        characteristicPointer = m_characteristics;
+        while (characteristicPointer)
+        {
+            characteristicDefinition->uuid = uuidForServiceDefinition(characteristicPointer->characteristicId());
+            characteristicDefinition->access_cb = accessCallback;
+            characteristicDefinition->arg = this;
+            characteristicDefinition->flags = characteristicFlags(characteristicPointer);
+            characteristicDefinition->val_handle = valueHandles++;
+
+            auto description = characteristicPointer->description();
+            if (description)
+            {
+                auto descriptorDefinition = (struct ble_gatt_dsc_def*) arena->allocate(
+                    2 * sizeof(struct ble_gatt_dsc_def),
+                    alignof(struct ble_gatt_dsc_def));
+                memset(descriptorDefinition, 0, 2 * sizeof(struct ble_gatt_dsc_def));
+                descriptorDefinition->uuid = &descriptionUuid.u;
+                descriptorDefinition->att_flags = BLE_ATT_F_READ;
+                descriptorDefinition->access_cb = descriptionAccessCallback;
+                descriptorDefinition->arg = (void*) description;
+                characteristicDefinition->descriptors = descriptorDefinition;
+            }
+
+            characteristicPointer->setHandleIndex(handleIndex + 1);
+            handleIndex += characteristicPointer->numberOfAttributes();
+
+            ++characteristicDefinition;
+            characteristicPointer = characteristicPointer->nextCharacteristic();
+        }
+
+        m_serviceDefinition = serviceDefinition;
+    }
+    catch(...)
+    {
+        arena->release(arenaMark);
+        throw;
+    }
+
+    return m_serviceDefinition;
+}
+
+void GattsService::pushHandles(void)
+{
+    if (!m_serviceDefinition)
+    {
+        throw std::runtime_error("service definition was not generated");
+    }
+
+    if (m_numberOfRegisteredChunks)
+    {
+        throw std::invalid_argument("handles were already supplied");
+    }
+
+    // the host assigns the handles of a service consecutively, thus any value handle gives the start handle
+    uint16_t startHandle = 0;
+    auto characteristicDefinition = m_serviceDefinition->characteristics;
+    auto characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        auto handle = *characteristicDefinition->val_handle;
+        if (!handle)
+        {
+            throw std::runtime_error("service was not registered by the host");
+        }
+        if (!startHandle)
+        {
+            startHandle = handle - characteristicPointer->handleIndex();
+        }
+        else if (handle != startHandle + characteristicPointer->handleIndex())
+        {
+            throw std::runtime_error("attribute handles are not consecutive");
+        }
+
+        ++characteristicDefinition;
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+    if (!startHandle && ble_gatts_find_svc(m_serviceDefinition->uuid, &startHandle) != 0)
+    {
+        throw std::runtime_error("service was not registered by the host");
+    }
+
+    m_chunkStartHandles[0] = startHandle;
+    m_chunkLengths[0] = numberOfAttributes();
+    m_numberOfRegisteredChunks = 1;
+
+    characteristicPointer = m_characteristics;
+    while (characteristicPointer)
+    {
+        characteristicPointer->setHandle(ESP_GATT_IF_NONE, startHandle + characteristicPointer->handleIndex());
+        HandleIndex::instance()->add(characteristicPointer->handle(), this, characteristicPointer);
+        if (characteristicPointer->notification() != GenericGattCharacteristic::Notification::NONE)
+        {
+            NotificationDispatcher::instance()->registerCharacteristic(characteristicPointer);
+        }
+
+        characteristicPointer = characteristicPointer->nextCharacteristic();
+    }
+}
+
+const ble_uuid_t* GattsService::uuidForServiceDefinition(const BleUuid& uuid)
+{
+    auto arena = GattArena::instance();
+
+    switch (uuid.width)
+    {
+        case BleUuid::Width::UUID_16:
+        {
+            auto nimbleUuid = (ble_uuid16_t*) arena->allocate(sizeof(ble_uuid16_t), alignof(ble_uuid16_t));
+            nimbleUuid->u.type = BLE_UUID_TYPE_16;
+            nimbleUuid->value = uuid.uuid;
+            return &nimbleUuid->u;
+        }
+        case BleUuid::Width::UUID_32:
+        {
+            auto nimbleUuid = (ble_uuid32_t*) arena->allocate(sizeof(ble_uuid32_t), alignof(ble_uuid32_t));
+            nimbleUuid->u.type = BLE_UUID_TYPE_32;
+            nimbleUuid->value = uuid.uuid;
+            return &nimbleUuid->u;
+        }
+        default:
+            break;
+    }
+
+    // both keep 128 bit UUIDs in little endian byte order
+    auto nimbleUuid = (ble_uuid128_t*) arena->allocate(sizeof(ble_uuid128_t), alignof(ble_uuid128_t));
+    nimbleUuid->u.type = BLE_UUID_TYPE_128;
+    uuid.copyTo(nimbleUuid->value);
+    return &nimbleUuid->u;
+}
+
+uint16_t GattsService::characteristicFlags(const GenericGattCharacteristic* characteristic)
+{
+    // the characteristic properties make up the lower byte of the flags, see BleHost.hpp
+    uint16_t flags = permissionBitmaskToCharacteristicProperty(characteristic->permission());
+    if (characteristic->writeWithoutResponse())
+    {
+        flags |= ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+    }
+    switch (characteristic->notification())
+    {
+        case GenericGattCharacteristic::Notification::NOTIFY:
+            flags |= ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+            break;
+        case GenericGattCharacteristic::Notification::INDICATE:
+            flags |= ESP_GATT_CHAR_PROP_BIT_INDICATE;
+            break;
+        default:
+            break;
+    }
+    return flags;
+}
+
+int GattsService::accessCallback(
+    uint16_t connectionHandle,
+    uint16_t attributeHandle,
+    struct ble_gatt_access_ctxt* context,
+    void* argument)
+{
+    // values may take up to 512 bytes, keep them off the stack of the host task running all access callbacks
+    static uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+
+    auto service = (GattsService*) argument;
+    if (connectionHandle >= GATT_CONNECTIONS_MAX)
+    {
+        ESP_LOGW(LOG_TAG, "Could not respond to request of connection %u", connectionHandle);
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    if (context->op == BLE_GATT_ACCESS_OP_READ_CHR)
+    {
+        // the host applies the offset of Read Blob requests itself, thus the value is always read as a whole
+        uint16_t length = 0;
+        try
+        {
+            service->readCharacteristic(connectionHandle, attributeHandle, 0, value, &length);
+        }
+        catch(const std::out_of_range& e)
+        {
+            ESP_LOGW(LOG_TAG, "Could not respond to read request: %s", e.what());
+            return BLE_ATT_ERR_INVALID_OFFSET;
+        }
+        catch(const std::exception& e)
+        {
+            ESP_LOGW(LOG_TAG, "Could not respond to read request: %s", e.what());
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+        return os_mbuf_append(context->om, value, length) ? BLE_ATT_ERR_INSUFFICIENT_RES : 0;
+    }
+
+    if (context->op == BLE_GATT_ACCESS_OP_WRITE_CHR)
+    {
+        // long writes are reassembled by the host, the value arrives complete
+        uint16_t length = 0;
+        if (ble_hs_mbuf_to_flat(context->om, value, sizeof(value), &length) != 0)
+        {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+
+        try
+        {
+            service->writeCharacteristic(connectionHandle, attributeHandle, value, length);
+        }
+        catch(const std::length_error& e)
+        {
+            ESP_LOGW(LOG_TAG, "Could not respond to write request: %s", e.what());
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        catch(const std::exception& e)
+        {
+            ESP_LOGW(LOG_TAG, "Could not respond to write request: %s", e.what());
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+        return 0;
+    }
+
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+int GattsService::descriptionAccessCallback(
+    uint16_t connectionHandle,
+    uint16_t attributeHandle,
+    struct ble_gatt_access_ctxt* context,
+    void* argument)
+{
+    if (context->op != BLE_GATT_ACCESS_OP_READ_DSC)
+    {
+        return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+
+    auto description = (const char*) argument;
+    return os_mbuf_append(context->om, description, strlen(description)) ? BLE_ATT_ERR_INSUFFICIENT_RES : 0;
+}
+
+} /* namespace Esp32 */
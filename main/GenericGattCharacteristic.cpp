@@ -1,5 +1,11 @@
+#include <string.h>
 #include <stdexcept>
+#include "ChangeJournal.hpp"
 #include "GenericGattCharacteristic.hpp"
+#include "NotificationDispatcher.hpp"
+
+#define CLIENT_CONFIGURATION_NOTIFY (0x0001)
+#define CLIENT_CONFIGURATION_INDICATE (0x0002)
 
 namespace Esp32
 {
@@ -13,7 +19,14 @@ GenericGattCharacteristic::GenericGattCharacteristic(
     m_length(length),
     m_permission(permission),
     m_description(description),
-    m_handleIndex(-1)
+    m_handleIndex(-1),
+    m_handle(0),
+    m_interface(ESP_GATT_IF_NONE),
+    m_notification(Notification::NONE),
+    m_writeWithoutResponse(false),
+    m_notificationSlot(-1),
+    m_subscribers(0),
+    m_nextCharacteristic(nullptr)
 {
 }
 
@@ -41,16 +54,146 @@ const char* GenericGattCharacteristic::description(void) const
     return m_description;
 }
 
+int GenericGattCharacteristic::numberOfAttributes(void) const
+{
+    return 2 +
+        (m_notification != Notification::NONE ? 1 : 0) +
+        (m_description ? 1 : 0);
+}
+
+void GenericGattCharacteristic::setNotification(Notification notification)
+{
+    if (m_handleIndex >= 0)
+    {
+        throw std::runtime_error("characteristic was already registered");
+    }
+    m_notification = notification;
+}
+
+GenericGattCharacteristic::Notification GenericGattCharacteristic::notification(void) const
+{
+    return m_notification;
+}
+
+void GenericGattCharacteristic::setWriteWithoutResponse(bool writeWithoutResponse)
+{
+    if (m_handleIndex >= 0)
+    {
+        throw std::runtime_error("characteristic was already registered");
+    }
+
+    if (writeWithoutResponse && !(m_permission & ESP_GATT_PERM_WRITE))
+    {
+        throw std::invalid_argument("characteristic is not writable");
+    }
+    m_writeWithoutResponse = writeWithoutResponse;
+}
+
+bool GenericGattCharacteristic::writeWithoutResponse(void) const
+{
+    return m_writeWithoutResponse;
+}
+
+void GenericGattCharacteristic::setClientConfiguration(uint16_t connectionId, uint16_t clientConfiguration)
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        throw std::out_of_range("connection ID out of range");
+    }
+
+    uint16_t mask = 0;
+    switch (m_notification)
+    {
+        case Notification::NOTIFY:
+            mask = CLIENT_CONFIGURATION_NOTIFY;
+            break;
+        case Notification::INDICATE:
+            mask = CLIENT_CONFIGURATION_INDICATE;
+            break;
+        default:
+            break;
+    }
+    if (clientConfiguration & ~mask)
+    {
+        throw std::invalid_argument("unsupported client configuration");
+    }
+
+    if (clientConfiguration)
+    {
+        m_subscribers.fetch_or(1u << connectionId);
+    }
+    else
+    {
+        m_subscribers.fetch_and(~(1u << connectionId));
+    }
+}
+
+uint16_t GenericGattCharacteristic::clientConfiguration(uint16_t connectionId) const
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX || !(m_subscribers.load() & (1u << connectionId)))
+    {
+        return 0;
+    }
+    return m_notification == Notification::INDICATE ? CLIENT_CONFIGURATION_INDICATE : CLIENT_CONFIGURATION_NOTIFY;
+}
+
+uint32_t GenericGattCharacteristic::subscribers(void) const
+{
+    return m_subscribers.load();
+}
+
+void GenericGattCharacteristic::notify(void)
+{
+    if (m_notification == Notification::NONE)
+    {
+        throw std::runtime_error("characteristic does not support notifications");
+    }
+    NotificationDispatcher::instance()->requestNotification(this);
+}
+
+void GenericGattCharacteristic::notifyFromIsr(void)
+{
+    NotificationDispatcher::instance()->requestNotificationFromIsr(this);
+}
+
 void GenericGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
 {
     throw std::runtime_error("reading from characteristic not supported");
 }
 
+void GenericGattCharacteristic::readAt(uint16_t connectionId, uint16_t offset, uint8_t* buffer, uint16_t* length)
+{
+    read(buffer, length);
+
+    // Read Blob requests continue a long value, the stack expects the remainder starting at the offset
+    if (offset > *length)
+    {
+        throw std::out_of_range("read offset beyond the value");
+    }
+    memmove(buffer, buffer + offset, *length - offset);
+    *length -= offset;
+}
+
 void GenericGattCharacteristic::write(const uint8_t* buffer, uint16_t length)
 {
     throw std::runtime_error("writing to characteristic not supported");
 }
 
+void GenericGattCharacteristic::writeAt(uint16_t connectionId, uint16_t offset, const uint8_t* buffer, uint16_t length)
+{
+    // only characteristics which can update a part of their value support prepared writes at an offset
+    if (offset)
+    {
+        throw std::out_of_range("write offset not supported");
+    }
+    write(buffer, length);
+}
+
+size_t GenericGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
 void GenericGattCharacteristic::setHandleIndex(int handleIndex)
 {
     m_handleIndex = handleIndex;
@@ -61,4 +204,51 @@ int GenericGattCharacteristic::handleIndex(void) const
     return m_handleIndex;
 }
 
+void GenericGattCharacteristic::setHandle(esp_gatt_if_t gatts_if, uint16_t handle)
+{
+    m_interface = gatts_if;
+    m_handle = handle;
+}
+
+uint16_t GenericGattCharacteristic::handle(void) const
+{
+    return m_handle;
+}
+
+esp_gatt_if_t GenericGattCharacteristic::interface(void) const
+{
+    return m_interface;
+}
+
+void GenericGattCharacteristic::setNotificationSlot(int notificationSlot)
+{
+    m_notificationSlot = notificationSlot;
+}
+
+int GenericGattCharacteristic::notificationSlot(void) const
+{
+    return m_notificationSlot;
+}
+
+void GenericGattCharacteristic::setNextCharacteristic(GenericGattCharacteristic* characteristic)
+{
+    m_nextCharacteristic = characteristic;
+}
+
+GenericGattCharacteristic* GenericGattCharacteristic::nextCharacteristic(void) const
+{
+    return m_nextCharacteristic;
+}
+
+void GenericGattCharacteristic::journalChange(const uint8_t* value, uint16_t length)
+{
+#ifdef CONFIG_BLE_CHANGE_JOURNAL
+    // values are only journaled once they are reachable by a handle
+    if (m_handle)
+    {
+        ChangeJournal::instance()->record(m_handle, value, length);
+    }
+#endif
+}
+
 } /* namespace Esp32 */
@@ -1,15 +1,25 @@
 #ifndef MAIN_GENERICGATTCHARACTERISTIC_HPP_
 #define MAIN_GENERICGATTCHARACTERISTIC_HPP_
 
-#include <esp_gatts_api.h>
+#include <atomic>
+#include "BleHost.hpp"
 #include "BleUuid.hpp"
 
+#define GATT_CONNECTIONS_MAX (32)
+
 namespace Esp32
 {
 
 class GenericGattCharacteristic
 {
 public:
+    enum class Notification: uint8_t
+    {
+        NONE,
+        NOTIFY,
+        INDICATE,
+    };
+
     GenericGattCharacteristic(
         const BleUuid& characteristicId,
         uint16_t length,
@@ -21,12 +31,34 @@ public:
     uint16_t length(void) const;
     uint16_t permission(void) const;
     const char* description(void) const;
+    int numberOfAttributes(void) const;
+
+    void setNotification(Notification notification);
+    Notification notification(void) const;
+    void setWriteWithoutResponse(bool writeWithoutResponse);
+    bool writeWithoutResponse(void) const;
+    virtual void setClientConfiguration(uint16_t connectionId, uint16_t clientConfiguration);
+    uint16_t clientConfiguration(uint16_t connectionId) const;
+    uint32_t subscribers(void) const;
+    void notify(void);
+    void notifyFromIsr(void);
 
     virtual void read(uint8_t* buffer, uint16_t* length);
+    virtual void readAt(uint16_t connectionId, uint16_t offset, uint8_t* buffer, uint16_t* length);
     virtual void write(const uint8_t* buffer, uint16_t length);
+    virtual void writeAt(uint16_t connectionId, uint16_t offset, const uint8_t* buffer, uint16_t length);
+    virtual size_t objectSize(void) const;
 
     void setHandleIndex(int handleIndex);
     int handleIndex(void) const;
+    void setHandle(esp_gatt_if_t gatts_if, uint16_t handle);
+    uint16_t handle(void) const;
+    esp_gatt_if_t interface(void) const;
+    void setNotificationSlot(int notificationSlot);
+    int notificationSlot(void) const;
+
+    void setNextCharacteristic(GenericGattCharacteristic* characteristic);
+    GenericGattCharacteristic* nextCharacteristic(void) const;
 
 protected:
 
@@ -36,6 +68,16 @@ protected:
     const char* m_description;
 
     int m_handleIndex;
+    uint16_t m_handle;
+    esp_gatt_if_t m_interface;
+    Notification m_notification;
+    bool m_writeWithoutResponse;
+    int8_t m_notificationSlot;
+    std::atomic<uint32_t> m_subscribers;
+
+    GenericGattCharacteristic* m_nextCharacteristic;
+
+    void journalChange(const uint8_t* value, uint16_t length);
 
 private:
 
@@ -0,0 +1,126 @@
+#include <string.h>
+#include <stdexcept>
+#include "HandleIndex.hpp"
+
+namespace Esp32
+{
+
+static HandleIndex handleIndex;
+
+HandleIndex::HandleIndex():
+    m_entries(),
+    m_size(0)
+{
+}
+
+HandleIndex::~HandleIndex()
+{
+}
+
+void HandleIndex::add(uint16_t handle, GattsService* service, GenericGattCharacteristic* characteristic)
+{
+    if (!service || !characteristic)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (m_size >= HANDLE_INDEX_SIZE)
+    {
+        throw std::runtime_error("handle index full, increase CONFIG_BLE_HANDLE_INDEX_SIZE");
+    }
+
+    auto position = lowerBound(handle);
+    if (position < m_size && m_entries[position].handle == handle)
+    {
+        throw std::invalid_argument("handle was already indexed");
+    }
+
+    memmove(m_entries + position + 1, m_entries + position, (m_size - position) * sizeof(Entry));
+    m_entries[position] = {characteristic, service, handle};
+    ++m_size;
+}
+
+void HandleIndex::remove(GattsService* service)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < m_size; ++i)
+    {
+        if (m_entries[i].service != service)
+        {
+            m_entries[kept++] = m_entries[i];
+        }
+    }
+    m_size = kept;
+}
+
+const HandleIndex::Entry* HandleIndex::find(uint16_t handle, bool* clientConfiguration) const
+{
+    if (clientConfiguration)
+    {
+        *clientConfiguration = false;
+    }
+
+    auto position = lowerBound(handle);
+    if (position < m_size && m_entries[position].handle == handle)
+    {
+        return m_entries + position;
+    }
+
+    // the client configuration descriptor follows the value attribute
+    if (position > 0)
+    {
+        auto& entry = m_entries[position - 1];
+        if (entry.handle + 1 == handle &&
+            entry.characteristic->notification() != GenericGattCharacteristic::Notification::NONE)
+        {
+            if (clientConfiguration)
+            {
+                *clientConfiguration = true;
+            }
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+size_t HandleIndex::size(void) const
+{
+    return m_size;
+}
+
+size_t HandleIndex::capacity(void) const
+{
+    return HANDLE_INDEX_SIZE;
+}
+
+HandleIndex* HandleIndex::instance(void)
+{
+    return &handleIndex;
+}
+
+size_t HandleIndex::lowerBound(uint16_t handle) const
+{
+    // first entry not below the handle, new handles are usually larger than all indexed ones
+    if (!m_size || m_entries[m_size - 1].handle < handle)
+    {
+        return m_size;
+    }
+
+    size_t low = 0;
+    size_t high = m_size;
+    while (low < high)
+    {
+        auto middle = low + (high - low) / 2;
+        if (m_entries[middle].handle < handle)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,63 @@
+#ifndef MAIN_HANDLEINDEX_HPP_
+#define MAIN_HANDLEINDEX_HPP_
+
+#include <sdkconfig.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "GattsService.hpp"
+#include "GenericGattCharacteristic.hpp"
+
+#ifdef CONFIG_BLE_HANDLE_INDEX_SIZE
+#define HANDLE_INDEX_SIZE (CONFIG_BLE_HANDLE_INDEX_SIZE)
+#else
+#define HANDLE_INDEX_SIZE (128)
+#endif
+
+namespace Esp32
+{
+
+/*
+ * Lookup of the characteristic and service behind an attribute handle for dispatching read and write requests. The
+ * value handles of all registered characteristics are kept in an array sorted by handle and found by binary search,
+ * so the cost of a request grows with the logarithm of the database size instead of walking all services and
+ * characteristics. A client configuration descriptor directly follows the value attribute of its characteristic.
+ *
+ * Handles are assigned in increasing order while services are registered, adding them is an append in the common
+ * case. The index is only accessed by the Bluetooth task.
+ */
+class HandleIndex
+{
+public:
+    struct Entry
+    {
+        GenericGattCharacteristic* characteristic;
+        GattsService* service;
+        uint16_t handle;
+    };
+
+    HandleIndex();
+    virtual ~HandleIndex();
+
+    void add(uint16_t handle, GattsService* service, GenericGattCharacteristic* characteristic);
+    void remove(GattsService* service);
+    const Entry* find(uint16_t handle, bool* clientConfiguration = nullptr) const;
+
+    size_t size(void) const;
+    size_t capacity(void) const;
+
+    static HandleIndex* instance(void);
+
+protected:
+
+    Entry m_entries[HANDLE_INDEX_SIZE];
+    size_t m_size;
+
+    size_t lowerBound(uint16_t handle) const;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_HANDLEINDEX_HPP_ */
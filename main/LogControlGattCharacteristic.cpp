@@ -0,0 +1,65 @@
+#include <string.h>
+#include <stdexcept>
+#include "LogControlGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+LogControlGattCharacteristic::LogControlGattCharacteristic(
+    const BleUuid& characteristicId,
+    const LogRingBuffer& ringBuffer,
+    esp_log_level_t level):
+    GenericGattCharacteristic(
+        characteristicId,
+        sizeof(uint8_t) + sizeof(uint32_t),
+        ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        "Log level"),
+    m_ringBuffer(ringBuffer),
+    m_level(level)
+{
+}
+
+LogControlGattCharacteristic::~LogControlGattCharacteristic()
+{
+}
+
+void LogControlGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    auto droppedLines = m_ringBuffer.droppedLines();
+
+    buffer[0] = m_level.load();
+    memcpy(buffer + 1, &droppedLines, sizeof(droppedLines));
+    *length = m_length;
+}
+
+void LogControlGattCharacteristic::write(const uint8_t* buffer, uint16_t length)
+{
+    if (length != sizeof(uint8_t))
+    {
+        throw std::invalid_argument("invalid length");
+    }
+
+    if (buffer[0] > ESP_LOG_VERBOSE)
+    {
+        throw std::invalid_argument("invalid log level");
+    }
+
+    m_level.store(buffer[0]);
+}
+
+size_t LogControlGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
+esp_log_level_t LogControlGattCharacteristic::level(void) const
+{
+    return (esp_log_level_t) m_level.load(std::memory_order_relaxed);
+}
+
+void LogControlGattCharacteristic::setLevel(esp_log_level_t level)
+{
+    m_level.store(level);
+}
+
+} /* namespace Esp32 */
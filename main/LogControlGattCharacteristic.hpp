@@ -0,0 +1,44 @@
+#ifndef MAIN_LOGCONTROLGATTCHARACTERISTIC_HPP_
+#define MAIN_LOGCONTROLGATTCHARACTERISTIC_HPP_
+
+#include <esp_log.h>
+#include <atomic>
+#include "GenericGattCharacteristic.hpp"
+#include "LogRingBuffer.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Control characteristic of the log stream service. Writing a single byte sets the maximum streamed log level
+ * (esp_log_level_t, 0 = none ... 5 = verbose). Reading returns the level followed by the number of lines which were
+ * dropped because the ring buffer was full (uint32_t, little endian).
+ */
+class LogControlGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    LogControlGattCharacteristic(
+        const BleUuid& characteristicId,
+        const LogRingBuffer& ringBuffer,
+        esp_log_level_t level = ESP_LOG_WARN);
+    virtual ~LogControlGattCharacteristic();
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    void write(const uint8_t* buffer, uint16_t length) override;
+    size_t objectSize(void) const override;
+
+    esp_log_level_t level(void) const;
+    void setLevel(esp_log_level_t level);
+
+protected:
+
+    const LogRingBuffer& m_ringBuffer;
+    std::atomic<uint8_t> m_level;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_LOGCONTROLGATTCHARACTERISTIC_HPP_ */
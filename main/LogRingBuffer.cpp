@@ -0,0 +1,143 @@
+#include <string.h>
+#include <stdexcept>
+#include "LogRingBuffer.hpp"
+
+#define LOG_RECORD_READY (0x80000000u)
+#define LOG_RECORD_LENGTH_MASK (0x0000ffffu)
+
+namespace Esp32
+{
+
+static inline uint32_t recordSize(uint32_t length)
+{
+    // header word plus the line padded to whole words, so headers never wrap around the end of the storage
+    return sizeof(uint32_t) + ((length + 3) & ~3u);
+}
+
+LogRingBuffer::LogRingBuffer(uint32_t* storage, size_t size):
+    m_storage(storage),
+    m_size(size),
+    m_reservePosition(0),
+    m_readPosition(0),
+    m_recordOffset(0),
+    m_droppedLines(0),
+    m_droppedBytes(0)
+{
+    if (!storage)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (size < 2 * sizeof(uint32_t) || (size & (size - 1)))
+    {
+        throw std::invalid_argument("ring buffer size is not a power of two");
+    }
+
+    memset(m_storage, 0, size);
+}
+
+LogRingBuffer::~LogRingBuffer()
+{
+}
+
+bool LogRingBuffer::push(const char* line, uint16_t length)
+{
+    auto size = recordSize(length);
+    auto position = m_reservePosition.load(std::memory_order_relaxed);
+    do
+    {
+        if (position + size - m_readPosition.load(std::memory_order_acquire) > m_size)
+        {
+            m_droppedLines.fetch_add(1, std::memory_order_relaxed);
+            m_droppedBytes.fetch_add(length, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    while (!m_reservePosition.compare_exchange_weak(position, position + size, std::memory_order_relaxed));
+
+    copyIn(position + sizeof(uint32_t), line, length);
+    __atomic_store_n(
+        &m_storage[(position & (m_size - 1)) / sizeof(uint32_t)],
+        LOG_RECORD_READY | length,
+        __ATOMIC_RELEASE);
+    return true;
+}
+
+uint16_t LogRingBuffer::pop(uint8_t* buffer, uint16_t length)
+{
+    uint16_t copied = 0;
+    while (copied < length)
+    {
+        auto position = m_readPosition.load(std::memory_order_relaxed);
+        auto headerIndex = (position & (m_size - 1)) / sizeof(uint32_t);
+        auto header = __atomic_load_n(&m_storage[headerIndex], __ATOMIC_ACQUIRE);
+        if (!(header & LOG_RECORD_READY))
+        {
+            // empty, or the producer of the next record has not finished copying yet
+            break;
+        }
+
+        uint16_t recordLength = header & LOG_RECORD_LENGTH_MASK;
+        uint16_t chunk = recordLength - m_recordOffset;
+        if (chunk > length - copied)
+        {
+            chunk = length - copied;
+        }
+        copyOut(position + sizeof(uint32_t) + m_recordOffset, buffer + copied, chunk);
+        copied += chunk;
+        m_recordOffset += chunk;
+
+        if (m_recordOffset == recordLength)
+        {
+            // every word may become a header later on, thus the whole record is wiped before it is handed back
+            auto words = recordSize(recordLength) / sizeof(uint32_t);
+            for (uint32_t i = 0; i < words; ++i)
+            {
+                __atomic_store_n(&m_storage[(headerIndex + i) & (m_size / sizeof(uint32_t) - 1)], 0, __ATOMIC_RELAXED);
+            }
+            m_recordOffset = 0;
+            m_readPosition.store(position + recordSize(recordLength), std::memory_order_release);
+        }
+    }
+    return copied;
+}
+
+void LogRingBuffer::clear(void)
+{
+    uint8_t discard[32];
+    while (pop(discard, sizeof(discard)))
+    {
+    }
+}
+
+uint32_t LogRingBuffer::droppedLines(void) const
+{
+    return m_droppedLines.load(std::memory_order_relaxed);
+}
+
+uint32_t LogRingBuffer::droppedBytes(void) const
+{
+    return m_droppedBytes.load(std::memory_order_relaxed);
+}
+
+void LogRingBuffer::copyIn(uint32_t position, const char* line, uint16_t length)
+{
+    auto bytes = (uint8_t*) m_storage;
+    auto offset = position & (m_size - 1);
+    auto firstPart = m_size - offset < length ? m_size - offset : length;
+
+    memcpy(bytes + offset, line, firstPart);
+    memcpy(bytes, line + firstPart, length - firstPart);
+}
+
+void LogRingBuffer::copyOut(uint32_t position, uint8_t* buffer, uint16_t length) const
+{
+    auto bytes = (const uint8_t*) m_storage;
+    auto offset = position & (m_size - 1);
+    auto firstPart = m_size - offset < length ? m_size - offset : length;
+
+    memcpy(buffer, bytes + offset, firstPart);
+    memcpy(buffer + firstPart, bytes, length - firstPart);
+}
+
+} /* namespace Esp32 */
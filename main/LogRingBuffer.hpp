@@ -0,0 +1,51 @@
+#ifndef MAIN_LOGRINGBUFFER_HPP_
+#define MAIN_LOGRINGBUFFER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace Esp32
+{
+
+/*
+ * Lock-free ring buffer for log lines with multiple producers and a single consumer. Producers reserve a record with a
+ * compare-and-swap on the write position, copy the line and publish the record by setting the ready flag in its header
+ * word. They never wait: if there is not enough space the line is dropped and counted. The consumer reads the records
+ * as a byte stream, a record may be split over several pop() calls.
+ *
+ * The storage size has to be a power of two and a multiple of four bytes.
+ */
+class LogRingBuffer
+{
+public:
+    LogRingBuffer(uint32_t* storage, size_t size);
+    virtual ~LogRingBuffer();
+
+    bool push(const char* line, uint16_t length);
+    uint16_t pop(uint8_t* buffer, uint16_t length);
+    void clear(void);
+
+    uint32_t droppedLines(void) const;
+    uint32_t droppedBytes(void) const;
+
+protected:
+
+    uint32_t* m_storage;
+    uint32_t m_size;
+    std::atomic<uint32_t> m_reservePosition;
+    std::atomic<uint32_t> m_readPosition;
+    uint16_t m_recordOffset;
+    std::atomic<uint32_t> m_droppedLines;
+    std::atomic<uint32_t> m_droppedBytes;
+
+    void copyIn(uint32_t position, const char* line, uint16_t length);
+    void copyOut(uint32_t position, uint8_t* buffer, uint16_t length) const;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_LOGRINGBUFFER_HPP_ */
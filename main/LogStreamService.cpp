@@ -0,0 +1,253 @@
+#include <esp_log.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+#include "LogStreamService.hpp"
+
+#define LOG_TAG "LogStreamService"
+
+#ifdef CONFIG_BLE_LOG_STREAM_PRIORITY
+#define LOG_STREAM_PRIORITY (CONFIG_BLE_LOG_STREAM_PRIORITY)
+#else
+#define LOG_STREAM_PRIORITY (2)
+#endif
+
+#ifdef CONFIG_BLE_LOG_STREAM_STACK_SIZE
+#define LOG_STREAM_STACK_SIZE (CONFIG_BLE_LOG_STREAM_STACK_SIZE)
+#else
+#define LOG_STREAM_STACK_SIZE (3072)
+#endif
+
+namespace Esp32
+{
+
+static uint32_t logStreamStorage[LOG_STREAM_BUFFER_SIZE / sizeof(uint32_t)];
+static std::atomic<LogStreamService*> activeLogStreamService(nullptr);
+static vprintf_like_t previousVprintf = nullptr;
+
+LogStreamService::LogStreamService(
+    const BleServiceUuid& serviceId,
+    const BleUuid& dataCharacteristicId,
+    const BleUuid& controlCharacteristicId,
+    esp_log_level_t level):
+    GattsService(serviceId),
+    m_ringBuffer(logStreamStorage, sizeof(logStreamStorage)),
+    m_dataCharacteristic(dataCharacteristicId, NOTIFICATION_VALUE_LENGTH_MAX, 0, "Log"),
+    m_controlCharacteristic(controlCharacteristicId, m_ringBuffer, level),
+    m_task(nullptr),
+    m_failedNotifications(0),
+    m_suppressedLines(0)
+{
+    m_dataCharacteristic.setNotification(GenericGattCharacteristic::Notification::NOTIFY);
+    addCharacteristic(&m_dataCharacteristic);
+    addCharacteristic(&m_controlCharacteristic);
+}
+
+LogStreamService::~LogStreamService()
+{
+}
+
+void LogStreamService::start(void)
+{
+    ESP_LOGD(LOG_TAG, "LogStreamService::start()");
+
+    if (m_task)
+    {
+        return;
+    }
+
+    LogStreamService* expected = nullptr;
+    if (!activeLogStreamService.compare_exchange_strong(expected, this))
+    {
+        throw std::runtime_error("another log stream service is already started");
+    }
+
+    if (xTaskCreate(task, "ble_log", LOG_STREAM_STACK_SIZE, this, LOG_STREAM_PRIORITY, &m_task) != pdPASS)
+    {
+        activeLogStreamService.store(nullptr);
+        throw std::runtime_error("error creating the log stream task");
+    }
+
+    previousVprintf = esp_log_set_vprintf(vprintfHook);
+}
+
+const LogRingBuffer& LogStreamService::ringBuffer(void) const
+{
+    return m_ringBuffer;
+}
+
+uint32_t LogStreamService::failedNotifications(void) const
+{
+    return m_failedNotifications;
+}
+
+uint32_t LogStreamService::suppressedLines(void) const
+{
+    return m_suppressedLines.load(std::memory_order_relaxed);
+}
+
+void LogStreamService::capture(const char* format, va_list arguments)
+{
+    // lines of the drain task itself would feed the stream they are sent with
+    if (!xPortInIsrContext() && xTaskGetCurrentTaskHandle() == m_task)
+    {
+        return;
+    }
+
+    char line[LOG_STREAM_LINE_LENGTH_MAX];
+    auto length = vsnprintf(line, sizeof(line), format, arguments);
+    if (length <= 0)
+    {
+        return;
+    }
+    if (length >= (int) sizeof(line))
+    {
+        length = sizeof(line) - 1;
+    }
+
+    if (levelOfLine(line) > m_controlCharacteristic.level())
+    {
+        return;
+    }
+
+    // the stack logs from its own tasks about the notifications of the drain task
+    if (isBluetoothStackLine(line))
+    {
+        m_suppressedLines.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (!m_ringBuffer.push(line, length))
+    {
+        return;
+    }
+
+    if (xPortInIsrContext())
+    {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(m_task, &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+    else
+    {
+        xTaskNotifyGive(m_task);
+    }
+}
+
+void LogStreamService::run(void)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // give related lines the chance to end up in the same notification
+        vTaskDelay(pdMS_TO_TICKS(LOG_STREAM_BATCH_DELAY_MS));
+        drain();
+    }
+}
+
+void LogStreamService::drain(void)
+{
+    for (;;)
+    {
+        auto subscribers = m_dataCharacteristic.subscribers();
+        if (!subscribers)
+        {
+            m_ringBuffer.clear();
+            return;
+        }
+
+        auto length = m_ringBuffer.pop(m_buffer, NotificationDispatcher::instance()->payloadLength(subscribers));
+        if (!length)
+        {
+            return;
+        }
+
+        while (subscribers)
+        {
+            uint16_t connectionId = __builtin_ctz(subscribers);
+            subscribers &= subscribers - 1;
+
+            if (!NotificationDispatcher::sendValue(&m_dataCharacteristic, connectionId, m_buffer, length, false))
+            {
+                ++m_failedNotifications;
+            }
+        }
+    }
+}
+
+int LogStreamService::vprintfHook(const char* format, va_list arguments)
+{
+    auto service = activeLogStreamService.load(std::memory_order_acquire);
+    if (service)
+    {
+        va_list copy;
+        va_copy(copy, arguments);
+        service->capture(format, copy);
+        va_end(copy);
+    }
+
+    return previousVprintf ? previousVprintf(format, arguments) : vprintf(format, arguments);
+}
+
+const char* LogStreamService::skipColor(const char* line)
+{
+    // skip the color sequence of CONFIG_LOG_COLORS, i.e. "\033[0;31m"
+    if (line[0] == '\033')
+    {
+        while (*line && *line != 'm')
+        {
+            ++line;
+        }
+        if (*line)
+        {
+            ++line;
+        }
+    }
+    return line;
+}
+
+esp_log_level_t LogStreamService::levelOfLine(const char* line)
+{
+    switch (*skipColor(line))
+    {
+        case 'E':
+            return ESP_LOG_ERROR;
+        case 'W':
+            return ESP_LOG_WARN;
+        case 'I':
+            return ESP_LOG_INFO;
+        case 'D':
+            return ESP_LOG_DEBUG;
+        case 'V':
+            return ESP_LOG_VERBOSE;
+        default:
+            // continuation of a line or plain output, streamed unless streaming is switched off
+            return ESP_LOG_ERROR;
+    }
+}
+
+bool LogStreamService::isBluetoothStackLine(const char* line)
+{
+    // "W (1234) BT_GATT: ..." or with CONFIG_LOG_TIMESTAMP_SOURCE_SYSTEM "W (12:34:56.789) BT_GATT: ..."
+    line = skipColor(line);
+    if (!*line || line[1] != ' ' || line[2] != '(')
+    {
+        return false;
+    }
+    line = strchr(line, ')');
+    if (!line || line[1] != ' ')
+    {
+        return false;
+    }
+    line += 2;
+
+    return !strncmp(line, "BT_", 3) || !strncmp(line, "NimBLE:", 7);
+}
+
+void LogStreamService::task(void* parameter)
+{
+    ((LogStreamService*) parameter)->run();
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,83 @@
+#ifndef MAIN_LOGSTREAMSERVICE_HPP_
+#define MAIN_LOGSTREAMSERVICE_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+#include <stdarg.h>
+#include <atomic>
+#include "GattsService.hpp"
+#include "LogControlGattCharacteristic.hpp"
+#include "LogRingBuffer.hpp"
+#include "NotificationDispatcher.hpp"
+
+#ifdef CONFIG_BLE_LOG_STREAM_BUFFER_SIZE
+#define LOG_STREAM_BUFFER_SIZE (CONFIG_BLE_LOG_STREAM_BUFFER_SIZE)
+#else
+#define LOG_STREAM_BUFFER_SIZE (2048)
+#endif
+
+#define LOG_STREAM_LINE_LENGTH_MAX (128)
+#define LOG_STREAM_BATCH_DELAY_MS (20)
+
+namespace Esp32
+{
+
+/*
+ * Optional service streaming the ESP_LOGx output to subscribed clients. start() installs an esp_log_set_vprintf()
+ * hook which formats each line on the stack of the logging task and pushes it into a lock-free ring buffer, then
+ * forwards it to the previous vprintf function (usually the UART). The hook never blocks and never calls into the
+ * Bluetooth stack, so logging from the BT task is safe. A low priority task drains the buffer as a byte stream packed
+ * into notifications of the smallest MTU of all subscribers. Lines logged by the drain task itself are not streamed
+ * to avoid a feedback loop, lines logged while nobody is subscribed are discarded. Neither are the lines of the
+ * Bluetooth stack (tags "BT_..." of Bluedroid and "NimBLE"): Bluedroid logs from its BTC task while it processes the
+ * notifications of the drain task, streaming those lines would feed the stream with itself. They are counted as
+ * suppressed and still reach the previous vprintf function.
+ *
+ * The data characteristic only notifies, the control characteristic (see LogControlGattCharacteristic) sets the level
+ * filter and reports overruns. Only one log stream service can be started, it keeps running until the next reset.
+ */
+class LogStreamService: public GattsService
+{
+public:
+    LogStreamService(
+        const BleServiceUuid& serviceId,
+        const BleUuid& dataCharacteristicId,
+        const BleUuid& controlCharacteristicId,
+        esp_log_level_t level = ESP_LOG_WARN);
+    virtual ~LogStreamService();
+
+    void start(void);
+
+    const LogRingBuffer& ringBuffer(void) const;
+    uint32_t failedNotifications(void) const;
+    uint32_t suppressedLines(void) const;
+
+protected:
+
+    LogRingBuffer m_ringBuffer;
+    GenericGattCharacteristic m_dataCharacteristic;
+    LogControlGattCharacteristic m_controlCharacteristic;
+
+    TaskHandle_t m_task;
+    uint8_t m_buffer[NOTIFICATION_VALUE_LENGTH_MAX];
+    uint32_t m_failedNotifications;
+    std::atomic<uint32_t> m_suppressedLines;
+
+    void capture(const char* format, va_list arguments);
+    void run(void);
+    void drain(void);
+
+    static int vprintfHook(const char* format, va_list arguments);
+    static const char* skipColor(const char* line);
+    static esp_log_level_t levelOfLine(const char* line);
+    static bool isBluetoothStackLine(const char* line);
+    static void task(void* parameter);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_LOGSTREAMSERVICE_HPP_ */
@@ -0,0 +1,311 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <stdexcept>
+#include "NotificationDispatcher.hpp"
+
+#define LOG_TAG "NotificationDispatcher"
+
+#ifdef CONFIG_BLE_NOTIFICATION_DISPATCHER_PRIORITY
+#define NOTIFICATION_DISPATCHER_PRIORITY (CONFIG_BLE_NOTIFICATION_DISPATCHER_PRIORITY)
+#else
+#define NOTIFICATION_DISPATCHER_PRIORITY (18)
+#endif
+
+#ifdef CONFIG_BLE_NOTIFICATION_DISPATCHER_STACK_SIZE
+#define NOTIFICATION_DISPATCHER_STACK_SIZE (CONFIG_BLE_NOTIFICATION_DISPATCHER_STACK_SIZE)
+#else
+#define NOTIFICATION_DISPATCHER_STACK_SIZE (3072)
+#endif
+
+namespace Esp32
+{
+
+static NotificationDispatcher notificationDispatcher;
+
+NotificationDispatcher::LatencyStatistics::LatencyStatistics():
+    samples(0),
+    minimum(UINT32_MAX),
+    maximum(0),
+    sum(0)
+{
+}
+
+void NotificationDispatcher::LatencyStatistics::add(uint32_t latency)
+{
+    ++samples;
+    sum += latency;
+    if (latency < minimum)
+    {
+        minimum = latency;
+    }
+    if (latency > maximum)
+    {
+        maximum = latency;
+    }
+}
+
+NotificationDispatcher::NotificationDispatcher():
+    m_task(nullptr),
+    m_numberOfCharacteristics(0),
+    m_pending(0),
+    m_failedNotifications(0),
+    m_truncatedNotifications(0)
+{
+    memset(m_characteristics, 0, sizeof(m_characteristics));
+    for (auto& requestTimestamp: m_requestTimestamps)
+    {
+        requestTimestamp.store(0);
+    }
+    for (auto& mtu: m_mtu)
+    {
+        mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+    }
+}
+
+NotificationDispatcher::~NotificationDispatcher()
+{
+}
+
+void NotificationDispatcher::probe(void)
+{
+    ESP_LOGD(LOG_TAG, "NotificationDispatcher::probe()");
+
+    if (m_task)
+    {
+        return;
+    }
+
+    if (xTaskCreate(
+            task,
+            "ble_notify",
+            NOTIFICATION_DISPATCHER_STACK_SIZE,
+            this,
+            NOTIFICATION_DISPATCHER_PRIORITY,
+            &m_task) != pdPASS)
+    {
+        throw std::runtime_error("error creating the notification dispatcher task");
+    }
+}
+
+void NotificationDispatcher::registerCharacteristic(GenericGattCharacteristic* characteristic)
+{
+    if (!characteristic)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (characteristic->notificationSlot() >= 0)
+    {
+        return;
+    }
+
+    if (characteristic->length() > sizeof(m_buffer))
+    {
+        throw std::invalid_argument("characteristic too long for notifications");
+    }
+
+    if (m_numberOfCharacteristics >= NOTIFICATION_CHARACTERISTICS_MAX)
+    {
+        throw std::runtime_error("too many notifying characteristics");
+    }
+
+    m_characteristics[m_numberOfCharacteristics] = characteristic;
+    characteristic->setNotificationSlot(m_numberOfCharacteristics);
+    ++m_numberOfCharacteristics;
+}
+
+void NotificationDispatcher::requestNotification(GenericGattCharacteristic* characteristic)
+{
+    auto slot = characteristic->notificationSlot();
+    if (slot < 0 || !m_task)
+    {
+        return;
+    }
+
+    m_requestTimestamps[slot].store((uint32_t) esp_timer_get_time(), std::memory_order_relaxed);
+    m_pending.fetch_or(1u << slot, std::memory_order_release);
+    xTaskNotifyGive(m_task);
+}
+
+void NotificationDispatcher::requestNotificationFromIsr(GenericGattCharacteristic* characteristic)
+{
+    auto slot = characteristic->notificationSlot();
+    if (slot < 0 || !m_task)
+    {
+        return;
+    }
+
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    m_requestTimestamps[slot].store((uint32_t) esp_timer_get_time(), std::memory_order_relaxed);
+    m_pending.fetch_or(1u << slot, std::memory_order_release);
+    vTaskNotifyGiveFromISR(m_task, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void NotificationDispatcher::setMtu(uint16_t connectionId, uint16_t mtu)
+{
+    if (connectionId < GATT_CONNECTIONS_MAX)
+    {
+        m_mtu[connectionId] = mtu;
+    }
+}
+
+uint16_t NotificationDispatcher::payloadLength(uint32_t subscribers) const
+{
+    // the same value is sent to all subscribers, thus it has to fit into the smallest MTU
+    uint16_t mtu = BLE_GATT_LOCAL_MTU;
+    while (subscribers)
+    {
+        auto connectionId = __builtin_ctz(subscribers);
+        subscribers &= subscribers - 1;
+
+        if (m_mtu[connectionId] < mtu)
+        {
+            mtu = m_mtu[connectionId];
+        }
+    }
+    return mtu - 3;
+}
+
+const NotificationDispatcher::LatencyStatistics& NotificationDispatcher::latencyStatistics(void) const
+{
+    return m_latencyStatistics;
+}
+
+uint32_t NotificationDispatcher::failedNotifications(void) const
+{
+    return m_failedNotifications;
+}
+
+uint32_t NotificationDispatcher::truncatedNotifications(void) const
+{
+    return m_truncatedNotifications.load();
+}
+
+void NotificationDispatcher::dumpStatistics(void) const
+{
+    ESP_LOGI(
+        LOG_TAG,
+        "request to send latency: %u samples, min=%uus, avg=%uus, max=%uus, %u failed, %u truncated",
+        (unsigned) m_latencyStatistics.samples,
+        (unsigned) (m_latencyStatistics.samples ? m_latencyStatistics.minimum : 0),
+        (unsigned) (m_latencyStatistics.samples ? m_latencyStatistics.sum / m_latencyStatistics.samples : 0),
+        (unsigned) m_latencyStatistics.maximum,
+        (unsigned) m_failedNotifications,
+        (unsigned) m_truncatedNotifications.load());
+}
+
+NotificationDispatcher* NotificationDispatcher::instance(void)
+{
+    return &notificationDispatcher;
+}
+
+void NotificationDispatcher::run(void)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        auto pending = m_pending.exchange(0, std::memory_order_acquire);
+        while (pending)
+        {
+            auto slot = __builtin_ctz(pending);
+            pending &= pending - 1;
+
+            sendNotification(slot);
+        }
+    }
+}
+
+void NotificationDispatcher::sendNotification(int slot)
+{
+    auto characteristic = m_characteristics[slot];
+    auto subscribers = characteristic->subscribers();
+    if (!subscribers)
+    {
+        return;
+    }
+
+    uint16_t length = 0;
+    try
+    {
+        characteristic->read(m_buffer, &length);
+    }
+    catch(const std::exception& e)
+    {
+        ESP_LOGW(LOG_TAG, "Could not read value for notification: %s", e.what());
+        ++m_failedNotifications;
+        return;
+    }
+    if (!length)
+    {
+        return;
+    }
+
+    m_latencyStatistics.add(
+        (uint32_t) esp_timer_get_time() - m_requestTimestamps[slot].load(std::memory_order_relaxed));
+
+    auto needConfirmation = characteristic->notification() == GenericGattCharacteristic::Notification::INDICATE;
+    while (subscribers)
+    {
+        uint16_t connectionId = __builtin_ctz(subscribers);
+        subscribers &= subscribers - 1;
+
+        if (!sendValue(characteristic, connectionId, m_buffer, length, needConfirmation))
+        {
+            ++m_failedNotifications;
+        }
+    }
+}
+
+bool NotificationDispatcher::sendValue(
+    const GenericGattCharacteristic* characteristic,
+    uint16_t connectionId,
+    const uint8_t* value,
+    uint16_t length,
+    bool needConfirmation)
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        return false;
+    }
+
+    auto dispatcher = instance();
+    auto payloadLength = dispatcher->payloadLength(1u << connectionId);
+    if (length > payloadLength)
+    {
+        ++dispatcher->m_truncatedNotifications;
+        length = payloadLength;
+    }
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    // the host takes ownership of the buffer, also if sending fails
+    auto buffer = ble_hs_mbuf_from_flat(value, length);
+    if (!buffer)
+    {
+        return false;
+    }
+    if (needConfirmation)
+    {
+        return ble_gattc_indicate_custom(connectionId, characteristic->handle(), buffer) == 0;
+    }
+    return ble_gattc_notify_custom(connectionId, characteristic->handle(), buffer) == 0;
+#else
+    return esp_ble_gatts_send_indicate(
+        characteristic->interface(),
+        connectionId,
+        characteristic->handle(),
+        length,
+        (uint8_t*) value,
+        needConfirmation) == ESP_OK;
+#endif
+}
+
+void NotificationDispatcher::task(void* parameter)
+{
+    ((NotificationDispatcher*) parameter)->run();
+}
+
+} /* namespace Esp32 */
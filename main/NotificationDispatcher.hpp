@@ -0,0 +1,95 @@
+#ifndef MAIN_NOTIFICATIONDISPATCHER_HPP_
+#define MAIN_NOTIFICATIONDISPATCHER_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+#include <atomic>
+#include "BleServer.hpp"
+#include "GenericGattCharacteristic.hpp"
+
+#ifdef CONFIG_BLE_NOTIFICATION_CHARACTERISTICS_MAX
+#define NOTIFICATION_CHARACTERISTICS_MAX (CONFIG_BLE_NOTIFICATION_CHARACTERISTICS_MAX)
+#else
+#define NOTIFICATION_CHARACTERISTICS_MAX (16)
+#endif
+
+#define NOTIFICATION_VALUE_LENGTH_MAX (BLE_GATT_LOCAL_MTU - 3)
+
+namespace Esp32
+{
+
+/*
+ * High priority task sending notifications/indications for characteristics which were flagged by notify() or
+ * notifyFromIsr(). Requests are kept in a pending bitmask (one bit per registered characteristic), multiple requests
+ * for the same characteristic are coalesced and the latest value is sent.
+ *
+ * sendValue() truncates values to the MTU of the receiving connection less the 3 bytes of the notification header,
+ * as the stack would otherwise do unnoticed; truncations are counted.
+ */
+class NotificationDispatcher
+{
+public:
+    struct LatencyStatistics
+    {
+        LatencyStatistics();
+
+        uint32_t samples;
+        uint32_t minimum;
+        uint32_t maximum;
+        uint64_t sum;
+
+        void add(uint32_t latency);
+    };
+
+    NotificationDispatcher();
+    virtual ~NotificationDispatcher();
+
+    void probe(void);
+    void registerCharacteristic(GenericGattCharacteristic* characteristic);
+
+    void requestNotification(GenericGattCharacteristic* characteristic);
+    void requestNotificationFromIsr(GenericGattCharacteristic* characteristic);
+
+    void setMtu(uint16_t connectionId, uint16_t mtu);
+    uint16_t payloadLength(uint32_t subscribers) const;
+
+    const LatencyStatistics& latencyStatistics(void) const;
+    uint32_t failedNotifications(void) const;
+    uint32_t truncatedNotifications(void) const;
+    void dumpStatistics(void) const;
+
+    static NotificationDispatcher* instance(void);
+    static bool sendValue(
+        const GenericGattCharacteristic* characteristic,
+        uint16_t connectionId,
+        const uint8_t* value,
+        uint16_t length,
+        bool needConfirmation);
+
+protected:
+
+    TaskHandle_t m_task;
+    GenericGattCharacteristic* m_characteristics[NOTIFICATION_CHARACTERISTICS_MAX];
+    uint8_t m_numberOfCharacteristics;
+    std::atomic<uint32_t> m_pending;
+    std::atomic<uint32_t> m_requestTimestamps[NOTIFICATION_CHARACTERISTICS_MAX];
+    uint16_t m_mtu[GATT_CONNECTIONS_MAX];
+
+    uint8_t m_buffer[NOTIFICATION_VALUE_LENGTH_MAX];
+    LatencyStatistics m_latencyStatistics;
+    uint32_t m_failedNotifications;
+    std::atomic<uint32_t> m_truncatedNotifications;
+
+    void run(void);
+    void sendNotification(int slot);
+
+    static void task(void* parameter);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_NOTIFICATIONDISPATCHER_HPP_ */
@@ -0,0 +1,358 @@
+#include <string.h>
+#include <esp_log.h>
+#include <sdkconfig.h>
+#include <stdexcept>
+#include "PendingTransactions.hpp"
+
+#define LOG_TAG "PendingTransactions"
+
+#ifdef CONFIG_BLE_DEFERRED_RESPONSE_TIMEOUT
+#define DEFERRED_RESPONSE_TIMEOUT_MS (CONFIG_BLE_DEFERRED_RESPONSE_TIMEOUT)
+#else
+#define DEFERRED_RESPONSE_TIMEOUT_MS (20000)
+#endif
+
+namespace Esp32
+{
+
+static PendingTransactions pendingTransactions;
+
+bool PendingTransactions::Response::complete(const uint8_t* value, uint16_t length) const
+{
+    return PendingTransactions::instance()->complete(*this, ESP_GATT_OK, value, length);
+}
+
+bool PendingTransactions::Response::fail(esp_gatt_status_t status) const
+{
+    return PendingTransactions::instance()->complete(*this, status, nullptr, 0);
+}
+
+PendingTransactions::PendingTransactions():
+    m_transactions(),
+    m_lock(portMUX_INITIALIZER_UNLOCKED),
+    m_sequence(0),
+    m_timeouts(0),
+    m_timer(nullptr),
+    m_timerArmed(false),
+    m_request(),
+    m_requestConnectionId(0),
+    m_dispatching(false),
+    m_needResponse(false),
+    m_deferred(false),
+    m_response(),
+    m_responseMutexBuffer(),
+    m_responseMutex(xSemaphoreCreateMutexStatic(&m_responseMutexBuffer))
+{
+}
+
+PendingTransactions::~PendingTransactions()
+{
+}
+
+void PendingTransactions::begin(
+    esp_gatt_if_t gatts_if,
+    uint16_t connectionId,
+    uint32_t transactionId,
+    uint16_t handle,
+    uint16_t offset,
+    bool read,
+    bool needResponse)
+{
+    m_request.sequence = 0;
+    m_request.transactionId = transactionId;
+    m_request.deadline = 0;
+    m_request.handle = handle;
+    m_request.offset = offset;
+    m_request.interface = gatts_if;
+    m_request.read = read;
+    m_requestConnectionId = connectionId;
+    m_needResponse = needResponse;
+    m_deferred = false;
+    m_dispatching = true;
+}
+
+PendingTransactions::Response PendingTransactions::defer(void)
+{
+    if (!m_dispatching)
+    {
+        throw std::runtime_error("no request to defer");
+    }
+
+    // e.g. a reliable write to two asynchronous characteristics, the request has one response only
+    if (m_deferred)
+    {
+        throw std::runtime_error("request was deferred already");
+    }
+
+    m_deferred = true;
+
+    // a write command needs no response, completing it is a no-op
+    Response response = {m_requestConnectionId, 0};
+    if (!m_needResponse)
+    {
+        return response;
+    }
+
+    if (m_requestConnectionId >= GATT_CONNECTIONS_MAX)
+    {
+        m_deferred = false;
+        throw std::out_of_range("connection id out of range");
+    }
+
+    bool replaced;
+    bool armTimer = false;
+    portENTER_CRITICAL(&m_lock);
+    auto& transaction = m_transactions[m_requestConnectionId];
+    replaced = transaction.sequence != 0;
+    transaction = m_request;
+    if (!++m_sequence)
+    {
+        ++m_sequence;
+    }
+    transaction.sequence = m_sequence;
+    transaction.deadline = esp_timer_get_time() + DEFERRED_RESPONSE_TIMEOUT_MS * 1000LL;
+    response.sequence = transaction.sequence;
+    m_request.sequence = transaction.sequence;
+    if (!m_timerArmed)
+    {
+        m_timerArmed = true;
+        armTimer = true;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (replaced)
+    {
+        ESP_LOGW(LOG_TAG, "replacing the pending transaction of connection %u", m_requestConnectionId);
+    }
+
+    if (armTimer)
+    {
+        try
+        {
+            this->armTimer(DEFERRED_RESPONSE_TIMEOUT_MS * 1000ULL);
+        }
+        catch (const std::exception& e)
+        {
+            portENTER_CRITICAL(&m_lock);
+            m_timerArmed = false;
+            portEXIT_CRITICAL(&m_lock);
+            abort();
+            throw;
+        }
+    }
+
+    return response;
+}
+
+bool PendingTransactions::end(void)
+{
+    m_dispatching = false;
+    return m_deferred;
+}
+
+bool PendingTransactions::abort(void)
+{
+    auto deferred = end();
+    m_deferred = false;
+    if (!deferred || !m_needResponse || m_requestConnectionId >= GATT_CONNECTIONS_MAX)
+    {
+        return true;
+    }
+
+    // the caller answers with an error unless the deferred transaction was completed (or timed out) meanwhile
+    bool unanswered;
+    portENTER_CRITICAL(&m_lock);
+    auto& transaction = m_transactions[m_requestConnectionId];
+    unanswered = transaction.sequence == m_request.sequence;
+    if (unanswered)
+    {
+        transaction.sequence = 0;
+    }
+    portEXIT_CRITICAL(&m_lock);
+    return unanswered;
+}
+
+bool PendingTransactions::complete(
+    const Response& response,
+    esp_gatt_status_t status,
+    const uint8_t* value,
+    uint16_t length)
+{
+    if (!response.sequence || response.connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        return false;
+    }
+
+    if (!value && length)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    // claim the transaction, a late completion after a timeout or a disconnect is ignored
+    Transaction transaction;
+    portENTER_CRITICAL(&m_lock);
+    transaction = m_transactions[response.connectionId];
+    bool claimed = transaction.sequence == response.sequence;
+    if (claimed)
+    {
+        m_transactions[response.connectionId].sequence = 0;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (!claimed)
+    {
+        ESP_LOGD(LOG_TAG, "transaction of connection %u is gone", response.connectionId);
+        return false;
+    }
+
+    xSemaphoreTake(m_responseMutex, portMAX_DELAY);
+
+    bzero(&m_response, sizeof(m_response));
+    m_response.attr_value.handle = transaction.handle;
+    m_response.attr_value.offset = transaction.offset;
+
+    if (transaction.read && status == ESP_GATT_OK)
+    {
+        // Read Blob requests continue a long value, the stack expects the remainder starting at the offset
+        if (transaction.offset > length)
+        {
+            status = ESP_GATT_INVALID_OFFSET;
+        }
+        else
+        {
+            length -= transaction.offset;
+            m_response.attr_value.len = length < ESP_GATT_MAX_ATTR_LEN ? length : ESP_GATT_MAX_ATTR_LEN;
+            memcpy(m_response.attr_value.value, value + transaction.offset, m_response.attr_value.len);
+        }
+    }
+
+    auto result = esp_ble_gatts_send_response(
+        transaction.interface,
+        response.connectionId,
+        transaction.transactionId,
+        status,
+        transaction.read ? &m_response : nullptr);
+
+    xSemaphoreGive(m_responseMutex);
+
+    if (result != ESP_OK)
+    {
+        ESP_LOGW(LOG_TAG, "error sending deferred response: %d", result);
+        return false;
+    }
+    return true;
+}
+
+void PendingTransactions::cancel(uint16_t connectionId)
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    m_transactions[connectionId].sequence = 0;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+size_t PendingTransactions::pending(void) const
+{
+    size_t pending = 0;
+    portENTER_CRITICAL(&m_lock);
+    for (auto& transaction : m_transactions)
+    {
+        if (transaction.sequence)
+        {
+            ++pending;
+        }
+    }
+    portEXIT_CRITICAL(&m_lock);
+    return pending;
+}
+
+uint32_t PendingTransactions::timeouts(void) const
+{
+    return m_timeouts;
+}
+
+PendingTransactions* PendingTransactions::instance(void)
+{
+    return &pendingTransactions;
+}
+
+void PendingTransactions::armTimer(uint64_t timeoutUs)
+{
+    if (!m_timer)
+    {
+        esp_timer_create_args_t timerArguments = {};
+        timerArguments.callback = timerCallback;
+        timerArguments.arg = this;
+        timerArguments.dispatch_method = ESP_TIMER_TASK;
+        timerArguments.name = "ble_deferred";
+
+        if (esp_timer_create(&timerArguments, &m_timer) != ESP_OK)
+        {
+            throw std::runtime_error("error creating the deferred response timer");
+        }
+    }
+
+    if (esp_timer_start_once(m_timer, timeoutUs) != ESP_OK)
+    {
+        throw std::runtime_error("error starting the deferred response timer");
+    }
+}
+
+void PendingTransactions::expire(void)
+{
+    auto now = esp_timer_get_time();
+
+    for (uint16_t connectionId = 0; connectionId < GATT_CONNECTIONS_MAX; ++connectionId)
+    {
+        portENTER_CRITICAL(&m_lock);
+        auto& transaction = m_transactions[connectionId];
+        Response response = {connectionId, transaction.sequence};
+        bool expired = transaction.sequence && transaction.deadline <= now;
+        portEXIT_CRITICAL(&m_lock);
+
+        if (expired && complete(response, ESP_GATT_ERR_UNLIKELY, nullptr, 0))
+        {
+            ESP_LOGW(LOG_TAG, "deferred response of connection %u timed out", connectionId);
+            ++m_timeouts;
+        }
+    }
+
+    // one shot timer, re-armed for the earliest deadline left including transactions deferred meanwhile
+    int64_t nextDeadline = 0;
+    portENTER_CRITICAL(&m_lock);
+    for (auto& transaction : m_transactions)
+    {
+        if (transaction.sequence && (!nextDeadline || transaction.deadline < nextDeadline))
+        {
+            nextDeadline = transaction.deadline;
+        }
+    }
+    m_timerArmed = nextDeadline != 0;
+    portEXIT_CRITICAL(&m_lock);
+
+    if (nextDeadline)
+    {
+        now = esp_timer_get_time();
+        armTimer(nextDeadline > now ? nextDeadline - now : 1);
+    }
+}
+
+void PendingTransactions::timerCallback(void* parameter)
+{
+    auto transactions = (PendingTransactions*) parameter;
+
+    try
+    {
+        transactions->expire();
+    }
+    catch (const std::exception& e)
+    {
+        ESP_LOGE(LOG_TAG, "error expiring deferred responses: %s", e.what());
+    }
+}
+
+} /* namespace Esp32 */
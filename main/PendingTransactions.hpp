@@ -0,0 +1,109 @@
+#ifndef MAIN_PENDINGTRANSACTIONS_HPP_
+#define MAIN_PENDINGTRANSACTIONS_HPP_
+
+#include <esp_gatts_api.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "GenericGattCharacteristic.hpp"
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "PendingTransactions needs Bluedroid, NimBLE answers requests within its access callbacks"
+#endif
+
+namespace Esp32
+{
+
+/*
+ * ATT requests answered after the GATTS event handler returned. Value attributes are ESP_GATT_RSP_BY_APP, so a read
+ * or write request may be answered any time before the ATT transaction timeout (30 s) by its transaction id.
+ *
+ * GattsApplication brackets the dispatch of each request by begin() and end(), including the execution of prepared
+ * writes. A characteristic which cannot answer right away (see AsyncGattCharacteristic) calls defer() meanwhile and
+ * gets a Response, which is completed later from any task; a request is deferred at most once. If the dispatch fails,
+ * abort() tells whether the request still has to be answered: a deferred one may have been completed already. A client
+ * has at most one request outstanding per connection, so one slot per connection is kept. Requests not completed within
+ * CONFIG_BLE_DEFERRED_RESPONSE_TIMEOUT are answered with an error, requests of a connection which is closed are
+ * dropped; completing a Response afterwards has no effect.
+ */
+class PendingTransactions
+{
+public:
+    struct Response
+    {
+        uint16_t connectionId;
+        uint32_t sequence;
+
+        bool complete(const uint8_t* value, uint16_t length) const;
+        bool fail(esp_gatt_status_t status) const;
+    };
+
+    PendingTransactions();
+    virtual ~PendingTransactions();
+
+    void begin(
+        esp_gatt_if_t gatts_if,
+        uint16_t connectionId,
+        uint32_t transactionId,
+        uint16_t handle,
+        uint16_t offset,
+        bool read,
+        bool needResponse);
+    Response defer(void);
+    bool end(void);
+    bool abort(void);
+
+    bool complete(const Response& response, esp_gatt_status_t status, const uint8_t* value, uint16_t length);
+    void cancel(uint16_t connectionId);
+
+    size_t pending(void) const;
+    uint32_t timeouts(void) const;
+
+    static PendingTransactions* instance(void);
+
+protected:
+
+    struct Transaction
+    {
+        uint32_t sequence;
+        uint32_t transactionId;
+        int64_t deadline;
+        uint16_t handle;
+        uint16_t offset;
+        esp_gatt_if_t interface;
+        bool read;
+    };
+
+    Transaction m_transactions[GATT_CONNECTIONS_MAX];
+    mutable portMUX_TYPE m_lock;
+    uint32_t m_sequence;
+    uint32_t m_timeouts;
+    esp_timer_handle_t m_timer;
+    bool m_timerArmed;
+
+    // request being dispatched by the Bluetooth task
+    Transaction m_request;
+    uint16_t m_requestConnectionId;
+    bool m_dispatching;
+    bool m_needResponse;
+    bool m_deferred;
+
+    // responses are larger than 600 bytes, one buffer is shared by all completing tasks
+    esp_gatt_rsp_t m_response;
+    StaticSemaphore_t m_responseMutexBuffer;
+    SemaphoreHandle_t m_responseMutex;
+
+    void armTimer(uint64_t timeoutUs);
+    void expire(void);
+
+    static void timerCallback(void* parameter);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_PENDINGTRANSACTIONS_HPP_ */
@@ -0,0 +1,109 @@
+#include <string.h>
+#include <stdexcept>
+#include "PrepareWriteQueue.hpp"
+
+namespace Esp32
+{
+
+PrepareWriteQueue::PrepareWriteQueue():
+    m_numberOfEntries(0),
+    m_used(0),
+    m_connectionId(-1)
+{
+}
+
+PrepareWriteQueue::~PrepareWriteQueue()
+{
+}
+
+bool PrepareWriteQueue::add(
+    uint16_t connectionId,
+    uint16_t handle,
+    uint16_t offset,
+    const uint8_t* value,
+    uint16_t length)
+{
+    if (!value && length)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (m_connectionId >= 0 && m_connectionId != connectionId)
+    {
+        return false;
+    }
+
+    if (m_numberOfEntries >= PREPARE_WRITE_ENTRIES_MAX || m_used + length > sizeof(m_buffer))
+    {
+        return false;
+    }
+
+    auto& entry = m_entries[m_numberOfEntries++];
+    entry.handle = handle;
+    entry.offset = offset;
+    entry.length = length;
+    entry.position = m_used;
+    memcpy(m_buffer + m_used, value, length);
+    m_used += length;
+    m_connectionId = connectionId;
+
+    return true;
+}
+
+bool PrepareWriteQueue::owns(uint16_t connectionId) const
+{
+    return m_connectionId == connectionId;
+}
+
+void PrepareWriteQueue::coalesce(void)
+{
+    if (!m_numberOfEntries)
+    {
+        return;
+    }
+
+    // values are stored in the order of arrival, a continuing write is adjacent within the buffer as well
+    size_t merged = 0;
+    for (size_t i = 1; i < m_numberOfEntries; ++i)
+    {
+        auto& previous = m_entries[merged];
+        auto& entry = m_entries[i];
+        if (entry.handle == previous.handle && entry.offset == previous.offset + previous.length)
+        {
+            previous.length += entry.length;
+        }
+        else
+        {
+            m_entries[++merged] = entry;
+        }
+    }
+    m_numberOfEntries = merged + 1;
+}
+
+void PrepareWriteQueue::clear(void)
+{
+    m_numberOfEntries = 0;
+    m_used = 0;
+    m_connectionId = -1;
+}
+
+size_t PrepareWriteQueue::size(void) const
+{
+    return m_numberOfEntries;
+}
+
+const PrepareWriteQueue::Entry& PrepareWriteQueue::entry(size_t index) const
+{
+    if (index >= m_numberOfEntries)
+    {
+        throw std::out_of_range("prepared write index out of range");
+    }
+    return m_entries[index];
+}
+
+const uint8_t* PrepareWriteQueue::value(const Entry& entry) const
+{
+    return m_buffer + entry.position;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,67 @@
+#ifndef MAIN_PREPAREWRITEQUEUE_HPP_
+#define MAIN_PREPAREWRITEQUEUE_HPP_
+
+#include <sdkconfig.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "PrepareWriteQueue needs Bluedroid, NimBLE reassembles long writes itself"
+#endif
+
+#ifdef CONFIG_BLE_PREPARE_WRITE_QUEUE_SIZE
+#define PREPARE_WRITE_QUEUE_SIZE (CONFIG_BLE_PREPARE_WRITE_QUEUE_SIZE)
+#else
+#define PREPARE_WRITE_QUEUE_SIZE (512)
+#endif
+
+#define PREPARE_WRITE_ENTRIES_MAX (16)
+
+namespace Esp32
+{
+
+/*
+ * Queue of prepared writes (ATT Prepare Write Request) until they are executed or cancelled. Prepared writes carry a
+ * value offset, so clients use them for long values as well as to update a part of a value. The queue belongs to one
+ * connection at a time, other connections are refused until it is executed, cancelled or the connection is closed.
+ *
+ * coalesce() merges writes continuing the previous one of the same handle, thus a long write is executed as one.
+ */
+class PrepareWriteQueue
+{
+public:
+    struct Entry
+    {
+        uint16_t handle;
+        uint16_t offset;
+        uint16_t length;
+        uint16_t position;
+    };
+
+    PrepareWriteQueue();
+    virtual ~PrepareWriteQueue();
+
+    bool add(uint16_t connectionId, uint16_t handle, uint16_t offset, const uint8_t* value, uint16_t length);
+    bool owns(uint16_t connectionId) const;
+    void coalesce(void);
+    void clear(void);
+
+    size_t size(void) const;
+    const Entry& entry(size_t index) const;
+    const uint8_t* value(const Entry& entry) const;
+
+protected:
+
+    uint8_t m_buffer[PREPARE_WRITE_QUEUE_SIZE];
+    Entry m_entries[PREPARE_WRITE_ENTRIES_MAX];
+    size_t m_numberOfEntries;
+    size_t m_used;
+    int m_connectionId;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_PREPAREWRITEQUEUE_HPP_ */
@@ -0,0 +1,217 @@
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <stdexcept>
+#include "BleServer.hpp"
+#include "GattArena.hpp"
+#include "ResourceMonitor.hpp"
+
+#define LOG_TAG "ResourceMonitor"
+
+#ifdef CONFIG_BLE_RESOURCE_MONITOR_STACK_WARNING
+#define RESOURCE_MONITOR_STACK_WARNING (CONFIG_BLE_RESOURCE_MONITOR_STACK_WARNING)
+#else
+#define RESOURCE_MONITOR_STACK_WARNING (512)
+#endif
+
+#define RESOURCE_MONITOR_HEAP_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+
+namespace Esp32
+{
+
+static ResourceMonitor resourceMonitor;
+
+// host tasks (Bluedroid or NimBLE), the controller task and the workers of this framework
+static const char* const defaultTaskNames[] = {
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+    "nimble_host",
+#else
+    "BTC_TASK",
+    "BTU_TASK",
+#endif
+    "BTController",
+    "ble_notify",
+    "ble_log",
+    "ble_tput",
+};
+
+ResourceMonitor::Snapshot::Snapshot():
+    freeHeap(0),
+    minimumFreeHeap(0),
+    largestFreeBlock(0),
+    arenaUsed(0),
+    arenaHighWaterMark(0),
+    gattFootprint(0)
+{
+    for (auto& stackHighWaterMark : stackHighWaterMarks)
+    {
+        stackHighWaterMark = RESOURCE_MONITOR_STACK_UNKNOWN;
+    }
+}
+
+ResourceMonitor::ResourceMonitor():
+    m_numberOfTasks(0),
+    m_timer(nullptr),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    for (auto name : defaultTaskNames)
+    {
+        addTask(name);
+    }
+}
+
+ResourceMonitor::~ResourceMonitor()
+{
+}
+
+void ResourceMonitor::addTask(const char* name)
+{
+    if (!name)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (m_numberOfTasks >= RESOURCE_MONITOR_TASKS_MAX)
+    {
+        throw std::runtime_error("too many monitored tasks");
+    }
+
+    m_taskNames[m_numberOfTasks] = name;
+    m_taskHandles[m_numberOfTasks] = nullptr;
+    ++m_numberOfTasks;
+}
+
+void ResourceMonitor::start(uint32_t intervalMs)
+{
+    ESP_LOGD(LOG_TAG, "ResourceMonitor::start(%u)", (unsigned) intervalMs);
+
+    if (m_timer)
+    {
+        return;
+    }
+
+    esp_timer_create_args_t timerArguments = {};
+    timerArguments.callback = timerCallback;
+    timerArguments.arg = this;
+    timerArguments.dispatch_method = ESP_TIMER_TASK;
+    timerArguments.name = "ble_monitor";
+
+    if (esp_timer_create(&timerArguments, &m_timer) != ESP_OK)
+    {
+        throw std::runtime_error("error creating the resource monitor timer");
+    }
+
+    if (esp_timer_start_periodic(m_timer, (uint64_t) intervalMs * 1000) != ESP_OK)
+    {
+        throw std::runtime_error("error starting the resource monitor timer");
+    }
+}
+
+void ResourceMonitor::stop(void)
+{
+    if (m_timer)
+    {
+        esp_timer_stop(m_timer);
+    }
+}
+
+ResourceMonitor::Snapshot ResourceMonitor::sample(void)
+{
+    Snapshot snapshot;
+
+    snapshot.freeHeap = heap_caps_get_free_size(RESOURCE_MONITOR_HEAP_CAPS);
+    snapshot.minimumFreeHeap = heap_caps_get_minimum_free_size(RESOURCE_MONITOR_HEAP_CAPS);
+    snapshot.largestFreeBlock = heap_caps_get_largest_free_block(RESOURCE_MONITOR_HEAP_CAPS);
+    snapshot.arenaUsed = GattArena::instance()->used();
+    snapshot.arenaHighWaterMark = GattArena::instance()->highWaterMark();
+    snapshot.gattFootprint = BleServer::instance()->footprint();
+
+    for (size_t i = 0; i < m_numberOfTasks; ++i)
+    {
+        // tasks are never deleted, a handle once found stays valid
+        if (!m_taskHandles[i])
+        {
+            m_taskHandles[i] = xTaskGetHandle(m_taskNames[i]);
+        }
+        if (m_taskHandles[i])
+        {
+            snapshot.stackHighWaterMarks[i] = uxTaskGetStackHighWaterMark(m_taskHandles[i]);
+        }
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    m_snapshot = snapshot;
+    portEXIT_CRITICAL(&m_lock);
+
+    return snapshot;
+}
+
+ResourceMonitor::Snapshot ResourceMonitor::snapshot(void) const
+{
+    portENTER_CRITICAL(&m_lock);
+    auto snapshot = m_snapshot;
+    portEXIT_CRITICAL(&m_lock);
+
+    return snapshot;
+}
+
+size_t ResourceMonitor::numberOfTasks(void) const
+{
+    return m_numberOfTasks;
+}
+
+const char* ResourceMonitor::taskName(size_t index) const
+{
+    if (index >= m_numberOfTasks)
+    {
+        throw std::out_of_range("task index out of range");
+    }
+    return m_taskNames[index];
+}
+
+void ResourceMonitor::dump(void) const
+{
+    auto snapshot = this->snapshot();
+
+    ESP_LOGI(
+        LOG_TAG,
+        "heap: %u bytes free (minimum %u), largest block %u; GATT: arena %u bytes (peak %u), objects %u bytes",
+        (unsigned) snapshot.freeHeap,
+        (unsigned) snapshot.minimumFreeHeap,
+        (unsigned) snapshot.largestFreeBlock,
+        (unsigned) snapshot.arenaUsed,
+        (unsigned) snapshot.arenaHighWaterMark,
+        (unsigned) snapshot.gattFootprint);
+
+    for (size_t i = 0; i < m_numberOfTasks; ++i)
+    {
+        auto stackHighWaterMark = snapshot.stackHighWaterMarks[i];
+        if (stackHighWaterMark == RESOURCE_MONITOR_STACK_UNKNOWN)
+        {
+            continue;
+        }
+
+        if (stackHighWaterMark < RESOURCE_MONITOR_STACK_WARNING)
+        {
+            ESP_LOGW(LOG_TAG, "task %s: only %u bytes of stack left", m_taskNames[i], (unsigned) stackHighWaterMark);
+        }
+        else
+        {
+            ESP_LOGI(LOG_TAG, "task %s: %u bytes of stack left", m_taskNames[i], (unsigned) stackHighWaterMark);
+        }
+    }
+}
+
+ResourceMonitor* ResourceMonitor::instance(void)
+{
+    return &resourceMonitor;
+}
+
+void ResourceMonitor::timerCallback(void* parameter)
+{
+    auto monitor = (ResourceMonitor*) parameter;
+
+    monitor->sample();
+    monitor->dump();
+}
+
+} /* namespace Esp32 */
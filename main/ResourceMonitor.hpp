@@ -0,0 +1,73 @@
+#ifndef MAIN_RESOURCEMONITOR_HPP_
+#define MAIN_RESOURCEMONITOR_HPP_
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RESOURCE_MONITOR_TASKS_MAX (8)
+#define RESOURCE_MONITOR_STACK_UNKNOWN (UINT32_MAX)
+
+namespace Esp32
+{
+
+/*
+ * Samples the resources the BLE subsystems depend on: the stack high-water marks (bytes never used) of the Bluedroid
+ * tasks and of our worker tasks, the internal heap (free, minimum free, largest free block) and the memory attributed
+ * to the GATT database (GATT arena and the objects of all registered applications).
+ *
+ * Tasks are looked up by name until they exist, so tasks which are started late (or never) are handled. Sampling is
+ * done on demand by sample() or periodically by start() which also logs each sample, warning about stacks close to
+ * overflowing.
+ */
+class ResourceMonitor
+{
+public:
+    struct Snapshot
+    {
+        Snapshot();
+
+        uint32_t freeHeap;
+        uint32_t minimumFreeHeap;
+        uint32_t largestFreeBlock;
+        uint32_t arenaUsed;
+        uint32_t arenaHighWaterMark;
+        uint32_t gattFootprint;
+        uint32_t stackHighWaterMarks[RESOURCE_MONITOR_TASKS_MAX];
+    };
+
+    ResourceMonitor();
+    virtual ~ResourceMonitor();
+
+    void addTask(const char* name);
+    void start(uint32_t intervalMs);
+    void stop(void);
+
+    Snapshot sample(void);
+    Snapshot snapshot(void) const;
+    size_t numberOfTasks(void) const;
+    const char* taskName(size_t index) const;
+    void dump(void) const;
+
+    static ResourceMonitor* instance(void);
+
+protected:
+
+    const char* m_taskNames[RESOURCE_MONITOR_TASKS_MAX];
+    TaskHandle_t m_taskHandles[RESOURCE_MONITOR_TASKS_MAX];
+    size_t m_numberOfTasks;
+    Snapshot m_snapshot;
+    esp_timer_handle_t m_timer;
+    mutable portMUX_TYPE m_lock;
+
+    static void timerCallback(void* parameter);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_RESOURCEMONITOR_HPP_ */
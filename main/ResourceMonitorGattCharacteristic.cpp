@@ -0,0 +1,57 @@
+#include <string.h>
+#include "ResourceMonitorGattCharacteristic.hpp"
+
+#define RESOURCE_MONITOR_HEADER_LENGTH (6 * sizeof(uint32_t))
+#define RESOURCE_MONITOR_STACK_FIELD_UNKNOWN (0xffff)
+
+namespace Esp32
+{
+
+ResourceMonitorGattCharacteristic::ResourceMonitorGattCharacteristic(
+    const BleUuid& characteristicId,
+    const char* description):
+    GenericGattCharacteristic(
+        characteristicId,
+        RESOURCE_MONITOR_HEADER_LENGTH + RESOURCE_MONITOR_TASKS_MAX * sizeof(uint16_t),
+        ESP_GATT_PERM_READ,
+        description)
+{
+}
+
+ResourceMonitorGattCharacteristic::~ResourceMonitorGattCharacteristic()
+{
+}
+
+void ResourceMonitorGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    auto monitor = ResourceMonitor::instance();
+    auto snapshot = monitor->sample();
+
+    uint32_t header[RESOURCE_MONITOR_HEADER_LENGTH / sizeof(uint32_t)] = {
+        snapshot.freeHeap,
+        snapshot.minimumFreeHeap,
+        snapshot.largestFreeBlock,
+        snapshot.arenaUsed,
+        snapshot.arenaHighWaterMark,
+        snapshot.gattFootprint,
+    };
+    memcpy(buffer, header, sizeof(header));
+    *length = sizeof(header);
+
+    for (size_t i = 0; i < monitor->numberOfTasks(); ++i)
+    {
+        auto stackHighWaterMark = snapshot.stackHighWaterMarks[i];
+        uint16_t field = stackHighWaterMark < RESOURCE_MONITOR_STACK_FIELD_UNKNOWN
+            ? stackHighWaterMark
+            : RESOURCE_MONITOR_STACK_FIELD_UNKNOWN;
+        memcpy(buffer + *length, &field, sizeof(field));
+        *length += sizeof(field);
+    }
+}
+
+size_t ResourceMonitorGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
+}
+
+} /* namespace Esp32 */
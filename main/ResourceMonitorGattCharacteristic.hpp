@@ -0,0 +1,32 @@
+#ifndef MAIN_RESOURCEMONITORGATTCHARACTERISTIC_HPP_
+#define MAIN_RESOURCEMONITORGATTCHARACTERISTIC_HPP_
+
+#include "GenericGattCharacteristic.hpp"
+#include "ResourceMonitor.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Read-only characteristic exposing a fresh ResourceMonitor sample: free heap, minimum free heap, largest free block,
+ * GATT arena used, GATT arena peak and GATT object footprint (u32 each), followed by the stack high-water mark of each
+ * monitored task in the order of ResourceMonitor::taskName() (u16 each, 0xffff for tasks not found).
+ */
+class ResourceMonitorGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    ResourceMonitorGattCharacteristic(const BleUuid& characteristicId, const char* description = "Resources");
+    virtual ~ResourceMonitorGattCharacteristic();
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    size_t objectSize(void) const override;
+
+protected:
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_RESOURCEMONITORGATTCHARACTERISTIC_HPP_ */
@@ -0,0 +1,244 @@
+#include <esp_log.h>
+#include <string.h>
+#include <stdexcept>
+#include "NotificationDispatcher.hpp"
+#include "SampledGattCharacteristic.hpp"
+
+#define LOG_TAG "SampledGattCharacteristic"
+
+namespace Esp32
+{
+
+SampledGattCharacteristic::Statistics::Statistics():
+    samples(0),
+    flushesFull(0),
+    flushesDeadline(0),
+    droppedBatches(0),
+    flushedSamples(0),
+    flushedBytes(0),
+    flushCapacity(0)
+{
+}
+
+int SampledGattCharacteristic::Statistics::fillRatio(void) const
+{
+    return flushCapacity ? (int) ((flushedBytes * 100) / flushCapacity) : 0;
+}
+
+SampledGattCharacteristic::SampledGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint16_t sampleSize,
+    Sampler sampler,
+    void* samplerContext,
+    uint8_t* buffer,
+    uint16_t bufferSize,
+    const char* description):
+    GenericGattCharacteristic(characteristicId, bufferSize / 2, 0, description),
+    m_sampleSize(sampleSize),
+    m_sampler(sampler),
+    m_samplerContext(samplerContext),
+    m_bufferSize(bufferSize),
+    m_timer(nullptr),
+    m_deadline(0),
+    m_batchStart(0),
+    m_fillIndex(0),
+    m_fillLength(0),
+    m_fillSamples(0),
+    m_readyLength(0)
+{
+    m_buffers[0] = buffer;
+    m_buffers[1] = buffer + bufferSize / 2;
+    m_notification = Notification::NOTIFY;
+}
+
+SampledGattCharacteristic::~SampledGattCharacteristic()
+{
+}
+
+void SampledGattCharacteristic::start(uint32_t samplingRate, uint32_t deadlineMs)
+{
+    if (!m_sampler || !m_buffers[0])
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    if (!m_sampleSize || maximumEncodedSize() > m_length)
+    {
+        throw std::invalid_argument("sample does not fit into the buffer");
+    }
+
+    if (!samplingRate || samplingRate > 1000000)
+    {
+        throw std::invalid_argument("unsupported sampling rate");
+    }
+
+    if (!m_timer)
+    {
+        esp_timer_create_args_t timerArguments;
+        memset(&timerArguments, 0, sizeof(timerArguments));
+        timerArguments.callback = timerCallback;
+        timerArguments.arg = this;
+        timerArguments.dispatch_method = ESP_TIMER_TASK;
+        timerArguments.name = "ble_sampler";
+
+        if (esp_timer_create(&timerArguments, &m_timer) != ESP_OK)
+        {
+            throw std::runtime_error("error creating the sampling timer");
+        }
+    }
+
+    stop();
+    m_deadline = (int64_t) deadlineMs * 1000;
+    m_fillLength = 0;
+
+    if (esp_timer_start_periodic(m_timer, 1000000 / samplingRate) != ESP_OK)
+    {
+        throw std::runtime_error("error starting the sampling timer");
+    }
+}
+
+void SampledGattCharacteristic::stop(void)
+{
+    if (m_timer)
+    {
+        esp_timer_stop(m_timer);
+    }
+}
+
+void SampledGattCharacteristic::setClientConfiguration(uint16_t connectionId, uint16_t clientConfiguration)
+{
+    GenericGattCharacteristic::setClientConfiguration(connectionId, clientConfiguration);
+
+    // a batch flushed for the last subscriber is never read, it would block all further flushes
+    if (!subscribers())
+    {
+        m_readyLength.store(0, std::memory_order_release);
+    }
+}
+
+void SampledGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    // called by the notification dispatcher, hands the flushed half back to the sampler
+    auto readyLength = m_readyLength.load(std::memory_order_acquire);
+
+    *length = readyLength;
+    if (readyLength)
+    {
+        memcpy(buffer, m_buffers[m_fillIndex ^ 1], readyLength);
+        m_readyLength.store(0, std::memory_order_release);
+    }
+}
+
+size_t SampledGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this) + m_bufferSize;
+}
+
+const SampledGattCharacteristic::Statistics& SampledGattCharacteristic::statistics(void) const
+{
+    return m_statistics;
+}
+
+void SampledGattCharacteristic::dumpStatistics(void) const
+{
+    ESP_LOGI(
+        LOG_TAG,
+        "%u samples, flushes: %u full, %u deadline, %u dropped batches, fill ratio %d%%",
+        (unsigned) m_statistics.samples,
+        (unsigned) m_statistics.flushesFull,
+        (unsigned) m_statistics.flushesDeadline,
+        (unsigned) m_statistics.droppedBatches,
+        m_statistics.fillRatio());
+}
+
+void SampledGattCharacteristic::sample(void)
+{
+    auto subscribers = m_subscribers.load();
+    if (!subscribers)
+    {
+        m_fillLength = 0;
+        m_fillSamples = 0;
+        m_readyLength.store(0, std::memory_order_release);
+        return;
+    }
+
+    uint16_t capacity = NotificationDispatcher::instance()->payloadLength(subscribers);
+    if (capacity > m_length)
+    {
+        capacity = m_length;
+    }
+    if (capacity < maximumEncodedSize())
+    {
+        return;
+    }
+
+    auto now = esp_timer_get_time();
+    auto firstOfBatch = !m_fillLength;
+    if (firstOfBatch)
+    {
+        m_batchStart = now;
+    }
+
+    m_fillLength += encodeSample(m_buffers[m_fillIndex] + m_fillLength, firstOfBatch, now);
+    ++m_fillSamples;
+    ++m_statistics.samples;
+
+    if (m_fillLength + maximumEncodedSize() > capacity)
+    {
+        flush(FlushReason::FULL, capacity);
+    }
+    else if (now - m_batchStart >= m_deadline)
+    {
+        flush(FlushReason::DEADLINE, capacity);
+    }
+}
+
+void SampledGattCharacteristic::flush(FlushReason reason, uint16_t capacity)
+{
+    switch (reason)
+    {
+        case FlushReason::FULL:
+            ++m_statistics.flushesFull;
+            break;
+        case FlushReason::DEADLINE:
+            ++m_statistics.flushesDeadline;
+            break;
+    }
+
+    if (m_readyLength.load(std::memory_order_acquire))
+    {
+        ++m_statistics.droppedBatches;
+        m_fillLength = 0;
+        m_fillSamples = 0;
+        return;
+    }
+
+    m_statistics.flushedSamples += m_fillSamples;
+    m_statistics.flushedBytes += m_fillLength;
+    m_statistics.flushCapacity += capacity;
+
+    m_fillIndex ^= 1;
+    m_readyLength.store(m_fillLength, std::memory_order_release);
+    m_fillLength = 0;
+    m_fillSamples = 0;
+
+    notify();
+}
+
+uint16_t SampledGattCharacteristic::maximumEncodedSize(void) const
+{
+    return m_sampleSize;
+}
+
+uint16_t SampledGattCharacteristic::encodeSample(uint8_t* destination, bool firstOfBatch, int64_t timestamp)
+{
+    m_sampler(m_samplerContext, destination);
+    return m_sampleSize;
+}
+
+void SampledGattCharacteristic::timerCallback(void* parameter)
+{
+    ((SampledGattCharacteristic*) parameter)->sample();
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,104 @@
+#ifndef MAIN_SAMPLEDGATTCHARACTERISTIC_HPP_
+#define MAIN_SAMPLEDGATTCHARACTERISTIC_HPP_
+
+#include <esp_timer.h>
+#include <atomic>
+#include "GenericGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Notification only characteristic which samples a value at a fixed rate (driven by esp_timer) and sends the samples
+ * packed into as few notifications as possible. A batch is flushed once the next sample would not fit into the
+ * payload of the smallest MTU of all subscribers anymore, or once the oldest sample of the batch exceeds the latency
+ * deadline.
+ *
+ * Subclasses may encode samples differently by overriding encodeSample() and maximumEncodedSize(), by default the
+ * samples are packed as they are returned by the sampler.
+ *
+ * The caller supplies the buffer which is split into two halves: one is filled by the sampler while the other one is
+ * waiting to be sent. If the previous batch was not sent yet when the next one is complete, the new batch is dropped.
+ * The flushed bytes, samples and capacity of the statistics only count batches handed over for sending. A batch still
+ * waiting when the last subscriber leaves is discarded, the dispatcher does not read characteristics without
+ * subscribers.
+ */
+class SampledGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    typedef void (*Sampler)(void* context, uint8_t* sample);
+
+    struct Statistics
+    {
+        Statistics();
+
+        uint32_t samples;
+        uint32_t flushesFull;
+        uint32_t flushesDeadline;
+        uint32_t droppedBatches;
+        uint64_t flushedSamples;
+        uint64_t flushedBytes;
+        uint64_t flushCapacity;
+
+        int fillRatio(void) const;
+    };
+
+    SampledGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint16_t sampleSize,
+        Sampler sampler,
+        void* samplerContext,
+        uint8_t* buffer,
+        uint16_t bufferSize,
+        const char* description = nullptr);
+    virtual ~SampledGattCharacteristic();
+
+    void start(uint32_t samplingRate, uint32_t deadlineMs);
+    void stop(void);
+
+    void setClientConfiguration(uint16_t connectionId, uint16_t clientConfiguration) override;
+    void read(uint8_t* buffer, uint16_t* length) override;
+    size_t objectSize(void) const override;
+
+    const Statistics& statistics(void) const;
+    virtual void dumpStatistics(void) const;
+
+protected:
+
+    enum class FlushReason
+    {
+        FULL,
+        DEADLINE,
+    };
+
+    uint16_t m_sampleSize;
+    Sampler m_sampler;
+    void* m_samplerContext;
+    uint8_t* m_buffers[2];
+    uint16_t m_bufferSize;
+
+    esp_timer_handle_t m_timer;
+    int64_t m_deadline;
+    int64_t m_batchStart;
+    uint8_t m_fillIndex;
+    uint16_t m_fillLength;
+    uint16_t m_fillSamples;
+    std::atomic<uint16_t> m_readyLength;
+
+    Statistics m_statistics;
+
+    void sample(void);
+    void flush(FlushReason reason, uint16_t capacity);
+
+    virtual uint16_t maximumEncodedSize(void) const;
+    virtual uint16_t encodeSample(uint8_t* destination, bool firstOfBatch, int64_t timestamp);
+
+    static void timerCallback(void* parameter);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_SAMPLEDGATTCHARACTERISTIC_HPP_ */
@@ -0,0 +1,82 @@
+#include <string.h>
+#include <stdexcept>
+#include "SchemaGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+SchemaGattCharacteristic::SchemaGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint16_t length,
+    uint16_t permission,
+    const char* description,
+    const uint8_t* initialValue,
+    uint16_t initialValueLength,
+    uint8_t* valueBuffer):
+    GenericGattCharacteristic(characteristicId, length, permission, description),
+    m_value(initialValue),
+    m_valueBuffer(valueBuffer),
+    m_valueLength(initialValueLength),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    if (initialValueLength > length)
+    {
+        throw std::invalid_argument("initial value too long");
+    }
+
+    if (m_valueBuffer)
+    {
+        memcpy(m_valueBuffer, initialValue, initialValueLength);
+        m_value = m_valueBuffer;
+    }
+}
+
+SchemaGattCharacteristic::~SchemaGattCharacteristic()
+{
+}
+
+void SchemaGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    if (!m_valueBuffer)
+    {
+        *length = m_valueLength;
+        memcpy(buffer, m_value, m_valueLength);
+        return;
+    }
+
+    portENTER_CRITICAL_SAFE(&m_lock);
+    *length = m_valueLength;
+    memcpy(buffer, m_valueBuffer, m_valueLength);
+    portEXIT_CRITICAL_SAFE(&m_lock);
+}
+
+void SchemaGattCharacteristic::write(const uint8_t* buffer, uint16_t length)
+{
+    if (!m_valueBuffer)
+    {
+        throw std::runtime_error("characteristic is read-only");
+    }
+
+    if (length > m_length)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+
+    portENTER_CRITICAL_SAFE(&m_lock);
+    memcpy(m_valueBuffer, buffer, length);
+    m_valueLength = length;
+    portEXIT_CRITICAL_SAFE(&m_lock);
+    journalChange(buffer, length);
+
+    if (m_notification != Notification::NONE)
+    {
+        notify();
+    }
+}
+
+size_t SchemaGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this) + (m_valueBuffer ? m_length : 0);
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,45 @@
+#ifndef MAIN_SCHEMAGATTCHARACTERISTIC_HPP_
+#define MAIN_SCHEMAGATTCHARACTERISTIC_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include "GenericGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Characteristic created from a GATT schema (see GattSchema). Read-only values are served straight from the memory
+ * mapped schema, writable values get a RAM buffer of the maximum length which is initialised from the schema. Values
+ * may have any length up to length(), reads return the length of the last write.
+ */
+class SchemaGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    SchemaGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint16_t length,
+        uint16_t permission,
+        const char* description,
+        const uint8_t* initialValue,
+        uint16_t initialValueLength,
+        uint8_t* valueBuffer = nullptr);
+    virtual ~SchemaGattCharacteristic();
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    void write(const uint8_t* buffer, uint16_t length) override;
+    size_t objectSize(void) const override;
+
+protected:
+
+    const uint8_t* m_value;
+    uint8_t* m_valueBuffer;
+    uint16_t m_valueLength;
+    portMUX_TYPE m_lock;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_SCHEMAGATTCHARACTERISTIC_HPP_ */
@@ -0,0 +1,120 @@
+#ifndef MAIN_SEQLOCKVALUE_HPP_
+#define MAIN_SEQLOCKVALUE_HPP_
+
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+#include "CriticalSection.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Storage for a trivially copyable value shared between tasks on both cores.
+ *
+ * The value is kept twice (sequence latch): a writer bumps the sequence number before updating each copy, readers
+ * use the copy selected by the sequence number and retry only if the sequence changed meanwhile. Thus a reader never
+ * waits for a preempted writer and never sees a torn value. Writers are serialized by a short critical section which
+ * can also be entered from an ISR. The header builds on the host as well, test/host/SeqLockValueTest.cpp runs readers
+ * and writers on threads against it.
+ */
+template<typename T>
+class SeqLockValue
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "value type needs to be trivially copyable");
+
+    SeqLockValue(const T& value = T());
+    ~SeqLockValue();
+
+    T load(void) const;
+    void store(const T& value);
+
+    uint32_t sequence(void) const;
+
+protected:
+
+    static constexpr size_t words = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<uint32_t> m_copies[2][words];
+    CriticalSection m_writerLock;
+
+    void storeCopy(int index, const uint32_t* buffer);
+
+private:
+
+};
+
+template<typename T>
+SeqLockValue<T>::SeqLockValue(const T& value):
+    m_sequence(0),
+    m_writerLock()
+{
+    uint32_t buffer[words] = {};
+    memcpy(buffer, &value, sizeof(T));
+    storeCopy(0, buffer);
+    storeCopy(1, buffer);
+}
+
+template<typename T>
+SeqLockValue<T>::~SeqLockValue()
+{
+}
+
+template<typename T>
+T SeqLockValue<T>::load(void) const
+{
+    uint32_t buffer[words];
+    uint32_t sequence;
+
+    do
+    {
+        sequence = m_sequence.load(std::memory_order_acquire);
+        auto& copy = m_copies[sequence & 1];
+        for (size_t i = 0; i < words; ++i)
+        {
+            buffer[i] = copy[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (sequence != m_sequence.load(std::memory_order_relaxed));
+
+    T value;
+    memcpy(&value, buffer, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void SeqLockValue<T>::store(const T& value)
+{
+    uint32_t buffer[words] = {};
+    memcpy(buffer, &value, sizeof(T));
+
+    m_writerLock.enter();
+    // odd sequence: readers use copy 1 while copy 0 is updated, and vice versa
+    m_sequence.fetch_add(1, std::memory_order_release);
+    storeCopy(0, buffer);
+    m_sequence.fetch_add(1, std::memory_order_release);
+    storeCopy(1, buffer);
+    m_writerLock.exit();
+}
+
+template<typename T>
+uint32_t SeqLockValue<T>::sequence(void) const
+{
+    return m_sequence.load(std::memory_order_acquire);
+}
+
+template<typename T>
+void SeqLockValue<T>::storeCopy(int index, const uint32_t* buffer)
+{
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < words; ++i)
+    {
+        m_copies[index][i].store(buffer[i], std::memory_order_relaxed);
+    }
+}
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_SEQLOCKVALUE_HPP_ */
@@ -0,0 +1,92 @@
+#include "ThroughputMeter.hpp"
+
+#define THROUGHPUT_METER_WINDOW_MS (THROUGHPUT_METER_BUCKETS * THROUGHPUT_METER_BUCKET_LENGTH_MS)
+
+namespace Esp32
+{
+
+ThroughputMeter::ThroughputMeter():
+    m_bytes(0),
+    m_packets(0),
+    m_drops(0)
+{
+    reset();
+}
+
+ThroughputMeter::~ThroughputMeter()
+{
+}
+
+void ThroughputMeter::add(uint32_t bytes, uint32_t now)
+{
+    auto start = bucketStart(now);
+    auto slot = (now / THROUGHPUT_METER_BUCKET_LENGTH_MS) % THROUGHPUT_METER_BUCKETS;
+
+    // a bucket is reused once the window moved on by a full round
+    if (m_bucketStart[slot].load(std::memory_order_relaxed) != start)
+    {
+        m_bucketBytes[slot].store(0, std::memory_order_relaxed);
+        m_bucketStart[slot].store(start, std::memory_order_relaxed);
+    }
+    m_bucketBytes[slot].fetch_add(bytes, std::memory_order_relaxed);
+
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    m_packets.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThroughputMeter::addDrops(uint32_t drops)
+{
+    m_drops.fetch_add(drops, std::memory_order_relaxed);
+}
+
+void ThroughputMeter::reset(void)
+{
+    m_bytes.store(0);
+    m_packets.store(0);
+    m_drops.store(0);
+    for (int i = 0; i < THROUGHPUT_METER_BUCKETS; ++i)
+    {
+        m_bucketBytes[i].store(0);
+        m_bucketStart[i].store(UINT32_MAX);
+    }
+}
+
+uint32_t ThroughputMeter::bytes(void) const
+{
+    return m_bytes.load(std::memory_order_relaxed);
+}
+
+uint32_t ThroughputMeter::packets(void) const
+{
+    return m_packets.load(std::memory_order_relaxed);
+}
+
+uint32_t ThroughputMeter::drops(void) const
+{
+    return m_drops.load(std::memory_order_relaxed);
+}
+
+uint32_t ThroughputMeter::kbps(uint32_t now) const
+{
+    // the window ends with the current (partial) bucket
+    auto windowStart = bucketStart(now) - (THROUGHPUT_METER_BUCKETS - 1) * THROUGHPUT_METER_BUCKET_LENGTH_MS;
+    uint64_t bytes = 0;
+    for (int i = 0; i < THROUGHPUT_METER_BUCKETS; ++i)
+    {
+        auto start = m_bucketStart[i].load(std::memory_order_relaxed);
+        if (start != UINT32_MAX && start - windowStart < THROUGHPUT_METER_WINDOW_MS)
+        {
+            bytes += m_bucketBytes[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    auto elapsed = now - windowStart;
+    return elapsed ? (uint32_t) (bytes * 8 / elapsed) : 0;
+}
+
+uint32_t ThroughputMeter::bucketStart(uint32_t now)
+{
+    return now - now % THROUGHPUT_METER_BUCKET_LENGTH_MS;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,51 @@
+#ifndef MAIN_THROUGHPUTMETER_HPP_
+#define MAIN_THROUGHPUTMETER_HPP_
+
+#include <stdint.h>
+#include <atomic>
+
+// powers of two keep the buckets aligned when the 32 bit millisecond timestamps wrap around
+#define THROUGHPUT_METER_BUCKETS (4)
+#define THROUGHPUT_METER_BUCKET_LENGTH_MS (256)
+
+namespace Esp32
+{
+
+/*
+ * Counts bytes, packets and drops of one direction and computes the rate over a rolling window of
+ * THROUGHPUT_METER_BUCKETS * THROUGHPUT_METER_BUCKET_LENGTH_MS milliseconds. Only one task may add and reset, any
+ * task may read the counters. Timestamps are passed in by the caller, so the meter does not depend on ESP-IDF and can be exercised
+ * on a host with simulated traffic.
+ */
+class ThroughputMeter
+{
+public:
+    ThroughputMeter();
+    virtual ~ThroughputMeter();
+
+    void add(uint32_t bytes, uint32_t now);
+    void addDrops(uint32_t drops);
+    void reset(void);
+
+    uint32_t bytes(void) const;
+    uint32_t packets(void) const;
+    uint32_t drops(void) const;
+    uint32_t kbps(uint32_t now) const;
+
+protected:
+
+    std::atomic<uint32_t> m_bytes;
+    std::atomic<uint32_t> m_packets;
+    std::atomic<uint32_t> m_drops;
+    std::atomic<uint32_t> m_bucketBytes[THROUGHPUT_METER_BUCKETS];
+    std::atomic<uint32_t> m_bucketStart[THROUGHPUT_METER_BUCKETS];
+
+    static uint32_t bucketStart(uint32_t now);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_THROUGHPUTMETER_HPP_ */
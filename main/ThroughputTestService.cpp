@@ -0,0 +1,276 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdexcept>
+#include "ThroughputTestService.hpp"
+
+#define LOG_TAG "ThroughputTestService"
+
+#ifdef CONFIG_BLE_THROUGHPUT_TEST_PRIORITY
+#define THROUGHPUT_TEST_PRIORITY (CONFIG_BLE_THROUGHPUT_TEST_PRIORITY)
+#else
+#define THROUGHPUT_TEST_PRIORITY (5)
+#endif
+
+#ifdef CONFIG_BLE_THROUGHPUT_TEST_STACK_SIZE
+#define THROUGHPUT_TEST_STACK_SIZE (CONFIG_BLE_THROUGHPUT_TEST_STACK_SIZE)
+#else
+#define THROUGHPUT_TEST_STACK_SIZE (3072)
+#endif
+
+#define THROUGHPUT_TEST_IDLE_MS (100)
+#define THROUGHPUT_TEST_BURST (16)
+
+namespace Esp32
+{
+
+ThroughputTestService::ThroughputTestService(
+    const BleServiceUuid& serviceId,
+    const BleUuid& sinkCharacteristicId,
+    const BleUuid& sourceCharacteristicId,
+    const BleUuid& statisticsCharacteristicId):
+    GattsService(serviceId),
+    m_sinkCharacteristic(sinkCharacteristicId, NOTIFICATION_VALUE_LENGTH_MAX, ESP_GATT_PERM_WRITE, "Sink"),
+    m_sourceCharacteristic(sourceCharacteristicId, NOTIFICATION_VALUE_LENGTH_MAX, 0, "Source"),
+    m_statisticsCharacteristic(
+        statisticsCharacteristicId,
+        THROUGHPUT_TEST_STATISTICS_LENGTH,
+        ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        "Statistics"),
+    m_sinkSynchronized(0),
+    m_congested(0),
+    m_sourceResetRequested(false),
+    m_task(nullptr)
+{
+    memset(m_sinkSequences, 0, sizeof(m_sinkSequences));
+    memset(m_sourceSequences, 0, sizeof(m_sourceSequences));
+    memset(m_buffer, 0x55, sizeof(m_buffer));
+
+    m_sinkCharacteristic.setWriteWithoutResponse(true);
+    m_sourceCharacteristic.setNotification(GenericGattCharacteristic::Notification::NOTIFY);
+    addCharacteristic(&m_sinkCharacteristic);
+    addCharacteristic(&m_sourceCharacteristic);
+    addCharacteristic(&m_statisticsCharacteristic);
+}
+
+ThroughputTestService::~ThroughputTestService()
+{
+}
+
+void ThroughputTestService::start(void)
+{
+    ESP_LOGD(LOG_TAG, "ThroughputTestService::start()");
+
+    if (m_task)
+    {
+        return;
+    }
+
+    if (xTaskCreate(task, "ble_tput", THROUGHPUT_TEST_STACK_SIZE, this, THROUGHPUT_TEST_PRIORITY, &m_task) != pdPASS)
+    {
+        throw std::runtime_error("error creating the throughput test task");
+    }
+}
+
+void ThroughputTestService::readCharacteristic(
+    uint16_t connectionId,
+    uint16_t handle,
+    uint16_t offset,
+    uint8_t* buffer,
+    uint16_t* length)
+{
+    if (handle != m_statisticsCharacteristic.handle())
+    {
+        GattsService::readCharacteristic(connectionId, handle, offset, buffer, length);
+        return;
+    }
+
+    if (offset)
+    {
+        throw std::out_of_range("read offset not supported");
+    }
+
+    auto timestamp = now();
+    uint32_t statistics[THROUGHPUT_TEST_STATISTICS_LENGTH / sizeof(uint32_t)] = {
+        m_sinkMeter.bytes(),
+        m_sinkMeter.packets(),
+        m_sinkMeter.drops(),
+        m_sinkMeter.kbps(timestamp),
+        m_sourceMeter.bytes(),
+        m_sourceMeter.packets(),
+        m_sourceMeter.drops(),
+        m_sourceMeter.kbps(timestamp),
+    };
+    memcpy(buffer, statistics, sizeof(statistics));
+    *length = sizeof(statistics);
+}
+
+void ThroughputTestService::writeCharacteristic(
+    uint16_t connectionId,
+    uint16_t handle,
+    const uint8_t* buffer,
+    uint16_t length)
+{
+    if (handle == m_sinkCharacteristic.handle())
+    {
+        receive(connectionId, buffer, length);
+    }
+    else if (handle == m_statisticsCharacteristic.handle())
+    {
+        // the sink is fed by this task, the source by the source task which resets its meter on the next round
+        m_sinkMeter.reset();
+        m_sinkSynchronized = 0;
+        m_sourceResetRequested.store(true);
+        if (m_task)
+        {
+            xTaskNotifyGive(m_task);
+        }
+    }
+    else
+    {
+        GattsService::writeCharacteristic(connectionId, handle, buffer, length);
+    }
+}
+
+void ThroughputTestService::clearClientConfigurations(uint16_t connectionId)
+{
+    GattsService::clearClientConfigurations(connectionId);
+
+    if (connectionId < GATT_CONNECTIONS_MAX)
+    {
+        m_sinkSynchronized &= ~(1u << connectionId);
+        m_sourceSequences[connectionId] = 0;
+        m_congested.fetch_and(~(1u << connectionId));
+    }
+}
+
+void ThroughputTestService::congestionChanged(uint16_t connectionId, bool congested)
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        return;
+    }
+
+    if (congested)
+    {
+        m_congested.fetch_or(1u << connectionId);
+    }
+    else
+    {
+        m_congested.fetch_and(~(1u << connectionId));
+        if (m_task)
+        {
+            xTaskNotifyGive(m_task);
+        }
+    }
+}
+
+const ThroughputMeter& ThroughputTestService::sinkMeter(void) const
+{
+    return m_sinkMeter;
+}
+
+const ThroughputMeter& ThroughputTestService::sourceMeter(void) const
+{
+    return m_sourceMeter;
+}
+
+void ThroughputTestService::dumpStatistics(void) const
+{
+    auto timestamp = now();
+    ESP_LOGI(
+        LOG_TAG,
+        "sink: %u bytes, %u packets, %u dropped, %u kbps",
+        m_sinkMeter.bytes(),
+        m_sinkMeter.packets(),
+        m_sinkMeter.drops(),
+        m_sinkMeter.kbps(timestamp));
+    ESP_LOGI(
+        LOG_TAG,
+        "source: %u bytes, %u packets, %u dropped, %u kbps",
+        m_sourceMeter.bytes(),
+        m_sourceMeter.packets(),
+        m_sourceMeter.drops(),
+        m_sourceMeter.kbps(timestamp));
+}
+
+void ThroughputTestService::receive(uint16_t connectionId, const uint8_t* buffer, uint16_t length)
+{
+    if (connectionId >= GATT_CONNECTIONS_MAX)
+    {
+        throw std::invalid_argument("connection id out of range");
+    }
+
+    // writes are handled by the Bluetooth task only, thus the sequence bookkeeping needs no synchronisation
+    if (length >= sizeof(uint32_t))
+    {
+        uint32_t sequence;
+        memcpy(&sequence, buffer, sizeof(sequence));
+
+        auto mask = 1u << connectionId;
+        if ((m_sinkSynchronized & mask) && sequence > m_sinkSequences[connectionId])
+        {
+            m_sinkMeter.addDrops(sequence - m_sinkSequences[connectionId]);
+        }
+        m_sinkSequences[connectionId] = sequence + 1;
+        m_sinkSynchronized |= mask;
+    }
+
+    m_sinkMeter.add(length, now());
+}
+
+void ThroughputTestService::run(void)
+{
+    for (unsigned int sent = 0;;)
+    {
+        if (m_sourceResetRequested.exchange(false))
+        {
+            m_sourceMeter.reset();
+        }
+
+        auto subscribers = m_sourceCharacteristic.subscribers() & ~m_congested.load();
+        if (!subscribers)
+        {
+            // woken up early once a congestion clears, new subscribers are noticed by polling
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(THROUGHPUT_TEST_IDLE_MS));
+            continue;
+        }
+
+        while (subscribers)
+        {
+            uint16_t connectionId = __builtin_ctz(subscribers);
+            subscribers &= subscribers - 1;
+
+            auto length = NotificationDispatcher::instance()->payloadLength(1u << connectionId);
+            memcpy(m_buffer, &m_sourceSequences[connectionId], sizeof(uint32_t));
+            if (!NotificationDispatcher::sendValue(&m_sourceCharacteristic, connectionId, m_buffer, length, false))
+            {
+                // the queue towards the controller is full, give it a tick to drain
+                m_sourceMeter.addDrops(1);
+                vTaskDelay(1);
+                continue;
+            }
+
+            ++m_sourceSequences[connectionId];
+            m_sourceMeter.add(length, now());
+        }
+
+        // let lower priority tasks run even if the stack never reports congestion
+        if (++sent % THROUGHPUT_TEST_BURST == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+}
+
+uint32_t ThroughputTestService::now(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+void ThroughputTestService::task(void* parameter)
+{
+    ((ThroughputTestService*) parameter)->run();
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,82 @@
+#ifndef MAIN_THROUGHPUTTESTSERVICE_HPP_
+#define MAIN_THROUGHPUTTESTSERVICE_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "GattsService.hpp"
+#include "NotificationDispatcher.hpp"
+#include "ThroughputMeter.hpp"
+
+#define THROUGHPUT_TEST_STATISTICS_LENGTH (32)
+
+namespace Esp32
+{
+
+/*
+ * Optional service measuring the GATT throughput of a link, e.g. to compare MTU, connection interval and PHY settings.
+ *
+ * Sink: clients flood it with Write Without Response, the first four bytes of each write should be a sequence
+ * number (u32, incremented per write) so gaps can be counted as drops.
+ * Source: once start() was called, subscribed clients receive notifications as fast as the stack accepts them,
+ * paused while the link reports congestion. Each payload is MTU-3 bytes long and starts with a u32 sequence number.
+ * Statistics: reading returns bytes, packets, drops and kbps (rolling window, see ThroughputMeter) of the sink
+ * followed by the source (u32 each), writing any value resets the counters. The source counters are reset by the
+ * source task itself, the only task adding to them, so a reset never races with a notification being counted.
+ */
+class ThroughputTestService: public GattsService
+{
+public:
+    ThroughputTestService(
+        const BleServiceUuid& serviceId,
+        const BleUuid& sinkCharacteristicId,
+        const BleUuid& sourceCharacteristicId,
+        const BleUuid& statisticsCharacteristicId);
+    virtual ~ThroughputTestService();
+
+    void start(void);
+
+    void readCharacteristic(
+        uint16_t connectionId,
+        uint16_t handle,
+        uint16_t offset,
+        uint8_t* buffer,
+        uint16_t* length) override;
+    void writeCharacteristic(uint16_t connectionId, uint16_t handle, const uint8_t* buffer, uint16_t length) override;
+    void clearClientConfigurations(uint16_t connectionId) override;
+    void congestionChanged(uint16_t connectionId, bool congested) override;
+
+    const ThroughputMeter& sinkMeter(void) const;
+    const ThroughputMeter& sourceMeter(void) const;
+    void dumpStatistics(void) const;
+
+protected:
+
+    GenericGattCharacteristic m_sinkCharacteristic;
+    GenericGattCharacteristic m_sourceCharacteristic;
+    GenericGattCharacteristic m_statisticsCharacteristic;
+
+    ThroughputMeter m_sinkMeter;
+    ThroughputMeter m_sourceMeter;
+    uint32_t m_sinkSequences[GATT_CONNECTIONS_MAX];
+    uint32_t m_sinkSynchronized;
+    uint32_t m_sourceSequences[GATT_CONNECTIONS_MAX];
+    std::atomic<uint32_t> m_congested;
+    std::atomic<bool> m_sourceResetRequested;
+
+    TaskHandle_t m_task;
+    uint8_t m_buffer[NOTIFICATION_VALUE_LENGTH_MAX];
+
+    void receive(uint16_t connectionId, const uint8_t* buffer, uint16_t length);
+    void run(void);
+
+    static uint32_t now(void);
+    static void task(void* parameter);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_THROUGHPUTTESTSERVICE_HPP_ */
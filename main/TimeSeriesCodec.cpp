@@ -0,0 +1,155 @@
+#include "TimeSeriesCodec.hpp"
+
+namespace Esp32
+{
+
+TimeSeriesCodec::TimeSeriesCodec(bool timestamps):
+    m_timestamps(timestamps),
+    m_previousSample(0),
+    m_previousTimestamp(0)
+{
+}
+
+TimeSeriesCodec::~TimeSeriesCodec()
+{
+}
+
+bool TimeSeriesCodec::timestamps(void) const
+{
+    return m_timestamps;
+}
+
+uint16_t TimeSeriesCodec::maximumEncodedSize(void) const
+{
+    // flags byte of a new batch plus the worst case varints of one sample
+    return 1 + TIME_SERIES_VARINT_LENGTH_MAX * (m_timestamps ? 2 : 1);
+}
+
+uint16_t TimeSeriesCodec::encode(uint8_t* destination, bool firstOfBatch, int32_t sample, uint32_t timestamp)
+{
+    uint16_t length = 0;
+    if (firstOfBatch)
+    {
+        // keyframe: the running values restart from zero so every batch decodes on its own
+        destination[length++] = m_timestamps ? TIME_SERIES_FLAG_TIMESTAMPS : 0;
+        m_previousSample = 0;
+        m_previousTimestamp = 0;
+    }
+
+    length += encodeVarint(
+        destination + length,
+        zigZagEncode((int32_t) ((uint32_t) sample - (uint32_t) m_previousSample)));
+    m_previousSample = sample;
+
+    if (m_timestamps)
+    {
+        length += encodeVarint(destination + length, timestamp - m_previousTimestamp);
+        m_previousTimestamp = timestamp;
+    }
+    return length;
+}
+
+uint16_t TimeSeriesCodec::encodeVarint(uint8_t* destination, uint32_t value)
+{
+    uint16_t length = 0;
+    while (value >= 0x80)
+    {
+        destination[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    destination[length++] = (uint8_t) value;
+    return length;
+}
+
+uint16_t TimeSeriesCodec::decodeVarint(const uint8_t* source, uint16_t length, uint32_t* value)
+{
+    uint32_t result = 0;
+    for (uint16_t i = 0; i < length && i < TIME_SERIES_VARINT_LENGTH_MAX; ++i)
+    {
+        // the fifth byte holds bits 28 to 31 only
+        if (i == TIME_SERIES_VARINT_LENGTH_MAX - 1 && source[i] > 0x0f)
+        {
+            return 0;
+        }
+
+        result |= (uint32_t) (source[i] & 0x7f) << (7 * i);
+        if (!(source[i] & 0x80))
+        {
+            // a zero last byte is padding, the encoder would have stopped a byte earlier
+            if (i && !source[i])
+            {
+                return 0;
+            }
+            *value = result;
+            return i + 1;
+        }
+    }
+    // truncated or overlong
+    return 0;
+}
+
+uint32_t TimeSeriesCodec::zigZagEncode(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+int32_t TimeSeriesCodec::zigZagDecode(uint32_t value)
+{
+    return (int32_t) ((value >> 1) ^ (0u - (value & 1)));
+}
+
+int TimeSeriesCodec::decode(
+    const uint8_t* payload,
+    uint16_t length,
+    int32_t* samples,
+    uint32_t* timestamps,
+    int maximumSamples)
+{
+    if (!payload || !samples || !length)
+    {
+        return -1;
+    }
+
+    auto withTimestamps = (payload[0] & TIME_SERIES_FLAG_TIMESTAMPS) != 0;
+    uint16_t offset = 1;
+    uint32_t sample = 0;
+    uint32_t timestamp = 0;
+    int numberOfSamples = 0;
+
+    while (offset < length)
+    {
+        if (numberOfSamples >= maximumSamples)
+        {
+            return -1;
+        }
+
+        uint32_t value;
+        auto consumed = decodeVarint(payload + offset, length - offset, &value);
+        if (!consumed)
+        {
+            return -1;
+        }
+        offset += consumed;
+        sample += (uint32_t) zigZagDecode(value);
+        samples[numberOfSamples] = (int32_t) sample;
+
+        if (withTimestamps)
+        {
+            consumed = decodeVarint(payload + offset, length - offset, &value);
+            if (!consumed)
+            {
+                return -1;
+            }
+            offset += consumed;
+            timestamp += value;
+            if (timestamps)
+            {
+                timestamps[numberOfSamples] = timestamp;
+            }
+        }
+        ++numberOfSamples;
+    }
+    return numberOfSamples;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,66 @@
+#ifndef MAIN_TIMESERIESCODEC_HPP_
+#define MAIN_TIMESERIESCODEC_HPP_
+
+#include <stdint.h>
+
+#define TIME_SERIES_VARINT_LENGTH_MAX (5)
+#define TIME_SERIES_FLAG_TIMESTAMPS (0x01)
+
+namespace Esp32
+{
+
+/*
+ * Encoding of int32_t sample series used by TimeSeriesGattCharacteristic. Each batch is self-contained:
+ *
+ *   flags        1 byte, bit 0 (TIME_SERIES_FLAG_TIMESTAMPS) set if timestamps are included
+ *   keyframe     zig-zag varint of the first sample
+ *   [timestamp]  varint of the first timestamp (microseconds since boot, truncated to 32 bits)
+ *   then for every following sample:
+ *   delta        zig-zag varint of (sample - previous sample), computed modulo 2^32
+ *   [timestamp]  varint of (timestamp - previous timestamp) in microseconds, modulo 2^32
+ *
+ * A varint stores 7 bits per byte, least significant group first, bit 7 is set on all bytes but the last one. It
+ * takes at most 5 bytes; the encoder never emits a zero last byte after a first one, nor bits above bit 31 in the
+ * fifth byte, and the decoder rejects such overlong varints. A zig-zag value z maps back to the signed value
+ * (z >> 1) ^ -(z & 1). To decode, read the flags, then read (value [, timestamp]) pairs until the end of the payload,
+ * keeping running sums for samples after the keyframe. The number of samples is implied by the payload length.
+ * decode() is a reference implementation.
+ *
+ * Slowly changing values need one byte per sample instead of four, with timestamps usually three instead of eight.
+ * The codec has no ESP-IDF dependencies, test/host checks and benchmarks it.
+ */
+class TimeSeriesCodec
+{
+public:
+    TimeSeriesCodec(bool timestamps = false);
+    virtual ~TimeSeriesCodec();
+
+    bool timestamps(void) const;
+    uint16_t maximumEncodedSize(void) const;
+    uint16_t encode(uint8_t* destination, bool firstOfBatch, int32_t sample, uint32_t timestamp);
+
+    static uint16_t encodeVarint(uint8_t* destination, uint32_t value);
+    static uint16_t decodeVarint(const uint8_t* source, uint16_t length, uint32_t* value);
+    static uint32_t zigZagEncode(int32_t value);
+    static int32_t zigZagDecode(uint32_t value);
+
+    static int decode(
+        const uint8_t* payload,
+        uint16_t length,
+        int32_t* samples,
+        uint32_t* timestamps,
+        int maximumSamples);
+
+protected:
+
+    bool m_timestamps;
+    int32_t m_previousSample;
+    uint32_t m_previousTimestamp;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_TIMESERIESCODEC_HPP_ */
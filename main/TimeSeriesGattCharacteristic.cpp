@@ -0,0 +1,64 @@
+#include <esp_log.h>
+#include "TimeSeriesGattCharacteristic.hpp"
+
+#define LOG_TAG "TimeSeriesGattCharacteristic"
+
+namespace Esp32
+{
+
+TimeSeriesGattCharacteristic::TimeSeriesGattCharacteristic(
+    const BleUuid& characteristicId,
+    Sampler sampler,
+    void* samplerContext,
+    uint8_t* buffer,
+    uint16_t bufferSize,
+    bool timestamps,
+    const char* description):
+    SampledGattCharacteristic(
+        characteristicId,
+        sizeof(int32_t),
+        sampler,
+        samplerContext,
+        buffer,
+        bufferSize,
+        description),
+    m_codec(timestamps)
+{
+}
+
+TimeSeriesGattCharacteristic::~TimeSeriesGattCharacteristic()
+{
+}
+
+bool TimeSeriesGattCharacteristic::timestamps(void) const
+{
+    return m_codec.timestamps();
+}
+
+int TimeSeriesGattCharacteristic::compressionRatio(void) const
+{
+    // raw size of the flushed samples in percent of their encoded size
+    uint64_t rawBytes = (uint64_t) m_statistics.flushedSamples * (m_codec.timestamps() ? 8 : 4);
+    return m_statistics.flushedBytes ? (int) ((rawBytes * 100) / m_statistics.flushedBytes) : 0;
+}
+
+void TimeSeriesGattCharacteristic::dumpStatistics(void) const
+{
+    SampledGattCharacteristic::dumpStatistics();
+    ESP_LOGI(LOG_TAG, "compression ratio %d%%", compressionRatio());
+}
+
+uint16_t TimeSeriesGattCharacteristic::maximumEncodedSize(void) const
+{
+    return m_codec.maximumEncodedSize();
+}
+
+uint16_t TimeSeriesGattCharacteristic::encodeSample(uint8_t* destination, bool firstOfBatch, int64_t timestamp)
+{
+    int32_t sample;
+    m_sampler(m_samplerContext, (uint8_t*) &sample);
+
+    return m_codec.encode(destination, firstOfBatch, sample, (uint32_t) timestamp);
+}
+
+} /* namespace Esp32 */
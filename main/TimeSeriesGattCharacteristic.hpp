@@ -0,0 +1,48 @@
+#ifndef MAIN_TIMESERIESGATTCHARACTERISTIC_HPP_
+#define MAIN_TIMESERIESGATTCHARACTERISTIC_HPP_
+
+#include "SampledGattCharacteristic.hpp"
+#include "TimeSeriesCodec.hpp"
+
+namespace Esp32
+{
+
+/*
+ * Sampled characteristic which compresses a series of int32_t samples (the sampler writes one int32_t, narrower
+ * sensor values are widened by the sampler). Each notification carries one self-contained batch, keyframe plus
+ * zig-zag varint deltas and optional timestamps; see TimeSeriesCodec for the encoding and a reference decoder.
+ *
+ * compressionRatio() relates the raw size of the samples of all batches handed over for sending to their encoded
+ * size, dropped batches and the batch being filled are not taken into account.
+ */
+class TimeSeriesGattCharacteristic: public SampledGattCharacteristic
+{
+public:
+    TimeSeriesGattCharacteristic(
+        const BleUuid& characteristicId,
+        Sampler sampler,
+        void* samplerContext,
+        uint8_t* buffer,
+        uint16_t bufferSize,
+        bool timestamps = false,
+        const char* description = nullptr);
+    virtual ~TimeSeriesGattCharacteristic();
+
+    bool timestamps(void) const;
+    int compressionRatio(void) const;
+    void dumpStatistics(void) const override;
+
+protected:
+
+    TimeSeriesCodec m_codec;
+
+    uint16_t maximumEncodedSize(void) const override;
+    uint16_t encodeSample(uint8_t* destination, bool firstOfBatch, int64_t timestamp) override;
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_TIMESERIESGATTCHARACTERISTIC_HPP_ */
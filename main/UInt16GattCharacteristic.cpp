@@ -21,8 +21,10 @@ UInt16GattCharacteristic::~UInt16GattCharacteristic()
 
 void UInt16GattCharacteristic::read(uint8_t* buffer, uint16_t* length)
 {
+    auto value = m_value.load();
+
     *length = m_length;
-    memcpy(buffer, &m_value, m_length);
+    memcpy(buffer, &value, m_length);
 }
 
 void UInt16GattCharacteristic::write(const uint8_t* buffer, uint16_t length)
@@ -32,7 +34,37 @@ void UInt16GattCharacteristic::write(const uint8_t* buffer, uint16_t length)
         throw std::invalid_argument("invalid length");
     }
 
-    memcpy(&m_value, buffer, length);
+    uint16_t value;
+    memcpy(&value, buffer, length);
+    m_value.store(value);
+    journalChange(buffer, length);
+}
+
+uint16_t UInt16GattCharacteristic::value(void) const
+{
+    return m_value.load();
+}
+
+void UInt16GattCharacteristic::setValue(uint16_t value)
+{
+    m_value.store(value);
+    journalChange((const uint8_t*) &value, sizeof(value));
+    if (m_notification != Notification::NONE)
+    {
+        notify();
+    }
+}
+
+void UInt16GattCharacteristic::setValueFromIsr(uint16_t value)
+{
+    m_value.store(value);
+    journalChange((const uint8_t*) &value, sizeof(value));
+    notifyFromIsr();
+}
+
+size_t UInt16GattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this);
 }
 
 } /* namespace Esp32 */
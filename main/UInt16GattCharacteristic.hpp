@@ -2,6 +2,7 @@
 #define MAIN_UINT16GATTCHARACTERISTIC_HPP_
 
 #include "GenericGattCharacteristic.hpp"
+#include "SeqLockValue.hpp"
 
 namespace Esp32
 {
@@ -18,10 +19,15 @@ public:
 
     void read(uint8_t* buffer, uint16_t* length) override;
     void write(const uint8_t* buffer, uint16_t length) override;
+    size_t objectSize(void) const override;
+
+    uint16_t value(void) const;
+    void setValue(uint16_t value);
+    void setValueFromIsr(uint16_t value);
 
 protected:
 
-    uint16_t m_value;
+    SeqLockValue<uint16_t> m_value;
 
 private:
 
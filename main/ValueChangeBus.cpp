@@ -0,0 +1,247 @@
+#include <esp_log.h>
+#include <string.h>
+#include <stdexcept>
+#include "ValueChangeBus.hpp"
+
+#define LOG_TAG "ValueChangeBus"
+
+namespace Esp32
+{
+
+static ValueChangeBus valueChangeBus;
+
+ValueChangeBus::ValueChangeBus():
+    m_storage(),
+    m_writePosition(0),
+    m_subscribers(),
+    m_subscribersLock(portMUX_INITIALIZER_UNLOCKED),
+    m_sequence(0),
+    m_droppedChanges(0)
+{
+    static_assert(
+        !(VALUE_CHANGE_BUS_SIZE & (VALUE_CHANGE_BUS_SIZE - 1)) && VALUE_CHANGE_BUS_SIZE >= 4 * sizeof(Record),
+        "value change bus size is not a power of two");
+
+    for (auto& subscriber: m_subscribers)
+    {
+        subscriber.active.store(false);
+        subscriber.readPosition.store(0);
+    }
+}
+
+ValueChangeBus::~ValueChangeBus()
+{
+}
+
+int ValueChangeBus::subscribe(Handler handler, void* context)
+{
+    if (!handler)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    int subscription = -1;
+    portENTER_CRITICAL(&m_subscribersLock);
+    for (int i = 0; i < VALUE_CHANGE_SUBSCRIBERS_MAX; ++i)
+    {
+        auto& subscriber = m_subscribers[i];
+        if (!subscriber.active.load(std::memory_order_relaxed))
+        {
+            // changes published before are not delivered
+            subscriber.handler = handler;
+            subscriber.context = context;
+            subscriber.task = xTaskGetCurrentTaskHandle();
+            subscriber.readPosition.store(m_writePosition.load(std::memory_order_acquire), std::memory_order_relaxed);
+            subscriber.active.store(true, std::memory_order_release);
+            subscription = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_subscribersLock);
+
+    if (subscription < 0)
+    {
+        throw std::runtime_error("too many value change subscribers");
+    }
+    return subscription;
+}
+
+void ValueChangeBus::unsubscribe(int subscription)
+{
+    if (subscription < 0 || subscription >= VALUE_CHANGE_SUBSCRIBERS_MAX)
+    {
+        throw std::out_of_range("subscription out of range");
+    }
+
+    portENTER_CRITICAL(&m_subscribersLock);
+    m_subscribers[subscription].active.store(false, std::memory_order_release);
+    portEXIT_CRITICAL(&m_subscribersLock);
+}
+
+size_t ValueChangeBus::dispatch(int subscription, TickType_t timeout)
+{
+    if (subscription < 0 || subscription >= VALUE_CHANGE_SUBSCRIBERS_MAX)
+    {
+        throw std::out_of_range("subscription out of range");
+    }
+
+    auto& subscriber = m_subscribers[subscription];
+    if (!subscriber.active.load(std::memory_order_acquire))
+    {
+        throw std::runtime_error("not subscribed");
+    }
+
+    // a notification left from changes delivered by the previous call is consumed without waiting
+    auto readPosition = subscriber.readPosition.load(std::memory_order_relaxed);
+    ulTaskNotifyTake(pdTRUE, readPosition == m_writePosition.load(std::memory_order_acquire) ? timeout : 0);
+
+    size_t delivered = 0;
+    while (readPosition != m_writePosition.load(std::memory_order_acquire))
+    {
+        uint32_t tail = VALUE_CHANGE_BUS_SIZE - (readPosition & (VALUE_CHANGE_BUS_SIZE - 1));
+        auto record = this->record(readPosition);
+
+        if (tail < sizeof(Record) || !record->characteristic)
+        {
+            // padding up to the end of the storage, records never wrap around
+            readPosition += tail;
+        }
+        else
+        {
+            ValueChange change = {
+                record->characteristic,
+                record->sequence,
+                record->connectionId,
+                record->handle,
+                record->offset,
+                record->length,
+                (const uint8_t*) (record + 1)};
+            subscriber.handler(subscriber.context, change);
+            ++delivered;
+            readPosition += recordSize(change.length);
+        }
+
+        // the space is released only after the handler returned, so the value stays valid meanwhile
+        subscriber.readPosition.store(readPosition, std::memory_order_release);
+    }
+
+    return delivered;
+}
+
+void ValueChangeBus::publish(
+    GenericGattCharacteristic* characteristic,
+    uint16_t connectionId,
+    uint16_t offset,
+    const uint8_t* value,
+    uint16_t length)
+{
+    if (!characteristic || (!value && length))
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    auto writePosition = m_writePosition.load(std::memory_order_relaxed);
+    uint32_t space;
+    if (!freeSpace(writePosition, &space))
+    {
+        return;
+    }
+
+    auto sequence = m_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    auto size = recordSize(length);
+    uint32_t tail = VALUE_CHANGE_BUS_SIZE - (writePosition & (VALUE_CHANGE_BUS_SIZE - 1));
+    uint32_t padding = tail < size ? tail : 0;
+
+    if (padding + size > space)
+    {
+        m_droppedChanges.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGD(LOG_TAG, "change %u of handle %u dropped", (unsigned) sequence, characteristic->handle());
+        return;
+    }
+
+    if (padding)
+    {
+        if (tail >= sizeof(Record))
+        {
+            record(writePosition)->characteristic = nullptr;
+        }
+        writePosition += padding;
+    }
+
+    auto record = this->record(writePosition);
+    record->characteristic = characteristic;
+    record->sequence = sequence;
+    record->connectionId = connectionId;
+    record->handle = characteristic->handle();
+    record->offset = offset;
+    record->length = length;
+    memcpy(record + 1, value, length);
+    m_writePosition.store(writePosition + size, std::memory_order_release);
+
+    // the tasks are woken outside of the critical section
+    TaskHandle_t tasks[VALUE_CHANGE_SUBSCRIBERS_MAX];
+    size_t numberOfTasks = 0;
+    portENTER_CRITICAL(&m_subscribersLock);
+    for (auto& subscriber: m_subscribers)
+    {
+        if (subscriber.active.load(std::memory_order_relaxed) && subscriber.task)
+        {
+            tasks[numberOfTasks++] = subscriber.task;
+        }
+    }
+    portEXIT_CRITICAL(&m_subscribersLock);
+
+    for (size_t i = 0; i < numberOfTasks; ++i)
+    {
+        xTaskNotifyGive(tasks[i]);
+    }
+}
+
+uint32_t ValueChangeBus::sequence(void) const
+{
+    return m_sequence.load(std::memory_order_relaxed);
+}
+
+uint32_t ValueChangeBus::droppedChanges(void) const
+{
+    return m_droppedChanges.load(std::memory_order_relaxed);
+}
+
+ValueChangeBus* ValueChangeBus::instance(void)
+{
+    return &valueChangeBus;
+}
+
+bool ValueChangeBus::freeSpace(uint32_t writePosition, uint32_t* space) const
+{
+    // the slowest subscriber determines the space left
+    bool subscribed = false;
+    uint32_t used = 0;
+    for (auto& subscriber: m_subscribers)
+    {
+        if (subscriber.active.load(std::memory_order_acquire))
+        {
+            auto subscriberUsed = writePosition - subscriber.readPosition.load(std::memory_order_acquire);
+            if (subscriberUsed > used)
+            {
+                used = subscriberUsed;
+            }
+            subscribed = true;
+        }
+    }
+
+    *space = VALUE_CHANGE_BUS_SIZE - used;
+    return subscribed;
+}
+
+ValueChangeBus::Record* ValueChangeBus::record(uint32_t position)
+{
+    return (Record*) (m_storage + (position & (VALUE_CHANGE_BUS_SIZE - 1)));
+}
+
+uint32_t ValueChangeBus::recordSize(uint16_t length)
+{
+    return sizeof(Record) + ((length + alignof(Record) - 1) & ~(alignof(Record) - 1));
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,111 @@
+#ifndef MAIN_VALUECHANGEBUS_HPP_
+#define MAIN_VALUECHANGEBUS_HPP_
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "GenericGattCharacteristic.hpp"
+
+#ifdef CONFIG_BLE_VALUE_CHANGE_BUS_SIZE
+#define VALUE_CHANGE_BUS_SIZE (CONFIG_BLE_VALUE_CHANGE_BUS_SIZE)
+#else
+#define VALUE_CHANGE_BUS_SIZE (1024)
+#endif
+
+#define VALUE_CHANGE_SUBSCRIBERS_MAX (8)
+
+namespace Esp32
+{
+
+/*
+ * Publishes the values written by clients to subscribers running on their own tasks, so that application code need
+ * not override write() and run within the Bluetooth task.
+ *
+ * GattsService::writeCharacteristic() publishes each accepted write: the value is copied once into a ring buffer and
+ * the tasks of all subscribers are woken by a task notification. Each subscriber calls dispatch() on its own task,
+ * its handler gets the changes in order of arrival with the value by reference into the ring buffer, valid until the
+ * handler returns. Every subscriber has a read position of its own; the space of a change is reused once all of them
+ * are past it. The publisher never waits: a change not fitting into the space left is dropped and counted, which
+ * subscribers notice by a gap in the sequence numbers. Thus a subscriber which does not keep up delays the others.
+ *
+ * Changes are published by the Bluetooth task only, there is a single producer.
+ */
+class ValueChangeBus
+{
+public:
+    struct ValueChange
+    {
+        GenericGattCharacteristic* characteristic;
+        uint32_t sequence;
+        uint16_t connectionId;
+        uint16_t handle;
+        uint16_t offset;
+        uint16_t length;
+        const uint8_t* value;
+    };
+
+    typedef void (*Handler)(void* context, const ValueChange& change);
+
+    ValueChangeBus();
+    virtual ~ValueChangeBus();
+
+    int subscribe(Handler handler, void* context);
+    void unsubscribe(int subscription);
+    size_t dispatch(int subscription, TickType_t timeout = 0);
+
+    void publish(
+        GenericGattCharacteristic* characteristic,
+        uint16_t connectionId,
+        uint16_t offset,
+        const uint8_t* value,
+        uint16_t length);
+
+    uint32_t sequence(void) const;
+    uint32_t droppedChanges(void) const;
+
+    static ValueChangeBus* instance(void);
+
+protected:
+
+    // the value follows the record, padded to the alignment of the next record
+    struct Record
+    {
+        GenericGattCharacteristic* characteristic;
+        uint32_t sequence;
+        uint16_t connectionId;
+        uint16_t handle;
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    struct Subscriber
+    {
+        std::atomic<bool> active;
+        std::atomic<uint32_t> readPosition;
+        Handler handler;
+        void* context;
+        TaskHandle_t task;
+    };
+
+    alignas(Record) uint8_t m_storage[VALUE_CHANGE_BUS_SIZE];
+    std::atomic<uint32_t> m_writePosition;
+    Subscriber m_subscribers[VALUE_CHANGE_SUBSCRIBERS_MAX];
+    portMUX_TYPE m_subscribersLock;
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<uint32_t> m_droppedChanges;
+
+    bool freeSpace(uint32_t writePosition, uint32_t* space) const;
+    Record* record(uint32_t position);
+
+    static uint32_t recordSize(uint16_t length);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_VALUECHANGEBUS_HPP_ */
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <sdkconfig.h>
+#include <stdexcept>
+#include "ValuePool.hpp"
+
+#ifdef CONFIG_BLE_VALUE_POOL_SIZE
+#define VALUE_POOL_SIZE (CONFIG_BLE_VALUE_POOL_SIZE)
+#else
+#define VALUE_POOL_SIZE (1024)
+#endif
+
+namespace Esp32
+{
+
+static ValuePool valuePool;
+
+// no constructor touches these, allocations made before valuePool is constructed are kept
+alignas(4) static uint8_t valuePoolStorage[VALUE_POOL_SIZE];
+static size_t valuePoolUsed;
+
+ValuePool::ValuePool()
+{
+}
+
+ValuePool::~ValuePool()
+{
+}
+
+uint8_t* ValuePool::allocate(size_t size)
+{
+    auto offset = (valuePoolUsed + 3) & ~(size_t) 3;
+    if (offset + size > sizeof(valuePoolStorage))
+    {
+        char buffer[80];
+        snprintf(
+            buffer,
+            sizeof(buffer) - 1,
+            "value pool exhausted (requested %u bytes, %u of %u in use)",
+            (unsigned) size,
+            (unsigned) valuePoolUsed,
+            (unsigned) sizeof(valuePoolStorage));
+        throw std::runtime_error(buffer);
+    }
+
+    valuePoolUsed = offset + size;
+    return valuePoolStorage + offset;
+}
+
+size_t ValuePool::capacity(void) const
+{
+    return sizeof(valuePoolStorage);
+}
+
+size_t ValuePool::used(void) const
+{
+    return valuePoolUsed;
+}
+
+ValuePool* ValuePool::instance(void)
+{
+    return &valuePool;
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,36 @@
+#ifndef MAIN_VALUEPOOL_HPP_
+#define MAIN_VALUEPOOL_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Esp32
+{
+
+/*
+ * Statically allocated storage for characteristic values too large to be kept inline. Buffers are taken once when a
+ * characteristic is constructed and live as long as the program, so there is no release. The storage is plain zero
+ * initialized memory, thus characteristics may be constructed during static initialization.
+ */
+class ValuePool
+{
+public:
+    ValuePool();
+    virtual ~ValuePool();
+
+    uint8_t* allocate(size_t size);
+
+    size_t capacity(void) const;
+    size_t used(void) const;
+
+    static ValuePool* instance(void);
+
+protected:
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_VALUEPOOL_HPP_ */
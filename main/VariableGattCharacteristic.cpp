@@ -0,0 +1,117 @@
+#include <string.h>
+#include <stdexcept>
+#include "ValuePool.hpp"
+#include "VariableGattCharacteristic.hpp"
+
+namespace Esp32
+{
+
+VariableGattCharacteristic::VariableGattCharacteristic(
+    const BleUuid& characteristicId,
+    uint16_t maximumLength,
+    uint16_t permission,
+    const char* description,
+    const uint8_t* initialValue,
+    uint16_t initialValueLength):
+    GenericGattCharacteristic(characteristicId, maximumLength, permission, description),
+    m_value(m_inlineValue),
+    m_valueLength(0),
+    m_lock(portMUX_INITIALIZER_UNLOCKED),
+    m_inlineValue()
+{
+    if (!maximumLength)
+    {
+        throw std::invalid_argument("invalid maximum length");
+    }
+
+    if (maximumLength > VARIABLE_VALUE_INLINE_SIZE)
+    {
+        m_value = ValuePool::instance()->allocate(maximumLength);
+    }
+
+    if (initialValue)
+    {
+        store(initialValue, initialValueLength);
+    }
+}
+
+VariableGattCharacteristic::~VariableGattCharacteristic()
+{
+}
+
+void VariableGattCharacteristic::read(uint8_t* buffer, uint16_t* length)
+{
+    portENTER_CRITICAL_SAFE(&m_lock);
+    *length = m_valueLength;
+    memcpy(buffer, m_value, m_valueLength);
+    portEXIT_CRITICAL_SAFE(&m_lock);
+}
+
+void VariableGattCharacteristic::write(const uint8_t* buffer, uint16_t length)
+{
+    store(buffer, length);
+    journalChange(buffer, length);
+
+    if (m_notification != Notification::NONE)
+    {
+        notify();
+    }
+}
+
+size_t VariableGattCharacteristic::objectSize(void) const
+{
+    return sizeof(*this) + (isInline() ? 0 : m_length);
+}
+
+uint16_t VariableGattCharacteristic::valueLength(void) const
+{
+    portENTER_CRITICAL_SAFE(&m_lock);
+    auto length = m_valueLength;
+    portEXIT_CRITICAL_SAFE(&m_lock);
+    return length;
+}
+
+bool VariableGattCharacteristic::isInline(void) const
+{
+    return m_value == m_inlineValue;
+}
+
+void VariableGattCharacteristic::setValue(const uint8_t* value, uint16_t length)
+{
+    write(value, length);
+}
+
+void VariableGattCharacteristic::setValue(const char* value)
+{
+    if (!value)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    auto length = strlen(value);
+    if (length > m_length)
+    {
+        throw std::length_error("value exceeds the maximum length");
+    }
+    write((const uint8_t*) value, length);
+}
+
+void VariableGattCharacteristic::store(const uint8_t* value, uint16_t length)
+{
+    if (length > m_length)
+    {
+        throw std::length_error("value exceeds the maximum length");
+    }
+
+    if (!value && length)
+    {
+        throw std::invalid_argument("null pointer exception");
+    }
+
+    portENTER_CRITICAL_SAFE(&m_lock);
+    memcpy(m_value, value, length);
+    m_valueLength = length;
+    portEXIT_CRITICAL_SAFE(&m_lock);
+}
+
+} /* namespace Esp32 */
@@ -0,0 +1,60 @@
+#ifndef MAIN_VARIABLEGATTCHARACTERISTIC_HPP_
+#define MAIN_VARIABLEGATTCHARACTERISTIC_HPP_
+
+#include <sdkconfig.h>
+#include <freertos/FreeRTOS.h>
+#include "GenericGattCharacteristic.hpp"
+
+#ifdef CONFIG_BLE_VARIABLE_VALUE_INLINE_SIZE
+#define VARIABLE_VALUE_INLINE_SIZE (CONFIG_BLE_VARIABLE_VALUE_INLINE_SIZE)
+#else
+#define VARIABLE_VALUE_INLINE_SIZE (20)
+#endif
+
+namespace Esp32
+{
+
+/*
+ * String or byte array characteristic with a maximum length (length()) and a current length. Reads return exactly
+ * the current value, writes of up to the maximum length replace it.
+ *
+ * Values with a maximum length of up to VARIABLE_VALUE_INLINE_SIZE bytes are stored inline within the object, larger
+ * ones in a buffer taken from the ValuePool once on construction. Writes never allocate.
+ */
+class VariableGattCharacteristic: public GenericGattCharacteristic
+{
+public:
+    VariableGattCharacteristic(
+        const BleUuid& characteristicId,
+        uint16_t maximumLength,
+        uint16_t permission = ESP_GATT_PERM_READ,
+        const char* description = nullptr,
+        const uint8_t* initialValue = nullptr,
+        uint16_t initialValueLength = 0);
+    virtual ~VariableGattCharacteristic();
+
+    void read(uint8_t* buffer, uint16_t* length) override;
+    void write(const uint8_t* buffer, uint16_t length) override;
+    size_t objectSize(void) const override;
+
+    uint16_t valueLength(void) const;
+    bool isInline(void) const;
+    void setValue(const uint8_t* value, uint16_t length);
+    void setValue(const char* value);
+
+protected:
+
+    uint8_t* m_value;
+    uint16_t m_valueLength;
+    mutable portMUX_TYPE m_lock;
+    uint8_t m_inlineValue[VARIABLE_VALUE_INLINE_SIZE];
+
+    void store(const uint8_t* value, uint16_t length);
+
+private:
+
+};
+
+} /* namespace Esp32 */
+
+#endif /* MAIN_VARIABLEGATTCHARACTERISTIC_HPP_ */
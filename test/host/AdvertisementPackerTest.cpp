@@ -0,0 +1,191 @@
+#include <string.h>
+#include "AdvertisementPacker.hpp"
+#include "HostTest.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+
+typedef AdvertisementPacker::Placement Placement;
+
+#define NAME "Environmental Sensor"
+
+/*
+ * Placement of AD elements by AdvertisementPacker, checked on the raw advertisement and scan response. A 128 bit
+ * service UUID (18 bytes) after the flags (3 bytes) leaves 10 bytes of the advertisement, too few for the complete
+ * name (22 bytes) but enough for a prefix of 8 characters.
+ */
+static const uint8_t serviceUuid[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x01, 0x00, 0x04, 0x21,
+};
+
+struct Packet
+{
+    uint8_t data[ADVERTISEMENT_LENGTH_MAX];
+    AdvertisementWriter writer;
+
+    Packet(size_t capacity = ADVERTISEMENT_LENGTH_MAX):
+        data(),
+        writer(data, capacity)
+    {
+    }
+
+    // the value of the first AD structure of the type, nullptr if there is none
+    const uint8_t* find(uint8_t type, size_t* length) const
+    {
+        size_t offset = 0;
+        while (offset < writer.length())
+        {
+            if (data[offset + 1] == type)
+            {
+                *length = data[offset] - 1;
+                return data + offset + 2;
+            }
+            offset += 1 + data[offset];
+        }
+        return nullptr;
+    }
+
+    bool contains(uint8_t type, const char* value) const
+    {
+        size_t length;
+        auto found = find(type, &length);
+        return found && length == strlen(value) && memcmp(found, value, length) == 0;
+    }
+
+    bool contains(uint8_t type) const
+    {
+        size_t length;
+        return find(type, &length) != nullptr;
+    }
+};
+
+static void addUuid(AdvertisementPacker* packer)
+{
+    packer->add(
+        AdvertisementEncoder::typeCompleteUuids128,
+        serviceUuid,
+        sizeof(serviceUuid),
+        AdvertisementPacker::priorityHigh);
+}
+
+static void testCompleteName(void)
+{
+    Packet advertisement, scanResponse;
+    AdvertisementPacker packer;
+    packer.setFlags(0x06);
+    packer.addName("Sensor", "Sens", AdvertisementPacker::priorityNormal);
+
+    CHECK(packer.pack(&advertisement.writer, &scanResponse.writer) == 0);
+    CHECK(advertisement.data[1] == AdvertisementEncoder::typeFlags && advertisement.data[2] == 0x06);
+    CHECK(advertisement.contains(AdvertisementEncoder::typeCompleteName, "Sensor"));
+    CHECK(!advertisement.contains(AdvertisementEncoder::typeShortenedName));
+    CHECK(scanResponse.writer.length() == 0);
+    CHECK(packer.placement(1) == Placement::ADVERTISEMENT);
+    CHECK(!packer.nameShortened());
+}
+
+static void testPrefix(void)
+{
+    Packet advertisement, scanResponse;
+    AdvertisementPacker packer;
+    packer.setFlags(0x06);
+    addUuid(&packer);
+    packer.addName(NAME, nullptr, AdvertisementPacker::priorityNormal);
+
+    CHECK(packer.pack(&advertisement.writer, &scanResponse.writer) == 0);
+    CHECK(advertisement.writer.length() == ADVERTISEMENT_LENGTH_MAX);
+    CHECK(advertisement.contains(AdvertisementEncoder::typeShortenedName, "Environm"));
+    CHECK(scanResponse.contains(AdvertisementEncoder::typeCompleteName, NAME));
+    CHECK(packer.placement(2) == Placement::SCAN_RESPONSE);
+    CHECK(packer.nameShortened());
+
+    // a prefix shorter than ADVERTISEMENT_PACKER_NAME_LENGTH_MIN is not worth it, 5 bytes leave 3 characters
+    Packet shortAdvertisement(ADVERTISEMENT_LENGTH_MAX - 5), scanResponse2;
+    CHECK(packer.pack(&shortAdvertisement.writer, &scanResponse2.writer) == 0);
+    CHECK(!shortAdvertisement.contains(AdvertisementEncoder::typeShortenedName));
+    CHECK(scanResponse2.contains(AdvertisementEncoder::typeCompleteName, NAME));
+    CHECK(packer.placement(2) == Placement::SCAN_RESPONSE);
+    CHECK(!packer.nameShortened());
+
+    // 6 bytes leave exactly ADVERTISEMENT_PACKER_NAME_LENGTH_MIN characters
+    Packet minimumAdvertisement(ADVERTISEMENT_LENGTH_MAX - 4), scanResponse3;
+    CHECK(packer.pack(&minimumAdvertisement.writer, &scanResponse3.writer) == 0);
+    CHECK(minimumAdvertisement.contains(AdvertisementEncoder::typeShortenedName, "Envi"));
+    CHECK(packer.nameShortened());
+}
+
+static void testShortName(void)
+{
+    Packet advertisement, scanResponse;
+    AdvertisementPacker packer;
+    packer.setFlags(0x06);
+    addUuid(&packer);
+    packer.addName(NAME, "EnvS", AdvertisementPacker::priorityNormal);
+
+    CHECK(packer.pack(&advertisement.writer, &scanResponse.writer) == 0);
+    CHECK(advertisement.contains(AdvertisementEncoder::typeShortenedName, "EnvS"));
+    CHECK(!advertisement.contains(AdvertisementEncoder::typeCompleteName));
+    CHECK(scanResponse.contains(AdvertisementEncoder::typeCompleteName, NAME));
+    CHECK(packer.placement(2) == Placement::SCAN_RESPONSE);
+    CHECK(packer.nameShortened());
+}
+
+static void testFlags(void)
+{
+    // e.g. the advertisement is given by the application, the flags must not move to the scan response
+    Packet advertisement(0), scanResponse;
+    AdvertisementPacker packer;
+    packer.setFlags(0x06);
+    addUuid(&packer);
+
+    CHECK(packer.pack(&advertisement.writer, &scanResponse.writer) == 1);
+    CHECK(packer.placement(0) == Placement::DROPPED);
+    CHECK(!scanResponse.contains(AdvertisementEncoder::typeFlags));
+    CHECK(packer.placement(1) == Placement::SCAN_RESPONSE);
+    CHECK(scanResponse.contains(AdvertisementEncoder::typeCompleteUuids128));
+}
+
+static void testDropped(void)
+{
+    const uint8_t manufacturerData[24] = { 0xe5, 0x02 };
+    const uint8_t serviceData[8] = { 0x0f, 0x18 };
+
+    Packet advertisement, scanResponse;
+    AdvertisementPacker packer;
+    packer.setFlags(0x06);
+    addUuid(&packer);
+    packer.add(
+        AdvertisementEncoder::typeManufacturerData,
+        manufacturerData,
+        sizeof(manufacturerData),
+        AdvertisementPacker::priorityHigh);
+    packer.addName(NAME, nullptr, AdvertisementPacker::priorityNormal);
+    packer.add(
+        AdvertisementEncoder::typeServiceData16,
+        serviceData,
+        sizeof(serviceData),
+        AdvertisementPacker::priorityLow);
+
+    // the advertisement takes a prefix of the name, the scan response has 5 bytes left after the manufacturer data
+    CHECK(packer.pack(&advertisement.writer, &scanResponse.writer) == 2);
+    CHECK(packer.placement(0) == Placement::ADVERTISEMENT);
+    CHECK(packer.placement(1) == Placement::ADVERTISEMENT);
+    CHECK(packer.placement(2) == Placement::SCAN_RESPONSE);
+    CHECK(advertisement.contains(AdvertisementEncoder::typeShortenedName, "Environm"));
+    CHECK(!scanResponse.contains(AdvertisementEncoder::typeCompleteName));
+    CHECK(packer.placement(3) == Placement::DROPPED);
+    CHECK(packer.nameShortened());
+    CHECK(packer.placement(4) == Placement::DROPPED);
+}
+
+int main(int argc, char** argv)
+{
+    testCompleteName();
+    testPrefix();
+    testShortName();
+    testFlags();
+    testDropped();
+
+    return HostTest::result();
+}
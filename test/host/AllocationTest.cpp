@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "BleServer.hpp"
+#include "FakeBleStack.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HostTest.hpp"
+#include "NotificationDispatcher.hpp"
+#include "ValuePool.hpp"
+#include "VariableGattCharacteristic.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+using HostTest::FakeBleStack;
+
+#define WRITES (1000)
+
+/*
+ * Proves that writes to VariableGattCharacteristic do not allocate: the global operator new is replaced by one which
+ * counts the calls of the thread under test. Values of up to VARIABLE_VALUE_INLINE_SIZE bytes are stored inline,
+ * larger ones in a buffer taken from the ValuePool on construction. Writes are checked directly and as write requests
+ * through the fake host, the task sending notifications runs on a thread of its own and is not counted. Only
+ * successful writes are covered, a rejected one throws and the exception object is allocated.
+ */
+static thread_local bool counting = false;
+static thread_local size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (counting)
+    {
+        ++allocations;
+    }
+    auto pointer = malloc(size ? size : 1);
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t size) noexcept
+{
+    free(pointer);
+}
+
+static VariableGattCharacteristic inlineValue(
+    BleUuid(BleUuid::Width::UUID_16, 0x4050),
+    VARIABLE_VALUE_INLINE_SIZE,
+    ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+static VariableGattCharacteristic pooledValue(
+    BleUuid(BleUuid::Width::UUID_16, 0x4051),
+    200,
+    ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+    "Pooled");
+static GattsService service(BleServiceUuid(BleUuid::Width::UUID_32, 0x21040001));
+static GattsApplication application(0, "Alloc");
+
+static size_t countWrites(VariableGattCharacteristic* characteristic, uint16_t connectionId, bool request)
+{
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    for (size_t i = 0; i < sizeof(value); ++i)
+    {
+        value[i] = i;
+    }
+
+    size_t failures = 0;
+    allocations = 0;
+    counting = true;
+    for (size_t i = 0; i < WRITES; ++i)
+    {
+        // all lengths up to the maximum, the value buffer is never resized
+        uint16_t length = i % (characteristic->length() + 1);
+        if (request)
+        {
+            failures += FakeBleStack::write(connectionId, characteristic->handle(), value, length) != 0;
+        }
+        else
+        {
+            characteristic->write(value, length);
+        }
+    }
+    counting = false;
+
+    CHECK(failures == 0);
+    CHECK(characteristic->valueLength() == (WRITES - 1) % (characteristic->length() + 1));
+    return allocations;
+}
+
+int main(int argc, char** argv)
+{
+    CHECK(inlineValue.isInline());
+    CHECK(!pooledValue.isInline());
+    CHECK(ValuePool::instance()->used() >= pooledValue.length());
+
+    // construction takes the buffer of a large value from the pool as well
+    counting = true;
+    VariableGattCharacteristic constructed(BleUuid(BleUuid::Width::UUID_16, 0x4052), 100);
+    counting = false;
+    CHECK(allocations == 0);
+    CHECK(!constructed.isInline());
+
+    pooledValue.setNotification(GenericGattCharacteristic::Notification::NOTIFY);
+    service.addCharacteristic(&inlineValue);
+    service.addCharacteristic(&pooledValue);
+    NotificationDispatcher::instance()->probe();
+    BleServer::instance()->probe();
+    application.addService(&service);
+    BleServer::instance()->addGattsApplication(&application);
+    FakeBleStack::pump();
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+
+    CHECK(countWrites(&inlineValue, 0, false) == 0);
+    CHECK(countWrites(&pooledValue, 0, false) == 0);
+
+    // write requests dispatched by the framework, with a subscriber the writes request notifications
+    auto connectionId = FakeBleStack::connect();
+    CHECK(FakeBleStack::subscribe(connectionId, pooledValue.handle(), 0x0001) == 0);
+    CHECK(countWrites(&inlineValue, connectionId, true) == 0);
+    CHECK(countWrites(&pooledValue, connectionId, true) == 0);
+
+    return HostTest::result();
+}
@@ -0,0 +1,150 @@
+#include <string.h>
+#include <stdexcept>
+#include <vector>
+#include "AsyncGattCharacteristic.hpp"
+#include "BleServer.hpp"
+#include "FakeBleStack.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HostTest.hpp"
+#include "PendingTransactions.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+using HostTest::FakeBleStack;
+
+/*
+ * Requests answered by an AsyncGattCharacteristic on the fake Bluedroid host: long writes are answered by the
+ * characteristic as well, and each request gets exactly one response even if the characteristic throws after it
+ * completed or kept the Response. Bluedroid only, AsyncGattCharacteristic does not compile for NimBLE.
+ */
+class TestAsyncCharacteristic: public AsyncGattCharacteristic
+{
+public:
+    enum class Mode
+    {
+        COMPLETE,
+        KEEP,
+        COMPLETE_AND_THROW,
+        KEEP_AND_THROW,
+    };
+
+    using AsyncGattCharacteristic::AsyncGattCharacteristic;
+
+    Mode mode = Mode::COMPLETE;
+    std::vector<uint8_t> written;
+    PendingTransactions::Response kept = {};
+
+protected:
+
+    void readAsync(const PendingTransactions::Response& response) override
+    {
+        static const uint8_t value[] = { 'a', 's', 'y', 'n', 'c' };
+        answer(response, value, sizeof(value));
+    }
+
+    void writeAsync(const PendingTransactions::Response& response, const uint8_t* buffer, uint16_t length) override
+    {
+        written.assign(buffer, buffer + length);
+        answer(response, nullptr, 0);
+    }
+
+    void answer(const PendingTransactions::Response& response, const uint8_t* value, uint16_t length)
+    {
+        if (mode == Mode::COMPLETE || mode == Mode::COMPLETE_AND_THROW)
+        {
+            response.complete(value, length);
+        }
+        else
+        {
+            kept = response;
+        }
+        if (mode == Mode::COMPLETE_AND_THROW || mode == Mode::KEEP_AND_THROW)
+        {
+            throw std::runtime_error("failing after the response was passed on");
+        }
+    }
+};
+
+static TestAsyncCharacteristic async(
+    BleUuid(BleUuid::Width::UUID_16, 0x4070),
+    64,
+    ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+static GattsService service(BleServiceUuid(BleUuid::Width::UUID_32, 0x21040001));
+static GattsApplication application(0, "Async");
+
+static void testLongWrite(uint16_t connectionId)
+{
+    uint8_t value[40];
+    for (size_t i = 0; i < sizeof(value); ++i)
+    {
+        value[i] = i;
+    }
+
+    // completed while the Execute Write request is dispatched
+    async.mode = TestAsyncCharacteristic::Mode::COMPLETE;
+    CHECK(FakeBleStack::writeLong(connectionId, async.handle(), value, sizeof(value)) == ESP_GATT_OK);
+    CHECK(async.written.size() == sizeof(value) && memcmp(async.written.data(), value, sizeof(value)) == 0);
+
+    // completed later, the Execute Write request is answered by the Response
+    async.mode = TestAsyncCharacteristic::Mode::KEEP;
+    async.written.clear();
+    CHECK(FakeBleStack::writeLong(connectionId, async.handle(), value, sizeof(value)) == ESP_GATT_BUSY);
+    CHECK(async.written.size() == sizeof(value));
+    CHECK(PendingTransactions::instance()->pending() == 1);
+    CHECK(async.kept.complete(nullptr, 0));
+    CHECK(PendingTransactions::instance()->pending() == 0);
+}
+
+static void testFailureAfterResponse(uint16_t connectionId)
+{
+    const uint8_t value[] = { 1, 2 };
+    uint8_t readValue[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t length;
+
+    // answered once by the characteristic, the exception does not add an error response
+    async.mode = TestAsyncCharacteristic::Mode::COMPLETE_AND_THROW;
+    CHECK(FakeBleStack::write(connectionId, async.handle(), value, sizeof(value)) == ESP_GATT_OK);
+    CHECK(FakeBleStack::read(connectionId, async.handle(), readValue, &length) == ESP_GATT_OK);
+    CHECK(length == 5 && memcmp(readValue, "async", length) == 0);
+    CHECK(FakeBleStack::writeLong(connectionId, async.handle(), value, sizeof(value)) == ESP_GATT_OK);
+
+    // not answered yet, the error response is sent and the Response is void
+    async.mode = TestAsyncCharacteristic::Mode::KEEP_AND_THROW;
+    CHECK(FakeBleStack::write(connectionId, async.handle(), value, sizeof(value)) == ESP_GATT_INTERNAL_ERROR);
+    CHECK(!async.kept.complete(nullptr, 0));
+    CHECK(FakeBleStack::read(connectionId, async.handle(), readValue, &length) == ESP_GATT_INTERNAL_ERROR);
+    CHECK(!async.kept.complete(readValue, 0));
+    CHECK(PendingTransactions::instance()->pending() == 0);
+
+    CHECK(FakeBleStack::duplicateResponses() == 0);
+}
+
+static void testDeferOnce(uint16_t connectionId)
+{
+    // e.g. a reliable write covering two asynchronous characteristics
+    auto transactions = PendingTransactions::instance();
+    transactions->begin(async.interface(), connectionId, 1000, 0, 0, false, true);
+    transactions->defer();
+    CHECK_THROWS(transactions->defer(), std::runtime_error);
+    CHECK(transactions->abort());
+    CHECK(transactions->pending() == 0);
+}
+
+int main(int argc, char** argv)
+{
+    service.addCharacteristic(&async);
+    BleServer::instance()->probe();
+    application.addService(&service);
+    BleServer::instance()->addGattsApplication(&application);
+    FakeBleStack::pump();
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+
+    auto connectionId = FakeBleStack::connect();
+    testLongWrite(connectionId);
+    testFailureAfterResponse(connectionId);
+    testDeferOnce(connectionId);
+
+    return HostTest::result();
+}
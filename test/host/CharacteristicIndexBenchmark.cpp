@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include "CharacteristicIndex.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HostTest.hpp"
+#include "UInt16GattCharacteristic.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+
+#define CHARACTERISTICS_PER_SERVICE (20)
+#define LOOKUPS (200000)
+
+/*
+ * StaticCharacteristicIndex::find() against walking the services and characteristics of the application, which is
+ * what application code does without the index. Characteristics have 128 bit UUIDs of one vendor base, lookups go to
+ * random characteristics of the application. Each index is sized 25% above the number of characteristics as
+ * recommended by CharacteristicIndex.hpp.
+ */
+static const uint8_t vendorBase[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+struct Database
+{
+    Database(size_t numberOfCharacteristics);
+
+    GattsApplication application;
+    std::vector<std::unique_ptr<GattsService>> services;
+    std::vector<std::unique_ptr<UInt16GattCharacteristic>> characteristics;
+};
+
+Database::Database(size_t numberOfCharacteristics):
+    application(0, "Index")
+{
+    for (size_t i = 0; i < numberOfCharacteristics; ++i)
+    {
+        if (i % CHARACTERISTICS_PER_SERVICE == 0)
+        {
+            services.emplace_back(new GattsService(BleServiceUuid(BleUuid(vendorBase, 0x21070000 + i), false)));
+            application.addService(services.back().get());
+        }
+        characteristics.emplace_back(new UInt16GattCharacteristic(BleUuid(vendorBase, 0x21080000 + i)));
+        services.back()->addCharacteristic(characteristics.back().get());
+    }
+}
+
+static GenericGattCharacteristic* walk(const GattsApplication* application, const BleUuid& uuid)
+{
+    auto servicePointer = application->services();
+    while (servicePointer)
+    {
+        auto characteristicPointer = servicePointer->characteristics();
+        while (characteristicPointer)
+        {
+            if (characteristicPointer->characteristicId() == uuid)
+            {
+                return characteristicPointer;
+            }
+            characteristicPointer = characteristicPointer->nextCharacteristic();
+        }
+        servicePointer = servicePointer->nextService();
+    }
+    return nullptr;
+}
+
+template<size_t CAPACITY>
+static void run(size_t numberOfCharacteristics)
+{
+    Database database(numberOfCharacteristics);
+    static StaticCharacteristicIndex<CAPACITY> index;
+
+    auto start = HostTest::seconds();
+    index.build(&database.application);
+    auto buildUs = (HostTest::seconds() - start) * 1e6;
+    CHECK(index.size() == numberOfCharacteristics);
+    CHECK(index.duplicates() == 0);
+
+    std::mt19937 random(1);
+    std::vector<size_t> targets(LOOKUPS);
+    for (auto& target : targets)
+    {
+        target = random() % numberOfCharacteristics;
+    }
+
+    size_t mismatches = 0;
+    start = HostTest::seconds();
+    for (auto target : targets)
+    {
+        auto& characteristic = database.characteristics[target];
+        mismatches += index.find(characteristic->characteristicId()) != characteristic.get();
+    }
+    auto indexNs = (HostTest::seconds() - start) * 1e9 / LOOKUPS;
+
+    start = HostTest::seconds();
+    for (auto target : targets)
+    {
+        auto& characteristic = database.characteristics[target];
+        mismatches += walk(&database.application, characteristic->characteristicId()) != characteristic.get();
+    }
+    auto walkNs = (HostTest::seconds() - start) * 1e9 / LOOKUPS;
+    CHECK(mismatches == 0);
+
+    printf(
+        "%16zu %9zu %10.1f %12.1f %10.1f %8.1fx\n",
+        numberOfCharacteristics,
+        CAPACITY,
+        buildUs,
+        indexNs,
+        walkNs,
+        walkNs / indexNs);
+
+    // a walk visits half of the characteristics on average, beyond a few dozen the index has to win
+    if (numberOfCharacteristics >= 100)
+    {
+        CHECK(indexNs < walkNs);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    printf("%d characteristics per service, %d lookups\n", CHARACTERISTICS_PER_SERVICE, LOOKUPS);
+    printf(
+        "%16s %9s %10s %12s %10s %9s\n",
+        "characteristics",
+        "capacity",
+        "build us",
+        "index ns",
+        "walk ns",
+        "speedup");
+    run<13>(10);
+    run<125>(100);
+    run<1250>(1000);
+
+    return HostTest::result();
+}
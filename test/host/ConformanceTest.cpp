@@ -0,0 +1,296 @@
+#include <string.h>
+#include <stdexcept>
+#include "BleServer.hpp"
+#include "ChangeJournalService.hpp"
+#include "FakeBleStack.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HostTest.hpp"
+#include "NotificationDispatcher.hpp"
+#include "UInt16GattCharacteristic.hpp"
+#include "VariableGattCharacteristic.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+using HostTest::FakeBleStack;
+
+/*
+ * The same requests against the framework on either Bluetooth host: built once with FakeBluedroid.cpp and once with
+ * FakeNimble.cpp. Where a feature is Bluedroid only, the NimBLE build checks that it is refused with an error naming
+ * NimBLE instead of being dropped silently.
+ */
+
+#define ATT_ERR_INVALID_HANDLE (0x01)
+#define ATT_ERR_READ_NOT_PERMITTED (0x02)
+#define ATT_ERR_WRITE_NOT_PERMITTED (0x03)
+#define ATT_ERR_INVALID_OFFSET (0x07)
+#define ATT_ERR_INVALID_ATTRIBUTE_VALUE_LENGTH (0x0d)
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#define ATT_ERR_UNEXPECTED (BLE_ATT_ERR_UNLIKELY)
+#else
+#define ATT_ERR_UNEXPECTED (ESP_GATT_INTERNAL_ERROR)
+#endif
+
+#define UUID_DESCRIPTION (0x2901)
+#define UUID_CLIENT_CONFIGURATION (0x2902)
+
+#define NOTIFICATION_TIMEOUT_MS (1000)
+
+static const uint8_t nameValue[] = { 'h', 'o', 's', 't' };
+
+static UInt16GattCharacteristic counter(
+    BleUuid(BleUuid::Width::UUID_16, 0x4020),
+    ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+    "Counter",
+    7);
+static VariableGattCharacteristic name(
+    BleUuid(BleUuid::Width::UUID_32, 0x21041000),
+    32,
+    ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+    nullptr,
+    nameValue,
+    sizeof(nameValue));
+static UInt16GattCharacteristic readOnly(BleUuid(BleUuid::Width::UUID_16, 0x4021), ESP_GATT_PERM_READ);
+static UInt16GattCharacteristic writeOnly(BleUuid(BleUuid::Width::UUID_16, 0x4022), ESP_GATT_PERM_WRITE);
+static UInt16GattCharacteristic level(BleUuid(BleUuid::Width::UUID_16, 0x4023), ESP_GATT_PERM_READ);
+static GattsService service(BleServiceUuid(BleUuid::Width::UUID_32, 0x21040001));
+static GattsApplication application(0, "Conform", "Conformance");
+
+static UInt16GattCharacteristic late(BleUuid(BleUuid::Width::UUID_16, 0x4030), ESP_GATT_PERM_READ, nullptr, 30);
+static GattsService lateService(BleServiceUuid(BleUuid::Width::UUID_32, 0x21040002, false));
+
+static UInt16GattCharacteristic other(BleUuid(BleUuid::Width::UUID_16, 0x4040), ESP_GATT_PERM_READ, nullptr, 40);
+static GattsService otherService(BleServiceUuid(BleUuid::Width::UUID_32, 0x21040003, false));
+static GattsApplication otherApplication(1, "Other", nullptr, GATTS_APPLICATION_DEFAULT_APPEARANCE, false);
+
+static uint16_t readUInt16(uint16_t connectionId, uint16_t handle, uint8_t* status)
+{
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t length = 0;
+    *status = FakeBleStack::read(connectionId, handle, value, &length);
+    return length == 2 ? value[0] | (value[1] << 8) : 0xffff;
+}
+
+template<typename Function>
+static bool throwsMentioning(Function function, const char* text)
+{
+    try
+    {
+        function();
+    }
+    catch (const std::runtime_error& e)
+    {
+        return strstr(e.what(), text) != nullptr;
+    }
+    return false;
+}
+
+static void testRegistration(void)
+{
+    level.setNotification(GenericGattCharacteristic::Notification::NOTIFY);
+    service.addCharacteristic(&counter);
+    service.addCharacteristic(&name);
+    service.addCharacteristic(&readOnly);
+    service.addCharacteristic(&writeOnly);
+    service.addCharacteristic(&level);
+    lateService.addCharacteristic(&late);
+    otherService.addCharacteristic(&other);
+
+    NotificationDispatcher::instance()->probe();
+    BleServer::instance()->probe();
+    application.addService(&service);
+    BleServer::instance()->addGattsApplication(&application);
+    FakeBleStack::pump();
+
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+    CHECK(counter.handle() != 0);
+    CHECK(name.handle() == counter.handle() + counter.numberOfAttributes());
+    CHECK(level.handle() != 0);
+    // service declaration, declaration and value of five characteristics, one description and one client configuration
+    CHECK(FakeBleStack::numberOfAttributes() == 1 + 5 * 2 + 2);
+}
+
+static void testRead(uint16_t connectionId)
+{
+    uint8_t status;
+    CHECK(readUInt16(connectionId, counter.handle(), &status) == 7);
+    CHECK(status == 0);
+
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t length = 0;
+    CHECK(FakeBleStack::read(connectionId, name.handle(), value, &length) == 0);
+    CHECK(length == sizeof(nameValue) && memcmp(value, nameValue, length) == 0);
+
+    // Read Blob
+    CHECK(FakeBleStack::read(connectionId, name.handle(), value, &length, 1) == 0);
+    CHECK(length == sizeof(nameValue) - 1 && memcmp(value, nameValue + 1, length) == 0);
+    CHECK(FakeBleStack::read(connectionId, name.handle(), value, &length, sizeof(nameValue) + 1)
+        == ATT_ERR_INVALID_OFFSET);
+
+    auto descriptionHandle = FakeBleStack::findDescriptor(counter.handle(), UUID_DESCRIPTION);
+    CHECK(descriptionHandle != 0);
+    CHECK(FakeBleStack::read(connectionId, descriptionHandle, value, &length) == 0);
+    CHECK(length == strlen("Counter") && memcmp(value, "Counter", length) == 0);
+}
+
+static void testWrite(uint16_t connectionId)
+{
+    const uint8_t counterValue[] = { 0x34, 0x12 };
+    CHECK(FakeBleStack::write(connectionId, counter.handle(), counterValue, sizeof(counterValue)) == 0);
+    CHECK(counter.value() == 0x1234);
+
+    const uint8_t hello[] = { 'h', 'e', 'l', 'l', 'o' };
+    CHECK(FakeBleStack::write(connectionId, name.handle(), hello, sizeof(hello)) == 0);
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t length = 0;
+    CHECK(FakeBleStack::read(connectionId, name.handle(), value, &length) == 0);
+    CHECK(length == sizeof(hello) && memcmp(value, hello, length) == 0);
+
+    // longer than the default MTU, prepared and executed on Bluedroid, reassembled by NimBLE
+    uint8_t longValue[32];
+    for (size_t i = 0; i < sizeof(longValue); ++i)
+    {
+        longValue[i] = 'a' + i % 26;
+    }
+    CHECK(FakeBleStack::writeLong(connectionId, name.handle(), longValue, sizeof(longValue)) == 0);
+    CHECK(FakeBleStack::read(connectionId, name.handle(), value, &length) == 0);
+    CHECK(length == sizeof(longValue) && memcmp(value, longValue, length) == 0);
+    CHECK(FakeBleStack::duplicateResponses() == 0);
+
+    // std::length_error maps to the same code on both hosts, other exceptions to the host specific one
+    uint8_t tooLong[33] = {};
+    CHECK(FakeBleStack::write(connectionId, name.handle(), tooLong, sizeof(tooLong))
+        == ATT_ERR_INVALID_ATTRIBUTE_VALUE_LENGTH);
+    CHECK(FakeBleStack::write(connectionId, counter.handle(), tooLong, 3) == ATT_ERR_UNEXPECTED);
+    CHECK(counter.value() == 0x1234);
+
+    // so is a journal request which is not a sequence number, the service is not registered for this check
+    ChangeJournalService journal(
+        BleServiceUuid(BleUuid::Width::UUID_32, 0x21040004, false),
+        BleUuid(BleUuid::Width::UUID_16, 0x4024),
+        BleUuid(BleUuid::Width::UUID_16, 0x4025),
+        &application);
+    CHECK_THROWS(journal.writeCharacteristic(connectionId, 0, tooLong, 3), std::length_error);
+}
+
+static void testPermissions(uint16_t connectionId)
+{
+    const uint8_t value[] = { 1, 0 };
+    uint8_t status;
+    CHECK(FakeBleStack::write(connectionId, readOnly.handle(), value, sizeof(value)) == ATT_ERR_WRITE_NOT_PERMITTED);
+    readUInt16(connectionId, writeOnly.handle(), &status);
+    CHECK(status == ATT_ERR_READ_NOT_PERMITTED);
+    CHECK(FakeBleStack::write(connectionId, writeOnly.handle(), value, sizeof(value)) == 0);
+    CHECK(writeOnly.value() == 1);
+
+    readUInt16(connectionId, 0xfff0, &status);
+    CHECK(status == ATT_ERR_INVALID_HANDLE);
+}
+
+static void testNotification(uint16_t connectionId)
+{
+    FakeBleStack::setMtu(connectionId, 100);
+    CHECK(FakeBleStack::subscribe(connectionId, level.handle(), 0x0001) == 0);
+    CHECK(level.subscribers() == (1u << connectionId));
+    CHECK(level.clientConfiguration(connectionId) == 0x0001);
+
+    // a client configuration of the wrong length is a length error, not an unexpected one
+    auto clientConfigurationHandle = FakeBleStack::findDescriptor(level.handle(), UUID_CLIENT_CONFIGURATION);
+    const uint8_t oneByte[] = { 0x02 };
+    CHECK(FakeBleStack::write(connectionId, clientConfigurationHandle, oneByte, sizeof(oneByte))
+        == ATT_ERR_INVALID_ATTRIBUTE_VALUE_LENGTH);
+    CHECK(level.clientConfiguration(connectionId) == 0x0001);
+
+    FakeBleStack::Notification notification;
+    level.setValue(0x0203);
+    CHECK(FakeBleStack::waitForNotification(&notification, NOTIFICATION_TIMEOUT_MS));
+    CHECK(notification.connectionId == connectionId);
+    CHECK(notification.handle == level.handle());
+    CHECK(!notification.indication);
+    CHECK(notification.value.size() == 2 && notification.value[0] == 0x03 && notification.value[1] == 0x02);
+
+    // client configurations belong to the connection
+    FakeBleStack::disconnect(connectionId);
+    FakeBleStack::pump();
+    CHECK(level.subscribers() == 0);
+    level.setValue(0x0405);
+    CHECK(!FakeBleStack::waitForNotification(&notification, 100));
+}
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+
+static void testServiceChanges(void)
+{
+    // the GATT database is handed over as a whole when the host starts
+    CHECK(throwsMentioning([]() { application.addService(&lateService); }, "NimBLE"));
+    CHECK(throwsMentioning([]() { application.removeService(&service); }, "NimBLE"));
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+    CHECK(late.handle() == 0);
+}
+
+static void testApplications(void)
+{
+    otherApplication.addService(&otherService);
+    CHECK(throwsMentioning([]() { BleServer::instance()->addGattsApplication(&otherApplication); }, "NimBLE"));
+    FakeBleStack::pump();
+    CHECK(other.handle() == 0);
+}
+
+#else
+
+static void testServiceChanges(void)
+{
+    uint8_t status;
+    auto connectionId = FakeBleStack::connect();
+    application.addService(&lateService);
+    FakeBleStack::pump();
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+    CHECK(late.handle() != 0);
+    CHECK(readUInt16(connectionId, late.handle(), &status) == 30);
+    CHECK(status == 0);
+
+    auto lateHandle = late.handle();
+    application.removeService(&lateService);
+    FakeBleStack::pump();
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+    readUInt16(connectionId, lateHandle, &status);
+    CHECK(status == ATT_ERR_INVALID_HANDLE);
+
+    // the remaining services keep their handles
+    CHECK(readUInt16(connectionId, counter.handle(), &status) == 0x1234);
+    FakeBleStack::disconnect(connectionId);
+}
+
+static void testApplications(void)
+{
+    uint8_t status;
+    otherApplication.addService(&otherService);
+    BleServer::instance()->addGattsApplication(&otherApplication);
+    FakeBleStack::pump();
+    CHECK(otherApplication.registrationState() == GattsApplication::RegistrationState::READY);
+    CHECK(other.handle() != 0 && other.interface() != counter.interface());
+
+    auto connectionId = FakeBleStack::connect();
+    CHECK(readUInt16(connectionId, other.handle(), &status) == 40);
+    CHECK(readUInt16(connectionId, counter.handle(), &status) == 0x1234);
+    FakeBleStack::disconnect(connectionId);
+}
+
+#endif
+
+int main(int argc, char** argv)
+{
+    testRegistration();
+
+    auto connectionId = FakeBleStack::connect();
+    testRead(connectionId);
+    testWrite(connectionId);
+    testPermissions(connectionId);
+    testNotification(connectionId);
+
+    testServiceChanges();
+    testApplications();
+
+    return HostTest::result();
+}
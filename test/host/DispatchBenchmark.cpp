@@ -0,0 +1,287 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "BleServer.hpp"
+#include "FakeBleStack.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HostTest.hpp"
+#include "UInt16GattCharacteristic.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+using HostTest::FakeBleStack;
+
+#define EVENTS (200000)
+
+// events are looked up by interface, dispatching to 4 applications may take this many times as long as to one
+#define DISPATCH_GROWTH_MAX (4.0)
+
+// not a transaction of the fake host, the responses to the read requests are discarded
+#define TRANSACTION_ID (UINT32_MAX)
+
+/*
+ * Cost of dispatching Bluedroid events against the number of registered GATTS applications. The events are passed to
+ * BleServer::gattsEventCallback() and gapEventCallback() directly, like the Bluetooth task does, so the attribute
+ * lookup of the fake host is not part of it. Read requests go round robin to one characteristic per application, GAP
+ * events to the application owning advertising. The applications are registered once per process, so every number of
+ * applications runs in a child process. The dispatch statistics are enabled on the host (see CMakeLists.txt) and
+ * are reported next to the time measured by the benchmark.
+ *
+ * The second part passes single kinds of GATTS events to one application: handled ones, ones the handler table ignores
+ * explicitly and ones without a handler, within the table and beyond it. Events without a handler must neither throw
+ * nor reach a handler, they are counted by unhandledGattsEvents().
+ */
+struct Result
+{
+    double gattsNs;
+    double gapNs;
+    uint32_t gattsStatisticsNs;
+    uint32_t gapStatisticsNs;
+    int failures;
+};
+
+struct EventKind
+{
+    const char* name;
+    const char* handler;
+    esp_gatts_cb_event_t event;
+};
+
+static const EventKind eventKinds[] = {
+    { "READ", "read", ESP_GATTS_READ_EVT },
+    { "CONF", "ignored", ESP_GATTS_CONF_EVT },
+    { "CONGEST", "congestion", ESP_GATTS_CONGEST_EVT },
+    { "LISTEN", nullptr, ESP_GATTS_LISTEN_EVT },
+    { "beyond table", nullptr, (esp_gatts_cb_event_t) GATTS_APPLICATION_GATTS_EVENTS },
+};
+
+#define EVENT_KINDS (sizeof(eventKinds) / sizeof(eventKinds[0]))
+
+struct EventResult
+{
+    double ns[EVENT_KINDS];
+    int failures;
+};
+
+static Result run(size_t numberOfApplications)
+{
+    std::vector<std::unique_ptr<UInt16GattCharacteristic>> characteristics;
+    std::vector<std::unique_ptr<GattsService>> services;
+    std::vector<std::unique_ptr<GattsApplication>> applications;
+
+    BleServer::instance()->probe();
+    for (size_t i = 0; i < numberOfApplications; ++i)
+    {
+        characteristics.emplace_back(new UInt16GattCharacteristic(
+            BleUuid(BleUuid::Width::UUID_16, 0x5000),
+            ESP_GATT_PERM_READ,
+            nullptr,
+            i));
+        services.emplace_back(new GattsService(BleServiceUuid(BleUuid::Width::UUID_32, 0x21060000 + i, false)));
+        services.back()->addCharacteristic(characteristics.back().get());
+        applications.emplace_back(new GattsApplication(
+            i,
+            "Dispatch",
+            nullptr,
+            GATTS_APPLICATION_DEFAULT_APPEARANCE,
+            i == 0));
+        applications.back()->addService(services.back().get());
+        BleServer::instance()->addGattsApplication(applications.back().get());
+    }
+    FakeBleStack::pump();
+
+    Result result = {};
+    for (auto& application : applications)
+    {
+        CHECK(application->registrationState() == GattsApplication::RegistrationState::READY);
+    }
+    auto connectionId = FakeBleStack::connect();
+
+    std::vector<esp_gatt_if_t> interfaces(numberOfApplications);
+    std::vector<esp_ble_gatts_cb_param_t> requests(numberOfApplications);
+    for (size_t i = 0; i < numberOfApplications; ++i)
+    {
+        interfaces[i] = applications[i]->interface();
+        requests[i] = {};
+        requests[i].read.conn_id = connectionId;
+        requests[i].read.trans_id = TRANSACTION_ID;
+        requests[i].read.handle = characteristics[i]->handle();
+        requests[i].read.need_rsp = true;
+    }
+
+    auto server = BleServer::instance();
+    auto gattsStatistics = server->gattsDispatchStatistics();
+    auto start = HostTest::seconds();
+    for (size_t i = 0; i < EVENTS; ++i)
+    {
+        auto index = i % numberOfApplications;
+        server->gattsEventCallback(ESP_GATTS_READ_EVT, interfaces[index], &requests[index]);
+    }
+    result.gattsNs = (HostTest::seconds() - start) * 1e9 / EVENTS;
+
+    esp_ble_gap_cb_param_t gapParam = {};
+    gapParam.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    auto gapStatistics = server->gapDispatchStatistics();
+    start = HostTest::seconds();
+    for (size_t i = 0; i < EVENTS; ++i)
+    {
+        server->gapEventCallback(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &gapParam);
+    }
+    result.gapNs = (HostTest::seconds() - start) * 1e9 / EVENTS;
+
+    // the statistics cover exactly the dispatched events, the difference is the time of this run
+    auto& gattsTotal = server->gattsDispatchStatistics();
+    auto& gapTotal = server->gapDispatchStatistics();
+    CHECK(gattsTotal.events - gattsStatistics.events == EVENTS);
+    CHECK(gapTotal.events - gapStatistics.events == EVENTS);
+    result.gattsStatisticsNs = (gattsTotal.cycles - gattsStatistics.cycles) / EVENTS;
+    result.gapStatisticsNs = (gapTotal.cycles - gapStatistics.cycles) / EVENTS;
+
+    CHECK(FakeBleStack::duplicateResponses() == 0);
+    result.failures = HostTest::failures;
+    return result;
+}
+
+static EventResult runEvents(void)
+{
+    UInt16GattCharacteristic characteristic(BleUuid(BleUuid::Width::UUID_16, 0x5000), ESP_GATT_PERM_READ, nullptr, 0);
+    GattsService service(BleServiceUuid(BleUuid::Width::UUID_32, 0x21060000, false));
+    GattsApplication application(0, "Dispatch");
+
+    BleServer::instance()->probe();
+    service.addCharacteristic(&characteristic);
+    application.addService(&service);
+    BleServer::instance()->addGattsApplication(&application);
+    FakeBleStack::pump();
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+    auto connectionId = FakeBleStack::connect();
+
+    EventResult result = {};
+    auto server = BleServer::instance();
+    for (size_t kind = 0; kind < EVENT_KINDS; ++kind)
+    {
+        esp_ble_gatts_cb_param_t param = {};
+        if (eventKinds[kind].event == ESP_GATTS_READ_EVT)
+        {
+            param.read.conn_id = connectionId;
+            param.read.trans_id = TRANSACTION_ID;
+            param.read.handle = characteristic.handle();
+            param.read.need_rsp = true;
+        }
+        else
+        {
+            param.congest.conn_id = connectionId;
+        }
+
+        auto unhandled = application.unhandledGattsEvents();
+        size_t exceptions = 0;
+        auto start = HostTest::seconds();
+        for (size_t i = 0; i < EVENTS; ++i)
+        {
+            try
+            {
+                server->gattsEventCallback(eventKinds[kind].event, application.interface(), &param);
+            }
+            catch(const std::exception& e)
+            {
+                ++exceptions;
+            }
+        }
+        result.ns[kind] = (HostTest::seconds() - start) * 1e9 / EVENTS;
+
+        CHECK(exceptions == 0);
+        CHECK(application.unhandledGattsEvents() - unhandled == (eventKinds[kind].handler ? 0 : EVENTS));
+    }
+
+    CHECK(FakeBleStack::duplicateResponses() == 0);
+    result.failures = HostTest::failures;
+    return result;
+}
+
+template<typename T, typename F>
+static bool runInChild(F run, T* result)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    auto pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        auto childResult = run();
+        auto written = write(fds[1], &childResult, sizeof(childResult));
+        _exit(written == sizeof(childResult) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    auto received = pid > 0 ? read(fds[0], result, sizeof(*result)) : 0;
+    close(fds[0]);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid)
+    {
+        return false;
+    }
+    return received == sizeof(*result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    printf("%d events per run, statistics by DispatchStatistics\n", EVENTS);
+    printf(
+        "%12s %10s %10s %18s %18s\n",
+        "applications",
+        "GATTS ns",
+        "GAP ns",
+        "GATTS statistics",
+        "GAP statistics");
+    std::vector<Result> results;
+    for (size_t applications = 1; applications <= BLE_SERVER_APPLICATIONS_MAX; ++applications)
+    {
+        Result result;
+        if (!CHECK(runInChild([applications]() { return run(applications); }, &result)))
+        {
+            continue;
+        }
+        printf(
+            "%12zu %10.1f %10.1f %18u %18u\n",
+            applications,
+            result.gattsNs,
+            result.gapNs,
+            (unsigned) result.gattsStatisticsNs,
+            (unsigned) result.gapStatisticsNs);
+        HostTest::failures += result.failures;
+        results.push_back(result);
+    }
+
+    if (results.size() > 1)
+    {
+        CHECK(results.back().gattsNs < DISPATCH_GROWTH_MAX * results.front().gattsNs);
+        CHECK(results.back().gapNs < DISPATCH_GROWTH_MAX * results.front().gapNs);
+    }
+
+    printf("\n%16s %12s %10s\n", "GATTS event", "handler", "ns");
+    EventResult eventResult;
+    if (CHECK(runInChild(runEvents, &eventResult)))
+    {
+        for (size_t kind = 0; kind < EVENT_KINDS; ++kind)
+        {
+            printf(
+                "%16s %12s %10.1f\n",
+                eventKinds[kind].name,
+                eventKinds[kind].handler ? eventKinds[kind].handler : "none",
+                eventResult.ns[kind]);
+        }
+        HostTest::failures += eventResult.failures;
+    }
+
+    return HostTest::result();
+}
@@ -0,0 +1,43 @@
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "FakeBleStack.hpp"
+
+namespace HostTest
+{
+
+// notifications are sent by the task of the NotificationDispatcher, not by the thread pumping the stack
+static std::mutex notificationsMutex;
+static std::condition_variable notificationsChanged;
+static std::deque<FakeBleStack::Notification> notifications;
+
+bool FakeBleStack::waitForNotification(Notification* notification, uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(notificationsMutex);
+    auto pending = []() { return !notifications.empty(); };
+    if (!notificationsChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), pending))
+    {
+        return false;
+    }
+
+    *notification = notifications.front();
+    notifications.pop_front();
+    return true;
+}
+
+void FakeBleStack::notificationSent(
+    uint16_t connectionId,
+    uint16_t handle,
+    bool indication,
+    const uint8_t* value,
+    uint16_t length)
+{
+    {
+        std::lock_guard<std::mutex> lock(notificationsMutex);
+        notifications.push_back({ connectionId, handle, indication, std::vector<uint8_t>(value, value + length) });
+    }
+    notificationsChanged.notify_all();
+}
+
+} /* namespace HostTest */
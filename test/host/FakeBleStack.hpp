@@ -0,0 +1,64 @@
+#ifndef TEST_HOST_FAKEBLESTACK_HPP_
+#define TEST_HOST_FAKEBLESTACK_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace HostTest
+{
+
+/*
+ * Peer side of the fake Bluetooth hosts the framework runs on in host tests: FakeBluedroid.cpp implements the
+ * Bluedroid API, FakeNimble.cpp the NimBLE API, a test links one of them together with the matching flavour of the
+ * framework library. Both keep an attribute database of what the framework registered and act as a client on it with
+ * the same interface, so one test source covers both backends.
+ *
+ * The calling thread acts as the Bluetooth task: pump() delivers pending stack events (Bluedroid) or synchronizes the
+ * host (NimBLE), requests are dispatched synchronously and return the ATT error code of the response (0 on success).
+ * Error codes of the framework differ where the stacks differ, e.g. a characteristic throwing an unexpected exception
+ * is answered with ESP_GATT_INTERNAL_ERROR (0x81) by Bluedroid and BLE_ATT_ERR_UNLIKELY (0x0e) by NimBLE. Requests
+ * neither allocate nor take locks besides the ones of the framework. writeLong() sends Prepare Write requests of the
+ * default MTU and an Execute Write request to Bluedroid, NimBLE reassembles long writes itself.
+ */
+class FakeBleStack
+{
+public:
+    struct Notification
+    {
+        uint16_t connectionId;
+        uint16_t handle;
+        bool indication;
+        std::vector<uint8_t> value;
+    };
+
+    static void pump(void);
+    static size_t numberOfAttributes(void);
+    static uint16_t findDescriptor(uint16_t valueHandle, uint16_t uuid);
+
+    static uint16_t connect(void);
+    static void disconnect(uint16_t connectionId);
+    static void setMtu(uint16_t connectionId, uint16_t mtu);
+
+    static uint8_t read(uint16_t connectionId, uint16_t handle, uint8_t* value, uint16_t* length, uint16_t offset = 0);
+    static uint8_t write(uint16_t connectionId, uint16_t handle, const uint8_t* value, uint16_t length);
+    static uint8_t writeLong(uint16_t connectionId, uint16_t handle, const uint8_t* value, uint16_t length);
+    static uint8_t subscribe(uint16_t connectionId, uint16_t valueHandle, uint16_t clientConfiguration);
+
+    // responses sent for a request which was answered already
+    static size_t duplicateResponses(void);
+
+    static bool waitForNotification(Notification* notification, uint32_t timeoutMs);
+
+    // called by the fakes when the framework sent a notification or an indication
+    static void notificationSent(
+        uint16_t connectionId,
+        uint16_t handle,
+        bool indication,
+        const uint8_t* value,
+        uint16_t length);
+};
+
+} /* namespace HostTest */
+
+#endif /* TEST_HOST_FAKEBLESTACK_HPP_ */
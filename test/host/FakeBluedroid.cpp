@@ -0,0 +1,606 @@
+#include <esp_bt_main.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatt_common_api.h>
+#include <esp_gatts_api.h>
+#include <string.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "FakeBleStack.hpp"
+
+/*
+ * Bluedroid as seen by the framework: attribute tables are assigned consecutive handles, registrations and service
+ * changes are confirmed by events queued until pump(). Attributes answered by the application (ESP_GATT_RSP_BY_APP)
+ * are dispatched as READ and WRITE events, the others are answered from the copy taken when the table was created.
+ * Permissions are checked by the stack before dispatching, as Bluedroid does.
+ */
+
+#define FIRST_HANDLE (40)
+#define FIRST_INTERFACE (3)
+#define INTERFACES_MAX (8)
+
+namespace
+{
+
+struct Attribute
+{
+    uint16_t handle;
+    uint16_t tableHandle;
+    uint16_t uuid;
+    uint16_t permission;
+    bool autoResponse;
+    esp_gatt_if_t interface;
+    std::vector<uint8_t> value;
+};
+
+struct Event
+{
+    bool gap;
+    int event;
+    esp_gatt_if_t interface;
+    esp_ble_gatts_cb_param_t gattsParam;
+    esp_ble_gap_cb_param_t gapParam;
+    std::vector<uint16_t> handles;
+};
+
+struct Response
+{
+    uint32_t transactionId;
+    bool received;
+    esp_gatt_status_t status;
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t length;
+};
+
+}
+
+static esp_gatts_cb_t gattsCallback;
+static esp_gap_ble_cb_t gapCallback;
+static esp_gatt_if_t interfaces[INTERFACES_MAX];
+static size_t numberOfInterfaces;
+
+static std::mutex mutex;
+static std::deque<Event> events;
+static std::vector<Attribute> attributes;
+static uint16_t nextHandle = FIRST_HANDLE;
+
+static uint16_t nextConnectionId;
+static uint32_t nextTransactionId;
+static Response response;
+static size_t duplicateResponses;
+
+static void queueGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t interface, const esp_ble_gatts_cb_param_t& param)
+{
+    Event entry = {};
+    entry.event = event;
+    entry.interface = interface;
+    entry.gattsParam = param;
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(entry);
+}
+
+static void queueGapEvent(esp_gap_ble_cb_event_t event)
+{
+    Event entry = {};
+    entry.gap = true;
+    entry.event = event;
+    entry.gapParam.adv_start_cmpl.status = ESP_BT_STATUS_SUCCESS;
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(entry);
+}
+
+static Attribute* findAttribute(uint16_t handle)
+{
+    // attributes are sorted by handle, handles of deleted tables are not reused
+    size_t low = 0;
+    size_t high = attributes.size();
+    while (low < high)
+    {
+        auto middle = (low + high) / 2;
+        if (attributes[middle].handle < handle)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low < attributes.size() && attributes[low].handle == handle ? &attributes[low] : nullptr;
+}
+
+static uint16_t uuidOf(const esp_attr_desc_t& description)
+{
+    // 128 bit UUIDs are not looked for by the tests
+    if (description.uuid_length != ESP_UUID_LEN_16)
+    {
+        return 0;
+    }
+    return description.uuid_p[0] | (description.uuid_p[1] << 8);
+}
+
+static void dispatch(esp_gatts_cb_event_t event, esp_gatt_if_t interface, esp_ble_gatts_cb_param_t* param)
+{
+    gattsCallback(event, interface, param);
+}
+
+static uint8_t request(
+    esp_gatts_cb_event_t event,
+    esp_gatt_if_t interface,
+    esp_ble_gatts_cb_param_t* param,
+    uint32_t transactionId)
+{
+    response.transactionId = transactionId;
+    response.received = false;
+    dispatch(event, interface, param);
+
+    // deferred responses are not awaited
+    return response.received ? response.status : ESP_GATT_BUSY;
+}
+
+static Attribute* findWritableAttribute(uint16_t handle, esp_gatt_if_t* interface, uint8_t* status)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto attribute = findAttribute(handle);
+    if (!attribute)
+    {
+        *status = ESP_GATT_INVALID_HANDLE;
+        return nullptr;
+    }
+    if (!(attribute->permission & ESP_GATT_PERM_WRITE) || attribute->autoResponse)
+    {
+        *status = ESP_GATT_WRITE_NOT_PERMIT;
+        return nullptr;
+    }
+    *interface = attribute->interface;
+    return attribute;
+}
+
+esp_err_t esp_bluedroid_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_enable(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback)
+{
+    gapCallback = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_device_name(const char* name)
+{
+    return name ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t* raw_data, uint32_t raw_data_len)
+{
+    if (raw_data_len > 31)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    queueGapEvent(ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_scan_rsp_data_raw(uint8_t* raw_data, uint32_t raw_data_len)
+{
+    if (raw_data_len > 31)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    queueGapEvent(ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t* adv_params)
+{
+    queueGapEvent(ESP_GAP_BLE_ADV_START_COMPLETE_EVT);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_stop_advertising(void)
+{
+    queueGapEvent(ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t* params)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback)
+{
+    gattsCallback = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id)
+{
+    if (numberOfInterfaces >= INTERFACES_MAX)
+    {
+        return ESP_FAIL;
+    }
+    auto interface = (esp_gatt_if_t) (FIRST_INTERFACE + numberOfInterfaces);
+    interfaces[numberOfInterfaces++] = interface;
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.reg.status = ESP_GATT_OK;
+    param.reg.app_id = app_id;
+    queueGattsEvent(ESP_GATTS_REG_EVT, interface, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_create_attr_tab(
+    const esp_gatts_attr_db_t* gatts_attr_db,
+    esp_gatt_if_t gatts_if,
+    uint16_t max_nb_attr,
+    uint8_t srvc_inst_id)
+{
+    if (!gatts_attr_db || !max_nb_attr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // the stack copies the table, the framework releases it once the table was created
+    Event entry = {};
+    entry.event = ESP_GATTS_CREAT_ATTR_TAB_EVT;
+    entry.interface = gatts_if;
+    entry.gattsParam.add_attr_tab.status = ESP_GATT_OK;
+    entry.gattsParam.add_attr_tab.svc_inst_id = srvc_inst_id;
+    entry.gattsParam.add_attr_tab.num_handle = max_nb_attr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto tableHandle = nextHandle;
+    for (uint16_t i = 0; i < max_nb_attr; ++i)
+    {
+        auto& description = gatts_attr_db[i].att_desc;
+        Attribute attribute;
+        attribute.handle = nextHandle++;
+        attribute.tableHandle = tableHandle;
+        attribute.uuid = uuidOf(description);
+        attribute.permission = description.perm;
+        attribute.autoResponse = gatts_attr_db[i].attr_control.auto_rsp == ESP_GATT_AUTO_RSP;
+        attribute.interface = gatts_if;
+        if (attribute.autoResponse && description.value)
+        {
+            attribute.value.assign(description.value, description.value + description.length);
+        }
+        attributes.push_back(attribute);
+        entry.handles.push_back(attribute.handle);
+    }
+    events.push_back(entry);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto attribute = findAttribute(service_handle);
+    if (!attribute || attribute->tableHandle != service_handle)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto interface = attribute->interface;
+    lock.unlock();
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.start.status = ESP_GATT_OK;
+    param.start.service_handle = service_handle;
+    queueGattsEvent(ESP_GATTS_START_EVT, interface, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_stop_service(uint16_t service_handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_delete_service(uint16_t service_handle)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto attribute = findAttribute(service_handle);
+    if (!attribute || attribute->tableHandle != service_handle)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto interface = attribute->interface;
+
+    size_t i = attribute - attributes.data();
+    auto end = i;
+    while (end < attributes.size() && attributes[end].tableHandle == service_handle)
+    {
+        ++end;
+    }
+    attributes.erase(attributes.begin() + i, attributes.begin() + end);
+    lock.unlock();
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.del.status = ESP_GATT_OK;
+    param.del.service_handle = service_handle;
+    queueGattsEvent(ESP_GATTS_DELETE_EVT, interface, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_response(
+    esp_gatt_if_t gatts_if,
+    uint16_t conn_id,
+    uint32_t trans_id,
+    esp_gatt_status_t status,
+    esp_gatt_rsp_t* rsp)
+{
+    if (trans_id != response.transactionId)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (response.received)
+    {
+        ++duplicateResponses;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    response.received = true;
+    response.status = status;
+    response.length = 0;
+    if (rsp && status == ESP_GATT_OK)
+    {
+        response.length = rsp->attr_value.len;
+        memcpy(response.value, rsp->attr_value.value, rsp->attr_value.len);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_indicate(
+    esp_gatt_if_t gatts_if,
+    uint16_t conn_id,
+    uint16_t attr_handle,
+    uint16_t value_len,
+    uint8_t* value,
+    bool need_confirm)
+{
+    HostTest::FakeBleStack::notificationSent(conn_id, attr_handle, need_confirm, value, value_len);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_set_attr_value(uint16_t attr_handle, uint16_t length, const uint8_t* value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto attribute = findAttribute(attr_handle);
+    if (!attribute)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    attribute->value.assign(value, value + length);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_service_change_indication(esp_gatt_if_t gatts_if, esp_bd_addr_t remote_bda)
+{
+    return ESP_OK;
+}
+
+namespace HostTest
+{
+
+void FakeBleStack::pump(void)
+{
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (events.empty())
+        {
+            return;
+        }
+        auto entry = events.front();
+        events.pop_front();
+        lock.unlock();
+
+        if (entry.gap)
+        {
+            gapCallback((esp_gap_ble_cb_event_t) entry.event, &entry.gapParam);
+            continue;
+        }
+        if (entry.event == ESP_GATTS_CREAT_ATTR_TAB_EVT)
+        {
+            entry.gattsParam.add_attr_tab.handles = entry.handles.data();
+        }
+        gattsCallback((esp_gatts_cb_event_t) entry.event, entry.interface, &entry.gattsParam);
+    }
+}
+
+size_t FakeBleStack::numberOfAttributes(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return attributes.size();
+}
+
+uint16_t FakeBleStack::findDescriptor(uint16_t valueHandle, uint16_t uuid)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto attribute = findAttribute(valueHandle);
+    if (!attribute)
+    {
+        return 0;
+    }
+
+    // the descriptors of a characteristic follow its value up to the next declaration
+    auto end = attributes.data() + attributes.size();
+    for (++attribute; attribute < end; ++attribute)
+    {
+        if (attribute->uuid == ESP_GATT_UUID_CHAR_DECLARE || attribute->uuid == ESP_GATT_UUID_PRI_SERVICE)
+        {
+            break;
+        }
+        if (attribute->uuid == uuid)
+        {
+            return attribute->handle;
+        }
+    }
+    return 0;
+}
+
+uint16_t FakeBleStack::connect(void)
+{
+    esp_ble_gatts_cb_param_t param = {};
+    param.connect.conn_id = nextConnectionId++;
+
+    // every application learns about the connection
+    for (size_t i = 0; i < numberOfInterfaces; ++i)
+    {
+        dispatch(ESP_GATTS_CONNECT_EVT, interfaces[i], &param);
+    }
+    return param.connect.conn_id;
+}
+
+void FakeBleStack::disconnect(uint16_t connectionId)
+{
+    esp_ble_gatts_cb_param_t param = {};
+    param.disconnect.conn_id = connectionId;
+    param.disconnect.reason = 0x13;
+    for (size_t i = 0; i < numberOfInterfaces; ++i)
+    {
+        dispatch(ESP_GATTS_DISCONNECT_EVT, interfaces[i], &param);
+    }
+}
+
+void FakeBleStack::setMtu(uint16_t connectionId, uint16_t mtu)
+{
+    esp_ble_gatts_cb_param_t param = {};
+    param.mtu.conn_id = connectionId;
+    param.mtu.mtu = mtu;
+    for (size_t i = 0; i < numberOfInterfaces; ++i)
+    {
+        dispatch(ESP_GATTS_MTU_EVT, interfaces[i], &param);
+    }
+}
+
+uint8_t FakeBleStack::read(uint16_t connectionId, uint16_t handle, uint8_t* value, uint16_t* length, uint16_t offset)
+{
+    *length = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto attribute = findAttribute(handle);
+    if (!attribute)
+    {
+        return ESP_GATT_INVALID_HANDLE;
+    }
+    if (!(attribute->permission & ESP_GATT_PERM_READ))
+    {
+        return ESP_GATT_READ_NOT_PERMIT;
+    }
+    if (attribute->autoResponse)
+    {
+        if (offset > attribute->value.size())
+        {
+            return ESP_GATT_INVALID_OFFSET;
+        }
+        *length = attribute->value.size() - offset;
+        memcpy(value, attribute->value.data() + offset, *length);
+        return ESP_GATT_OK;
+    }
+    auto interface = attribute->interface;
+    lock.unlock();
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.read.conn_id = connectionId;
+    param.read.trans_id = ++nextTransactionId;
+    param.read.handle = handle;
+    param.read.offset = offset;
+    param.read.is_long = offset != 0;
+    param.read.need_rsp = true;
+
+    auto status = request(ESP_GATTS_READ_EVT, interface, &param, param.read.trans_id);
+    if (!response.received)
+    {
+        return status;
+    }
+
+    *length = response.length;
+    memcpy(value, response.value, response.length);
+    return status;
+}
+
+uint8_t FakeBleStack::write(uint16_t connectionId, uint16_t handle, const uint8_t* value, uint16_t length)
+{
+    esp_gatt_if_t interface;
+    uint8_t status;
+    if (!findWritableAttribute(handle, &interface, &status))
+    {
+        return status;
+    }
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.write.conn_id = connectionId;
+    param.write.trans_id = ++nextTransactionId;
+    param.write.handle = handle;
+    param.write.need_rsp = true;
+    param.write.len = length;
+    param.write.value = (uint8_t*) value;
+    return request(ESP_GATTS_WRITE_EVT, interface, &param, param.write.trans_id);
+}
+
+uint8_t FakeBleStack::writeLong(uint16_t connectionId, uint16_t handle, const uint8_t* value, uint16_t length)
+{
+    esp_gatt_if_t interface;
+    uint8_t status;
+    if (!findWritableAttribute(handle, &interface, &status))
+    {
+        return status;
+    }
+
+    // Prepare Write requests carry handle and offset besides the value
+    const uint16_t chunkSize = ESP_GATT_DEF_BLE_MTU_SIZE - 5;
+    esp_ble_gatts_cb_param_t param = {};
+    for (uint16_t offset = 0; offset < length; offset += chunkSize)
+    {
+        param = {};
+        param.write.conn_id = connectionId;
+        param.write.trans_id = ++nextTransactionId;
+        param.write.handle = handle;
+        param.write.offset = offset;
+        param.write.need_rsp = true;
+        param.write.is_prep = true;
+        param.write.len = length - offset < chunkSize ? length - offset : chunkSize;
+        param.write.value = (uint8_t*) value + offset;
+        status = request(ESP_GATTS_WRITE_EVT, interface, &param, param.write.trans_id);
+        if (status != ESP_GATT_OK)
+        {
+            return status;
+        }
+    }
+
+    param = {};
+    param.exec_write.conn_id = connectionId;
+    param.exec_write.trans_id = ++nextTransactionId;
+    param.exec_write.exec_write_flag = ESP_GATT_PREP_WRITE_EXEC;
+    return request(ESP_GATTS_EXEC_WRITE_EVT, interface, &param, param.exec_write.trans_id);
+}
+
+uint8_t FakeBleStack::subscribe(uint16_t connectionId, uint16_t valueHandle, uint16_t clientConfiguration)
+{
+    // client configurations are answered by the application, see GattsService::generateAttributeTable()
+    auto handle = findDescriptor(valueHandle, ESP_GATT_UUID_CHAR_CLIENT_CONFIG);
+    if (!handle)
+    {
+        return ESP_GATT_INVALID_HANDLE;
+    }
+
+    uint8_t value[2] = { (uint8_t) (clientConfiguration & 0xff), (uint8_t) (clientConfiguration >> 8) };
+    return write(connectionId, handle, value, sizeof(value));
+}
+
+size_t FakeBleStack::duplicateResponses(void)
+{
+    return ::duplicateResponses;
+}
+
+} /* namespace HostTest */
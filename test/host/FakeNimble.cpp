@@ -0,0 +1,617 @@
+#include <host/ble_hs.h>
+#include <nimble/nimble_port.h>
+#include <nimble/nimble_port_freertos.h>
+#include <services/gap/ble_svc_gap.h>
+#include <services/gatt/ble_svc_gatt.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+#include "FakeBleStack.hpp"
+
+/*
+ * The NimBLE host as seen by the framework: the services handed over by ble_gatts_add_svcs() are laid out when the
+ * host synchronizes, which pump() does once the host task was started. The host task itself does not run, requests are
+ * dispatched to the access callbacks by the calling thread. Declarations and client configurations are answered by
+ * the fake like the real host does, subscriptions are reported as GAP events to the callback given when advertising
+ * started.
+ */
+
+#define FIRST_HANDLE (20)
+#define CONNECTIONS_MAX (8)
+
+#define BLE_HS_EINVAL (3)
+#define BLE_HS_EMSGSIZE (4)
+#define BLE_HS_ENOENT (5)
+#define BLE_HS_ENOMEM (6)
+
+#define CHARACTERISTIC_READ_FLAGS (BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN)
+#define CHARACTERISTIC_WRITE_FLAGS \
+    (BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN)
+
+namespace
+{
+
+enum class AttributeType
+{
+    SERVICE,
+    DECLARATION,
+    VALUE,
+    CLIENT_CONFIGURATION,
+    DESCRIPTOR,
+};
+
+struct Attribute
+{
+    uint16_t handle;
+    AttributeType type;
+    const struct ble_gatt_svc_def* service;
+    const struct ble_gatt_chr_def* characteristic;
+    const struct ble_gatt_dsc_def* descriptor;
+    uint16_t valueHandle;
+    uint16_t clientConfigurations[CONNECTIONS_MAX];
+};
+
+}
+
+struct ble_hs_cfg ble_hs_cfg;
+
+static std::mutex mutex;
+static std::vector<const struct ble_gatt_svc_def*> definitions;
+static std::vector<Attribute> attributes;
+static bool started;
+static bool synchronized;
+
+static ble_gap_event_fn* gapCallback;
+static void* gapCallbackArgument;
+static uint16_t nextConnectionId;
+
+static void addAttribute(
+    AttributeType type,
+    const struct ble_gatt_svc_def* service,
+    const struct ble_gatt_chr_def* characteristic = nullptr,
+    const struct ble_gatt_dsc_def* descriptor = nullptr,
+    uint16_t valueHandle = 0)
+{
+    Attribute attribute = {};
+    attribute.handle = FIRST_HANDLE + attributes.size();
+    attribute.type = type;
+    attribute.service = service;
+    attribute.characteristic = characteristic;
+    attribute.descriptor = descriptor;
+    attribute.valueHandle = valueHandle;
+    attributes.push_back(attribute);
+}
+
+static void layOutServices(void)
+{
+    // the same order as the real host: declaration, value, client configuration, descriptors
+    for (auto service : definitions)
+    {
+        addAttribute(AttributeType::SERVICE, service);
+        for (auto characteristic = service->characteristics; characteristic && characteristic->uuid; ++characteristic)
+        {
+            addAttribute(AttributeType::DECLARATION, service, characteristic);
+            uint16_t valueHandle = FIRST_HANDLE + attributes.size();
+            addAttribute(AttributeType::VALUE, service, characteristic, nullptr, valueHandle);
+            if (characteristic->val_handle)
+            {
+                *characteristic->val_handle = valueHandle;
+            }
+            if (characteristic->flags & (BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE))
+            {
+                addAttribute(AttributeType::CLIENT_CONFIGURATION, service, characteristic, nullptr, valueHandle);
+            }
+            for (auto descriptor = characteristic->descriptors; descriptor && descriptor->uuid; ++descriptor)
+            {
+                addAttribute(AttributeType::DESCRIPTOR, service, characteristic, descriptor, valueHandle);
+            }
+        }
+    }
+}
+
+static Attribute* findAttribute(uint16_t handle)
+{
+    if (handle < FIRST_HANDLE || (size_t) (handle - FIRST_HANDLE) >= attributes.size())
+    {
+        return nullptr;
+    }
+    return &attributes[handle - FIRST_HANDLE];
+}
+
+static size_t uuidLength(const ble_uuid_t* uuid)
+{
+    switch (uuid->type)
+    {
+        case BLE_UUID_TYPE_16:
+            return 2;
+        case BLE_UUID_TYPE_32:
+            return 4;
+        default:
+            return 16;
+    }
+}
+
+static void copyUuid(const ble_uuid_t* uuid, uint8_t* buffer)
+{
+    switch (uuid->type)
+    {
+        case BLE_UUID_TYPE_16:
+        {
+            auto value = ((const ble_uuid16_t*) uuid)->value;
+            buffer[0] = value & 0xff;
+            buffer[1] = value >> 8;
+            break;
+        }
+        case BLE_UUID_TYPE_32:
+        {
+            auto value = ((const ble_uuid32_t*) uuid)->value;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                buffer[i] = (value >> (8 * i)) & 0xff;
+            }
+            break;
+        }
+        default:
+            memcpy(buffer, ((const ble_uuid128_t*) uuid)->value, 16);
+            break;
+    }
+}
+
+static bool sameUuid(const ble_uuid_t* a, const ble_uuid_t* b)
+{
+    uint8_t bytesA[16];
+    uint8_t bytesB[16];
+    if (a->type != b->type)
+    {
+        return false;
+    }
+    copyUuid(a, bytesA);
+    copyUuid(b, bytesB);
+    return memcmp(bytesA, bytesB, uuidLength(a)) == 0;
+}
+
+static int sendGapEvent(struct ble_gap_event* event)
+{
+    return gapCallback ? gapCallback(event, gapCallbackArgument) : 0;
+}
+
+uint16_t os_mbuf_pktlen(const struct os_mbuf* om)
+{
+    return om->om_len;
+}
+
+int os_mbuf_append(struct os_mbuf* om, const void* data, uint16_t len)
+{
+    if (om->om_len + len > sizeof(om->om_data))
+    {
+        return BLE_HS_ENOMEM;
+    }
+    memcpy(om->om_data + om->om_len, data, len);
+    om->om_len += len;
+    return 0;
+}
+
+int ble_hs_mbuf_to_flat(const struct os_mbuf* om, void* flat, uint16_t max_len, uint16_t* out_copy_len)
+{
+    auto length = om->om_len < max_len ? om->om_len : max_len;
+    memcpy(flat, om->om_data, length);
+    if (out_copy_len)
+    {
+        *out_copy_len = length;
+    }
+    return length < om->om_len ? BLE_HS_EMSGSIZE : 0;
+}
+
+struct os_mbuf* ble_hs_mbuf_from_flat(const void* buf, uint16_t len)
+{
+    if (len > BLE_ATT_ATTR_MAX_LEN)
+    {
+        return nullptr;
+    }
+    auto om = new os_mbuf;
+    om->om_len = len;
+    memcpy(om->om_data, buf, len);
+    return om;
+}
+
+int ble_att_set_preferred_mtu(uint16_t mtu)
+{
+    return mtu >= BLE_ATT_MTU_DFLT ? 0 : BLE_HS_EINVAL;
+}
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def* defs)
+{
+    return defs ? 0 : BLE_HS_EINVAL;
+}
+
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def* svcs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (started)
+    {
+        return BLE_HS_EINVAL;
+    }
+    for (auto service = svcs; service->type != BLE_GATT_SVC_TYPE_END; ++service)
+    {
+        definitions.push_back(service);
+    }
+    return 0;
+}
+
+int ble_gatts_find_svc(const ble_uuid_t* uuid, uint16_t* out_handle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& attribute : attributes)
+    {
+        if (attribute.type == AttributeType::SERVICE && sameUuid(attribute.service->uuid, uuid))
+        {
+            *out_handle = attribute.handle;
+            return 0;
+        }
+    }
+    return BLE_HS_ENOENT;
+}
+
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf* om)
+{
+    HostTest::FakeBleStack::notificationSent(conn_handle, att_handle, false, om->om_data, om->om_len);
+    delete om;
+    return 0;
+}
+
+int ble_gattc_indicate_custom(uint16_t conn_handle, uint16_t chr_val_handle, struct os_mbuf* txom)
+{
+    HostTest::FakeBleStack::notificationSent(conn_handle, chr_val_handle, true, txom->om_data, txom->om_len);
+    delete txom;
+    return 0;
+}
+
+int ble_gap_adv_set_data(const uint8_t* data, int data_len)
+{
+    return data_len <= 31 ? 0 : BLE_HS_EMSGSIZE;
+}
+
+int ble_gap_adv_rsp_set_data(const uint8_t* data, int data_len)
+{
+    return data_len <= 31 ? 0 : BLE_HS_EMSGSIZE;
+}
+
+int ble_gap_adv_start(
+    uint8_t own_addr_type,
+    const ble_addr_t* direct_addr,
+    int32_t duration_ms,
+    const struct ble_gap_adv_params* adv_params,
+    ble_gap_event_fn* cb,
+    void* cb_arg)
+{
+    gapCallback = cb;
+    gapCallbackArgument = cb_arg;
+    return 0;
+}
+
+int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params* params)
+{
+    return 0;
+}
+
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason)
+{
+    return 0;
+}
+
+int ble_hs_id_infer_auto(int privacy, uint8_t* out_addr_type)
+{
+    *out_addr_type = 0;
+    return 0;
+}
+
+void ble_svc_gap_init(void)
+{
+}
+
+int ble_svc_gap_device_name_set(const char* name)
+{
+    return name ? 0 : BLE_HS_EINVAL;
+}
+
+int ble_svc_gap_device_appearance_set(uint16_t appearance)
+{
+    return 0;
+}
+
+void ble_svc_gatt_init(void)
+{
+}
+
+esp_err_t nimble_port_init(void)
+{
+    return ESP_OK;
+}
+
+void nimble_port_run(void)
+{
+}
+
+int nimble_port_stop(void)
+{
+    return 0;
+}
+
+void nimble_port_freertos_init(void (*host_task_fn)(void* parameter))
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    started = true;
+}
+
+void nimble_port_freertos_deinit(void)
+{
+}
+
+namespace HostTest
+{
+
+void FakeBleStack::pump(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!started || synchronized)
+        {
+            return;
+        }
+        layOutServices();
+        synchronized = true;
+    }
+    ble_hs_cfg.sync_cb();
+}
+
+size_t FakeBleStack::numberOfAttributes(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return attributes.size();
+}
+
+uint16_t FakeBleStack::findDescriptor(uint16_t valueHandle, uint16_t uuid)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto attribute = findAttribute(valueHandle + 1); attribute; attribute = findAttribute(attribute->handle + 1))
+    {
+        if (attribute->valueHandle != valueHandle)
+        {
+            break;
+        }
+        if (attribute->type == AttributeType::CLIENT_CONFIGURATION && uuid == 0x2902)
+        {
+            return attribute->handle;
+        }
+        auto descriptorUuid = attribute->descriptor ? attribute->descriptor->uuid : nullptr;
+        if (descriptorUuid && descriptorUuid->type == BLE_UUID_TYPE_16
+            && ((const ble_uuid16_t*) descriptorUuid)->value == uuid)
+        {
+            return attribute->handle;
+        }
+    }
+    return 0;
+}
+
+uint16_t FakeBleStack::connect(void)
+{
+    struct ble_gap_event event = {};
+    event.type = BLE_GAP_EVENT_CONNECT;
+    event.connect.status = 0;
+    event.connect.conn_handle = nextConnectionId++;
+    sendGapEvent(&event);
+    return event.connect.conn_handle;
+}
+
+void FakeBleStack::disconnect(uint16_t connectionId)
+{
+    if (connectionId < CONNECTIONS_MAX)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& attribute : attributes)
+        {
+            attribute.clientConfigurations[connectionId] = 0;
+        }
+    }
+
+    struct ble_gap_event event = {};
+    event.type = BLE_GAP_EVENT_DISCONNECT;
+    event.disconnect.reason = BLE_ERR_REM_USER_CONN_TERM;
+    event.disconnect.conn.conn_handle = connectionId;
+    sendGapEvent(&event);
+}
+
+void FakeBleStack::setMtu(uint16_t connectionId, uint16_t mtu)
+{
+    struct ble_gap_event event = {};
+    event.type = BLE_GAP_EVENT_MTU;
+    event.mtu.conn_handle = connectionId;
+    event.mtu.value = mtu;
+    sendGapEvent(&event);
+}
+
+uint8_t FakeBleStack::read(uint16_t connectionId, uint16_t handle, uint8_t* value, uint16_t* length, uint16_t offset)
+{
+    struct os_mbuf om;
+    om.om_len = 0;
+    *length = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto attribute = findAttribute(handle);
+    if (!attribute)
+    {
+        return BLE_ATT_ERR_INVALID_HANDLE;
+    }
+
+    struct ble_gatt_access_ctxt context = {};
+    context.om = &om;
+    ble_gatt_access_fn* callback = nullptr;
+    void* argument = nullptr;
+    switch (attribute->type)
+    {
+        case AttributeType::SERVICE:
+            om.om_len = uuidLength(attribute->service->uuid);
+            copyUuid(attribute->service->uuid, om.om_data);
+            break;
+        case AttributeType::DECLARATION:
+            om.om_data[0] = attribute->characteristic->flags & 0xff;
+            om.om_data[1] = (handle + 1) & 0xff;
+            om.om_data[2] = (handle + 1) >> 8;
+            om.om_len = 3 + uuidLength(attribute->characteristic->uuid);
+            copyUuid(attribute->characteristic->uuid, om.om_data + 3);
+            break;
+        case AttributeType::VALUE:
+            if (!(attribute->characteristic->flags & CHARACTERISTIC_READ_FLAGS))
+            {
+                return BLE_ATT_ERR_READ_NOT_PERMITTED;
+            }
+            context.op = BLE_GATT_ACCESS_OP_READ_CHR;
+            context.chr = attribute->characteristic;
+            callback = attribute->characteristic->access_cb;
+            argument = attribute->characteristic->arg;
+            break;
+        case AttributeType::CLIENT_CONFIGURATION:
+        {
+            auto clientConfiguration = connectionId < CONNECTIONS_MAX
+                ? attribute->clientConfigurations[connectionId]
+                : 0;
+            om.om_data[0] = clientConfiguration & 0xff;
+            om.om_data[1] = clientConfiguration >> 8;
+            om.om_len = 2;
+            break;
+        }
+        case AttributeType::DESCRIPTOR:
+            if (!(attribute->descriptor->att_flags & BLE_ATT_F_READ))
+            {
+                return BLE_ATT_ERR_READ_NOT_PERMITTED;
+            }
+            context.op = BLE_GATT_ACCESS_OP_READ_DSC;
+            context.dsc = attribute->descriptor;
+            callback = attribute->descriptor->access_cb;
+            argument = attribute->descriptor->arg;
+            break;
+    }
+    lock.unlock();
+
+    if (callback)
+    {
+        auto status = callback(connectionId, handle, &context, argument);
+        if (status)
+        {
+            return status;
+        }
+    }
+
+    // the host applies the offset of Read Blob requests
+    if (offset > om.om_len)
+    {
+        return BLE_ATT_ERR_INVALID_OFFSET;
+    }
+    *length = om.om_len - offset;
+    memcpy(value, om.om_data + offset, *length);
+    return 0;
+}
+
+uint8_t FakeBleStack::write(uint16_t connectionId, uint16_t handle, const uint8_t* value, uint16_t length)
+{
+    if (length > BLE_ATT_ATTR_MAX_LEN)
+    {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto attribute = findAttribute(handle);
+    if (!attribute)
+    {
+        return BLE_ATT_ERR_INVALID_HANDLE;
+    }
+
+    struct os_mbuf om;
+    om.om_len = length;
+    memcpy(om.om_data, value, length);
+    struct ble_gatt_access_ctxt context = {};
+    context.om = &om;
+    ble_gatt_access_fn* callback = nullptr;
+    void* argument = nullptr;
+    switch (attribute->type)
+    {
+        case AttributeType::VALUE:
+            if (!(attribute->characteristic->flags & CHARACTERISTIC_WRITE_FLAGS))
+            {
+                return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+            }
+            context.op = BLE_GATT_ACCESS_OP_WRITE_CHR;
+            context.chr = attribute->characteristic;
+            callback = attribute->characteristic->access_cb;
+            argument = attribute->characteristic->arg;
+            break;
+        case AttributeType::CLIENT_CONFIGURATION:
+        {
+            if (length != 2)
+            {
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+            if (connectionId >= CONNECTIONS_MAX)
+            {
+                return BLE_ATT_ERR_UNLIKELY;
+            }
+
+            // the host keeps the client configuration and reports the change
+            struct ble_gap_event event = {};
+            event.type = BLE_GAP_EVENT_SUBSCRIBE;
+            event.subscribe.conn_handle = connectionId;
+            event.subscribe.attr_handle = attribute->valueHandle;
+            auto previous = attribute->clientConfigurations[connectionId];
+            auto current = (uint16_t) (value[0] | (value[1] << 8));
+            attribute->clientConfigurations[connectionId] = current;
+            event.subscribe.prev_notify = (previous & 0x0001) != 0;
+            event.subscribe.prev_indicate = (previous & 0x0002) != 0;
+            event.subscribe.cur_notify = (current & 0x0001) != 0;
+            event.subscribe.cur_indicate = (current & 0x0002) != 0;
+            lock.unlock();
+            sendGapEvent(&event);
+            return 0;
+        }
+        case AttributeType::DESCRIPTOR:
+            if (!(attribute->descriptor->att_flags & BLE_ATT_F_WRITE))
+            {
+                return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+            }
+            context.op = BLE_GATT_ACCESS_OP_WRITE_DSC;
+            context.dsc = attribute->descriptor;
+            callback = attribute->descriptor->access_cb;
+            argument = attribute->descriptor->arg;
+            break;
+        default:
+            return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+    lock.unlock();
+
+    return callback(connectionId, handle, &context, argument);
+}
+
+uint8_t FakeBleStack::writeLong(uint16_t connectionId, uint16_t handle, const uint8_t* value, uint16_t length)
+{
+    // the host answers the Prepare Write requests and hands over the reassembled value
+    return write(connectionId, handle, value, length);
+}
+
+uint8_t FakeBleStack::subscribe(uint16_t connectionId, uint16_t valueHandle, uint16_t clientConfiguration)
+{
+    auto handle = findDescriptor(valueHandle, 0x2902);
+    if (!handle)
+    {
+        return BLE_ATT_ERR_INVALID_HANDLE;
+    }
+
+    uint8_t value[2] = { (uint8_t) (clientConfiguration & 0xff), (uint8_t) (clientConfiguration >> 8) };
+    return write(connectionId, handle, value, sizeof(value));
+}
+
+size_t FakeBleStack::duplicateResponses(void)
+{
+    // responses are the return values of the access callbacks
+    return 0;
+}
+
+} /* namespace HostTest */
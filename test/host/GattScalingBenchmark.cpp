@@ -0,0 +1,203 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include "BleServer.hpp"
+#include "FakeBleStack.hpp"
+#include "GattArena.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HandleIndex.hpp"
+#include "HostTest.hpp"
+#include "UInt16GattCharacteristic.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+using HostTest::FakeBleStack;
+
+#define CHARACTERISTICS_PER_SERVICE (20)
+#define REQUESTS (200000)
+
+// requests at the largest database may take this many times as long as at the smallest one: cache misses grow with
+// the database, a linear walk of 2000 characteristics instead of 10 would take about 200 times as long
+#define DISPATCH_GROWTH_MAX (20.0)
+
+/*
+ * Registration time and per-request dispatch cost against the size of the GATT database, on the fake host the
+ * benchmark is linked with. A database is registered once per process, so every size runs in a child process. Each
+ * service has CHARACTERISTICS_PER_SERVICE read/write characteristics of two attributes, requests go to random value
+ * handles and include the attribute lookup of the fake host.
+ */
+struct Result
+{
+    size_t attributes;
+    double registrationMs;
+    double readNs;
+    double writeNs;
+    size_t arenaUsed;
+    int failures;
+};
+
+static Result run(size_t numberOfCharacteristics)
+{
+    auto numberOfServices = (numberOfCharacteristics + CHARACTERISTICS_PER_SERVICE - 1) / CHARACTERISTICS_PER_SERVICE;
+    std::vector<std::unique_ptr<UInt16GattCharacteristic>> characteristics;
+    std::vector<std::unique_ptr<GattsService>> services;
+    GattsApplication application(0, "Scaling");
+
+    // distinct service UUIDs, not advertised
+    for (size_t i = 0; i < numberOfServices; ++i)
+    {
+        services.emplace_back(new GattsService(BleServiceUuid(BleUuid::Width::UUID_32, 0x21050000 + i, false)));
+    }
+    for (size_t i = 0; i < numberOfCharacteristics; ++i)
+    {
+        characteristics.emplace_back(new UInt16GattCharacteristic(
+            BleUuid(BleUuid::Width::UUID_16, 0x5000 + i % CHARACTERISTICS_PER_SERVICE),
+            ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+            nullptr,
+            i));
+        services[i / CHARACTERISTICS_PER_SERVICE]->addCharacteristic(characteristics.back().get());
+    }
+
+    Result result = {};
+    auto start = HostTest::seconds();
+    BleServer::instance()->probe();
+    for (auto& service : services)
+    {
+        application.addService(service.get());
+    }
+    BleServer::instance()->addGattsApplication(&application);
+    FakeBleStack::pump();
+    result.registrationMs = (HostTest::seconds() - start) * 1e3;
+    result.attributes = FakeBleStack::numberOfAttributes();
+    result.arenaUsed = GattArena::instance()->used();
+
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+    CHECK(HandleIndex::instance()->size() == numberOfCharacteristics);
+    CHECK(result.attributes == numberOfServices + 2 * numberOfCharacteristics);
+
+    std::mt19937 random(1);
+    std::vector<uint16_t> handles(REQUESTS);
+    std::vector<uint16_t> expected(REQUESTS);
+    for (size_t i = 0; i < REQUESTS; ++i)
+    {
+        auto index = random() % numberOfCharacteristics;
+        handles[i] = characteristics[index]->handle();
+        expected[i] = index;
+    }
+
+    auto connectionId = FakeBleStack::connect();
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t length;
+    size_t mismatches = 0;
+    start = HostTest::seconds();
+    for (size_t i = 0; i < REQUESTS; ++i)
+    {
+        if (FakeBleStack::read(connectionId, handles[i], value, &length) || (value[0] | (value[1] << 8)) != expected[i])
+        {
+            ++mismatches;
+        }
+    }
+    result.readNs = (HostTest::seconds() - start) * 1e9 / REQUESTS;
+
+    start = HostTest::seconds();
+    for (size_t i = 0; i < REQUESTS; ++i)
+    {
+        if (FakeBleStack::write(connectionId, handles[i], (const uint8_t*) &expected[i], sizeof(uint16_t)))
+        {
+            ++mismatches;
+        }
+    }
+    result.writeNs = (HostTest::seconds() - start) * 1e9 / REQUESTS;
+    CHECK(mismatches == 0);
+
+    result.failures = HostTest::failures;
+    return result;
+}
+
+static bool runInChild(size_t numberOfCharacteristics, Result* result)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    auto pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        auto childResult = run(numberOfCharacteristics);
+        auto written = write(fds[1], &childResult, sizeof(childResult));
+        _exit(written == sizeof(childResult) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    auto received = pid > 0 ? read(fds[0], result, sizeof(*result)) : 0;
+    close(fds[0]);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid)
+    {
+        return false;
+    }
+    return received == sizeof(*result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+    {
+        sizes.push_back(strtoul(argv[i], nullptr, 0));
+    }
+    if (sizes.empty())
+    {
+        sizes = {10, 100, 1000, 2000};
+    }
+
+    printf("%d characteristics per service, %d requests\n", CHARACTERISTICS_PER_SERVICE, REQUESTS);
+    printf(
+        "%16s %10s %16s %10s %10s %12s\n",
+        "characteristics",
+        "attributes",
+        "registration ms",
+        "read ns",
+        "write ns",
+        "arena bytes");
+    std::vector<Result> results;
+    for (auto size : sizes)
+    {
+        Result result;
+        if (!CHECK(size && size <= HANDLE_INDEX_SIZE && runInChild(size, &result)))
+        {
+            continue;
+        }
+        printf(
+            "%16zu %10zu %16.2f %10.1f %10.1f %12zu\n",
+            size,
+            result.attributes,
+            result.registrationMs,
+            result.readNs,
+            result.writeNs,
+            result.arenaUsed);
+        HostTest::failures += result.failures;
+        results.push_back(result);
+    }
+
+    // handles are looked up by binary search, a linear walk would grow with the number of attributes
+    if (results.size() > 1)
+    {
+        auto& smallest = results.front();
+        auto& largest = results.back();
+        CHECK(largest.readNs < DISPATCH_GROWTH_MAX * smallest.readNs);
+        CHECK(largest.writeNs < DISPATCH_GROWTH_MAX * smallest.writeNs);
+    }
+
+    return HostTest::result();
+}
@@ -0,0 +1,24 @@
+# Compiles the example schema with tools/gatt_schema.py and parses the result with GattSchemaTest, then checks that
+# the compiler rejects the encrypted and signed permissions GattsService does not support.
+execute_process(COMMAND ${PYTHON3_EXECUTABLE} ${COMPILER} compile ${INPUT} ${OUTPUT} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "compiling ${INPUT} failed")
+endif()
+
+execute_process(COMMAND ${TEST} ${OUTPUT} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "parsing ${OUTPUT} failed")
+endif()
+
+foreach(permission read_encrypted read_enc_mitm write_encrypted write_enc_mitm write_signed write_signed_mitm)
+    file(WRITE ${OUTPUT}.json
+        "{\"services\": [{\"uuid\": \"0x1234\", \"characteristics\": "
+        "[{\"uuid\": \"0x5678\", \"permission\": [\"read\", \"${permission}\"], \"length\": 1}]}]}")
+    execute_process(
+        COMMAND ${PYTHON3_EXECUTABLE} ${COMPILER} compile ${OUTPUT}.json ${OUTPUT}.rejected
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error)
+    if(result EQUAL 0 OR NOT error MATCHES "unsupported permission")
+        message(FATAL_ERROR "the compiler accepted the permission ${permission}")
+    endif()
+endforeach()
@@ -0,0 +1,353 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "GattSchema.hpp"
+#include "HostTest.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using Esp32::GattSchema;
+
+#define PERMISSION_READ_WRITE (GATT_SCHEMA_PERMISSION_READ | GATT_SCHEMA_PERMISSION_WRITE)
+
+/*
+ * Writes schemas in the format described in GattSchema.hpp, with a correct header unless a test changes it later.
+ */
+class SchemaBuilder
+{
+public:
+    SchemaBuilder& service(uint8_t uuidLength, bool advertise, uint8_t numberOfCharacteristics)
+    {
+        put8(uuidLength);
+        put8(advertise ? 1 : 0);
+        put8(numberOfCharacteristics);
+        put8(0);
+        putUuid(uuidLength);
+        ++m_numberOfServices;
+        return *this;
+    }
+
+    SchemaBuilder& characteristic(
+        uint8_t uuidLength,
+        uint16_t permission,
+        uint16_t length,
+        const std::string& value = "",
+        const char* description = nullptr,
+        uint8_t notification = 0)
+    {
+        put8(uuidLength);
+        put8(notification);
+        put16(permission);
+        put16(length);
+        put16(value.size());
+        put16(description ? strlen(description) + 1 : 0);
+        put16(0);
+        putUuid(uuidLength);
+        putPadded(value.data(), value.size());
+        if (description)
+        {
+            putPadded(description, strlen(description) + 1);
+        }
+        return *this;
+    }
+
+    std::vector<uint8_t> build(void) const
+    {
+        std::vector<uint8_t> schema(GATT_SCHEMA_HEADER_LENGTH + m_body.size());
+        std::copy(m_body.begin(), m_body.end(), schema.begin() + GATT_SCHEMA_HEADER_LENGTH);
+        schema[4] = GATT_SCHEMA_VERSION;
+        schema[5] = m_numberOfServices;
+        seal(schema);
+        return schema;
+    }
+
+    // writes magic, total length and checksum for the current size and content
+    static void seal(std::vector<uint8_t>& schema)
+    {
+        write32(schema.data(), GATT_SCHEMA_MAGIC);
+        write32(schema.data() + 8, schema.size());
+        write32(
+            schema.data() + 12,
+            GattSchema::crc32(schema.data() + GATT_SCHEMA_HEADER_LENGTH, schema.size() - GATT_SCHEMA_HEADER_LENGTH));
+    }
+
+    static void write32(uint8_t* data, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data[i] = (uint8_t) (value >> (8 * i));
+        }
+    }
+
+protected:
+
+    std::vector<uint8_t> m_body;
+    uint8_t m_numberOfServices = 0;
+
+    void put8(uint8_t value)
+    {
+        m_body.push_back(value);
+    }
+
+    void put16(uint16_t value)
+    {
+        put8(value & 0xff);
+        put8(value >> 8);
+    }
+
+    void putUuid(uint8_t uuidLength)
+    {
+        auto fieldLength = uuidLength == 16 ? 16 : 4;
+        for (int i = 0; i < fieldLength; ++i)
+        {
+            put8(i < uuidLength ? 0x10 + i : 0);
+        }
+    }
+
+    void putPadded(const void* data, size_t length)
+    {
+        m_body.insert(m_body.end(), (const uint8_t*) data, (const uint8_t*) data + length);
+        m_body.resize((m_body.size() + 3) & ~(size_t) 3);
+    }
+};
+
+static bool parses(const std::vector<uint8_t>& schema)
+{
+    try
+    {
+        GattSchema gattSchema(schema.data(), schema.size());
+        return true;
+    }
+    catch (std::invalid_argument&)
+    {
+        return false;
+    }
+}
+
+static std::vector<uint8_t> validSchema(void)
+{
+    return SchemaBuilder()
+        .service(4, true, 2)
+        .characteristic(4, PERMISSION_READ_WRITE, 2, "BA", "Foo")
+        .characteristic(2, GATT_SCHEMA_PERMISSION_READ, 2, "21", "Bar", 1)
+        .service(2, false, 1)
+        .characteristic(2, PERMISSION_READ_WRITE, 20, "Baz", "Baz")
+        .service(16, true, 2)
+        .characteristic(16, GATT_SCHEMA_PERMISSION_READ, 12, "firmware 1.0")
+        .characteristic(16, 0, GATT_SCHEMA_VALUE_LENGTH_MAX, "", nullptr, 2)
+        .build();
+}
+
+static void testCrc32(void)
+{
+    // check value of CRC-32/ISO-HDLC as used by zlib
+    const char text[] = "123456789";
+    CHECK(GattSchema::crc32((const uint8_t*) text, strlen(text)) == 0xcbf43926);
+    CHECK(GattSchema::crc32(nullptr, 0) == 0);
+}
+
+static void testValid(void)
+{
+    auto schema = validSchema();
+    // the partition is larger than the schema
+    schema.resize(schema.size() + 4096, 0xff);
+
+    GattSchema gattSchema(schema.data(), schema.size());
+    CHECK(gattSchema.numberOfServices() == 3);
+    CHECK(gattSchema.numberOfCharacteristics() == 5);
+    CHECK(gattSchema.length() == schema.size() - 4096);
+
+    GattSchema::Service service;
+    GattSchema::Characteristic characteristic;
+    auto record = gattSchema.readService(gattSchema.firstRecord(), &service);
+    CHECK(service.uuidLength == 4 && service.advertise && service.numberOfCharacteristics == 2);
+    CHECK(service.uuid[0] == 0x10 && service.uuid[3] == 0x13);
+
+    record = gattSchema.readCharacteristic(record, &characteristic);
+    CHECK(characteristic.uuidLength == 4);
+    CHECK(characteristic.permission == PERMISSION_READ_WRITE);
+    CHECK(characteristic.notification == 0);
+    CHECK(characteristic.length == 2);
+    CHECK(characteristic.initialValueLength == 2 && !memcmp(characteristic.initialValue, "BA", 2));
+    CHECK(characteristic.description && !strcmp(characteristic.description, "Foo"));
+
+    record = gattSchema.readCharacteristic(record, &characteristic);
+    CHECK(characteristic.uuidLength == 2 && characteristic.notification == 1);
+
+    record = gattSchema.readService(record, &service);
+    CHECK(service.uuidLength == 2 && !service.advertise && service.numberOfCharacteristics == 1);
+    record = gattSchema.readCharacteristic(record, &characteristic);
+    CHECK(characteristic.length == 20 && characteristic.initialValueLength == 3);
+
+    record = gattSchema.readService(record, &service);
+    CHECK(service.uuidLength == 16 && service.uuid[15] == 0x1f);
+    record = gattSchema.readCharacteristic(record, &characteristic);
+    CHECK(characteristic.description == nullptr);
+    record = gattSchema.readCharacteristic(record, &characteristic);
+    CHECK(characteristic.permission == 0 && characteristic.notification == 2);
+    CHECK(characteristic.length == GATT_SCHEMA_VALUE_LENGTH_MAX && characteristic.initialValueLength == 0);
+    CHECK(record == schema.data() + gattSchema.length());
+
+    // reading beyond the schema is refused
+    CHECK_THROWS(gattSchema.readService(record, &service), std::invalid_argument);
+}
+
+static void testTruncated(void)
+{
+    auto schema = validSchema();
+    CHECK_THROWS(GattSchema(nullptr, schema.size()), std::invalid_argument);
+
+    // a partition smaller than the length in the header
+    for (size_t size = 0; size < schema.size(); ++size)
+    {
+        CHECK(!parses(std::vector<uint8_t>(schema.begin(), schema.begin() + size)));
+    }
+
+    // a consistent header over a cut body ends within a record or misses records
+    for (size_t size = GATT_SCHEMA_HEADER_LENGTH; size < schema.size(); ++size)
+    {
+        std::vector<uint8_t> truncated(schema.begin(), schema.begin() + size);
+        SchemaBuilder::seal(truncated);
+        CHECK(!parses(truncated));
+    }
+}
+
+static void testCorrupted(void)
+{
+    auto schema = validSchema();
+
+    // single bit errors are detected, in the header by the field checks, in the body by the checksum
+    size_t accepted = 0;
+    for (size_t offset = 0; offset < schema.size(); ++offset)
+    {
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            auto corrupted = schema;
+            corrupted[offset] ^= 1 << bit;
+            if (parses(corrupted))
+            {
+                ++accepted;
+            }
+        }
+    }
+    // the reserved u16 of the header is not checked
+    CHECK(accepted == 16);
+
+    // corruption with a matching checksum is caught by the field checks or parses into a consistent schema
+    for (size_t offset = GATT_SCHEMA_HEADER_LENGTH; offset < schema.size(); ++offset)
+    {
+        for (auto value : {0x00, 0x03, 0x11, 0x80, 0xff})
+        {
+            auto corrupted = schema;
+            corrupted[offset] = value;
+            SchemaBuilder::seal(corrupted);
+            try
+            {
+                GattSchema gattSchema(corrupted.data(), corrupted.size());
+                CHECK(gattSchema.length() == corrupted.size());
+            }
+            catch (std::invalid_argument&)
+            {
+            }
+        }
+    }
+}
+
+static void testInvalidFields(void)
+{
+    auto schema = validSchema();
+
+    auto badMagic = schema;
+    badMagic[0] = 'X';
+    CHECK(!parses(badMagic));
+
+    auto badVersion = schema;
+    badVersion[4] = GATT_SCHEMA_VERSION + 1;
+    SchemaBuilder::seal(badVersion);
+    CHECK(!parses(badVersion));
+
+    auto trailing = schema;
+    trailing.resize(trailing.size() + 4);
+    SchemaBuilder::seal(trailing);
+    CHECK(!parses(trailing));
+
+    CHECK(parses(SchemaBuilder().build()));
+    CHECK(!parses(SchemaBuilder().service(3, true, 1).characteristic(2, GATT_SCHEMA_PERMISSION_READ, 1).build()));
+    CHECK(!parses(SchemaBuilder().service(2, true, 0).build()));
+    CHECK(!parses(SchemaBuilder().service(2, true, 1).characteristic(8, GATT_SCHEMA_PERMISSION_READ, 1).build()));
+    CHECK(!parses(SchemaBuilder().service(2, true, 1).characteristic(2, GATT_SCHEMA_PERMISSION_READ, 0).build()));
+    CHECK(!parses(SchemaBuilder()
+        .service(2, true, 1)
+        .characteristic(2, GATT_SCHEMA_PERMISSION_READ, GATT_SCHEMA_VALUE_LENGTH_MAX + 1)
+        .build()));
+    CHECK(!parses(SchemaBuilder().service(2, true, 1).characteristic(2, GATT_SCHEMA_PERMISSION_READ, 2, "abc").build()));
+    CHECK(!parses(SchemaBuilder()
+        .service(2, true, 1)
+        .characteristic(2, GATT_SCHEMA_PERMISSION_READ, 2, "", nullptr, 3)
+        .build()));
+
+    // a description without its terminating zero
+    auto unterminated = SchemaBuilder().service(2, true, 1).characteristic(2, GATT_SCHEMA_PERMISSION_READ, 2, "", "abc")
+        .build();
+    unterminated[unterminated.size() - 1] = 'x';
+    SchemaBuilder::seal(unterminated);
+    CHECK(!parses(unterminated));
+}
+
+static void testUnsupportedPermissions(void)
+{
+    // encrypted and signed access (ESP_GATT_PERM_READ_ENCRYPTED ... ESP_GATT_PERM_WRITE_SIGNED_MITM)
+    const uint16_t permissions[] = {0x0002, 0x0004, 0x0020, 0x0040, 0x0080, 0x0100, 0x0001 | 0x0020};
+    for (auto permission : permissions)
+    {
+        auto schema = SchemaBuilder().service(2, true, 1).characteristic(2, permission, 2).build();
+        try
+        {
+            GattSchema gattSchema(schema.data(), schema.size());
+            CHECK(!"unsupported permission accepted");
+        }
+        catch (std::invalid_argument& e)
+        {
+            CHECK(!strcmp(e.what(), "unsupported permission in GATT schema"));
+        }
+    }
+}
+
+static void testCompiledSchema(const char* fileName)
+{
+    // a schema compiled by tools/gatt_schema.py
+    auto file = fopen(fileName, "rb");
+    CHECK(file);
+    if (!file)
+    {
+        return;
+    }
+    std::vector<uint8_t> schema(65536);
+    schema.resize(fread(schema.data(), 1, schema.size(), file));
+    fclose(file);
+
+    GattSchema gattSchema(schema.data(), schema.size());
+    CHECK(gattSchema.length() == schema.size());
+    CHECK(gattSchema.numberOfServices() > 0);
+    CHECK(gattSchema.numberOfCharacteristics() >= gattSchema.numberOfServices());
+}
+
+int main(int argc, char** argv)
+{
+    testCrc32();
+    testValid();
+    testTruncated();
+    testCorrupted();
+    testInvalidFields();
+    testUnsupportedPermissions();
+    if (argc > 1)
+    {
+        testCompiledSchema(argv[1]);
+    }
+
+    return HostTest::result();
+}
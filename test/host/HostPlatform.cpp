@@ -0,0 +1,464 @@
+#include <esp_bt.h>
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <nvs_flash.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+/*
+ * The parts of ESP-IDF and FreeRTOS the framework uses, implemented by the C++ standard library so that the sources
+ * in main/ run on the host: tasks and timers are threads, mutexes are std::recursive_timed_mutex, spinlocks spin on
+ * an atomic owner. The Bluetooth host is faked separately, see FakeBluedroid.cpp and FakeNimble.cpp.
+ */
+
+struct HostTask
+{
+    HostTask(const char* name);
+
+    std::string name;
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifications;
+};
+
+struct HostSemaphore
+{
+    std::recursive_timed_mutex mutex;
+};
+
+struct esp_timer
+{
+    esp_timer(const esp_timer_create_args_t* arguments);
+
+    esp_timer_cb_t callback;
+    void* argument;
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint32_t generation;
+    bool running;
+};
+
+static_assert(sizeof(HostSemaphore) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t too small for HostSemaphore");
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+static std::atomic<int> logLevel(ESP_LOG_WARN);
+static std::atomic<vprintf_like_t> logVprintf(&vprintf);
+
+static thread_local HostTask* currentTask = nullptr;
+static std::atomic<uint32_t> nextThreadId(1);
+static thread_local uint32_t threadId = 0;
+
+HostTask::HostTask(const char* name):
+    name(name ? name : ""),
+    notifications(0)
+{
+}
+
+esp_timer::esp_timer(const esp_timer_create_args_t* arguments):
+    callback(arguments->callback),
+    argument(arguments->arg),
+    generation(0),
+    running(false)
+{
+}
+
+static uint32_t currentThreadId(void)
+{
+    if (!threadId)
+    {
+        threadId = nextThreadId.fetch_add(1);
+    }
+    return threadId;
+}
+
+static std::chrono::milliseconds ticksToDuration(TickType_t ticks)
+{
+    return std::chrono::milliseconds(ticks * portTICK_PERIOD_MS);
+}
+
+// spinlocks
+
+void vPortEnterCritical(portMUX_TYPE* mux)
+{
+    auto self = currentThreadId();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_RELAXED) == self)
+    {
+        ++mux->count;
+        return;
+    }
+
+    uint32_t expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, self, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux)
+{
+    if (--mux->count)
+    {
+        return;
+    }
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
+
+// tasks
+
+BaseType_t xTaskCreate(
+    TaskFunction_t function,
+    const char* name,
+    uint32_t stackDepth,
+    void* parameter,
+    UBaseType_t priority,
+    TaskHandle_t* createdTask)
+{
+    auto task = new HostTask(name);
+    if (createdTask)
+    {
+        *createdTask = task;
+    }
+
+    std::thread([task, function, parameter]()
+    {
+        currentTask = task;
+        function(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char* name,
+    uint32_t stackDepth,
+    void* parameter,
+    UBaseType_t priority,
+    TaskHandle_t* createdTask,
+    BaseType_t coreId)
+{
+    return xTaskCreate(function, name, stackDepth, parameter, priority, createdTask);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // a task deleting itself returns from its function instead, deleting other tasks is not supported on the host
+    if (task && task != currentTask)
+    {
+        fprintf(stderr, "vTaskDelete() of another task is not supported on the host\n");
+        abort();
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(ticksToDuration(ticks));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t) (esp_timer_get_time() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetHandle(const char* name)
+{
+    return nullptr;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!currentTask)
+    {
+        currentTask = new HostTask("main");
+    }
+    return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 8192;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        ++task->notifications;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken)
+{
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken)
+    {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    auto task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto notified = [task]() { return task->notifications != 0; };
+    if (ticksToWait == portMAX_DELAY)
+    {
+        task->notified.wait(lock, notified);
+    }
+    else
+    {
+        task->notified.wait_for(lock, ticksToDuration(ticksToWait), notified);
+    }
+
+    auto notifications = task->notifications;
+    if (notifications)
+    {
+        task->notifications = clearCountOnExit ? 0 : notifications - 1;
+    }
+    return notifications;
+}
+
+// mutexes
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return new HostSemaphore();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer)
+{
+    return new(buffer) HostSemaphore();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t* buffer)
+{
+    return new(buffer) HostSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    if (ticksToWait == portMAX_DELAY)
+    {
+        semaphore->mutex.lock();
+        return pdTRUE;
+    }
+    return semaphore->mutex.try_lock_for(ticksToDuration(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    semaphore->mutex.unlock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    return xSemaphoreTake(semaphore, ticksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+    return xSemaphoreGive(semaphore);
+}
+
+// timers
+
+int64_t esp_timer_get_time(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_handle = new esp_timer(create_args);
+    return ESP_OK;
+}
+
+static esp_err_t startTimer(esp_timer_handle_t timer, uint64_t microseconds, bool periodic)
+{
+    std::unique_lock<std::mutex> lock(timer->mutex);
+    if (timer->running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->running = true;
+    auto generation = ++timer->generation;
+
+    // the thread ends once the timer expired or was stopped, i.e. its generation is not current anymore
+    std::thread([timer, microseconds, periodic, generation]()
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+        std::unique_lock<std::mutex> lock(timer->mutex);
+        for (;;)
+        {
+            if (timer->changed.wait_until(lock, deadline, [timer, generation]()
+                {
+                    return timer->generation != generation;
+                }))
+            {
+                return;
+            }
+
+            if (!periodic)
+            {
+                timer->running = false;
+            }
+            lock.unlock();
+            timer->callback(timer->argument);
+            lock.lock();
+            if (!periodic || timer->generation != generation)
+            {
+                return;
+            }
+            deadline += std::chrono::microseconds(microseconds);
+        }
+    }).detach();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return startTimer(timer, period, true);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return startTimer(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        if (!timer->running)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        timer->running = false;
+        ++timer->generation;
+    }
+    timer->changed.notify_all();
+    return ESP_OK;
+}
+
+// logging
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    return logVprintf.exchange(func);
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level)
+{
+    logLevel.store(level);
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t) (esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+    if (level > logLevel.load())
+    {
+        return;
+    }
+
+    va_list arguments;
+    va_start(arguments, format);
+    logVprintf.load()(format, arguments);
+    va_end(arguments);
+}
+
+// system
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    return (esp_cpu_cycle_count_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return 256 * 1024;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return 256 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return 128 * 1024;
+}
+
+const esp_partition_t* esp_partition_find_first(
+    esp_partition_type_t type,
+    esp_partition_subtype_t subtype,
+    const char* label)
+{
+    return nullptr;
+}
+
+esp_err_t esp_partition_mmap(
+    const esp_partition_t* partition,
+    size_t offset,
+    size_t size,
+    esp_partition_mmap_memory_t memory,
+    const void** out_ptr,
+    spi_flash_mmap_handle_t* out_handle)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t* config)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode)
+{
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+#ifndef TEST_HOST_HOSTTEST_HPP_
+#define TEST_HOST_HOSTTEST_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+/*
+ * Minimal checks for the host tests: a failed CHECK() reports the location and lets the test return 1 at the end, so
+ * that one run shows all failures. Each test is a plain executable registered with CTest.
+ */
+namespace HostTest
+{
+
+extern int failures;
+
+inline bool check(bool condition, const char* expression, const char* file, int line)
+{
+    if (!condition)
+    {
+        ++failures;
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+    }
+    return condition;
+}
+
+inline int result(void)
+{
+    if (failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
+
+inline double seconds(void)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} /* namespace HostTest */
+
+#define HOST_TEST_MAIN_STATE int HostTest::failures = 0
+
+#define CHECK(expression) HostTest::check((expression), #expression, __FILE__, __LINE__)
+
+#define CHECK_THROWS(expression, exception) \
+    do { \
+        bool thrown = false; \
+        try \
+        { \
+            expression; \
+        } \
+        catch (const exception&) \
+        { \
+            thrown = true; \
+        } \
+        HostTest::check(thrown, #expression " throws " #exception, __FILE__, __LINE__); \
+    } while (0)
+
+#endif /* TEST_HOST_HOSTTEST_HPP_ */
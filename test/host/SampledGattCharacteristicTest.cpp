@@ -0,0 +1,100 @@
+#include <string.h>
+#include "BleServer.hpp"
+#include "FakeBleStack.hpp"
+#include "GattsApplication.hpp"
+#include "GattsService.hpp"
+#include "HostTest.hpp"
+#include "NotificationDispatcher.hpp"
+#include "SampledGattCharacteristic.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using namespace Esp32;
+using HostTest::FakeBleStack;
+
+#define SAMPLE_SIZE (4)
+#define NOTIFICATION_TIMEOUT_MS (1000)
+
+/*
+ * A batch flushed for a subscriber which leaves before the notification dispatcher gets to it must not stall the
+ * stream. The dispatcher is started late: until then requested notifications are lost, which is what happens when the
+ * last subscriber is gone by the time the dispatcher runs. The samples are taken by the test instead of the timer,
+ * with a deadline of 0 every sample is flushed on its own.
+ */
+class TestSampledCharacteristic: public SampledGattCharacteristic
+{
+public:
+    using SampledGattCharacteristic::SampledGattCharacteristic;
+
+    void takeSample(void)
+    {
+        sample();
+    }
+};
+
+static uint32_t sampleValue = 0;
+
+static void sampler(void* context, uint8_t* sample)
+{
+    ++sampleValue;
+    memcpy(sample, &sampleValue, SAMPLE_SIZE);
+}
+
+static uint8_t sampleBuffer[2 * 20];
+static TestSampledCharacteristic sampled(
+    BleUuid(BleUuid::Width::UUID_16, 0x4060),
+    SAMPLE_SIZE,
+    sampler,
+    nullptr,
+    sampleBuffer,
+    sizeof(sampleBuffer));
+static GattsService service(BleServiceUuid(BleUuid::Width::UUID_32, 0x21040001));
+static GattsApplication application(0, "Sampled");
+
+int main(int argc, char** argv)
+{
+    service.addCharacteristic(&sampled);
+    BleServer::instance()->probe();
+    application.addService(&service);
+    BleServer::instance()->addGattsApplication(&application);
+    FakeBleStack::pump();
+    CHECK(application.registrationState() == GattsApplication::RegistrationState::READY);
+
+    auto& statistics = sampled.statistics();
+    auto connectionId = FakeBleStack::connect();
+    CHECK(FakeBleStack::subscribe(connectionId, sampled.handle(), 0x0001) == 0);
+    sampled.takeSample();
+    CHECK(statistics.flushesDeadline == 1 && statistics.droppedBatches == 0);
+
+    // the subscriber disconnects before the batch is sent
+    FakeBleStack::disconnect(connectionId);
+    FakeBleStack::pump();
+    connectionId = FakeBleStack::connect();
+    CHECK(FakeBleStack::subscribe(connectionId, sampled.handle(), 0x0001) == 0);
+    sampled.takeSample();
+    CHECK(statistics.flushesDeadline == 2 && statistics.droppedBatches == 0);
+
+    // the subscriber unsubscribes before the batch is sent
+    CHECK(FakeBleStack::subscribe(connectionId, sampled.handle(), 0) == 0);
+    CHECK(FakeBleStack::subscribe(connectionId, sampled.handle(), 0x0001) == 0);
+    sampled.takeSample();
+    CHECK(statistics.flushesDeadline == 3 && statistics.droppedBatches == 0);
+
+    // notifications resume once the dispatcher runs
+    NotificationDispatcher::instance()->probe();
+    CHECK(FakeBleStack::subscribe(connectionId, sampled.handle(), 0) == 0);
+    CHECK(FakeBleStack::subscribe(connectionId, sampled.handle(), 0x0001) == 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        sampled.takeSample();
+
+        FakeBleStack::Notification notification;
+        CHECK(FakeBleStack::waitForNotification(&notification, NOTIFICATION_TIMEOUT_MS));
+        CHECK(notification.handle == sampled.handle());
+        CHECK(notification.value.size() == SAMPLE_SIZE
+            && memcmp(notification.value.data(), &sampleValue, SAMPLE_SIZE) == 0);
+    }
+    CHECK(statistics.droppedBatches == 0);
+
+    return HostTest::result();
+}
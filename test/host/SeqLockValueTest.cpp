@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "HostTest.hpp"
+#include "SeqLockValue.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using Esp32::SeqLockValue;
+
+#define WRITERS_MAX (8)
+
+/*
+ * Multi-word value: every word carries the same stamp, a reader seeing different stamps within one value read a torn
+ * value. The stamp holds the writer in its upper byte and the number of its store in the lower bits.
+ */
+struct Sample
+{
+    uint32_t words[12];
+};
+
+static Sample stamped(uint32_t stamp)
+{
+    Sample sample;
+    for (auto& word : sample.words)
+    {
+        word = stamp;
+    }
+    return sample;
+}
+
+int main(int argc, char** argv)
+{
+    int readers = argc > 1 ? atoi(argv[1]) : 4;
+    int writers = argc > 2 ? atoi(argv[2]) : 2;
+    uint32_t storesPerWriter = argc > 3 ? strtoul(argv[3], nullptr, 0) : 200000;
+    if (writers < 1 || writers > WRITERS_MAX || readers < 1)
+    {
+        fprintf(stderr, "usage: %s [readers] [writers <= %d] [stores per writer]\n", argv[0], WRITERS_MAX);
+        return 2;
+    }
+
+    SeqLockValue<Sample> value(stamped(0));
+    std::atomic<int> runningWriters(writers);
+    std::atomic<uint64_t> tornReads(0);
+    std::atomic<uint64_t> reorderedReads(0);
+    std::atomic<uint64_t> reads(0);
+
+    std::vector<std::thread> threads;
+    for (int reader = 0; reader < readers; ++reader)
+    {
+        threads.emplace_back([&]()
+        {
+            // stores of one writer are serialized, so a reader must never see an older one after a newer one
+            uint32_t lastCount[WRITERS_MAX] = {};
+            uint64_t localReads = 0;
+            do
+            {
+                auto sample = value.load();
+                ++localReads;
+                for (auto word : sample.words)
+                {
+                    if (word != sample.words[0])
+                    {
+                        ++tornReads;
+                        break;
+                    }
+                }
+
+                auto writer = sample.words[0] >> 24;
+                auto count = sample.words[0] & 0xffffff;
+                if (writer > 0 && writer <= WRITERS_MAX)
+                {
+                    if (count < lastCount[writer - 1])
+                    {
+                        ++reorderedReads;
+                    }
+                    lastCount[writer - 1] = count;
+                }
+            } while (runningWriters.load(std::memory_order_relaxed));
+            reads += localReads;
+        });
+    }
+
+    auto start = HostTest::seconds();
+    for (int writer = 1; writer <= writers; ++writer)
+    {
+        threads.emplace_back([&, writer]()
+        {
+            for (uint32_t count = 1; count <= storesPerWriter; ++count)
+            {
+                value.store(stamped(((uint32_t) writer << 24) | (count & 0xffffff)));
+            }
+            --runningWriters;
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto elapsed = HostTest::seconds() - start;
+
+    printf(
+        "%d readers, %d writers: %llu reads, %u stores in %.2f s, %llu torn, %llu reordered\n",
+        readers,
+        writers,
+        (unsigned long long) reads.load(),
+        (unsigned) (writers * storesPerWriter),
+        elapsed,
+        (unsigned long long) tornReads.load(),
+        (unsigned long long) reorderedReads.load());
+
+    CHECK(tornReads.load() == 0);
+    CHECK(reorderedReads.load() == 0);
+    CHECK(reads.load() > 0);
+    // two increments per store
+    CHECK(value.sequence() == 2 * writers * storesPerWriter);
+
+    return HostTest::result();
+}
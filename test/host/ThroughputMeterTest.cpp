@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <random>
+#include "HostTest.hpp"
+#include "ThroughputMeter.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using Esp32::ThroughputMeter;
+
+#define WINDOW_MS (THROUGHPUT_METER_BUCKETS * THROUGHPUT_METER_BUCKET_LENGTH_MS)
+
+static bool near(uint32_t value, uint32_t expected, double tolerance)
+{
+    return value >= expected * (1 - tolerance) && value <= expected * (1 + tolerance);
+}
+
+/*
+ * Feeds packets of the given length at the given interval from start until end (milliseconds) and returns the next
+ * timestamp.
+ */
+static uint32_t feed(ThroughputMeter& meter, uint32_t start, uint32_t end, uint32_t intervalMs, uint32_t length)
+{
+    auto now = start;
+    for (; now - start < end - start; now += intervalMs)
+    {
+        meter.add(length, now);
+    }
+    return now;
+}
+
+static void testConstantRate(void)
+{
+    // 244 byte notifications every millisecond: 1952 kbps
+    ThroughputMeter meter;
+    auto now = feed(meter, 1000, 6000, 1, 244);
+    CHECK(meter.packets() == 5000);
+    CHECK(meter.bytes() == 5000 * 244);
+    CHECK(meter.drops() == 0);
+
+    // any position within the current bucket
+    for (uint32_t offset = 0; offset < THROUGHPUT_METER_BUCKET_LENGTH_MS; offset += 50)
+    {
+        ThroughputMeter partial;
+        auto end = feed(partial, 1000, 6000 + offset, 1, 244);
+        CHECK(near(partial.kbps(end - 1), 1952, 0.02));
+    }
+    CHECK(near(meter.kbps(now - 1), 1952, 0.02));
+}
+
+static void testRateChange(void)
+{
+    // the window forgets the old rate after one window length
+    ThroughputMeter meter;
+    auto now = feed(meter, 0, 3000, 1, 1000);
+    CHECK(near(meter.kbps(now - 1), 8000, 0.02));
+
+    now = feed(meter, now, now + WINDOW_MS, 1, 100);
+    CHECK(near(meter.kbps(now - 1), 800, 0.05));
+}
+
+static void testIdle(void)
+{
+    ThroughputMeter meter;
+    CHECK(meter.kbps(0) == 0);
+    CHECK(meter.kbps(123456) == 0);
+
+    auto now = feed(meter, 5000, 7000, 2, 500);
+    CHECK(meter.kbps(now) > 0);
+
+    // a single stale bucket does not count once the window moved past it
+    CHECK(meter.kbps(now + WINDOW_MS + THROUGHPUT_METER_BUCKET_LENGTH_MS) == 0);
+    // a slot reused a full round later starts over
+    meter.add(100, now + 2 * WINDOW_MS);
+    CHECK(meter.kbps(now + 2 * WINDOW_MS + 1) <= 100 * 8 / (WINDOW_MS - THROUGHPUT_METER_BUCKET_LENGTH_MS) + 1);
+}
+
+static void testLossyLink(void)
+{
+    // a sink as in ThroughputTestService: writes carry sequence numbers, gaps are drops
+    std::mt19937 random(42);
+    ThroughputMeter meter;
+    uint32_t nextExpected = 0;
+    uint32_t lost = 0;
+    uint32_t delivered = 0;
+    uint64_t deliveredBytes = 0;
+    uint32_t now = 10000;
+
+    for (uint32_t sequence = 0; sequence < 20000; ++sequence, now += random() % 3)
+    {
+        if (random() % 100 < 5)
+        {
+            ++lost;
+            continue;
+        }
+
+        auto length = 20 + random() % 225;
+        if (sequence > nextExpected)
+        {
+            meter.addDrops(sequence - nextExpected);
+        }
+        nextExpected = sequence + 1;
+        meter.add(length, now);
+        ++delivered;
+        deliveredBytes += length;
+    }
+
+    CHECK(meter.drops() == lost);
+    CHECK(meter.packets() == delivered);
+    CHECK(meter.bytes() == deliveredBytes);
+    CHECK(meter.kbps(now) > 0);
+}
+
+static void testReset(void)
+{
+    ThroughputMeter meter;
+    auto now = feed(meter, 0, 2000, 1, 244);
+    meter.addDrops(7);
+
+    meter.reset();
+    CHECK(meter.bytes() == 0);
+    CHECK(meter.packets() == 0);
+    CHECK(meter.drops() == 0);
+    CHECK(meter.kbps(now) == 0);
+
+    now = feed(meter, now, now + 2000, 1, 244);
+    CHECK(near(meter.kbps(now - 1), 1952, 0.02));
+}
+
+static void testWrapAround(void)
+{
+    // esp_timer_get_time() / 1000 truncated to 32 bits wraps after 49.7 days
+    ThroughputMeter meter;
+    auto now = feed(meter, UINT32_MAX - 3000, 3000, 1, 244);
+    CHECK(meter.packets() == 6001);
+    CHECK(near(meter.kbps(now - 1), 1952, 0.02));
+    for (uint32_t offset = 0; offset < WINDOW_MS; offset += 100)
+    {
+        ThroughputMeter wrapped;
+        auto end = feed(wrapped, UINT32_MAX - 3000, offset, 1, 244);
+        CHECK(near(wrapped.kbps(end - 1), 1952, 0.02));
+    }
+    CHECK(meter.kbps(now + 2000 - 1) == 0);
+}
+
+int main(int argc, char** argv)
+{
+    testConstantRate();
+    testRateChange();
+    testIdle();
+    testLossyLink();
+    testReset();
+    testWrapAround();
+
+    return HostTest::result();
+}
@@ -0,0 +1,159 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+#include "HostTest.hpp"
+#include "TimeSeriesCodec.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using Esp32::TimeSeriesCodec;
+
+// payload of one notification at an MTU of 247, the usual maximum of phones
+#define PAYLOAD_CAPACITY (244)
+
+/*
+ * Encode throughput and compression ratio of TimeSeriesCodec on representative sensor series, batched the way
+ * SampledGattCharacteristic fills notifications. The ratio is the raw size (4 bytes per sample, 8 with timestamps)
+ * over the encoded size including the flags byte of every batch.
+ */
+struct Series
+{
+    const char* name;
+    std::vector<int32_t> samples;
+    std::vector<uint32_t> timestamps;
+};
+
+static std::vector<uint32_t> timestamps(size_t count, uint32_t periodUs, std::mt19937& random)
+{
+    // sampling by esp_timer jitters by a few percent
+    std::vector<uint32_t> result(count);
+    uint32_t timestamp = 12345678;
+    for (auto& value : result)
+    {
+        timestamp += periodUs - periodUs / 50 + random() % (periodUs / 25 + 1);
+        value = timestamp;
+    }
+    return result;
+}
+
+static std::vector<Series> representativeSeries(size_t count)
+{
+    std::mt19937 random(1);
+    std::vector<Series> series;
+
+    // temperature in 1/100 degree at 1 Hz: slow drift plus sensor noise
+    Series temperature = {"temperature 1 Hz", {}, timestamps(count, 1000000, random)};
+    for (size_t i = 0; i < count; ++i)
+    {
+        temperature.samples.push_back(2150 + (int32_t) (300 * sin(i / 600.0)) + (int32_t) (random() % 5) - 2);
+    }
+    series.push_back(temperature);
+
+    // acceleration in mg at 100 Hz: gravity plus vibration
+    Series acceleration = {"acceleration 100 Hz", {}, timestamps(count, 10000, random)};
+    for (size_t i = 0; i < count; ++i)
+    {
+        acceleration.samples.push_back(
+            1000 + (int32_t) (120 * sin(i / 7.0)) + (int32_t) (random() % 41) - 20);
+    }
+    series.push_back(acceleration);
+
+    // event counter at 10 Hz
+    Series counter = {"counter 10 Hz", {}, timestamps(count, 100000, random)};
+    int32_t events = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        events += random() % 4;
+        counter.samples.push_back(events);
+    }
+    series.push_back(counter);
+
+    // 24 bit ADC at 1 kHz using its full range, the worst case for delta encoding
+    Series adc = {"24 bit ADC noise 1 kHz", {}, timestamps(count, 1000, random)};
+    for (size_t i = 0; i < count; ++i)
+    {
+        adc.samples.push_back((int32_t) (random() & 0xffffff) - 0x800000);
+    }
+    series.push_back(adc);
+
+    return series;
+}
+
+struct Result
+{
+    double ratio;
+    double samplesPerSecond;
+    double samplesPerBatch;
+};
+
+static Result run(const Series& series, bool withTimestamps, std::vector<uint8_t>& payload)
+{
+    TimeSeriesCodec codec(withTimestamps);
+    uint64_t encodedBytes = 0;
+    uint64_t batches = 0;
+    uint16_t fillLength = 0;
+
+    auto start = HostTest::seconds();
+    for (size_t i = 0; i < series.samples.size(); ++i)
+    {
+        fillLength += codec.encode(
+            payload.data() + fillLength,
+            !fillLength,
+            series.samples[i],
+            series.timestamps[i]);
+        if (fillLength + codec.maximumEncodedSize() > PAYLOAD_CAPACITY)
+        {
+            encodedBytes += fillLength;
+            ++batches;
+            fillLength = 0;
+        }
+    }
+    auto elapsed = HostTest::seconds() - start;
+    if (fillLength)
+    {
+        encodedBytes += fillLength;
+        ++batches;
+    }
+
+    Result result;
+    result.ratio = (double) series.samples.size() * (withTimestamps ? 8 : 4) / encodedBytes;
+    result.samplesPerSecond = series.samples.size() / elapsed;
+    result.samplesPerBatch = (double) series.samples.size() / batches;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 0) : 1000000;
+    auto allSeries = representativeSeries(count);
+    std::vector<uint8_t> payload(PAYLOAD_CAPACITY);
+
+    printf("%zu samples per series, %d byte payloads\n", count, PAYLOAD_CAPACITY);
+    printf("%-24s %-10s %8s %14s %12s\n", "series", "timestamps", "ratio", "samples/batch", "Msamples/s");
+    for (auto& series : allSeries)
+    {
+        for (auto withTimestamps : {false, true})
+        {
+            auto result = run(series, withTimestamps, payload);
+            printf(
+                "%-24s %-10s %7.2fx %14.1f %12.1f\n",
+                series.name,
+                withTimestamps ? "yes" : "no",
+                result.ratio,
+                result.samplesPerBatch,
+                result.samplesPerSecond / 1e6);
+
+            // slowly changing samples take one byte, noise over 24 bits must not expand beyond the varint overhead
+            if (&series != &allSeries.back())
+            {
+                CHECK(result.ratio > (withTimestamps ? 1.8 : 3.5));
+            }
+            CHECK(result.ratio > 0.75);
+        }
+    }
+
+    return HostTest::result();
+}
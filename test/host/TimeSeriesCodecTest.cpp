@@ -0,0 +1,307 @@
+#include <stdint.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "HostTest.hpp"
+#include "TimeSeriesCodec.hpp"
+
+HOST_TEST_MAIN_STATE;
+
+using Esp32::TimeSeriesCodec;
+
+/*
+ * Decoder written from the format description in TimeSeriesCodec.hpp only, without sharing code with the codec. It
+ * returns false for anything the description does not allow.
+ */
+struct ReferenceBatch
+{
+    bool timestamps;
+    std::vector<int32_t> samples;
+    std::vector<uint32_t> timestampValues;
+};
+
+static bool referenceVarint(const std::vector<uint8_t>& payload, size_t* offset, uint32_t* value)
+{
+    uint64_t result = 0;
+    for (int shift = 0, bytes = 0; *offset < payload.size(); shift += 7)
+    {
+        auto byte = payload[(*offset)++];
+        ++bytes;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            if ((bytes > 1 && byte == 0) || result > UINT32_MAX)
+            {
+                return false;
+            }
+            *value = (uint32_t) result;
+            return true;
+        }
+        if (bytes == 5)
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+static bool referenceDecode(const std::vector<uint8_t>& payload, ReferenceBatch* batch)
+{
+    if (payload.empty())
+    {
+        return false;
+    }
+    batch->timestamps = payload[0] & TIME_SERIES_FLAG_TIMESTAMPS;
+    batch->samples.clear();
+    batch->timestampValues.clear();
+
+    size_t offset = 1;
+    int64_t sample = 0;
+    uint64_t timestamp = 0;
+    while (offset < payload.size())
+    {
+        uint32_t zigZag;
+        if (!referenceVarint(payload, &offset, &zigZag))
+        {
+            return false;
+        }
+        int64_t delta = (zigZag & 1) ? -(int64_t) (zigZag >> 1) - 1 : (int64_t) (zigZag >> 1);
+        // running sums wrap modulo 2^32
+        sample = (int32_t) (uint32_t) (uint64_t) (sample + delta);
+        batch->samples.push_back((int32_t) sample);
+
+        if (batch->timestamps)
+        {
+            uint32_t timestampDelta;
+            if (!referenceVarint(payload, &offset, &timestampDelta))
+            {
+                return false;
+            }
+            timestamp = (uint32_t) (timestamp + timestampDelta);
+            batch->timestampValues.push_back((uint32_t) timestamp);
+        }
+    }
+    return true;
+}
+
+static std::vector<uint8_t> encodeBatch(
+    const std::vector<int32_t>& samples,
+    const std::vector<uint32_t>& timestamps,
+    bool withTimestamps)
+{
+    TimeSeriesCodec codec(withTimestamps);
+    std::vector<uint8_t> payload(samples.size() * codec.maximumEncodedSize() + 1);
+    size_t length = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        length += codec.encode(payload.data() + length, i == 0, samples[i], withTimestamps ? timestamps[i] : 0);
+    }
+    payload.resize(length);
+    return payload;
+}
+
+static void checkRoundTrip(const std::vector<int32_t>& samples, const std::vector<uint32_t>& timestamps)
+{
+    auto withTimestamps = !timestamps.empty();
+    auto payload = encodeBatch(samples, timestamps, withTimestamps);
+
+    // the codec decoder
+    std::vector<int32_t> decodedSamples(samples.size());
+    std::vector<uint32_t> decodedTimestamps(samples.size());
+    auto decoded = TimeSeriesCodec::decode(
+        payload.data(),
+        payload.size(),
+        decodedSamples.data(),
+        decodedTimestamps.data(),
+        samples.size());
+    CHECK(decoded == (int) samples.size());
+    CHECK(decodedSamples == samples);
+    if (withTimestamps)
+    {
+        CHECK(decodedTimestamps == timestamps);
+    }
+
+    // the reference decoder
+    ReferenceBatch batch;
+    CHECK(referenceDecode(payload, &batch));
+    CHECK(batch.timestamps == withTimestamps);
+    CHECK(batch.samples == samples);
+    CHECK(batch.timestampValues == timestamps);
+}
+
+static void testZigZag(void)
+{
+    CHECK(TimeSeriesCodec::zigZagEncode(0) == 0);
+    CHECK(TimeSeriesCodec::zigZagEncode(-1) == 1);
+    CHECK(TimeSeriesCodec::zigZagEncode(1) == 2);
+    CHECK(TimeSeriesCodec::zigZagEncode(INT32_MAX) == UINT32_MAX - 1);
+    CHECK(TimeSeriesCodec::zigZagEncode(INT32_MIN) == UINT32_MAX);
+
+    const int32_t values[] = {0, 1, -1, 63, -64, 64, -65, 1000000, -1000000, INT32_MAX, INT32_MIN, INT32_MIN + 1};
+    for (auto value : values)
+    {
+        CHECK(TimeSeriesCodec::zigZagDecode(TimeSeriesCodec::zigZagEncode(value)) == value);
+    }
+}
+
+static void testVarints(void)
+{
+    uint8_t buffer[TIME_SERIES_VARINT_LENGTH_MAX];
+    const uint32_t values[] = {0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000, 0xfffffff, 0x10000000, UINT32_MAX};
+    const uint16_t lengths[] = {1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        auto length = TimeSeriesCodec::encodeVarint(buffer, values[i]);
+        CHECK(length == lengths[i]);
+
+        uint32_t value = 0;
+        CHECK(TimeSeriesCodec::decodeVarint(buffer, length, &value) == length);
+        CHECK(value == values[i]);
+
+        // every shorter prefix is truncated
+        for (uint16_t prefix = 0; prefix < length; ++prefix)
+        {
+            CHECK(TimeSeriesCodec::decodeVarint(buffer, prefix, &value) == 0);
+        }
+    }
+}
+
+static void testOverlongVarints(void)
+{
+    uint32_t value = 0;
+
+    // six bytes
+    const uint8_t sixBytes[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+    CHECK(TimeSeriesCodec::decodeVarint(sixBytes, sizeof(sixBytes), &value) == 0);
+
+    // bits above bit 31 in the fifth byte
+    const uint8_t beyond32Bits[] = {0xff, 0xff, 0xff, 0xff, 0x1f};
+    CHECK(TimeSeriesCodec::decodeVarint(beyond32Bits, sizeof(beyond32Bits), &value) == 0);
+    const uint8_t maximum[] = {0xff, 0xff, 0xff, 0xff, 0x0f};
+    CHECK(TimeSeriesCodec::decodeVarint(maximum, sizeof(maximum), &value) == 5);
+    CHECK(value == UINT32_MAX);
+
+    // zero padding: 0 and 1 encoded with two bytes
+    const uint8_t paddedZero[] = {0x80, 0x00};
+    CHECK(TimeSeriesCodec::decodeVarint(paddedZero, sizeof(paddedZero), &value) == 0);
+    const uint8_t paddedOne[] = {0x81, 0x80, 0x00};
+    CHECK(TimeSeriesCodec::decodeVarint(paddedOne, sizeof(paddedOne), &value) == 0);
+
+    // within a batch
+    const uint8_t batch[] = {0x00, 0x02, 0x80, 0x00};
+    int32_t samples[4];
+    CHECK(TimeSeriesCodec::decode(batch, sizeof(batch), samples, nullptr, 4) == -1);
+}
+
+static void testTruncatedBatches(void)
+{
+    std::vector<int32_t> samples = {100, 5000, -70000, 2000000000};
+    std::vector<uint32_t> timestamps = {10, 1010, 300000, 4000000000u};
+    auto payload = encodeBatch(samples, timestamps, true);
+
+    int32_t decodedSamples[4];
+    uint32_t decodedTimestamps[4];
+    ReferenceBatch batch;
+
+    // a cut within a varint or between a sample and its timestamp is an error, a cut between two pairs is not
+    std::vector<size_t> pairEnds;
+    {
+        size_t offset = 1;
+        uint32_t value;
+        while (offset < payload.size())
+        {
+            offset += TimeSeriesCodec::decodeVarint(payload.data() + offset, payload.size() - offset, &value);
+            offset += TimeSeriesCodec::decodeVarint(payload.data() + offset, payload.size() - offset, &value);
+            pairEnds.push_back(offset);
+        }
+    }
+
+    for (size_t length = 1; length < payload.size(); ++length)
+    {
+        std::vector<uint8_t> truncated(payload.begin(), payload.begin() + length);
+        auto decoded = TimeSeriesCodec::decode(
+            truncated.data(),
+            truncated.size(),
+            decodedSamples,
+            decodedTimestamps,
+            4);
+        auto referenceValid = referenceDecode(truncated, &batch);
+
+        bool atPairEnd = length == 1;
+        for (auto end : pairEnds)
+        {
+            atPairEnd |= end == length;
+        }
+        CHECK(referenceValid == atPairEnd);
+        CHECK((decoded >= 0) == atPairEnd);
+        if (atPairEnd)
+        {
+            CHECK(decoded == (int) batch.samples.size());
+        }
+    }
+
+    CHECK(TimeSeriesCodec::decode(nullptr, 4, decodedSamples, nullptr, 4) == -1);
+    CHECK(TimeSeriesCodec::decode(payload.data(), 0, decodedSamples, nullptr, 4) == -1);
+    // more samples than the caller has room for
+    CHECK(TimeSeriesCodec::decode(payload.data(), payload.size(), decodedSamples, decodedTimestamps, 3) == -1);
+}
+
+static void testExtremeDeltas(void)
+{
+    // deltas of INT32_MIN and INT32_MAX and wrapping differences between the extremes
+    checkRoundTrip({INT32_MIN, INT32_MAX, INT32_MIN, 0, INT32_MAX, -1, INT32_MIN, 1}, {});
+    checkRoundTrip({0, INT32_MIN}, {});
+    checkRoundTrip({0, INT32_MAX}, {});
+    checkRoundTrip({-1, INT32_MAX}, {});
+    checkRoundTrip({INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN}, {0, UINT32_MAX, 0, UINT32_MAX});
+
+    // the worst case fits into maximumEncodedSize()
+    TimeSeriesCodec codec(true);
+    uint8_t buffer[16];
+    CHECK(codec.encode(buffer, true, INT32_MIN, UINT32_MAX) <= codec.maximumEncodedSize());
+    CHECK(codec.encode(buffer, false, INT32_MAX, 0) <= codec.maximumEncodedSize() - 1);
+}
+
+static void testRandomRoundTrips(void)
+{
+    std::mt19937 random(4711);
+    for (int round = 0; round < 2000; ++round)
+    {
+        auto count = 1 + random() % 60;
+        std::vector<int32_t> samples;
+        std::vector<uint32_t> timestamps;
+        int32_t sample = (int32_t) random();
+        uint32_t timestamp = random();
+        for (size_t i = 0; i < count; ++i)
+        {
+            switch (round % 3)
+            {
+                case 0:
+                    sample = (int32_t) random();
+                    break;
+                case 1:
+                    sample += (int32_t) (random() % 201) - 100;
+                    break;
+                default:
+                    sample = (int32_t) ((uint32_t) sample + random() % 3);
+                    break;
+            }
+            timestamp += random() % 20000;
+            samples.push_back(sample);
+            timestamps.push_back(timestamp);
+        }
+        checkRoundTrip(samples, round % 2 ? timestamps : std::vector<uint32_t>());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    testZigZag();
+    testVarints();
+    testOverlongVarints();
+    testTruncatedBatches();
+    testExtremeDeltas();
+    testRandomRoundTrips();
+
+    return HostTest::result();
+}
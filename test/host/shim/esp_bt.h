@@ -0,0 +1,25 @@
+#ifndef TEST_HOST_SHIM_ESP_BT_H_
+#define TEST_HOST_SHIM_ESP_BT_H_
+
+#include "esp_bt_defs.h"
+
+typedef enum
+{
+    ESP_BT_MODE_IDLE,
+    ESP_BT_MODE_BLE,
+    ESP_BT_MODE_CLASSIC_BT,
+    ESP_BT_MODE_BTDM,
+} esp_bt_mode_t;
+
+typedef struct
+{
+    int reserved;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() { 0 }
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode);
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t* config);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
+
+#endif /* TEST_HOST_SHIM_ESP_BT_H_ */
@@ -0,0 +1,32 @@
+#ifndef TEST_HOST_SHIM_ESP_BT_DEFS_H_
+#define TEST_HOST_SHIM_ESP_BT_DEFS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_UUID_LEN_16 (2)
+#define ESP_UUID_LEN_32 (4)
+#define ESP_UUID_LEN_128 (16)
+
+typedef uint8_t esp_bd_addr_t[6];
+typedef uint8_t esp_ble_addr_type_t;
+
+typedef enum
+{
+    ESP_BT_STATUS_SUCCESS = 0,
+    ESP_BT_STATUS_FAIL,
+} esp_bt_status_t;
+
+typedef struct
+{
+    uint16_t len;
+    union
+    {
+        uint16_t uuid16;
+        uint32_t uuid32;
+        uint8_t uuid128[ESP_UUID_LEN_128];
+    } uuid;
+} esp_bt_uuid_t;
+
+#endif /* TEST_HOST_SHIM_ESP_BT_DEFS_H_ */
@@ -0,0 +1,13 @@
+#ifndef TEST_HOST_SHIM_ESP_BT_MAIN_H_
+#define TEST_HOST_SHIM_ESP_BT_MAIN_H_
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "Bluedroid header included in a NimBLE build"
+#endif
+
+#include "esp_err.h"
+
+esp_err_t esp_bluedroid_init(void);
+esp_err_t esp_bluedroid_enable(void);
+
+#endif /* TEST_HOST_SHIM_ESP_BT_MAIN_H_ */
@@ -0,0 +1,11 @@
+#ifndef TEST_HOST_SHIM_ESP_CPU_H_
+#define TEST_HOST_SHIM_ESP_CPU_H_
+
+#include <stdint.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+// nanoseconds of the monotonic clock, i.e. "cycles" of a 1 GHz CPU
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#endif /* TEST_HOST_SHIM_ESP_CPU_H_ */
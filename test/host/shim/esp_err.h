@@ -0,0 +1,21 @@
+#ifndef TEST_HOST_SHIM_ESP_ERR_H_
+#define TEST_HOST_SHIM_ESP_ERR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK (0)
+#define ESP_FAIL (-1)
+#define ESP_ERR_NO_MEM (0x101)
+#define ESP_ERR_INVALID_ARG (0x102)
+#define ESP_ERR_INVALID_STATE (0x103)
+#define ESP_ERR_NOT_FOUND (0x105)
+#define ESP_ERR_NVS_NO_FREE_PAGES (0x1100)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND (0x1101)
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif /* TEST_HOST_SHIM_ESP_ERR_H_ */
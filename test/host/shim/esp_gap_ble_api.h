@@ -0,0 +1,107 @@
+#ifndef TEST_HOST_SHIM_ESP_GAP_BLE_API_H_
+#define TEST_HOST_SHIM_ESP_GAP_BLE_API_H_
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "Bluedroid header included in a NimBLE build"
+#endif
+
+#include "esp_bt_defs.h"
+
+typedef enum
+{
+    ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT = 0,
+    ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT,
+    ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT,
+    ESP_GAP_BLE_SCAN_RESULT_EVT,
+    ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT,
+    ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT,
+    ESP_GAP_BLE_ADV_START_COMPLETE_EVT,
+    ESP_GAP_BLE_SCAN_START_COMPLETE_EVT,
+    ESP_GAP_BLE_AUTH_CMPL_EVT,
+    ESP_GAP_BLE_KEY_EVT,
+    ESP_GAP_BLE_SEC_REQ_EVT,
+    ESP_GAP_BLE_PASSKEY_NOTIF_EVT,
+    ESP_GAP_BLE_PASSKEY_REQ_EVT,
+    ESP_GAP_BLE_OOB_REQ_EVT,
+    ESP_GAP_BLE_LOCAL_IR_EVT,
+    ESP_GAP_BLE_LOCAL_ER_EVT,
+    ESP_GAP_BLE_NC_REQ_EVT,
+    ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT,
+    ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT,
+    ESP_GAP_BLE_SET_STATIC_RAND_ADDR_EVT,
+    ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT,
+    ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT,
+    ESP_GAP_BLE_EVT_MAX = 60,
+} esp_gap_ble_cb_event_t;
+
+typedef enum
+{
+    ADV_TYPE_IND = 0,
+} esp_ble_adv_type_t;
+
+#define BLE_ADDR_TYPE_PUBLIC (0)
+#define ADV_CHNL_ALL (7)
+#define ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY (0)
+
+typedef struct
+{
+    uint16_t adv_int_min;
+    uint16_t adv_int_max;
+    esp_ble_adv_type_t adv_type;
+    esp_ble_addr_type_t own_addr_type;
+    esp_bd_addr_t peer_addr;
+    esp_ble_addr_type_t peer_addr_type;
+    uint8_t channel_map;
+    uint8_t adv_filter_policy;
+} esp_ble_adv_params_t;
+
+typedef struct
+{
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_ble_conn_update_params_t;
+
+typedef union
+{
+    struct
+    {
+        esp_bt_status_t status;
+    } adv_data_raw_cmpl;
+    struct
+    {
+        esp_bt_status_t status;
+    } scan_rsp_data_raw_cmpl;
+    struct
+    {
+        esp_bt_status_t status;
+    } adv_start_cmpl;
+    struct
+    {
+        esp_bt_status_t status;
+    } adv_stop_cmpl;
+    struct
+    {
+        esp_bt_status_t status;
+        esp_bd_addr_t bda;
+        uint16_t min_int;
+        uint16_t max_int;
+        uint16_t latency;
+        uint16_t conn_int;
+        uint16_t timeout;
+    } update_conn_params;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback);
+esp_err_t esp_ble_gap_set_device_name(const char* name);
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t* raw_data, uint32_t raw_data_len);
+esp_err_t esp_ble_gap_config_scan_rsp_data_raw(uint8_t* raw_data, uint32_t raw_data_len);
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t* adv_params);
+esp_err_t esp_ble_gap_stop_advertising(void);
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t* params);
+
+#endif /* TEST_HOST_SHIM_ESP_GAP_BLE_API_H_ */
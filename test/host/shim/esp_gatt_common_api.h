@@ -0,0 +1,12 @@
+#ifndef TEST_HOST_SHIM_ESP_GATT_COMMON_API_H_
+#define TEST_HOST_SHIM_ESP_GATT_COMMON_API_H_
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "Bluedroid header included in a NimBLE build"
+#endif
+
+#include "esp_gatt_defs.h"
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu);
+
+#endif /* TEST_HOST_SHIM_ESP_GATT_COMMON_API_H_ */
@@ -0,0 +1,98 @@
+#ifndef TEST_HOST_SHIM_ESP_GATT_DEFS_H_
+#define TEST_HOST_SHIM_ESP_GATT_DEFS_H_
+
+#ifdef CONFIG_BT_NIMBLE_ENABLED
+#error "Bluedroid header included in a NimBLE build"
+#endif
+
+#include "esp_bt_defs.h"
+
+#define ESP_GATT_UUID_PRI_SERVICE (0x2800)
+#define ESP_GATT_UUID_CHAR_DECLARE (0x2803)
+#define ESP_GATT_UUID_CHAR_DESCRIPTION (0x2901)
+#define ESP_GATT_UUID_CHAR_CLIENT_CONFIG (0x2902)
+#define ESP_GATT_UUID_GATT_SRV_CHGD (0x2A05)
+
+#define ESP_GATT_PERM_READ (1 << 0)
+#define ESP_GATT_PERM_READ_ENCRYPTED (1 << 1)
+#define ESP_GATT_PERM_READ_ENC_MITM (1 << 2)
+#define ESP_GATT_PERM_WRITE (1 << 4)
+#define ESP_GATT_PERM_WRITE_ENCRYPTED (1 << 5)
+#define ESP_GATT_PERM_WRITE_ENC_MITM (1 << 6)
+
+#define ESP_GATT_CHAR_PROP_BIT_READ (1 << 1)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE_NR (1 << 2)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE (1 << 3)
+#define ESP_GATT_CHAR_PROP_BIT_NOTIFY (1 << 4)
+#define ESP_GATT_CHAR_PROP_BIT_INDICATE (1 << 5)
+
+#define ESP_GATT_RSP_BY_APP (0)
+#define ESP_GATT_AUTO_RSP (1)
+
+#define ESP_GATT_MAX_ATTR_LEN (600)
+#define ESP_GATT_DEF_BLE_MTU_SIZE (23)
+#define ESP_GATT_IF_NONE (0xff)
+
+#define ESP_GATT_PREP_WRITE_CANCEL (0x00)
+#define ESP_GATT_PREP_WRITE_EXEC (0x01)
+
+typedef uint8_t esp_gatt_if_t;
+typedef uint16_t esp_gatt_perm_t;
+typedef uint8_t esp_gatt_char_prop_t;
+
+// the values are the ATT error codes, except for the ones above 0x80
+typedef enum
+{
+    ESP_GATT_OK = 0x00,
+    ESP_GATT_INVALID_HANDLE = 0x01,
+    ESP_GATT_READ_NOT_PERMIT = 0x02,
+    ESP_GATT_WRITE_NOT_PERMIT = 0x03,
+    ESP_GATT_INVALID_PDU = 0x04,
+    ESP_GATT_INVALID_OFFSET = 0x07,
+    ESP_GATT_PREPARE_Q_FULL = 0x09,
+    ESP_GATT_INVALID_ATTR_LEN = 0x0d,
+    ESP_GATT_ERR_UNLIKELY = 0x0e,
+    ESP_GATT_NO_RESOURCES = 0x80,
+    ESP_GATT_INTERNAL_ERROR = 0x81,
+    ESP_GATT_BUSY = 0x84,
+    ESP_GATT_CONGESTED = 0x8f,
+    ESP_GATT_OUT_OF_RANGE = 0xff,
+} esp_gatt_status_t;
+
+typedef struct
+{
+    uint8_t auto_rsp;
+} esp_attr_control_t;
+
+typedef struct
+{
+    uint16_t uuid_length;
+    uint8_t* uuid_p;
+    uint16_t perm;
+    uint16_t max_length;
+    uint16_t length;
+    uint8_t* value;
+} esp_attr_desc_t;
+
+typedef struct
+{
+    esp_attr_control_t attr_control;
+    esp_attr_desc_t att_desc;
+} esp_gatts_attr_db_t;
+
+typedef struct
+{
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t handle;
+    uint16_t offset;
+    uint16_t len;
+    uint8_t auth_req;
+} esp_gatt_value_t;
+
+typedef union
+{
+    esp_gatt_value_t attr_value;
+    uint16_t handle;
+} esp_gatt_rsp_t;
+
+#endif /* TEST_HOST_SHIM_ESP_GATT_DEFS_H_ */
@@ -0,0 +1,40 @@
+#ifndef TEST_HOST_SHIM_ESP_LOG_H_
+#define TEST_HOST_SHIM_ESP_LOG_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+typedef int (*vprintf_like_t)(const char* format, va_list arguments);
+
+/*
+ * Lines have the format of ESP-IDF, "L (timestamp) tag: message", and pass the hook set by esp_log_set_vprintf().
+ * The level applies to all tags, it defaults to ESP_LOG_WARN so that test output is not buried under INFO lines.
+ */
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+uint32_t esp_log_timestamp(void);
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOG_LINE(level, letter, tag, format, ...) \
+    esp_log_write(level, tag, letter " (%u) %s: " format "\n", (unsigned) esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LINE(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LINE(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LINE(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LINE(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LINE(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+#define ESP_EARLY_LOGE ESP_LOGE
+
+#endif /* TEST_HOST_SHIM_ESP_LOG_H_ */
@@ -0,0 +1,51 @@
+#ifndef TEST_HOST_SHIM_ESP_PARTITION_H_
+#define TEST_HOST_SHIM_ESP_PARTITION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0,
+    ESP_PARTITION_TYPE_DATA = 1,
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef enum
+{
+    ESP_PARTITION_MMAP_DATA,
+    ESP_PARTITION_MMAP_INST,
+} esp_partition_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct
+{
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+// the host has no partitions, finding one always fails
+const esp_partition_t* esp_partition_find_first(
+    esp_partition_type_t type,
+    esp_partition_subtype_t subtype,
+    const char* label);
+esp_err_t esp_partition_mmap(
+    const esp_partition_t* partition,
+    size_t offset,
+    size_t size,
+    esp_partition_mmap_memory_t memory,
+    const void** out_ptr,
+    spi_flash_mmap_handle_t* out_handle);
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
+
+#endif /* TEST_HOST_SHIM_ESP_PARTITION_H_ */
@@ -0,0 +1,50 @@
+#ifndef TEST_HOST_SHIM_FREERTOS_FREERTOS_H_
+#define TEST_HOST_SHIM_FREERTOS_FREERTOS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+/*
+ * portMUX spinlocks are spinlocks on the host as well: owned by one thread at a time and recursive for the owner, as
+ * on the ESP32. There are no interrupts, thus the ISR variants are the same.
+ */
+typedef struct
+{
+    volatile uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux) vPortExitCritical(mux)
+
+#define pdTRUE (1)
+#define pdFALSE (0)
+#define pdPASS (1)
+#define pdFAIL (0)
+
+// one tick per millisecond
+#define configTICK_RATE_HZ (1000)
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define portTICK_PERIOD_MS (1)
+#define portMAX_DELAY ((TickType_t) 0xffffffff)
+
+#define portYIELD_FROM_ISR(woken) (void) (woken)
+#define tskNO_AFFINITY (0x7fffffff)
+#define configMAX_PRIORITIES (25)
+#define xPortInIsrContext() (0)
+
+#endif /* TEST_HOST_SHIM_FREERTOS_FREERTOS_H_ */
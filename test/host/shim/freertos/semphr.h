@@ -0,0 +1,22 @@
+#ifndef TEST_HOST_SHIM_FREERTOS_SEMPHR_H_
+#define TEST_HOST_SHIM_FREERTOS_SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+typedef struct HostSemaphore* SemaphoreHandle_t;
+
+// storage of a mutex created by the static variants, checked to be large enough by HostPlatform.cpp
+typedef struct
+{
+    uint64_t storage[16];
+} StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t* buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore);
+
+#endif /* TEST_HOST_SHIM_FREERTOS_SEMPHR_H_ */
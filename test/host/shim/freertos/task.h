@@ -0,0 +1,40 @@
+#ifndef TEST_HOST_SHIM_FREERTOS_TASK_H_
+#define TEST_HOST_SHIM_FREERTOS_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* parameter);
+
+/*
+ * Tasks are detached threads, priorities, stack sizes and cores are ignored. Threads not created by xTaskCreate()
+ * (e.g. the main thread of a test) get a handle on their first call of xTaskGetCurrentTaskHandle() or
+ * ulTaskNotifyTake(), so that they can be notified as well.
+ */
+BaseType_t xTaskCreate(
+    TaskFunction_t function,
+    const char* name,
+    uint32_t stackDepth,
+    void* parameter,
+    UBaseType_t priority,
+    TaskHandle_t* createdTask);
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char* name,
+    uint32_t stackDepth,
+    void* parameter,
+    UBaseType_t priority,
+    TaskHandle_t* createdTask,
+    BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetHandle(const char* name);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+#endif /* TEST_HOST_SHIM_FREERTOS_TASK_H_ */
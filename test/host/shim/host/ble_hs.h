@@ -0,0 +1,265 @@
+#ifndef TEST_HOST_SHIM_HOST_BLE_HS_H_
+#define TEST_HOST_SHIM_HOST_BLE_HS_H_
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define BLE_ATT_MTU_DFLT (23)
+#define BLE_ATT_ATTR_MAX_LEN (512)
+
+#define BLE_ATT_ERR_INVALID_HANDLE (0x01)
+#define BLE_ATT_ERR_READ_NOT_PERMITTED (0x02)
+#define BLE_ATT_ERR_WRITE_NOT_PERMITTED (0x03)
+#define BLE_ATT_ERR_INVALID_OFFSET (0x07)
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN (0x0d)
+#define BLE_ATT_ERR_UNLIKELY (0x0e)
+#define BLE_ATT_ERR_INSUFFICIENT_RES (0x11)
+
+#define BLE_ATT_F_READ (0x01)
+#define BLE_ATT_F_WRITE (0x02)
+
+// a single buffer instead of a chain, large enough for any attribute value
+struct os_mbuf
+{
+    uint16_t om_len;
+    uint8_t om_data[BLE_ATT_ATTR_MAX_LEN];
+};
+
+uint16_t os_mbuf_pktlen(const struct os_mbuf* om);
+int os_mbuf_append(struct os_mbuf* om, const void* data, uint16_t len);
+int ble_hs_mbuf_to_flat(const struct os_mbuf* om, void* flat, uint16_t max_len, uint16_t* out_copy_len);
+struct os_mbuf* ble_hs_mbuf_from_flat(const void* buf, uint16_t len);
+
+#define OS_MBUF_PKTLEN(om) os_mbuf_pktlen(om)
+
+enum
+{
+    BLE_UUID_TYPE_16 = 16,
+    BLE_UUID_TYPE_32 = 32,
+    BLE_UUID_TYPE_128 = 128,
+};
+
+typedef struct
+{
+    uint8_t type;
+} ble_uuid_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint16_t value;
+} ble_uuid16_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint32_t value;
+} ble_uuid32_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint8_t value[16];
+} ble_uuid128_t;
+
+int ble_att_set_preferred_mtu(uint16_t mtu);
+
+#define BLE_GATT_ACCESS_OP_READ_CHR (0)
+#define BLE_GATT_ACCESS_OP_WRITE_CHR (1)
+#define BLE_GATT_ACCESS_OP_READ_DSC (2)
+#define BLE_GATT_ACCESS_OP_WRITE_DSC (3)
+
+#define BLE_GATT_SVC_TYPE_END (0)
+#define BLE_GATT_SVC_TYPE_PRIMARY (1)
+
+#define BLE_GATT_CHR_F_BROADCAST (0x0001)
+#define BLE_GATT_CHR_F_READ (0x0002)
+#define BLE_GATT_CHR_F_WRITE_NO_RSP (0x0004)
+#define BLE_GATT_CHR_F_WRITE (0x0008)
+#define BLE_GATT_CHR_F_NOTIFY (0x0010)
+#define BLE_GATT_CHR_F_INDICATE (0x0020)
+#define BLE_GATT_CHR_F_READ_ENC (0x0200)
+#define BLE_GATT_CHR_F_READ_AUTHEN (0x0400)
+#define BLE_GATT_CHR_F_WRITE_ENC (0x1000)
+#define BLE_GATT_CHR_F_WRITE_AUTHEN (0x2000)
+
+typedef uint16_t ble_gatt_chr_flags;
+
+struct ble_gatt_access_ctxt;
+
+typedef int ble_gatt_access_fn(
+    uint16_t conn_handle,
+    uint16_t attr_handle,
+    struct ble_gatt_access_ctxt* ctxt,
+    void* arg);
+
+struct ble_gatt_dsc_def
+{
+    const ble_uuid_t* uuid;
+    uint8_t att_flags;
+    uint8_t min_key_size;
+    ble_gatt_access_fn* access_cb;
+    void* arg;
+};
+
+struct ble_gatt_chr_def
+{
+    const ble_uuid_t* uuid;
+    ble_gatt_access_fn* access_cb;
+    void* arg;
+    struct ble_gatt_dsc_def* descriptors;
+    ble_gatt_chr_flags flags;
+    uint8_t min_key_size;
+    uint16_t* val_handle;
+};
+
+struct ble_gatt_svc_def
+{
+    uint8_t type;
+    const ble_uuid_t* uuid;
+    const struct ble_gatt_svc_def** includes;
+    const struct ble_gatt_chr_def* characteristics;
+};
+
+struct ble_gatt_access_ctxt
+{
+    uint8_t op;
+    struct os_mbuf* om;
+    union
+    {
+        const struct ble_gatt_chr_def* chr;
+        const struct ble_gatt_dsc_def* dsc;
+    };
+};
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def* defs);
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def* svcs);
+int ble_gatts_find_svc(const ble_uuid_t* uuid, uint16_t* out_handle);
+
+// both take ownership of the buffer, also if sending fails
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf* om);
+int ble_gattc_indicate_custom(uint16_t conn_handle, uint16_t chr_val_handle, struct os_mbuf* txom);
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+struct ble_gap_conn_desc
+{
+    uint16_t conn_handle;
+    ble_addr_t peer_id_addr;
+};
+
+#define BLE_GAP_EVENT_CONNECT (0)
+#define BLE_GAP_EVENT_DISCONNECT (1)
+#define BLE_GAP_EVENT_CONN_UPDATE (3)
+#define BLE_GAP_EVENT_ADV_COMPLETE (9)
+#define BLE_GAP_EVENT_NOTIFY_TX (13)
+#define BLE_GAP_EVENT_SUBSCRIBE (14)
+#define BLE_GAP_EVENT_MTU (15)
+
+struct ble_gap_event
+{
+    uint8_t type;
+    union
+    {
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } connect;
+        struct
+        {
+            int reason;
+            struct ble_gap_conn_desc conn;
+        } disconnect;
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } conn_update;
+        struct
+        {
+            int reason;
+        } adv_complete;
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t reason;
+            uint8_t prev_notify:1;
+            uint8_t cur_notify:1;
+            uint8_t prev_indicate:1;
+            uint8_t cur_indicate:1;
+        } subscribe;
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t channel_id;
+            uint16_t value;
+        } mtu;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event* event, void* arg);
+
+struct ble_gap_adv_params
+{
+    uint8_t conn_mode;
+    uint8_t disc_mode;
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+    uint8_t channel_map;
+    uint8_t filter_policy;
+    uint8_t high_duty_cycle:1;
+};
+
+struct ble_gap_upd_params
+{
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+    uint16_t latency;
+    uint16_t supervision_timeout;
+    uint16_t min_ce_len;
+    uint16_t max_ce_len;
+};
+
+#define BLE_GAP_CONN_MODE_NON (0)
+#define BLE_GAP_CONN_MODE_DIR (1)
+#define BLE_GAP_CONN_MODE_UND (2)
+#define BLE_GAP_DISC_MODE_NON (0)
+#define BLE_GAP_DISC_MODE_LTD (1)
+#define BLE_GAP_DISC_MODE_GEN (2)
+#define BLE_HCI_ADV_FILT_NONE (0)
+#define BLE_HS_FOREVER (INT32_MAX)
+#define BLE_ERR_REM_USER_CONN_TERM (0x13)
+
+int ble_gap_adv_set_data(const uint8_t* data, int data_len);
+int ble_gap_adv_rsp_set_data(const uint8_t* data, int data_len);
+int ble_gap_adv_start(
+    uint8_t own_addr_type,
+    const ble_addr_t* direct_addr,
+    int32_t duration_ms,
+    const struct ble_gap_adv_params* adv_params,
+    ble_gap_event_fn* cb,
+    void* cb_arg);
+int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params* params);
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason);
+int ble_hs_id_infer_auto(int privacy, uint8_t* out_addr_type);
+
+typedef void ble_hs_reset_fn(int reason);
+typedef void ble_hs_sync_fn(void);
+
+struct ble_hs_cfg
+{
+    ble_hs_reset_fn* reset_cb;
+    ble_hs_sync_fn* sync_cb;
+};
+
+extern struct ble_hs_cfg ble_hs_cfg;
+
+#endif /* TEST_HOST_SHIM_HOST_BLE_HS_H_ */
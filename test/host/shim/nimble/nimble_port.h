@@ -0,0 +1,10 @@
+#ifndef TEST_HOST_SHIM_NIMBLE_NIMBLE_PORT_H_
+#define TEST_HOST_SHIM_NIMBLE_NIMBLE_PORT_H_
+
+#include "esp_err.h"
+
+esp_err_t nimble_port_init(void);
+void nimble_port_run(void);
+int nimble_port_stop(void);
+
+#endif /* TEST_HOST_SHIM_NIMBLE_NIMBLE_PORT_H_ */
@@ -0,0 +1,9 @@
+#ifndef TEST_HOST_SHIM_NIMBLE_NIMBLE_PORT_FREERTOS_H_
+#define TEST_HOST_SHIM_NIMBLE_NIMBLE_PORT_FREERTOS_H_
+
+#include "freertos/FreeRTOS.h"
+
+void nimble_port_freertos_init(void (*host_task_fn)(void* parameter));
+void nimble_port_freertos_deinit(void);
+
+#endif /* TEST_HOST_SHIM_NIMBLE_NIMBLE_PORT_FREERTOS_H_ */
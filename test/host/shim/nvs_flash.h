@@ -0,0 +1,9 @@
+#ifndef TEST_HOST_SHIM_NVS_FLASH_H_
+#define TEST_HOST_SHIM_NVS_FLASH_H_
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#endif /* TEST_HOST_SHIM_NVS_FLASH_H_ */
@@ -0,0 +1,9 @@
+#ifndef TEST_HOST_SHIM_SDKCONFIG_H_
+#define TEST_HOST_SHIM_SDKCONFIG_H_
+
+/*
+ * Host builds take the Kconfig defaults of the sources, options are passed as compile definitions by CMakeLists.txt
+ * instead (e.g. CONFIG_BT_NIMBLE_ENABLED for the NimBLE flavour of the library).
+ */
+
+#endif /* TEST_HOST_SHIM_SDKCONFIG_H_ */
@@ -0,0 +1,10 @@
+#ifndef TEST_HOST_SHIM_SERVICES_GAP_BLE_SVC_GAP_H_
+#define TEST_HOST_SHIM_SERVICES_GAP_BLE_SVC_GAP_H_
+
+#include <stdint.h>
+
+void ble_svc_gap_init(void);
+int ble_svc_gap_device_name_set(const char* name);
+int ble_svc_gap_device_appearance_set(uint16_t appearance);
+
+#endif /* TEST_HOST_SHIM_SERVICES_GAP_BLE_SVC_GAP_H_ */
@@ -0,0 +1,6 @@
+#ifndef TEST_HOST_SHIM_SERVICES_GATT_BLE_SVC_GATT_H_
+#define TEST_HOST_SHIM_SERVICES_GATT_BLE_SVC_GATT_H_
+
+void ble_svc_gatt_init(void);
+
+#endif /* TEST_HOST_SHIM_SERVICES_GATT_BLE_SVC_GATT_H_ */
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Compile a JSON description of a GATT database into the binary schema read by main/GattSchema.cpp.
+
+Example schema:
+
+    {
+        "services": [
+            {
+                "uuid": "0x21040001",
+                "advertise": true,
+                "characteristics": [
+                    {
+                        "uuid": "0x4020",
+                        "permission": ["read", "write"],
+                        "notification": "notify",
+                        "length": 2,
+                        "value": [0x42, 0x41],
+                        "description": "Foo"
+                    }
+                ]
+            }
+        ]
+    }
+
+UUIDs are given as "0x1234", "0x12345678" or in the canonical 128 bit form. A value is either a list of bytes or a
+string. Flash the result into the data partition labeled "gatt_schema", i.e.
+
+    parttool.py write_partition --partition-name gatt_schema --input schema.bin
+
+Use "check" to validate a binary schema and list its content.
+"""
+
+import argparse
+import json
+import struct
+import sys
+import uuid as uuidlib
+import zlib
+
+MAGIC = b"GSCH"
+VERSION = 1
+HEADER_LENGTH = 16
+VALUE_LENGTH_MAX = 512
+
+# ESP_GATT_PERM_READ and ESP_GATT_PERM_WRITE, GattsService supports neither encrypted nor signed access
+PERMISSIONS = {
+    "read": 0x0001,
+    "write": 0x0010,
+}
+UNSUPPORTED_PERMISSIONS = (
+    "read_encrypted", "read_enc_mitm", "write_encrypted", "write_enc_mitm", "write_signed", "write_signed_mitm")
+
+NOTIFICATIONS = {"none": 0, "notify": 1, "indicate": 2}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def pad(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def encode_uuid(text):
+    text = str(text)
+    if text.lower().startswith("0x"):
+        value = int(text, 16)
+        if value <= 0xFFFF:
+            return 2, struct.pack("<I", value)
+        if value <= 0xFFFFFFFF:
+            return 4, struct.pack("<I", value)
+        raise SchemaError("UUID out of range: %s" % text)
+    return 16, uuidlib.UUID(text).bytes[::-1]
+
+
+def encode_value(value):
+    if value is None:
+        return b""
+    if isinstance(value, str):
+        return value.encode("utf-8")
+    return bytes(value)
+
+
+def encode_characteristic(characteristic):
+    uuid_length, uuid = encode_uuid(characteristic["uuid"])
+    permission = 0
+    for name in characteristic.get("permission", ["read"]):
+        if name in UNSUPPORTED_PERMISSIONS:
+            raise SchemaError("unsupported permission: %s" % name)
+        if name not in PERMISSIONS:
+            raise SchemaError("unknown permission: %s" % name)
+        permission |= PERMISSIONS[name]
+    notification = NOTIFICATIONS[characteristic.get("notification", "none")]
+    value = encode_value(characteristic.get("value"))
+    length = characteristic.get("length", len(value))
+    if not 0 < length <= VALUE_LENGTH_MAX or len(value) > length:
+        raise SchemaError("invalid length of characteristic %s" % characteristic["uuid"])
+    description = characteristic.get("description")
+    description = description.encode("utf-8") + b"\0" if description else b""
+
+    header = struct.pack(
+        "<BBHHHHH", uuid_length, notification, permission, length, len(value), len(description), 0)
+    return header + uuid + pad(value) + pad(description)
+
+
+def compile_schema(document):
+    body = b""
+    services = document["services"]
+    if len(services) > 255:
+        raise SchemaError("too many services")
+    for service in services:
+        characteristics = service["characteristics"]
+        if not 0 < len(characteristics) <= 255:
+            raise SchemaError("invalid number of characteristics in service %s" % service["uuid"])
+        uuid_length, uuid = encode_uuid(service["uuid"])
+        flags = 0x01 if service.get("advertise", True) else 0x00
+        body += struct.pack("<BBBB", uuid_length, flags, len(characteristics), 0) + uuid
+        for characteristic in characteristics:
+            body += encode_characteristic(characteristic)
+
+    header = MAGIC + struct.pack(
+        "<BBHII", VERSION, len(services), 0, HEADER_LENGTH + len(body), zlib.crc32(body) & 0xFFFFFFFF)
+    return header + body
+
+
+def format_uuid(uuid_length, uuid):
+    if uuid_length == 16:
+        return str(uuidlib.UUID(bytes=bytes(uuid[::-1])))
+    return "0x%0*x" % (uuid_length * 2, struct.unpack("<I", uuid)[0])
+
+
+def check_schema(data):
+    """Mirrors GattSchema::GattSchema(), returns a list of lines describing the schema."""
+    if len(data) < HEADER_LENGTH or data[:4] != MAGIC:
+        raise SchemaError("not a GATT schema")
+    version, number_of_services, _, length, crc = struct.unpack_from("<BBHII", data, 4)
+    if version != VERSION:
+        raise SchemaError("unsupported GATT schema version")
+    if not HEADER_LENGTH <= length <= len(data):
+        raise SchemaError("invalid GATT schema length")
+    data = data[:length]
+    if zlib.crc32(data[HEADER_LENGTH:]) & 0xFFFFFFFF != crc:
+        raise SchemaError("GATT schema checksum mismatch")
+
+    def take(offset, count):
+        if offset + count > length:
+            raise SchemaError("truncated GATT schema")
+        return data[offset:offset + count], offset + count
+
+    def take_uuid(offset, uuid_length):
+        if uuid_length not in (2, 4, 16):
+            raise SchemaError("invalid UUID length in GATT schema")
+        return take(offset, 16 if uuid_length == 16 else 4)
+
+    lines = []
+    offset = HEADER_LENGTH
+    for _ in range(number_of_services):
+        record, offset = take(offset, 4)
+        uuid_length, flags, number_of_characteristics, _ = struct.unpack("<BBBB", record)
+        if not number_of_characteristics:
+            raise SchemaError("service without characteristics in GATT schema")
+        uuid, offset = take_uuid(offset, uuid_length)
+        lines.append("service %s%s" % (format_uuid(uuid_length, uuid), "" if flags & 0x01 else " (not advertised)"))
+        for _ in range(number_of_characteristics):
+            record, offset = take(offset, 12)
+            uuid_length, notification, permission, value_length, initial_length, description_length, _ = \
+                struct.unpack("<BBHHHHH", record)
+            if notification > 2:
+                raise SchemaError("invalid notification in GATT schema")
+            if permission & ~(PERMISSIONS["read"] | PERMISSIONS["write"]):
+                raise SchemaError("unsupported permission in GATT schema")
+            if not 0 < value_length <= VALUE_LENGTH_MAX or initial_length > value_length:
+                raise SchemaError("invalid value length in GATT schema")
+            uuid, offset = take_uuid(offset, uuid_length)
+            value, offset = take(offset, initial_length + (-initial_length % 4))
+            description = ""
+            if description_length:
+                text, offset = take(offset, description_length + (-description_length % 4))
+                if text[description_length - 1] != 0:
+                    raise SchemaError("unterminated description in GATT schema")
+                description = text[:description_length - 1].decode("utf-8")
+            lines.append("  characteristic %s permission=0x%04x notification=%d length=%d value=%s %s" % (
+                format_uuid(uuid_length, uuid), permission, notification, value_length,
+                value[:initial_length].hex(), description))
+    if offset != length:
+        raise SchemaError("trailing data in GATT schema")
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+    compile_parser = commands.add_parser("compile", help="compile a JSON schema")
+    compile_parser.add_argument("input")
+    compile_parser.add_argument("output")
+    check_parser = commands.add_parser("check", help="validate and list a binary schema")
+    check_parser.add_argument("input")
+    arguments = parser.parse_args()
+
+    try:
+        if arguments.command == "compile":
+            with open(arguments.input) as input_file:
+                schema = compile_schema(json.load(input_file))
+            check_schema(schema)
+            with open(arguments.output, "wb") as output_file:
+                output_file.write(schema)
+            print("%s: %d bytes" % (arguments.output, len(schema)))
+        elif arguments.command == "check":
+            with open(arguments.input, "rb") as input_file:
+                print("\n".join(check_schema(input_file.read())))
+        else:
+            parser.print_help()
+            return 2
+    except (SchemaError, KeyError, ValueError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())